@@ -17,7 +17,7 @@
 void sdl_init();	// initialize SDL
 SDL_Window* sdl_create_window(const char* title, uint32_t pixel_size);	// create an SDL window
 SDL_Renderer* sdl_create_renderer(SDL_Window* host);	// create an SDL renderer
-bool sdl_draw(SDL_Renderer* renderer, uint32_t pixel_size);	// draw to and present renderer. Returns false on error.
+bool sdl_draw(SDL_Renderer* renderer, uint32_t pixel_size);	// draw to and present renderer, uploading only damage. Returns false on error.
 
 void sdl_init()
 {
@@ -49,55 +49,24 @@ SDL_Renderer* sdl_create_renderer(SDL_Window* host)
 	return ren;
 }
 
-bool sdl_draw(SDL_Renderer* renderer, uint32_t pixel_size)
+// convert the pixels of 'rect' from the bound color buffer to 'target'. Returns false on error.
+bool sdl_upload(SDL_Texture* target, SDL_Rect* rect, SDL_PixelFormat* format)
 {
-	if(!_brcontext)
-		return false;	// no bound context
-	
-	int render_width = 0;
-	int render_height = 0;
-	
-	int result = SDL_GetRendererOutputSize(renderer, &render_width, &render_height);
-	if(result != 0)
-	{
-		printf("sdl_draw: couldn't get renderer dimensions\n");
-		return false;	// could not get renderer dimensions
-	}
-		
-	int render_pixel_width = render_width / pixel_size;
-	int render_pixel_height = render_height / pixel_size;
-	
-	if(_brcontext->rb_width != render_pixel_width || _brcontext->rb_height != render_pixel_height)
-	{
-		printf("sdl_draw: incompatible buffer dimensions\n");
-		return false;		// buffer incompatible with renderer
-	}
-		
-	SDL_Texture* target = NULL;
-	target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
-		render_pixel_width, render_pixel_height);
-	
-	if(!target)
-	{
-		printf("sdl_draw: failed to create target texture\n");
-		return false;	// failed to create target texture
-	}
-		
 	Uint32* pixels = NULL;
-	int pitch = render_pixel_width * 4;
+	int pitch = rect->w * 4;
 	
-	// lock target
-	if(SDL_LockTexture(target, NULL, (void**)&pixels, &pitch) != 0)
+	// lock the rect of target
+	if(SDL_LockTexture(target, rect, (void**)&pixels, &pitch) != 0)
 	{
 		printf("sdl_draw: failed to lock target texture\n");
 		return false;
 	}
-		
+	
 	// map pixels from buffer to target
-	for(int y = 0; y < render_pixel_height; y += 1)
-		for(int x = 0; x < render_pixel_width; x += 1)
+	for(int y = 0; y < rect->h; y += 1)
+		for(int x = 0; x < rect->w; x += 1)
 		{
-			uint32_t index = x + y * render_pixel_width;
+			uint32_t index = (rect->x + x) + (rect->y + y) * _brcontext->rb_pitch;
 			uint32_t col = 0;
 			
 			uint32_t r = 0;
@@ -105,7 +74,7 @@ bool sdl_draw(SDL_Renderer* renderer, uint32_t pixel_size)
 			uint32_t b = 0;
 			
 			Uint32* p = 
-				&pixels[index];
+				&pixels[x + y * (pitch / 4)];
 				
 			switch(_brcontext->cb_type)
 			{
@@ -114,24 +83,102 @@ bool sdl_draw(SDL_Renderer* renderer, uint32_t pixel_size)
 					r = _BR_R8G8B8A8_R(col);
 					g = _BR_R8G8B8A8_G(col);
 					b = _BR_R8G8B8A8_B(col);
-					*p = SDL_MapRGB(SDL_AllocFormat(SDL_PIXELFORMAT_RGBA8888),
-						r, g, b);
+					*p = SDL_MapRGB(format, r, g, b);
 					break;
 				case BR_R5G5B5A1:
 					col = ( (uint16_t*)_brcontext->cb ) [index];
 					r = _BR_R5G5B5A1_R(col)*8.22580645161f;
 					g = _BR_R5G5B5A1_G(col)*8.22580645161f;
 					b = _BR_R5G5B5A1_B(col)*8.22580645161f;
-					*p = SDL_MapRGB(SDL_AllocFormat(SDL_PIXELFORMAT_RGBA8888),
-						r, g, b);
+					*p = SDL_MapRGB(format, r, g, b);
 					break;
 				default:
 					printf("2sdl error: color buffer not R8G8B8A8\n");
+					SDL_UnlockTexture(target);
 					return false;
 			}
 		}
 		
 	SDL_UnlockTexture(target);
+	return true;
+}
+
+bool sdl_draw(SDL_Renderer* renderer, uint32_t pixel_size)
+{
+	if(!_brcontext)
+		return false;	// no bound context
+	
+	int render_width = 0;
+	int render_height = 0;
+	
+	int result = SDL_GetRendererOutputSize(renderer, &render_width, &render_height);
+	if(result != 0)
+	{
+		printf("sdl_draw: couldn't get renderer dimensions\n");
+		return false;	// could not get renderer dimensions
+	}
+		
+	int render_pixel_width = render_width / pixel_size;
+	int render_pixel_height = render_height / pixel_size;
+	
+	if(_brcontext->rb_width != render_pixel_width || _brcontext->rb_height != render_pixel_height)
+	{
+		printf("sdl_draw: incompatible buffer dimensions\n");
+		return false;		// buffer incompatible with renderer
+	}
+	
+	// the target texture is kept between draws, so that only the damaged rects (see brGetDamage) 
+	// need uploading; it is (re)created, and uploaded whole, when the renderer or dimensions change
+	static SDL_Texture* target = NULL;
+	static SDL_Renderer* target_renderer = NULL;
+	static int target_width = 0;
+	static int target_height = 0;
+	bool whole = false;
+	
+	if(!target || target_renderer != renderer || target_width != render_pixel_width || target_height != render_pixel_height)
+	{
+		if(target)
+			SDL_DestroyTexture(target);
+		target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+			render_pixel_width, render_pixel_height);
+		target_renderer = renderer;
+		target_width = render_pixel_width;
+		target_height = render_pixel_height;
+		whole = true;
+	}
+	
+	if(!target)
+	{
+		printf("sdl_draw: failed to create target texture\n");
+		return false;	// failed to create target texture
+	}
+	
+	brrect damage[BR_MAX_DAMAGE_RECTS];
+	uint32_t damage_count = whole ? 0 : brGetDamage(damage, BR_MAX_DAMAGE_RECTS);
+	SDL_PixelFormat* format = SDL_AllocFormat(SDL_PIXELFORMAT_RGBA8888);
+	bool uploaded = true;
+	
+	if(whole)
+	{
+		SDL_Rect rect = { 0, 0, render_pixel_width, render_pixel_height };
+		uploaded = sdl_upload(target, &rect, format);
+	}
+	for(uint32_t i = 0; i < damage_count && uploaded; i += 1)
+	{
+		SDL_Rect rect = { damage[i].x, damage[i].y, damage[i].width, damage[i].height };
+		
+		// damage may predate the bound color buffer; clamp to it
+		if(rect.x + rect.w > render_pixel_width)
+			rect.w = render_pixel_width - rect.x;
+		if(rect.y + rect.h > render_pixel_height)
+			rect.h = render_pixel_height - rect.y;
+		if(rect.w > 0 && rect.h > 0)
+			uploaded = sdl_upload(target, &rect, format);
+	}
+	SDL_FreeFormat(format);
+	if(!uploaded)
+		return false;
+	brClearDamage();
 	
 	SDL_Rect dst;
 	dst.x = 0, dst.y = 0;
@@ -27,10 +27,43 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#ifdef BR_ENABLE_STATISTICS
+#include <time.h>
+#endif
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#endif
 
 #define BR_VERSION_STRING "1.0"
 
 #define BR_NUM_TEXTURE_UNITS 256
+#define BR_SETUP_BATCH_SIZE 16		// triangles (or lines) set up per block
+#define BR_SPLAT_BATCH_SIZE 64		// point cloud points transformed per block
+#define BR_RENDERBUFFER_ALIGNMENT 64	// byte alignment of allocated renderbuffers
+#define BR_ROW_ALIGNMENT 16			// rows of allocated renderbuffers are padded to a multiple of this many pixels
+#define BR_SMALL_TRIANGLE_SIZE 4	// triangles with bounding boxes this many pixels or less skip the scanline rasterizer
+#define BR_STREAM_VERTICES 64		// vertices fetched at a time by streamed (single instance) draws
+#define BR_HUGE_PAGE_SIZE (2*1024*1024)	// allocations this size or larger use huge pages with brHugePageAllocator
+#define BR_MAX_SWAP_CHAIN_IMAGES 8	// images in a swap chain, at most (see brCreateSwapChain)
+#define BR_MAX_DAMAGE_RECTS 16		// damaged rects kept, at most (see brGetDamage); more are merged
+#define BR_COMMAND_RING_SIZE (1024*1024)	// default bytes of a render thread's command ring (see brStartRenderThread)
+#define BR_MAX_JOB_THREADS 256		// threads of the job scheduler, at most (see brJobThreads)
+#define BR_JOB_DEQUE_SIZE 1024		// jobs each job thread can queue; a power of two
+#define BR_JOB_ROWS 16				// rows per job of clears & resolves
+#define BR_JOB_VERTICES 256			// vertices per job of vertex fetch & shading
 
 #define BR_DOUBLE_BUFFER				0
 #define BR_DEPTH_WRITE					1
@@ -58,6 +91,9 @@
 #define BR_NORMAL_ARRAY					23
 #define BR_TEXCOORD_ARRAY				24
 
+// define BR_ENABLE_STATISTICS before including this header to gather pipeline statistics
+// (see brBeginQuery). when not defined, statistics counters compile out entirely.
+
 // windings
 #define BR_CW							25
 #define BR_CCW							26
@@ -127,6 +163,63 @@
 #define BR_VERTEX_COUNT					83
 #define BR_COLOR_COUNT					84
 
+// blend factors
+#define BR_ZERO							85
+#define BR_ONE							86
+#define BR_SRC_COLOR					87
+#define BR_ONE_MINUS_SRC_COLOR			88
+#define BR_DST_COLOR					89
+#define BR_ONE_MINUS_DST_COLOR			90
+#define BR_SRC_ALPHA					91
+#define BR_ONE_MINUS_SRC_ALPHA			92
+#define BR_DST_ALPHA					93
+#define BR_ONE_MINUS_DST_ALPHA			94
+// blend equations
+#define BR_FUNC_ADD						95
+#define BR_FUNC_SUBTRACT				96
+#define BR_FUNC_REVERSE_SUBTRACT		97
+#define BR_MIN							98
+#define BR_MAX							99
+#define BR_BLEND_SRC					100
+#define BR_BLEND_DST					101
+#define BR_BLEND_EQUATION				102
+#define BR_PIPELINE_STATISTICS			103	// query target
+#define BR_SAMPLES_PASSED				104	// query target
+#define BR_COLOR_WRITE					105	// capability; disable for depth-only rendering
+#define BR_INSTANCE_ID					106	// vertex shader attribute
+#define BR_INSTANCE_ATTRIBUTE			107	// vertex shader attribute
+#define BR_INSTANCE_ARRAY				108
+#define BR_TRIANGLE_STRIP				109	// primitive description types
+#define BR_TRIANGLE_FAN					110
+#define BR_LINE_STRIP					111
+#define BR_LINE_LOOP					112
+#define BR_PRIMITIVE_RESTART			113	// capability
+#define BR_PRIMITIVE_RESTART_INDEX		114	// render state
+#define BR_UNSIGNED_BYTE				115	// element types
+#define BR_UNSIGNED_SHORT				116
+#define BR_UNSIGNED_INT					117
+#define BR_LINE_WIDTH					118	// render state
+#define BR_FRONT_PITCH					119	// renderbuffer state
+#define BR_BACK_PITCH					120
+#define BR_MEMORY_STATE					121	// state type
+#define BR_ALLOCATED_BYTES				122	// memory state
+#define BR_PEAK_ALLOCATED_BYTES			123
+#define BR_SAMPLE_COUNT					124	// render state
+#define BR_SCISSOR_TEST					125	// capability
+#define BR_VIEWPORT						126	// render state
+#define BR_SCISSOR_BOX					127
+#define BR_ALREADY_SIGNALED				128	// brClientWaitSync results
+#define BR_CONDITION_SATISFIED			129
+#define BR_TIMEOUT_EXPIRED				130
+#define BR_JOBS							131	// capability
+#define BR_JOB_THREADS					132	// global state
+#define BR_TEXTURE_INDEX_ARRAY			133
+#define BR_CLAMP						134	// texture wrap modes
+#define BR_REPEAT						135
+#define BR_MIRROR						136
+
+#define BR_TIMEOUT_IGNORED				0xFFFFFFFFFFFFFFFF	// wait on a fence for as long as it takes
+
 #define BR_COLOR_BUFFER_BIT				0x80000000
 #define BR_DEPTH_BUFFER_BIT				0x40000000
 
@@ -186,6 +279,18 @@
 #define _BR_B2G3R3_G(x)			(uint8_t)((x & 0x38)>>3)
 #define _BR_B2G3R3_B(x)			(uint8_t)((x & 0xC0)>>6)
 
+// 8-bit blend unit macros
+// x*y/255, rounded, for x and y in 0-255
+#define _BR_MUL8(x,y)			((((x)*(y)+128) + (((x)*(y)+128)>>8))>>8)
+// 16.16 (0-1) to 0-255, clamped
+#define _BR_TO8(x)				(uint32_t)((x) >= 65536 ? 255 : ((x)*255)>>16)
+// 0-255 to the 16.16 value that converts back to it exactly
+#define _BR_FROM8(x)			(uint32_t)((x)*257 + ((x) != 0))
+// expand 5, 3 and 2 bit channels to 0-255
+#define _BR_EXPAND5(x)			(uint32_t)(((x)<<3) | ((x)>>2))
+#define _BR_EXPAND3(x)			(uint32_t)(((x)<<5) | ((x)<<2) | ((x)>>1))
+#define _BR_EXPAND2(x)			(uint32_t)((x)*85)
+
 // reciprocals, for removal of divisions
 // undefined at end of header
 #define _INV_65536	.00001525878f
@@ -194,6 +299,17 @@
 #define _INV_7		.14285714285f
 #define _INV_3		.33333333333f
 
+// statistics counters & timers (see BR_ENABLE_STATISTICS)
+#ifdef BR_ENABLE_STATISTICS
+#define _BR_STAT(counter,n)				do { if(_brcontext->query_statistics) __atomic_fetch_add(&_brcontext->statistics.counter, (n), __ATOMIC_RELAXED); } while(0)
+#define _BR_STAT_TIME(var)				uint64_t var = _brcontext->query_statistics ? _get_time_ns() : 0
+#define _BR_STAT_ELAPSED(counter,var)	do { if(_brcontext->query_statistics) __atomic_fetch_add(&_brcontext->statistics.counter, _get_time_ns() - var, __ATOMIC_RELAXED); } while(0)
+#else
+#define _BR_STAT(counter,n)				do {} while(0)
+#define _BR_STAT_TIME(var)
+#define _BR_STAT_ELAPSED(counter,var)	do {} while(0)
+#endif
+
 typedef struct brvec2 brvec2;
 typedef struct brvec3 brvec3;
 typedef struct brvec4 brvec4;
@@ -215,7 +331,126 @@ struct brmat4 {				// data[row][col]
 	float m00, m01, m02, m03, m10, m11, m12, m13, m20, m21, m22, m23, m30, m31, m32, m33;
 };
 
+// 16-byte aligned vectors & matrices; arrays of them never split a vector across cache lines (see brMat4Vec4Array)
+typedef brvec4 brvec4a __attribute__((aligned(16)));
+typedef brmat4 brmat4a __attribute__((aligned(16)));
+
+// pipeline statistics, gathered between brBeginQuery & brEndQuery (BR_PIPELINE_STATISTICS)
+typedef struct brstatistics brstatistics;
+struct brstatistics {
+	uint64_t vertices_shaded;		// vertices passed through _vertex_pass
+	uint64_t primitives_in;			// primitives assembled from drawn arrays
+	uint64_t primitives_culled;		// primitives culled (winding, zero area, outside frustum or no samples)
+	uint64_t primitives_clipped;	// primitives that needed clipping
+	uint64_t primitives_rasterized;	// (possibly clipped) primitives sent to the rasterizer
+	uint64_t fragments_generated;	// fragments generated before depth testing
+	uint64_t depth_passed;			// fragments passing the depth test
+	uint64_t depth_failed;			// fragments failing the depth test
+	uint64_t pixels_blended;		// pixels blended with the color buffer
+	uint64_t texture_fetches;		// texels fetched
+	uint64_t vertex_ns;				// nanoseconds spent in vertex shading
+	uint64_t setup_ns;				// nanoseconds spent in fetch, assembly, culling, clipping & setup
+	uint64_t raster_ns;				// nanoseconds spent in rasterization & fragment processing
+	uint64_t draw_ns;				// nanoseconds spent in draw calls (all of the above)
+};
+
+// memory allocation callbacks (see brSetAllocator)
+typedef struct brallocator brallocator;
+struct brallocator {
+	void* (*alloc)(size_t size, size_t alignment, void* user);	// return 'size' bytes aligned to 'alignment' (a power of two), or NULL
+	void (*free)(void* ptr, size_t size, void* user);			// release a block returned by alloc; 'size' is the size that was requested
+	void* user;													// passed to both callbacks
+};
+
+// a rect of pixels: columns [x, x+width) of rows [y, y+height)
+typedef struct brrect brrect;
+struct brrect {
+	int32_t x, y;
+	int32_t width, height;
+};
+
+// an image that can be both rendered to (see brBindSurface) & sampled as a texture (see brTextureSurface)
+// without conversion. pixels are packed in the format's layout, as in renderbuffers.
+typedef struct brsurface brsurface;
+struct brsurface {
+	void* data;					// pixels (or depths); row y starts 'y*pitch' pixels in
+	uint32_t format;			// pixel or depth format
+	uint32_t width, height;
+	uint32_t pitch;				// row pitch, in pixels
+};
+
+// swap chain image states, in shared memory (see brCreateSwapChain)
+#define _BR_IMAGE_FREE			0	// may be acquired for rendering
+#define _BR_IMAGE_RENDERING		1	// being rendered by the producer
+#define _BR_IMAGE_READY			2	// presented and not yet read
+#define _BR_IMAGE_READING		3	// being read by a consumer (see brAcquireFrame)
+
+#define _BR_SWAP_CHAIN_MAGIC	0x43535242	// "BRSC"
+#define _BR_SWAP_CHAIN_PAGE		4096		// images start on page boundaries, after a page holding the control block
+
+// control block at the start of a swap chain's shared memory. the image states are the only
+// fields written after creation; sequence[i] is written by the producer while it owns image i.
+typedef struct _swap_chain_shared_t _swap_chain_shared_t;
+struct _swap_chain_shared_t
+{
+	uint32_t magic;
+	uint32_t count;						// images in the chain
+	uint32_t width, height, pitch;		// image dimensions; pitch in pixels
+	uint32_t color_type, depth_type;	// depth_type is 0 if images have no depth buffer
+	uint64_t color_size;				// bytes from the start of an image to its depth buffer
+	uint64_t image_size;				// bytes from the start of an image to the next
+	uint64_t frame;						// frames presented
+	uint32_t state[BR_MAX_SWAP_CHAIN_IMAGES];
+	uint64_t sequence[BR_MAX_SWAP_CHAIN_IMAGES];	// frame number each image was presented as
+};
+
+// a chain of render targets in shared memory, used to hand finished frames to another process without copying.
+// the producer binds it with brBindSwapChain and presents with brSwapBuffers; consumers map it with brOpenSwapChain
+// and read frames with brAcquireFrame & brReleaseFrame. neither side ever blocks on the other.
+typedef struct brswapchain brswapchain;
+struct brswapchain
+{
+	int fd;							// file descriptor backing the chain; may be passed to another process
+	size_t size;					// bytes mapped
+	_swap_chain_shared_t* shared;	// control block, followed by the images
+};
+
+// a fence in a context's command stream (see brFenceSync); fences are signaled in the order they are made
+typedef uint64_t brsync;
+
+// a command run by a render thread (see brSubmit) with a copy of the data submitted with it
+typedef void (*brcommand)(void* data);
+
+// the render thread of a context (see brStartRenderThread). commands are written to a ring by the app thread
+// & read by the render thread without locks; the mutex & condition are only used to sleep when one waits on the other.
+typedef struct _render_thread_t _render_thread_t;
+struct _render_thread_t
+{
+#ifdef __linux__
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+	uint8_t* ring;
+	size_t ring_size;		// a power of two
+	uint64_t head;			// bytes ever written to the ring; written by the app thread
+	uint64_t tail;			// bytes ever read from the ring; written by the render thread
+	uint32_t sleepers;		// threads sleeping on cond
+	brsync* fence_signaled;	// last fence passed by the thread; the fence_signaled of its context
+	bool stop;				// whether or not the render thread is to exit once the ring is empty
+};
+
 // Bear context definition
+// memory accounting of a context (see BR_MEMORY_STATE). every block charged to a context references its account,
+// which is released with the last of them, so blocks may be freed after their context.
+typedef struct _alloc_account_t _alloc_account_t;
+struct _alloc_account_t
+{
+	uint64_t allocated_bytes;		// bytes currently allocated on behalf of the context
+	uint64_t peak_allocated_bytes;	// high-water mark of allocated_bytes
+	uint64_t references;			// the context & each block charged to it
+};
+
 typedef struct brcontext brcontext;
 struct brcontext
 {
@@ -225,15 +460,21 @@ struct brcontext
 	uint32_t db_type, db2_type;
 	uint32_t rb_width, rb_height;
 	uint32_t rb2_width, rb2_height;
+	uint32_t rb_pitch, rb2_pitch;		// row pitch of color & depth buffers, in pixels
 	brvec4 clear_color;
 	float clear_depth;
 	float point_radius;
+	float line_width;
 	bool double_buffer;
 	bool depth_write;
+	bool color_write;
 	bool depth_test;
 	bool persp_corr;
 	bool texture;
 	bool blend;
+	uint32_t blend_src;		// source blend factor
+	uint32_t blend_dst;		// destination blend factor
+	uint32_t blend_eq;		// blend equation
 	bool cull;
 	uint32_t cull_winding;
 	bool clip;
@@ -241,28 +482,55 @@ struct brcontext
 	bool scale_z;
 
 	uint32_t poly_mode;
+	bool primitive_restart;
+	uint32_t restart_index;		// element that restarts strips, fans & loops (BR_PRIMITIVE_RESTART)
 	bool vertex_array;
 	bool color_array;
 	bool normal_array;
 	bool tcoord_array;
+	bool texture_index_array;
 	
 	// vertex array attribute (byte) offsets
 	size_t vertex_stride;
 	size_t color_stride;
 	size_t normal_stride;
 	size_t tcoord_stride;
+	size_t texture_index_stride;
 	void* vertex_offset;
 	void* color_offset;
 	void* normal_offset;
 	void* tcoord_offset;
+	void* texture_index_offset;
 	uint32_t vertex_count;
 	uint32_t color_count;
+	
+	// instance array attribute (byte) offset & stride, advanced once per instance
+	bool instance_array;
+	size_t instance_stride;
+	void* instance_offset;
+	uint32_t instance_count;
+	uint32_t instance_id;		// instance being drawn
+	brvec4 instance_attrib;		// instance array attribute of the instance being drawn
+	
+	// point rasterization
+	struct _fragment_t* point_frag;	// fragment context shared by the points of the draw being drawn
+	uint32_t* point_spans;			// span table (see _point_span_table)
+	uint32_t point_span_radius;		// radius of the span table
+	
+	// point cloud splatting (see brBeginPointCloud)
+	uint64_t* splat_buffer;			// packed depth & color per pixel, while splatting
+	uint64_t* splat_storage;
+	size_t splat_size;
+	uint32_t splat_width;			// renderbuffer dimensions at brBeginPointCloud
+	uint32_t splat_height;
 
 	uint32_t texture_unit;
 	void* textures[BR_NUM_TEXTURE_UNITS];
 	uint32_t texture_widths[BR_NUM_TEXTURE_UNITS];
 	uint32_t texture_heights[BR_NUM_TEXTURE_UNITS];
 	uint32_t texture_formats[BR_NUM_TEXTURE_UNITS];
+	uint32_t texture_pitches[BR_NUM_TEXTURE_UNITS];		// row pitches of textures, in texels
+	uint32_t texture_wraps[BR_NUM_TEXTURE_UNITS][2];	// wrap modes of textures along s & t (see brTextureWrap)
 	bool texture_compressed_booleans[BR_NUM_TEXTURE_UNITS];
 
 	brvec4 (*vshader) (void* data, uint32_t* format, uint32_t attrib_count);	// current vertex shader
@@ -274,6 +542,8 @@ struct brcontext
 	bool sh_vtcoords;	// whether or not to pass vertex texture coordinates to vertex shader
 	bool sh_vnormals;	// whether or not to pass vertex normals to vertex shader
 	bool sh_vtype;		// whether or not to pass vertex type to vertex shader
+	bool sh_instance_id;		// whether or not to pass instance ID to vertex shader
+	bool sh_instance_attrib;	// whether or not to pass instance array attribute to vertex shader
 	/// fragment shader attributes
 	bool sh_prim_color;	// whether or not to pass primitive color to fragment shader
 	bool sh_tex_color;	// whether or not to pass texture color to fragment shader
@@ -282,9 +552,179 @@ struct brcontext
 	bool sh_bary_persp;		// whether or not to pass perspective-correct bary coords to fragment shader
 	bool sh_fposition;		// whether or not to pass pixel coordinates to fragment shader
 	bool sh_fdepth;			// whether or not to pass depth to fragment shader
+	
+	bool query_statistics;		// whether or not a BR_PIPELINE_STATISTICS query is active
+	brstatistics statistics;	// statistics of the current (or last) query
+	bool query_samples;			// whether or not a BR_SAMPLES_PASSED query is active
+	uint64_t samples_passed;	// samples passed of the current (or last) query
+	
+	uint32_t sample_count;		// samples per pixel (see brSampleCount)
+	uint32_t* msaa_color;		// per-sample R8G8B8A8 colors of the front set; NULL when not multisampling
+	uint32_t* msaa_depth;		// per-sample depths of the front set
+	size_t msaa_size;			// samples in each sample buffer
+	uint32_t* blend_span;		// scanline of 8-bit RGBA colors gathered for blending (see _raster_triangle)
+	uint8_t* blend_span_mask;	// which pixels of blend_span were written
+	uint32_t blend_span_width;	// pixels in blend_span; the width of the front set
+	struct brswapchain* swap_chain;	// bound swap chain (see brBindSwapChain), or NULL
+	int32_t swap_image;				// image of swap_chain bound as the front set, or -1
+	
+	brrect viewport;			// pixels normalized device coordinates map to (see brViewport); empty to use the front set
+	float viewport_center_x, viewport_center_y;		// viewport transform: raster = center + ndc * half (y flipped)
+	float viewport_half_width, viewport_half_height;
+	bool scissor_test;			// whether or not rasterization & clears are limited to scissor_rect
+	brrect scissor_rect;
+	bool redraw;				// whether or not rasterization & clears are limited to redraw_rect (see brRedrawRegion)
+	brrect redraw_rect;
+	int32_t clip_x0, clip_y0;	// pixels rasterized & cleared are within [clip_x0, clip_x1) x [clip_y0, clip_y1):
+	int32_t clip_x1, clip_y1;	// the front set, limited to scissor_rect and redraw_rect
+	int32_t draw_x0, draw_y0;	// bounds of the pixels touched by the current draw, [draw_x0, draw_x1) x [draw_y0, draw_y1)
+	int32_t draw_x1, draw_y1;
+	brrect damage[BR_MAX_DAMAGE_RECTS];	// rects damaged since brClearDamage; none overlap or touch
+	uint32_t damage_count;
+	
+	_render_thread_t* render_thread;	// render thread running the context's commands, or NULL
+	brsync fence_issued;				// last fence made (see brFenceSync)
+	brsync fence_signaled;				// last fence passed by the render thread
+	bool jobs;							// whether or not stages are split into jobs (see BR_JOBS)
+	
+	_alloc_account_t* account;		// memory allocated on behalf of this context (see BR_MEMORY_STATE)
 };
 static brcontext* _brcontext = NULL;	// current context
 
+// default allocation callbacks; aligned_alloc requires a size that is a multiple of the alignment.
+void* _br_default_alloc(size_t size, size_t alignment, void* user)
+{
+	(void)user;
+	return aligned_alloc(alignment, (size + alignment-1) & ~(alignment-1));
+}
+
+void _br_default_free(void* ptr, size_t size, void* user)
+{
+	(void)size;
+	(void)user;
+	free(ptr);
+}
+
+static brallocator _brallocator = { _br_default_alloc, _br_default_free, NULL };	// current allocator
+
+// every block allocated through _br_alloc is preceded by a header recording how to release it,
+// so blocks stay valid across brSetAllocator calls.
+typedef struct _alloc_header_t _alloc_header_t;
+struct _alloc_header_t
+{
+	void (*free)(void* ptr, size_t size, void* user);	// callback of the allocator the block came from
+	void* user;
+	size_t size;		// bytes requested by the caller
+	size_t offset;		// bytes from the start of the allocation to the block
+	_alloc_account_t* account;	// account the block was charged to, or NULL
+};
+
+// charge (or credit, for negative 'bytes') an account for memory allocated through _br_alloc.
+void _account_bytes(_alloc_account_t* account, int64_t bytes)
+{
+	uint64_t total = __atomic_add_fetch(&account->allocated_bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
+	uint64_t peak = __atomic_load_n(&account->peak_allocated_bytes, __ATOMIC_RELAXED);
+	while(total > peak && !__atomic_compare_exchange_n(&account->peak_allocated_bytes, &peak, total, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// allocate 'size' bytes aligned to 'alignment' (a power of two) with the current allocator.
+// not accounted to any context; see _br_alloc.
+void* _br_alloc_unaccounted(size_t size, size_t alignment)
+{
+	// the alignment stays a power of two
+	while(alignment < sizeof(_alloc_header_t))
+		alignment *= 2;
+	// the header sits just before the block, in an alignment-sized prefix
+	size_t offset = (sizeof(_alloc_header_t) + alignment-1) & ~(alignment-1);
+	uint8_t* base = (uint8_t*) _brallocator.alloc(size + offset, alignment, _brallocator.user);
+	if(!base)
+		return NULL;
+	_alloc_header_t* header = (_alloc_header_t*)(base + offset) - 1;
+	header->free = _brallocator.free;
+	header->user = _brallocator.user;
+	header->size = size;
+	header->offset = offset;
+	header->account = NULL;
+	return base + offset;
+}
+
+// return the size requested for a block allocated through _br_alloc.
+size_t _br_alloc_size(void* ptr)
+{
+	return ((_alloc_header_t*)ptr - 1)->size;
+}
+
+void _br_free_unaccounted(void* ptr)
+{
+	if(!ptr)
+		return;
+	_alloc_header_t* header = (_alloc_header_t*)ptr - 1;
+	header->free((uint8_t*)ptr - header->offset, header->size + header->offset, header->user);
+}
+
+// drop a reference to an account, freeing it with the last one.
+void _release_account(_alloc_account_t* account)
+{
+	if(__atomic_sub_fetch(&account->references, 1, __ATOMIC_ACQ_REL) == 0)
+		_br_free_unaccounted(account);
+}
+
+// allocate through the current allocator, accounting the block to the current context, if any.
+void* _br_alloc(size_t size, size_t alignment)
+{
+	void* ptr = _br_alloc_unaccounted(size, alignment);
+	if(ptr && _brcontext)
+	{
+		_alloc_account_t* account = _brcontext->account;
+		__atomic_add_fetch(&account->references, 1, __ATOMIC_RELAXED);
+		_account_bytes(account, size);
+		((_alloc_header_t*)ptr - 1)->account = account;
+	}
+	return ptr;
+}
+
+void* _br_malloc(size_t size)
+{
+	return _br_alloc(size, 16);
+}
+
+void* _br_calloc(size_t count, size_t size)
+{
+	if(size && count > SIZE_MAX / size)
+		return NULL;
+	void* ptr = _br_alloc(count * size, 16);
+	if(ptr)
+		memset(ptr, 0, count * size);
+	return ptr;
+}
+
+// free a block, crediting the context it was charged to.
+void _br_free(void* ptr)
+{
+	if(!ptr)
+		return;
+	_alloc_account_t* account = ((_alloc_header_t*)ptr - 1)->account;
+	if(account)
+	{
+		_account_bytes(account, -(int64_t)_br_alloc_size(ptr));
+		_release_account(account);
+	}
+	_br_free_unaccounted(ptr);
+}
+
+void* _br_realloc(void* ptr, size_t size)
+{
+	if(!ptr)
+		return _br_malloc(size);
+	void* data = _br_malloc(size);
+	if(!data)
+		return NULL;
+	size_t old_size = _br_alloc_size(ptr);
+	memcpy(data, ptr, old_size < size ? old_size : size);
+	_br_free(ptr);
+	return data;
+}
+
 float _fdiv(float a, float b)
 {
 	if(b == 0.0f)
@@ -299,311 +739,1157 @@ int _idiv(int a, int b)
 	return a / b;
 }
 
-// plot a pixel to the (assumed to exist) color buffer.
-// rgba components are 16.16 fixed point (representing 0-1)
-// may blend with destination
-void _plot_pixel(uint32_t index, brvec4ui rgba, bool blend)
+// job scheduler: a pool of threads, shared by all contexts, that each keep a deque of jobs & steal from one another
+// when theirs is empty. a stage splits its work into a range (e.g. of rows) that jobs halve until they are no more
+// than a grain, pushing one half for other threads to steal. the thread that starts the work runs jobs until it
+// is done.
+typedef void (*_job_function_t)(void* data, uint32_t begin, uint32_t end);
+
+typedef struct _job_group_t _job_group_t;
+typedef struct _job_t _job_t;
+struct _job_t
 {
-	void* cb = _brcontext->cb;
-	uint32_t cb_type = _brcontext->cb_type;
-	switch(cb_type)
-	{
-	case BR_R8G8B8: {
-		uint8_t r = (rgba.x * 255) >> 16;
-		uint8_t g = (rgba.y * 255) >> 16;
-		uint8_t b = (rgba.z * 255) >> 16;
-		uint8_t a = (rgba.w * 255) >> 16;
-		if(!blend)
-			((uint32_t*)cb)[index] = _BR_B8G8R8(r,g,b);
-		else
-		{
-			if(a == 255) {
-				((uint32_t*)cb)[index] = _BR_R8G8B8(r,g,b);
-				return;
-			}
-			if(a == 0)   return;
-			uint32_t* dst = &(((uint32_t*)cb)[index]);
-			uint32_t dst_val = *dst;
-			uint8_t dst_r = _BR_R8G8B8_R(r);
-			uint8_t dst_g = _BR_R8G8B8_G(g);
-			uint8_t dst_b = _BR_R8G8B8_B(b);
-			float alpha = (float)a*_INV_255;
-			float _1_minus_alpha = 1.0f - alpha;
-			uint8_t pr = (r*alpha) + (dst_r*_1_minus_alpha);
-			uint8_t pg = (g*alpha) + (dst_g*_1_minus_alpha);
-			uint8_t pb = (b*alpha) + (dst_b*_1_minus_alpha);
-			*dst = _BR_R8G8B8(pr,pg,pb);
-		} }
-		break;
-	case BR_R8G8B8A8: {
-		uint8_t r = (rgba.x * 255) >> 16;
-		uint8_t g = (rgba.y * 255) >> 16;
-		uint8_t b = (rgba.z * 255) >> 16;
-		uint8_t a = (rgba.w * 255) >> 16;
-		if(!blend)
-			((uint32_t*)cb)[index] = _BR_R8G8B8A8(r, g, b, a);
-		else
-		{
-			if(a == 255) {
-				((uint32_t*)cb)[index] = _BR_R8G8B8A8(r, g, b, a);
-				return;
-			}
-			if(a == 0)   return;
-			uint32_t* dst = &(((uint32_t*)cb)[index]);
-			uint32_t dst_val = *dst;
-			uint8_t dst_r = _BR_R8G8B8A8_R(dst_val);
-			uint8_t dst_g = _BR_R8G8B8A8_G(dst_val);
-			uint8_t dst_b = _BR_R8G8B8A8_B(dst_val);
-			uint8_t dst_a = _BR_R8G8B8A8_A(dst_val);
-			float alpha = (float)a*_INV_255;
-			float _1_minus_alpha = 1.0f - alpha;
-			uint8_t pr = (r*alpha) + (dst_r*_1_minus_alpha);
-			uint8_t pg = (g*alpha) + (dst_g*_1_minus_alpha);
-			uint8_t pb = (b*alpha) + (dst_b*_1_minus_alpha);
-			uint8_t pa = (a*alpha) + (dst_a*_1_minus_alpha);
-			*dst = _BR_R8G8B8A8(pr, pg, pb, pa);
-		} }
-		break;
-	case BR_B8G8R8: {
-		uint8_t r = (rgba.x * 255) >> 16;
-		uint8_t g = (rgba.y * 255) >> 16;
-		uint8_t b = (rgba.z * 255) >> 16;
-		uint8_t a = (rgba.w * 255) >> 16;
-		if(!blend)
-			((uint32_t*)cb)[index] = _BR_B8G8R8(r,g,b);
-		else
-		{
-			if(a == 255) {
-				((uint32_t*)cb)[index] = _BR_B8G8R8(r,g,b);
-				return;
-			}
-			if(a == 0)   return;
-			uint32_t* dst = &(((uint32_t*)cb)[index]);
-			uint32_t dst_val = *dst;
-			uint8_t dst_r = _BR_B8G8R8_R(r);
-			uint8_t dst_g = _BR_B8G8R8_G(g);
-			uint8_t dst_b = _BR_B8G8R8_B(b);
-			float alpha = (float)a*_INV_255;
-			float _1_minus_alpha = 1.0f - alpha;
-			uint8_t pr = (r*alpha) + (dst_r*_1_minus_alpha);
-			uint8_t pg = (g*alpha) + (dst_g*_1_minus_alpha);
-			uint8_t pb = (b*alpha) + (dst_b*_1_minus_alpha);
-			*dst = _BR_B8G8R8(pr,pg,pb);
-		}
-		break; }
-	case BR_A8B8G8R8: {
-		uint8_t r = (rgba.x * 255) >> 16;
-		uint8_t g = (rgba.y * 255) >> 16;
-		uint8_t b = (rgba.z * 255) >> 16;
-		uint8_t a = (rgba.w * 255) >> 16;
-		if(!blend)
-			((uint32_t*)cb)[index] = _BR_A8B8G8R8(r, g, b, a);
-		else
-		{
-			if(a == 255) {
-				((uint32_t*)cb)[index] = _BR_A8B8G8R8(r, g, b, a);
-				return;
-			}
-			if(a == 0)   return;
-			uint32_t* dst = &(((uint32_t*)cb)[index]);
-			uint32_t dst_val = *dst;
-			uint8_t dst_r = _BR_A8B8G8R8_R(dst_val);
-			uint8_t dst_g = _BR_A8B8G8R8_G(dst_val);
-			uint8_t dst_b = _BR_A8B8G8R8_B(dst_val);
-			uint8_t dst_a = _BR_A8B8G8R8_A(dst_val);
-			float alpha = (float)a*_INV_255;
-			float _1_minus_alpha = 1.0f - alpha;
-			uint8_t pr = (r*alpha) + (dst_r*_1_minus_alpha);
-			uint8_t pg = (g*alpha) + (dst_g*_1_minus_alpha);
-			uint8_t pb = (b*alpha) + (dst_b*_1_minus_alpha);
-			uint8_t pa = (a*alpha) + (dst_a*_1_minus_alpha);
-			*dst = _BR_A8B8G8R8(pr, pg, pb, pa);
-		} }
-		break;
-	case BR_R5G5B5: {
-		uint8_t r = (rgba.x * 31) >> 16;
-		uint8_t g = (rgba.y * 31) >> 16;
-		uint8_t b = (rgba.z * 31) >> 16;
-		if(!blend)
-			((uint16_t*)cb)[index] = _BR_R5G5B5(r,g,b);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint16_t*)cb)[index] = _BR_R5G5B5(r,g,b);
-			return;
-		} }
-		break;
-	case BR_R5G5B5A1: {
-		uint8_t r = (rgba.x * 31) >> 16;
-		uint8_t g = (rgba.y * 31) >> 16;
-		uint8_t b = (rgba.z * 31) >> 16;
-		if(!blend)
-			((uint16_t*)cb)[index] = _BR_R5G5B5A1(r,g,b,1);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint16_t*)cb)[index] = _BR_R5G5B5A1(r,g,b,1);
-			return;
-		} }
-		break;
-	case BR_B5G5R5: {
-		uint8_t r = (rgba.x * 31) >> 16;
-		uint8_t g = (rgba.y * 31) >> 16;
-		uint8_t b = (rgba.z * 31) >> 16;
-		if(!blend)
-			((uint16_t*)cb)[index] = _BR_B5G5R5(r,g,b);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint16_t*)cb)[index] = _BR_B5G5R5(r,g,b);
-			return;
-		} }
-		break;
-	case BR_A1B5G5R5: {
-		uint8_t r = (rgba.x * 31) >> 16;
-		uint8_t g = (rgba.y * 31) >> 16;
-		uint8_t b = (rgba.z * 31) >> 16;
-		if(!blend)
-			((uint16_t*)cb)[index] = _BR_A1B5G5R5(r,g,b,1);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint16_t*)cb)[index] = _BR_A1B5G5R5(r,g,b,1);
-			return;
-		} }
-		break;
-	case BR_R3G3B2: {
-		uint8_t r = (rgba.x * 7) >> 16;
-		uint8_t g = (rgba.y * 7) >> 16;
-		uint8_t b = (rgba.z * 3) >> 16;
-		if(!blend)
-			((uint8_t*)cb)[index] = _BR_R3G3B2(r,g,b);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint8_t*)cb)[index] = _BR_R3G3B2(r,g,b);
-			return;
-		} }
-		break;
-	case BR_R3G2B2A1: {
-		uint8_t r = (rgba.x * 7) >> 16;
-		uint8_t g = (rgba.y * 3) >> 16;
-		uint8_t b = (rgba.z * 3) >> 16;
-		if(!blend)
-			((uint8_t*)cb)[index] = _BR_R3G2B2A1(r,g,b,1);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint8_t*)cb)[index] = _BR_R3G2B2A1(r,g,b,1);
-			return;
-		} }
-		break;
-	case BR_B2G3R3: {
-		uint8_t r = (rgba.x * 7) >> 16;
-		uint8_t g = (rgba.y * 7) >> 16;
-		uint8_t b = (rgba.z * 3) >> 16;
-		if(!blend)
-			((uint8_t*)cb)[index] = _BR_B2G3R3(r,g,b);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint8_t*)cb)[index] = _BR_B2G3R3(r,g,b);
-			return;
-		} }
-		break;
-	case BR_A1B2G2R3: {
-		uint8_t r = (rgba.x * 7) >> 16;
-		uint8_t g = (rgba.y * 3) >> 16;
-		uint8_t b = (rgba.z * 3) >> 16;
-		if(!blend)
-			((uint8_t*)cb)[index] = _BR_A1B2G2R3(r,g,b,1);
-		else
-		{
-			if(rgba.w<32768) return;
-			((uint8_t*)cb)[index] = _BR_A1B2G2R3(r,g,b,1);
-			return;
-		} }
-		break;
-	}
-}
+	_job_group_t* group;
+	uint32_t begin, end;
+};
 
-// plot a depth to the (assumed to exist) depth buffer.
-void _plot_depth(uint32_t index, int64_t depth)
+// the jobs of one _br_parallel_for; their storage is claimed from 'jobs' as ranges are split
+struct _job_group_t
 {
-	if(_brcontext->db_type == BR_D16)
-		((uint16_t*)_brcontext->db) [index] = depth;
-	if(_brcontext->db_type == BR_D32)
-		((uint32_t*)_brcontext->db) [index] = depth;
-}
+	_job_function_t function;
+	void* data;
+	uint32_t grain;
+	_job_t* jobs;
+	uint32_t jobs_used;
+	uint32_t pending;	// jobs not yet finished
+};
 
-// get a depth from the (assumed to exist) depth buffer.
-int64_t _get_depth(uint32_t index)
+// a fixed size Chase-Lev deque; the owner pushes & pops at bottom, thieves steal at top
+typedef struct _job_deque_t _job_deque_t;
+struct _job_deque_t
 {
-	if(_brcontext->db_type == BR_D16)
-		return ((uint16_t*)_brcontext->db) [index];
-	if(_brcontext->db_type == BR_D32)
-		return ((uint32_t*)_brcontext->db) [index];
+	int64_t top;
+	int64_t bottom;
+	_job_t* jobs[BR_JOB_DEQUE_SIZE];
+};
+
+typedef struct _job_pool_t _job_pool_t;
+struct _job_pool_t
+{
+	uint32_t count;				// job threads, besides threads starting work
+	_job_deque_t* deques;		// one per job thread
+	_job_t* injected;			// a job from a thread outside the pool, or NULL; guarded by lock
+#ifdef __linux__
+	pthread_t* threads;
+	uint32_t started;			// threads created, of count
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+	uint32_t sleepers;			// job threads sleeping on cond
+	bool stop;
+};
+
+static _job_pool_t* _brjobs = NULL;		// the job scheduler, started when first used
+static uint32_t _brjob_threads = 0;		// threads the scheduler uses (see brJobThreads); 0 is one per CPU
+static __thread int32_t _brjob_index = -1;	// deque of the calling job thread, or -1
+#ifdef __linux__
+static pthread_mutex_t _brjob_lock = PTHREAD_MUTEX_INITIALIZER;	// guards starting & stopping the scheduler
+#endif
+
+bool _push_job(_job_deque_t* deque, _job_t* job)
+{
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	if(bottom - __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST) >= BR_JOB_DEQUE_SIZE)
+		return false;
+	__atomic_store_n(&deque->jobs[bottom & (BR_JOB_DEQUE_SIZE-1)], job, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_SEQ_CST);
+	return true;
 }
 
-// convert depth from clip-space to raster-space
-// note depth of 1.0 has accuracy error (will result in (depth*range)+1)
-int64_t _convert_depth(float depth)
+_job_t* _pop_job(_job_deque_t* deque)
 {
-	if(_brcontext->db_type == BR_D16)
-		return depth * 0xFFFF;
-	if(_brcontext->db_type == BR_D32)
-		return depth * 0xFFFFFFFF;
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_SEQ_CST);
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	if(top > bottom)
+	{
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_SEQ_CST);
+		return NULL;
+	}
+	_job_t* job = __atomic_load_n(&deque->jobs[bottom & (BR_JOB_DEQUE_SIZE-1)], __ATOMIC_RELAXED);
+	if(top == bottom)
+	{
+		// the last job; race thieves for it
+		if(!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			job = NULL;
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_SEQ_CST);
+	}
+	return job;
 }
 
-// return whether or not a depth is a depth valid for depth buffer
-bool _is_valid_depth(int64_t depth)
+_job_t* _steal_job(_job_deque_t* deque)
 {
-	if(_brcontext->db_type == BR_D16)
-		return (depth >= 0 && depth <= 0xFFFF);
-	if(_brcontext->db_type == BR_D32)
-		return (depth >= 0 && depth <= 0xFFFFFFFF);
-		
-	return false;
+	int64_t top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+	int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+	if(top >= bottom)
+		return NULL;
+	_job_t* job = __atomic_load_n(&deque->jobs[top & (BR_JOB_DEQUE_SIZE-1)], __ATOMIC_RELAXED);
+	if(!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		return NULL;
+	return job;
 }
 
-// return whether or not a value is a pixel format
-bool _is_pixel_format(uint32_t value)
+// take a job from anywhere in the pool: the calling job thread's deque, an injected job, or another deque.
+// threads outside the pool only steal, leaving injected jobs to job threads, which split them.
+_job_t* _find_job(_job_pool_t* pool)
 {
-	switch(value)
+	_job_t* job = NULL;
+	if(_brjob_index >= 0 && (job = _pop_job(&pool->deques[_brjob_index])))
+		return job;
+#ifdef __linux__
+	if(_brjob_index >= 0 && __atomic_load_n(&pool->injected, __ATOMIC_SEQ_CST))
 	{
-		case BR_R8G8B8A8:
-		case BR_R8G8B8:
-		case BR_A8B8G8R8:
-		case BR_B8G8R8:
-		case BR_R5G5B5A1:
-		case BR_R5G5B5:
-		case BR_A1B5G5R5:
-		case BR_B5G5R5:
-		case BR_R3G2B2A1:
-		case BR_R3G3B2:
-		case BR_A1B2G2R3:
-		case BR_B2G3R3:
-			return true;
-		default:
-			return false;
+		pthread_mutex_lock(&pool->lock);
+		job = pool->injected;
+		pool->injected = NULL;
+		pthread_mutex_unlock(&pool->lock);
+		if(job)
+			return job;
 	}
+#endif
+	uint32_t first = _brjob_index >= 0 ? _brjob_index + 1 : 0;
+	for(uint32_t i = 0; i < pool->count; i += 1)
+		if((job = _steal_job(&pool->deques[(first + i) % pool->count])))
+			return job;
+	return NULL;
 }
 
-// get texel from texture and return 0-1 RGBA components
-// assume alpha of 1 in absence alpha channel
-void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint32_t width, uint32_t height, bool compressed)
+void _wake_job_threads(_job_pool_t* pool)
 {
-	if(!_brcontext || !_is_pixel_format(format))
+#ifdef __linux__
+	if(!__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST))
 		return;
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+#endif
+}
 
-	if(x >= width)
-		x = width - 1;
-	if(x < 0)
-		x = 0;
-	if(y >= height)
-		y = height - 1;
-	if(y < 0)
-		y = 0;
+// run a job, first splitting off halves of its range for other threads while it is larger than its grain.
+void _run_job(_job_pool_t* pool, _job_t* job)
+{
+	_job_group_t* group = job->group;
+	while(_brjob_index >= 0 && job->end - job->begin > group->grain)
+	{
+		_job_t* half = &group->jobs[__atomic_fetch_add(&group->jobs_used, 1, __ATOMIC_RELAXED)];
+		half->group = group;
+		half->begin = job->begin + (job->end - job->begin) / 2;
+		half->end = job->end;
+		__atomic_add_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+		if(!_push_job(&pool->deques[_brjob_index], half))
+		{
+			__atomic_sub_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+			break;	// deque full; run the whole range here
+		}
+		job->end = half->begin;
+		_wake_job_threads(pool);
+	}
+	group->function(group->data, job->begin, job->end);
+	__atomic_sub_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+}
+
+bool _jobs_available(_job_pool_t* pool)
+{
+	if(__atomic_load_n(&pool->injected, __ATOMIC_SEQ_CST) || __atomic_load_n(&pool->stop, __ATOMIC_SEQ_CST))
+		return true;
+	for(uint32_t i = 0; i < pool->count; i += 1)
+		if(__atomic_load_n(&pool->deques[i].top, __ATOMIC_SEQ_CST) < __atomic_load_n(&pool->deques[i].bottom, __ATOMIC_SEQ_CST))
+			return true;
+	return false;
+}
+
+void* _job_thread_main(void* arg)
+{
+#ifdef __linux__
+	_job_pool_t* pool = _brjobs;
+	_brjob_index = (int32_t)(intptr_t)arg;
+	for(;;)
+	{
+		_job_t* job = _find_job(pool);
+		if(job)
+		{
+			_run_job(pool, job);
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		__atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+		while(!_jobs_available(pool))
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		__atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&pool->lock);
+		if(__atomic_load_n(&pool->stop, __ATOMIC_SEQ_CST))
+			break;
+	}
+#endif
+	return NULL;
+}
+
+// stop & free the job scheduler. no work may be running on it.
+void _stop_job_pool()
+{
+#ifdef __linux__
+	_job_pool_t* pool = _brjobs;
+	if(!pool)
+		return;
+	__atomic_store_n(&pool->stop, true, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+	for(uint32_t i = 0; i < pool->started; i += 1)
+		pthread_join(pool->threads[i], NULL);
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	_br_free_unaccounted(pool->threads);
+	_br_free_unaccounted(pool->deques);
+	_br_free_unaccounted(pool);
+	_brjobs = NULL;
+#endif
+}
+
+// return the job scheduler, starting it if need be, or NULL if it has no threads.
+_job_pool_t* _job_pool()
+{
+#ifdef __linux__
+	_job_pool_t* pool = __atomic_load_n(&_brjobs, __ATOMIC_ACQUIRE);
+	if(pool)
+		return pool;
+	
+	pthread_mutex_lock(&_brjob_lock);
+	if((pool = _brjobs))
+	{
+		pthread_mutex_unlock(&_brjob_lock);
+		return pool;
+	}
+	uint32_t threads = _brjob_threads;
+	if(!threads)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cpus > 0 ? cpus : 1;
+	}
+	if(threads > BR_MAX_JOB_THREADS)
+		threads = BR_MAX_JOB_THREADS;
+	// the thread starting work is one of the threads
+	uint32_t count = threads - 1;
+	if(!count)
+	{
+		pthread_mutex_unlock(&_brjob_lock);
+		return NULL;
+	}
+	
+	pool = (_job_pool_t*) _br_alloc_unaccounted(sizeof(_job_pool_t), 64);
+	_job_deque_t* deques = (_job_deque_t*) _br_alloc_unaccounted(count * sizeof(_job_deque_t), 64);
+	pthread_t* handles = (pthread_t*) _br_alloc_unaccounted(count * sizeof(pthread_t), 16);
+	if(!pool || !deques || !handles)
+	{
+		_br_free_unaccounted(pool);
+		_br_free_unaccounted(deques);
+		_br_free_unaccounted(handles);
+		pthread_mutex_unlock(&_brjob_lock);
+		return NULL;
+	}
+	memset(pool, 0, sizeof(_job_pool_t));
+	memset(deques, 0, count * sizeof(_job_deque_t));
+	pool->count = count;
+	pool->deques = deques;
+	pool->threads = handles;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	__atomic_store_n(&_brjobs, pool, __ATOMIC_RELEASE);
+	for(uint32_t i = 0; i < count; i += 1)
+	{
+		if(pthread_create(&handles[i], NULL, _job_thread_main, (void*)(intptr_t)i))
+			break;
+		pool->started += 1;
+	}
+	if(!pool->started)
+	{
+		_stop_job_pool();
+		pool = NULL;
+	}
+	pthread_mutex_unlock(&_brjob_lock);
+	return pool;
+#else
+	return NULL;
+#endif
+}
+
+// call 'function' over [0, count) in ranges of up to 'grain', as jobs when the bound context has BR_JOBS enabled.
+// ranges may run at once, in any order, on any thread; returns once all have run.
+void _br_parallel_for(uint32_t count, uint32_t grain, _job_function_t function, void* data)
+{
+	if(!count)
+		return;
+	_job_pool_t* pool = (_brcontext && _brcontext->jobs && count > grain) ? _job_pool() : NULL;
+	if(!pool)
+	{
+		function(data, 0, count);
+		return;
+	}
+	
+	// every split makes one job; halving leaves ranges of more than half a grain, so fewer than twice as many
+	// jobs as grains
+	uint32_t capacity = 2 * ((count + grain - 1) / grain);
+	_job_t local[64];
+	_job_t* jobs = capacity <= 64 ? local : (_job_t*) _br_alloc_unaccounted(capacity * sizeof(_job_t), 16);
+	if(!jobs)
+	{
+		function(data, 0, count);
+		return;
+	}
+	_job_group_t group = { function, data, grain, jobs, 1, 1 };
+	jobs[0] = { &group, 0, count };
+	
+	if(_brjob_index >= 0)
+		_run_job(pool, &jobs[0]);
+	else
+	{
+#ifdef __linux__
+		// hand the range to the pool; only one outside job waits at a time, so run it here if another does
+		pthread_mutex_lock(&pool->lock);
+		bool injected = !pool->injected;
+		if(injected)
+			__atomic_store_n(&pool->injected, &jobs[0], __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&pool->lock);
+		if(injected)
+			_wake_job_threads(pool);
+		else
+#endif
+			function(data, 0, count), __atomic_sub_fetch(&group.pending, 1, __ATOMIC_SEQ_CST);
+	}
+	
+	// help until every job of the group has run
+	while(__atomic_load_n(&group.pending, __ATOMIC_SEQ_CST))
+	{
+		_job_t* job = _find_job(pool);
+		if(job)
+			_run_job(pool, job);
+#ifdef __linux__
+		else
+			sched_yield();
+#endif
+	}
+	if(jobs != local)
+		_br_free_unaccounted(jobs);
+}
+
+#ifdef BR_ENABLE_STATISTICS
+// monotonic time in nanoseconds
+uint64_t _get_time_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+// return an 8-bit (0-255) blend factor for a channel.
+// s & d are the source & destination channel, sa & da the source & destination alpha.
+uint32_t _blend_factor(uint32_t factor, uint32_t s, uint32_t d, uint32_t sa, uint32_t da)
+{
+	switch(factor)
+	{
+		case BR_ZERO:					return 0;
+		case BR_ONE:					return 255;
+		case BR_SRC_COLOR:				return s;
+		case BR_ONE_MINUS_SRC_COLOR:	return 255 - s;
+		case BR_DST_COLOR:				return d;
+		case BR_ONE_MINUS_DST_COLOR:	return 255 - d;
+		case BR_SRC_ALPHA:				return sa;
+		case BR_ONE_MINUS_SRC_ALPHA:	return 255 - sa;
+		case BR_DST_ALPHA:				return da;
+		case BR_ONE_MINUS_DST_ALPHA:	return 255 - da;
+	}
+	return 0;
+}
+
+// blend one 8-bit channel using the current blend factors & equation.
+// BR_MIN & BR_MAX ignore the blend factors.
+uint32_t _blend_channel(uint32_t s, uint32_t d, uint32_t sa, uint32_t da)
+{
+	uint32_t eq = _brcontext->blend_eq;
+	if(eq == BR_MIN)
+		return s < d ? s : d;
+	if(eq == BR_MAX)
+		return s > d ? s : d;
+
+	uint32_t fs = _BR_MUL8(s, _blend_factor(_brcontext->blend_src, s, d, sa, da));
+	uint32_t fd = _BR_MUL8(d, _blend_factor(_brcontext->blend_dst, s, d, sa, da));
+	if(eq == BR_FUNC_SUBTRACT)
+		return fs > fd ? fs - fd : 0;
+	if(eq == BR_FUNC_REVERSE_SUBTRACT)
+		return fd > fs ? fd - fs : 0;
+	return fs + fd > 255 ? 255 : fs + fd;
+}
+
+// blend an 8-bit source color with an 8-bit destination color.
+brvec4ui _blend_rgba8(brvec4ui src, brvec4ui dst)
+{
+	brvec4ui out;
+	out.x = _blend_channel(src.x, dst.x, src.w, dst.w);
+	out.y = _blend_channel(src.y, dst.y, src.w, dst.w);
+	out.z = _blend_channel(src.z, dst.z, src.w, dst.w);
+	out.w = _blend_channel(src.w, dst.w, src.w, dst.w);
+	return out;
+}
+
+// whether or not the current blend state is plain source-over (the default),
+// for which fully transparent and fully opaque fragments need no destination read.
+bool _is_blend_over()
+{
+	return _brcontext->blend_src == BR_SRC_ALPHA && _brcontext->blend_dst == BR_ONE_MINUS_SRC_ALPHA
+		&& _brcontext->blend_eq == BR_FUNC_ADD;
+}
+
+// read a pixel from the (assumed to exist) color buffer as 0-255 components.
+// assume alpha of 255 in absence alpha channel
+brvec4ui _get_pixel(uint32_t index)
+{
+	void* cb = _brcontext->cb;
+	brvec4ui c = {0,0,0,255};
+	uint32_t x;
+	switch(_brcontext->cb_type)
+	{
+	case BR_R8G8B8:
+		x = ((uint32_t*)cb)[index];
+		c = { _BR_R8G8B8_R(x), _BR_R8G8B8_G(x), _BR_R8G8B8_B(x), 255 };
+		break;
+	case BR_R8G8B8A8:
+		x = ((uint32_t*)cb)[index];
+		c = { _BR_R8G8B8A8_R(x), _BR_R8G8B8A8_G(x), _BR_R8G8B8A8_B(x), _BR_R8G8B8A8_A(x) };
+		break;
+	case BR_B8G8R8:
+		x = ((uint32_t*)cb)[index];
+		c = { _BR_B8G8R8_R(x), _BR_B8G8R8_G(x), _BR_B8G8R8_B(x), 255 };
+		break;
+	case BR_A8B8G8R8:
+		x = ((uint32_t*)cb)[index];
+		c = { _BR_A8B8G8R8_R(x), _BR_A8B8G8R8_G(x), _BR_A8B8G8R8_B(x), _BR_A8B8G8R8_A(x) };
+		break;
+	case BR_R5G5B5:
+		x = ((uint16_t*)cb)[index];
+		c = { _BR_EXPAND5(_BR_R5G5B5_R(x)), _BR_EXPAND5(_BR_R5G5B5_G(x)), _BR_EXPAND5(_BR_R5G5B5_B(x)), 255 };
+		break;
+	case BR_R5G5B5A1:
+		x = ((uint16_t*)cb)[index];
+		c = { _BR_EXPAND5(_BR_R5G5B5A1_R(x)), _BR_EXPAND5(_BR_R5G5B5A1_G(x)), _BR_EXPAND5(_BR_R5G5B5A1_B(x)), 
+			(uint32_t)_BR_R5G5B5A1_A(x)*255 };
+		break;
+	case BR_B5G5R5:
+		x = ((uint16_t*)cb)[index];
+		c = { _BR_EXPAND5(_BR_B5G5R5_R(x)), _BR_EXPAND5(_BR_B5G5R5_G(x)), _BR_EXPAND5(_BR_B5G5R5_B(x)), 255 };
+		break;
+	case BR_A1B5G5R5:
+		x = ((uint16_t*)cb)[index];
+		c = { _BR_EXPAND5(_BR_A1B5G5R5_R(x)), _BR_EXPAND5(_BR_A1B5G5R5_G(x)), _BR_EXPAND5(_BR_A1B5G5R5_B(x)), 
+			(uint32_t)_BR_A1B5G5R5_A(x)*255 };
+		break;
+	case BR_R3G3B2:
+		x = ((uint8_t*)cb)[index];
+		c = { _BR_EXPAND3(_BR_R3G3B2_R(x)), _BR_EXPAND3(_BR_R3G3B2_G(x)), _BR_EXPAND2(_BR_R3G3B2_B(x)), 255 };
+		break;
+	case BR_R3G2B2A1:
+		x = ((uint8_t*)cb)[index];
+		c = { _BR_EXPAND3(_BR_R3G2B2A1_R(x)), _BR_EXPAND2(_BR_R3G2B2A1_G(x)), _BR_EXPAND2(_BR_R3G2B2A1_B(x)), 
+			(uint32_t)_BR_R3G2B2A1_A(x)*255 };
+		break;
+	case BR_B2G3R3:
+		x = ((uint8_t*)cb)[index];
+		c = { _BR_EXPAND3(_BR_B2G3R3_R(x)), _BR_EXPAND3(_BR_B2G3R3_G(x)), _BR_EXPAND2(_BR_B2G3R3_B(x)), 255 };
+		break;
+	case BR_A1B2G2R3:
+		x = ((uint8_t*)cb)[index];
+		c = { _BR_EXPAND3(_BR_A1B2G2R3_R(x)), _BR_EXPAND2(_BR_A1B2G2R3_G(x)), _BR_EXPAND2(_BR_A1B2G2R3_B(x)), 
+			(uint32_t)_BR_A1B2G2R3_A(x)*255 };
+		break;
+	}
+	return c;
+}
+
+void _plot_samples(uint32_t index, uint32_t mask, brvec4ui rgba, bool blend);
+void _store_pixel(uint32_t index, brvec4ui rgba);
+
+// plot a pixel to the (assumed to exist) color buffer.
+// rgba components are 16.16 fixed point (representing 0-1)
+// may blend with destination
+void _plot_pixel(uint32_t index, brvec4ui rgba, bool blend)
+{
+	// when multisampling, primitives other than triangles cover every sample of their pixels
+	if(_brcontext->msaa_color)
+	{
+		_plot_samples(index, 0xFF, rgba, blend);
+		return;
+	}
+
+	if(blend)
+	{
+		brvec4ui src = { _BR_TO8(rgba.x), _BR_TO8(rgba.y), _BR_TO8(rgba.z), _BR_TO8(rgba.w) };
+		bool over = _is_blend_over();
+		if(over && src.w == 0)
+			return;
+		// opaque source-over is a plain write
+		if(!over || src.w != 255)
+		{
+			_BR_STAT(pixels_blended, 1);
+			brvec4ui out = _blend_rgba8(src, _get_pixel(index));
+			rgba.x = _BR_FROM8(out.x);
+			rgba.y = _BR_FROM8(out.y);
+			rgba.z = _BR_FROM8(out.z);
+			rgba.w = _BR_FROM8(out.w);
+		}
+	}
+
+	_store_pixel(index, rgba);
+}
+
+// write a 16.16 color to the (assumed to exist) color buffer, converting it to the buffer's format.
+void _store_pixel(uint32_t index, brvec4ui rgba)
+{
+	void* cb = _brcontext->cb;
+	uint32_t cb_type = _brcontext->cb_type;
+
+	switch(cb_type)
+	{
+	case BR_R8G8B8: {
+		uint8_t r = _BR_TO8(rgba.x);
+		uint8_t g = _BR_TO8(rgba.y);
+		uint8_t b = _BR_TO8(rgba.z);
+		((uint32_t*)cb)[index] = _BR_R8G8B8(r,g,b);
+		break; }
+	case BR_R8G8B8A8: {
+		uint8_t r = _BR_TO8(rgba.x);
+		uint8_t g = _BR_TO8(rgba.y);
+		uint8_t b = _BR_TO8(rgba.z);
+		uint8_t a = _BR_TO8(rgba.w);
+		((uint32_t*)cb)[index] = _BR_R8G8B8A8(r, g, b, a);
+		break; }
+	case BR_B8G8R8: {
+		uint8_t r = _BR_TO8(rgba.x);
+		uint8_t g = _BR_TO8(rgba.y);
+		uint8_t b = _BR_TO8(rgba.z);
+		((uint32_t*)cb)[index] = _BR_B8G8R8(r,g,b);
+		break; }
+	case BR_A8B8G8R8: {
+		uint8_t r = _BR_TO8(rgba.x);
+		uint8_t g = _BR_TO8(rgba.y);
+		uint8_t b = _BR_TO8(rgba.z);
+		uint8_t a = _BR_TO8(rgba.w);
+		((uint32_t*)cb)[index] = _BR_A8B8G8R8(r, g, b, a);
+		break; }
+	case BR_R5G5B5: {
+		uint8_t r = (rgba.x * 31) >> 16;
+		uint8_t g = (rgba.y * 31) >> 16;
+		uint8_t b = (rgba.z * 31) >> 16;
+		((uint16_t*)cb)[index] = _BR_R5G5B5(r,g,b);
+		break; }
+	case BR_R5G5B5A1: {
+		uint8_t r = (rgba.x * 31) >> 16;
+		uint8_t g = (rgba.y * 31) >> 16;
+		uint8_t b = (rgba.z * 31) >> 16;
+		((uint16_t*)cb)[index] = _BR_R5G5B5A1(r,g,b,1);
+		break; }
+	case BR_B5G5R5: {
+		uint8_t r = (rgba.x * 31) >> 16;
+		uint8_t g = (rgba.y * 31) >> 16;
+		uint8_t b = (rgba.z * 31) >> 16;
+		((uint16_t*)cb)[index] = _BR_B5G5R5(r,g,b);
+		break; }
+	case BR_A1B5G5R5: {
+		uint8_t r = (rgba.x * 31) >> 16;
+		uint8_t g = (rgba.y * 31) >> 16;
+		uint8_t b = (rgba.z * 31) >> 16;
+		((uint16_t*)cb)[index] = _BR_A1B5G5R5(r,g,b,1);
+		break; }
+	case BR_R3G3B2: {
+		uint8_t r = (rgba.x * 7) >> 16;
+		uint8_t g = (rgba.y * 7) >> 16;
+		uint8_t b = (rgba.z * 3) >> 16;
+		((uint8_t*)cb)[index] = _BR_R3G3B2(r,g,b);
+		break; }
+	case BR_R3G2B2A1: {
+		uint8_t r = (rgba.x * 7) >> 16;
+		uint8_t g = (rgba.y * 3) >> 16;
+		uint8_t b = (rgba.z * 3) >> 16;
+		((uint8_t*)cb)[index] = _BR_R3G2B2A1(r,g,b,1);
+		break; }
+	case BR_B2G3R3: {
+		uint8_t r = (rgba.x * 7) >> 16;
+		uint8_t g = (rgba.y * 7) >> 16;
+		uint8_t b = (rgba.z * 3) >> 16;
+		((uint8_t*)cb)[index] = _BR_B2G3R3(r,g,b);
+		break; }
+	case BR_A1B2G2R3: {
+		uint8_t r = (rgba.x * 7) >> 16;
+		uint8_t g = (rgba.y * 3) >> 16;
+		uint8_t b = (rgba.z * 3) >> 16;
+		((uint8_t*)cb)[index] = _BR_A1B2G2R3(r,g,b,1);
+		break; }
+	}
+}
+
+// pack a 16.16 color into an 8-bit per channel RGBA color buffer format.
+uint32_t _pack_rgba8(brvec4ui rgba, uint32_t format)
+{
+	uint32_t r = _BR_TO8(rgba.x);
+	uint32_t g = _BR_TO8(rgba.y);
+	uint32_t b = _BR_TO8(rgba.z);
+	uint32_t a = _BR_TO8(rgba.w);
+	if(format == BR_A8B8G8R8)
+		return _BR_A8B8G8R8(r, g, b, a);
+	return _BR_R8G8B8A8(r, g, b, a);
+}
+
+// blend a span of packed source pixels onto an 8-bit RGBA color buffer (BR_R8G8B8A8 or BR_A8B8G8R8),
+// beginning at index. pixels with a zero mask entry are left untouched.
+// uses SSE2 (4 pixels at a time) when available; results match _blend_rgba8 exactly.
+void _blend_span_rgba8(uint32_t index, uint32_t* src, uint8_t* mask, uint32_t count)
+{
+	uint32_t* dst = ((uint32_t*)_brcontext->cb) + index;
+	bool abgr = _brcontext->cb_type == BR_A8B8G8R8;
+	uint32_t i = 0;
+
+#ifdef __SSE2__
+	uint32_t eq = _brcontext->blend_eq;
+	__m128i zero = _mm_setzero_si128();
+	__m128i c255 = _mm_set1_epi16(255);
+	__m128i c128 = _mm_set1_epi16(128);
+	for(; i+4 <= count; i += 4)
+	{
+		if(!(mask[i] | mask[i+1] | mask[i+2] | mask[i+3]))
+			continue;
+		_BR_STAT(pixels_blended, (mask[i] != 0) + (mask[i+1] != 0) + (mask[i+2] != 0) + (mask[i+3] != 0));
+		__m128i s = _mm_loadu_si128((__m128i*)(src+i));
+		__m128i d = _mm_loadu_si128((__m128i*)(dst+i));
+		__m128i res;
+		if(eq == BR_MIN)
+			res = _mm_min_epu8(s, d);
+		else if(eq == BR_MAX)
+			res = _mm_max_epu8(s, d);
+		else
+		{
+			// two pixels per register, 16 bits per channel
+			__m128i sv[2] = { _mm_unpacklo_epi8(s, zero), _mm_unpackhi_epi8(s, zero) };
+			__m128i dv[2] = { _mm_unpacklo_epi8(d, zero), _mm_unpackhi_epi8(d, zero) };
+			__m128i out[2];
+			for(int h = 0; h < 2; h += 1)
+			{
+				__m128i sa, da;
+				if(abgr) {
+					sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sv[h], 0xFF), 0xFF);
+					da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(dv[h], 0xFF), 0xFF);
+				} else {
+					sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sv[h], 0x00), 0x00);
+					da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(dv[h], 0x00), 0x00);
+				}
+				__m128i f[2];
+				uint32_t factors[2] = { _brcontext->blend_src, _brcontext->blend_dst };
+				for(int k = 0; k < 2; k += 1)
+				{
+					switch(factors[k])
+					{
+						case BR_ONE:					f[k] = c255; break;
+						case BR_SRC_COLOR:				f[k] = sv[h]; break;
+						case BR_ONE_MINUS_SRC_COLOR:	f[k] = _mm_sub_epi16(c255, sv[h]); break;
+						case BR_DST_COLOR:				f[k] = dv[h]; break;
+						case BR_ONE_MINUS_DST_COLOR:	f[k] = _mm_sub_epi16(c255, dv[h]); break;
+						case BR_SRC_ALPHA:				f[k] = sa; break;
+						case BR_ONE_MINUS_SRC_ALPHA:	f[k] = _mm_sub_epi16(c255, sa); break;
+						case BR_DST_ALPHA:				f[k] = da; break;
+						case BR_ONE_MINUS_DST_ALPHA:	f[k] = _mm_sub_epi16(c255, da); break;
+						default:						f[k] = zero; break;
+					}
+				}
+				// _BR_MUL8 in 16-bit lanes
+				__m128i ts = _mm_add_epi16(_mm_mullo_epi16(sv[h], f[0]), c128);
+				__m128i td = _mm_add_epi16(_mm_mullo_epi16(dv[h], f[1]), c128);
+				ts = _mm_srli_epi16(_mm_add_epi16(ts, _mm_srli_epi16(ts, 8)), 8);
+				td = _mm_srli_epi16(_mm_add_epi16(td, _mm_srli_epi16(td, 8)), 8);
+				if(eq == BR_FUNC_SUBTRACT)
+					out[h] = _mm_subs_epu16(ts, td);
+				else if(eq == BR_FUNC_REVERSE_SUBTRACT)
+					out[h] = _mm_subs_epu16(td, ts);
+				else
+					out[h] = _mm_add_epi16(ts, td);
+			}
+			// saturates to 255
+			res = _mm_packus_epi16(out[0], out[1]);
+		}
+		__m128i m = _mm_set_epi32(mask[i+3] ? -1 : 0, mask[i+2] ? -1 : 0, mask[i+1] ? -1 : 0, mask[i] ? -1 : 0);
+		res = _mm_or_si128(_mm_and_si128(m, res), _mm_andnot_si128(m, d));
+		_mm_storeu_si128((__m128i*)(dst+i), res);
+	}
+#endif
+
+	for(; i < count; i += 1)
+	{
+		if(!mask[i])
+			continue;
+		_BR_STAT(pixels_blended, 1);
+		brvec4ui s, d;
+		if(abgr) {
+			s = { _BR_A8B8G8R8_R(src[i]), _BR_A8B8G8R8_G(src[i]), _BR_A8B8G8R8_B(src[i]), _BR_A8B8G8R8_A(src[i]) };
+			d = { _BR_A8B8G8R8_R(dst[i]), _BR_A8B8G8R8_G(dst[i]), _BR_A8B8G8R8_B(dst[i]), _BR_A8B8G8R8_A(dst[i]) };
+		} else {
+			s = { _BR_R8G8B8A8_R(src[i]), _BR_R8G8B8A8_G(src[i]), _BR_R8G8B8A8_B(src[i]), _BR_R8G8B8A8_A(src[i]) };
+			d = { _BR_R8G8B8A8_R(dst[i]), _BR_R8G8B8A8_G(dst[i]), _BR_R8G8B8A8_B(dst[i]), _BR_R8G8B8A8_A(dst[i]) };
+		}
+		brvec4ui o = _blend_rgba8(s, d);
+		if(abgr)
+			dst[i] = _BR_A8B8G8R8(o.x, o.y, o.z, o.w);
+		else
+			dst[i] = _BR_R8G8B8A8(o.x, o.y, o.z, o.w);
+	}
+}
+
+// plot a depth to the (assumed to exist) depth buffer.
+void _plot_depth(uint32_t index, int64_t depth)
+{
+	if(_brcontext->msaa_depth)
+	{
+		uint32_t n = _brcontext->sample_count;
+		for(uint32_t s = 0; s < n; s += 1)
+			_brcontext->msaa_depth[index*n + s] = depth;
+		return;
+	}
+	if(_brcontext->db_type == BR_D16)
+		((uint16_t*)_brcontext->db) [index] = depth;
+	if(_brcontext->db_type == BR_D32)
+		((uint32_t*)_brcontext->db) [index] = depth;
+}
+
+// get a depth from the (assumed to exist) depth buffer.
+// when multisampling, this is the depth of the pixel's first sample.
+int64_t _get_depth(uint32_t index)
+{
+	if(_brcontext->msaa_depth)
+		return _brcontext->msaa_depth[index*_brcontext->sample_count];
+	if(_brcontext->db_type == BR_D16)
+		return ((uint16_t*)_brcontext->db) [index];
+	if(_brcontext->db_type == BR_D32)
+		return ((uint32_t*)_brcontext->db) [index];
+}
+
+// sample positions for 2, 4 & 8 samples per pixel, as 24.8 offsets from a pixel's sample point
+static const brvec2i _msaa_positions_2[2] = { {64,64}, {-64,-64} };
+static const brvec2i _msaa_positions_4[4] = { {-32,-96}, {96,-32}, {-96,32}, {32,96} };
+static const brvec2i _msaa_positions_8[8] = { {16,-48}, {-16,48}, {80,16}, {-48,-80}, {-80,80}, {-112,-16}, {48,112}, {112,-112} };
+
+// return the sample positions for the current sample count.
+const brvec2i* _sample_positions()
+{
+	if(_brcontext->sample_count == 8)
+		return _msaa_positions_8;
+	if(_brcontext->sample_count == 4)
+		return _msaa_positions_4;
+	return _msaa_positions_2;
+}
+
+// plot a 16.16 color to the samples of a pixel selected by 'mask' (bit s for sample s).
+// samples are R8G8B8A8, and are blended individually.
+void _plot_samples(uint32_t index, uint32_t mask, brvec4ui rgba, bool blend)
+{
+	uint32_t n = _brcontext->sample_count;
+	uint32_t* samples = _brcontext->msaa_color + index*n;
+	brvec4ui src = { _BR_TO8(rgba.x), _BR_TO8(rgba.y), _BR_TO8(rgba.z), _BR_TO8(rgba.w) };
+	bool over = blend && _is_blend_over();
+	if(over && src.w == 0)
+		return;
+	// opaque source-over is a plain write
+	if(blend && (!over || src.w != 255))
+	{
+		for(uint32_t s = 0; s < n; s += 1)
+		{
+			if(!(mask & (1<<s)))
+				continue;
+			_BR_STAT(pixels_blended, 1);
+			uint32_t d = samples[s];
+			brvec4ui dst = { _BR_R8G8B8A8_R(d), _BR_R8G8B8A8_G(d), _BR_R8G8B8A8_B(d), _BR_R8G8B8A8_A(d) };
+			brvec4ui out = _blend_rgba8(src, dst);
+			samples[s] = _BR_R8G8B8A8(out.x, out.y, out.z, out.w);
+		}
+		return;
+	}
+	uint32_t packed = _BR_R8G8B8A8(src.x, src.y, src.z, src.w);
+	for(uint32_t s = 0; s < n; s += 1)
+		if(mask & (1<<s))
+			samples[s] = packed;
+}
+
+// (re)allocate the sample buffers to match the front set & sample count, or free them when not multisampling.
+// the buffers hold sample_count samples per pixel of the front set, rows padded as the front set's are.
+void _update_sample_buffers()
+{
+	uint32_t n = _brcontext->sample_count;
+	size_t size = (size_t)_brcontext->rb_pitch * _brcontext->rb_height * n;
+	if(n > 1 && size && size == _brcontext->msaa_size)
+		return;
+	
+	_br_free(_brcontext->msaa_color);
+	_br_free(_brcontext->msaa_depth);
+	_brcontext->msaa_color = NULL;
+	_brcontext->msaa_depth = NULL;
+	_brcontext->msaa_size = 0;
+	if(n < 2 || !size)
+		return;
+	
+	uint32_t* color = (uint32_t*) _br_alloc(size * sizeof(uint32_t), BR_RENDERBUFFER_ALIGNMENT);
+	uint32_t* depth = (uint32_t*) _br_alloc(size * sizeof(uint32_t), BR_RENDERBUFFER_ALIGNMENT);
+	if(!color || !depth)
+	{
+		// out of memory; render without multisampling
+		_br_free(color);
+		_br_free(depth);
+		return;
+	}
+	memset(color, 0, size * sizeof(uint32_t));
+	memset(depth, 0xFF, size * sizeof(uint32_t));
+	_brcontext->msaa_color = color;
+	_brcontext->msaa_depth = depth;
+	_brcontext->msaa_size = size;
+}
+
+// (re)allocate the blend span to the width of the front set (see _raster_triangle).
+// on failure it is left NULL and triangles blend pixel by pixel.
+void _update_blend_span()
+{
+	uint32_t width = _brcontext->rb_width;
+	if(width == _brcontext->blend_span_width && _brcontext->blend_span)
+		return;
+	
+	_br_free(_brcontext->blend_span);
+	_br_free(_brcontext->blend_span_mask);
+	_brcontext->blend_span = NULL;
+	_brcontext->blend_span_mask = NULL;
+	_brcontext->blend_span_width = 0;
+	if(!width)
+		return;
+	
+	uint32_t* span = (uint32_t*) _br_malloc(width * sizeof(uint32_t));
+	uint8_t* mask = (uint8_t*) _br_malloc(width);
+	if(!span || !mask)
+	{
+		_br_free(span);
+		_br_free(mask);
+		return;
+	}
+	_brcontext->blend_span = span;
+	_brcontext->blend_span_mask = mask;
+	_brcontext->blend_span_width = width;
+}
+
+// clear rows [row0, row1) of the sample buffers' clip rect; 'data' points to the buffer bits.
+void _clear_sample_rows(void* data, uint32_t row0, uint32_t row1)
+{
+	size_t y0 = _brcontext->clip_y0 + row0, y1 = _brcontext->clip_y0 + row1;
+	uint32_t buffers = *(uint32_t*)data;
+	size_t n = _brcontext->sample_count;
+	size_t pitch = _brcontext->rb_pitch;
+	if(buffers & BR_COLOR_BUFFER_BIT)
+	{
+		uint32_t color = _BR_R8G8B8A8((uint8_t)(_brcontext->clear_color.x*255.0f), (uint8_t)(_brcontext->clear_color.y*255.0f), 
+			(uint8_t)(_brcontext->clear_color.z*255.0f), (uint8_t)(_brcontext->clear_color.w*255.0f));
+		for(size_t y = y0; y < y1; y += 1)
+		for(size_t i = (y*pitch + _brcontext->clip_x0)*n; i < (y*pitch + _brcontext->clip_x1)*n; i += 1)
+			_brcontext->msaa_color[i] = color;
+	}
+	if(buffers & BR_DEPTH_BUFFER_BIT)
+	{
+		int64_t max = (_brcontext->db_type == BR_D16) ? 0xFFFF : 0xFFFFFFFF;
+		int64_t d = _brcontext->clear_depth * max;
+		if(d > max) d = max;
+		if(d < 0) d = 0;
+		for(size_t y = y0; y < y1; y += 1)
+		for(size_t i = (y*pitch + _brcontext->clip_x0)*n; i < (y*pitch + _brcontext->clip_x1)*n; i += 1)
+			_brcontext->msaa_depth[i] = d;
+	}
+}
+
+// clear the sample buffers within the clip rect to the clear color and/or depth (see brClear).
+void _clear_samples(uint32_t buffers)
+{
+	uint32_t rows = _brcontext->clip_y1 > _brcontext->clip_y0 ? _brcontext->clip_y1 - _brcontext->clip_y0 : 0;
+	_br_parallel_for(rows, BR_JOB_ROWS, _clear_sample_rows, &buffers);
+}
+
+// return the pixels of a 'width' x 'height' renderbuffer within the scissor rect (see brScissor) and the 
+// redraw region (see brRedrawRegion), if enabled.
+brrect _clip_rect(uint32_t width, uint32_t height)
+{
+	int64_t x0 = 0, y0 = 0;
+	int64_t x1 = width, y1 = height;
+	for(uint32_t i = 0; i < 2; i += 1)
+	{
+		if(!(i ? _brcontext->redraw : _brcontext->scissor_test))
+			continue;
+		brrect r = i ? _brcontext->redraw_rect : _brcontext->scissor_rect;
+		if(r.x > x0) x0 = r.x;
+		if(r.y > y0) y0 = r.y;
+		if((int64_t)r.x + r.width < x1) x1 = (int64_t)r.x + r.width;
+		if((int64_t)r.y + r.height < y1) y1 = (int64_t)r.y + r.height;
+	}
+	if(x1 < x0) x1 = x0;
+	if(y1 < y0) y1 = y0;
+	return { (int32_t)x0, (int32_t)y0, (int32_t)(x1 - x0), (int32_t)(y1 - y0) };
+}
+
+// set the viewport transform from the viewport, or the front set when the viewport is empty.
+void _update_viewport()
+{
+	brrect v = _brcontext->viewport;
+	if(v.width <= 0 || v.height <= 0)
+		v = { 0, 0, (int32_t)_brcontext->rb_width, (int32_t)_brcontext->rb_height };
+	_brcontext->viewport_half_width  = v.width  * 0.5f;
+	_brcontext->viewport_half_height = v.height * 0.5f;
+	_brcontext->viewport_center_x = v.x + _brcontext->viewport_half_width;
+	_brcontext->viewport_center_y = v.y + _brcontext->viewport_half_height;
+}
+
+// limit the pixels rasterized to the front set and, if enabled, the scissor rect & redraw region.
+void _update_clip()
+{
+	brrect r = _clip_rect(_brcontext->rb_width, _brcontext->rb_height);
+	_brcontext->clip_x0 = r.x;
+	_brcontext->clip_y0 = r.y;
+	_brcontext->clip_x1 = r.x + r.width;
+	_brcontext->clip_y1 = r.y + r.height;
+}
+
+// extend the bounds of the current draw by raster-space bounds, widened by a pixel for rounding & clamped
+// to the clip rect. returns false when no pixel within the bounds can be touched.
+bool _touch_bounds(float min_x, float min_y, float max_x, float max_y)
+{
+	float x0 = min_x - 1.0f, y0 = min_y - 1.0f;
+	float x1 = max_x + 2.0f, y1 = max_y + 2.0f;
+	if(!(x0 < _brcontext->clip_x1 && y0 < _brcontext->clip_y1 && x1 > _brcontext->clip_x0 && y1 > _brcontext->clip_y0))
+		return false;	// outside the clip rect (or NaN)
+	
+	int32_t ix0 = x0 > _brcontext->clip_x0 ? (int32_t)x0 : _brcontext->clip_x0;
+	int32_t iy0 = y0 > _brcontext->clip_y0 ? (int32_t)y0 : _brcontext->clip_y0;
+	int32_t ix1 = x1 < _brcontext->clip_x1 ? (int32_t)x1 : _brcontext->clip_x1;
+	int32_t iy1 = y1 < _brcontext->clip_y1 ? (int32_t)y1 : _brcontext->clip_y1;
+	if(ix0 < _brcontext->draw_x0) _brcontext->draw_x0 = ix0;
+	if(iy0 < _brcontext->draw_y0) _brcontext->draw_y0 = iy0;
+	if(ix1 > _brcontext->draw_x1) _brcontext->draw_x1 = ix1;
+	if(iy1 > _brcontext->draw_y1) _brcontext->draw_y1 = iy1;
+	return true;
+}
+
+// add [x0, x1) x [y0, y1) to the damage. rects it overlaps or touches are merged into it; when there are
+// BR_MAX_DAMAGE_RECTS rects already, it is merged with the one whose union grows the least.
+void _add_damage(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+	if(x0 >= x1 || y0 >= y1)
+		return;
+	
+	brrect* damage = _brcontext->damage;
+	for(uint32_t i = 0; i < _brcontext->damage_count; )
+	{
+		brrect r = damage[i];
+		if(x0 > r.x + r.width || r.x > x1 || y0 > r.y + r.height || r.y > y1)
+		{
+			i += 1;
+			continue;
+		}
+		if(r.x < x0) x0 = r.x;
+		if(r.y < y0) y0 = r.y;
+		if(r.x + r.width > x1) x1 = r.x + r.width;
+		if(r.y + r.height > y1) y1 = r.y + r.height;
+		// the union may now touch rects already passed
+		damage[i] = damage[--_brcontext->damage_count];
+		i = 0;
+	}
+	
+	if(_brcontext->damage_count == BR_MAX_DAMAGE_RECTS)
+	{
+		uint32_t best = 0;
+		int64_t best_growth = INT64_MAX;
+		for(uint32_t i = 0; i < BR_MAX_DAMAGE_RECTS; i += 1)
+		{
+			brrect r = damage[i];
+			int64_t ux0 = r.x < x0 ? r.x : x0, uy0 = r.y < y0 ? r.y : y0;
+			int64_t ux1 = r.x + r.width > x1 ? r.x + r.width : x1, uy1 = r.y + r.height > y1 ? r.y + r.height : y1;
+			int64_t growth = (ux1 - ux0) * (uy1 - uy0) - (int64_t)r.width * r.height;
+			if(growth < best_growth)
+			{
+				best = i;
+				best_growth = growth;
+			}
+		}
+		brrect r = damage[best];
+		damage[best] = damage[--_brcontext->damage_count];
+		if(r.x < x0) x0 = r.x;
+		if(r.y < y0) y0 = r.y;
+		if(r.x + r.width > x1) x1 = r.x + r.width;
+		if(r.y + r.height > y1) y1 = r.y + r.height;
+		_add_damage(x0, y0, x1, y1);
+		return;
+	}
+	
+	damage[_brcontext->damage_count++] = { x0, y0, x1 - x0, y1 - y0 };
+}
+
+// add the bounds of the current draw to the damage & begin a new draw.
+void _damage_draw()
+{
+	_add_damage(_brcontext->draw_x0, _brcontext->draw_y0, _brcontext->draw_x1, _brcontext->draw_y1);
+	_brcontext->draw_x0 = _brcontext->draw_y0 = INT32_MAX;
+	_brcontext->draw_x1 = _brcontext->draw_y1 = INT32_MIN;
+}
+
+// convert depth from clip-space to raster-space
+// note depth of 1.0 has accuracy error (will result in (depth*range)+1)
+int64_t _convert_depth(float depth)
+{
+	if(_brcontext->db_type == BR_D16)
+		return depth * 0xFFFF;
+	if(_brcontext->db_type == BR_D32)
+		return depth * 0xFFFFFFFF;
+}
+
+// return whether or not a depth is a depth valid for depth buffer
+bool _is_valid_depth(int64_t depth)
+{
+	if(_brcontext->db_type == BR_D16)
+		return (depth >= 0 && depth <= 0xFFFF);
+	if(_brcontext->db_type == BR_D32)
+		return (depth >= 0 && depth <= 0xFFFFFFFF);
+		
+	return false;
+}
+
+// return whether or not a value is a pixel format
+bool _is_pixel_format(uint32_t value)
+{
+	switch(value)
+	{
+		case BR_R8G8B8A8:
+		case BR_R8G8B8:
+		case BR_A8B8G8R8:
+		case BR_B8G8R8:
+		case BR_R5G5B5A1:
+		case BR_R5G5B5:
+		case BR_A1B5G5R5:
+		case BR_B5G5R5:
+		case BR_R3G2B2A1:
+		case BR_R3G3B2:
+		case BR_A1B2G2R3:
+		case BR_B2G3R3:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// return whether or not a value is a format textures may have
+bool _is_texture_format(uint32_t value)
+{
+	return _is_pixel_format(value) || value == BR_D16 || value == BR_D32;
+}
+
+// texel addressing along one axis of a texture, set up once per primitive from its wrap mode (see brTextureWrap).
+// a texel coordinate t is wrapped to t & mask (or to t % modulo, when the wrap period isn't a power of two),
+// mirrored to min(t, mirror - t) and clamped to at most max. modes not using a step make it have no effect.
+typedef struct _texel_address_t _texel_address_t;
+struct _texel_address_t
+{
+	uint32_t wrap;		// BR_CLAMP, BR_REPEAT or BR_MIRROR
+	uint32_t mask;
+	uint32_t modulo;
+	uint32_t mirror;
+	uint32_t max;
+	float scale;		// texels per unit of texture coordinate
+};
+
+// set up the addressing of an axis of 'size' texels with wrap mode 'wrap'.
+void _setup_texel_address(_texel_address_t* address, uint32_t size, uint32_t wrap)
+{
+	address->wrap = wrap;
+	address->mask = 0xFFFFFFFF;
+	address->modulo = 0;
+	address->mirror = 0xFFFFFFFF;
+	address->max = size - 1;
+	// clamped coordinates span the texel centers, wrapped ones whole texels
+	address->scale = wrap == BR_CLAMP ? size - 1 : size;
+	if(wrap == BR_CLAMP)
+		return;
+	
+	uint32_t period = wrap == BR_MIRROR ? size * 2 : size;
+	if(!(period & (period - 1)))
+		address->mask = period - 1;
+	else
+		address->modulo = period;
+	if(wrap == BR_MIRROR)
+		address->mirror = period - 1;
+}
+
+// get the 16.16 fixed-point texel coordinates of 'n' texture coordinates of a primitive along an axis.
+// repeated & mirrored coordinates are first shifted by whole periods so that none are negative.
+// coordinates are clamped to [0,65536) texels, the range of 16.16 (see brTextureWrap).
+void _texel_coords(float* coords, uint32_t n, _texel_address_t* address, uint32_t* out)
+{
+	float shift = 0.0f;
+	if(address->wrap != BR_CLAMP)
+	{
+		float min = coords[0];
+		for(uint32_t i = 1; i < n; i += 1)
+			if(coords[i] < min)
+				min = coords[i];
+		float period = address->wrap == BR_MIRROR ? 2.0f : 1.0f;
+		shift = floor(min / period) * period;
+	}
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		float coord = (coords[i] - shift) * address->scale * 65536;
+		// 4294967040 is the largest float below 2^32; NaN goes to 0
+		out[i] = !(coord > 0) ? 0 : coord >= 4294967040.0f ? 0xFFFFFFFF : (uint32_t)coord;
+	}
+}
+
+// wrap, mirror & clamp a texel coordinate (see _texel_address_t).
+static inline uint32_t _address_texel(uint32_t t, _texel_address_t* address)
+{
+	t &= address->mask;
+	if(address->modulo)
+		t %= address->modulo;
+	uint32_t mirrored = address->mirror - t;
+	t = t < mirrored ? t : mirrored;
+	return t < address->max ? t : address->max;
+}
+
+// get texel from texture and return 0-1 RGBA components
+// assume alpha of 1 in absence alpha channel
+// rows are 'pitch' texels apart and 'address' holds the addressing of x & y (see _texel_address_t).
+// depth textures (BR_D16, BR_D32) return their 0-1 depth in each color channel.
+void _get_texel(uint32_t x, uint32_t y, brvec4* col, void* texture, uint32_t format, _texel_address_t* address, uint32_t pitch, bool compressed)
+{
+	if(!_brcontext || !_is_texture_format(format))
+		return;
+	_BR_STAT(texture_fetches, 1);
+
+	x = _address_texel(x, &address[0]);
+	y = _address_texel(y, &address[1]);
+
+	if(format == BR_D16)
+	{
+		float depth = ((uint16_t*)texture)[y*pitch+x] * (1.0f/0xFFFF);
+		*col = { depth, depth, depth, 1 };
+		return;
+	}
+	if(format == BR_D32)
+	{
+		float depth = ((uint32_t*)texture)[y*pitch+x] * (1.0f/0xFFFFFFFF);
+		*col = { depth, depth, depth, 1 };
+		return;
+	}
 
 	if(!compressed)
 	{
@@ -622,7 +1908,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 				texel_width = 3;
 		}
 		uint8_t* tex = (uint8_t*) texture;
-		uint8_t* texel = &tex[(y*width+x)*texel_width];
+		uint8_t* texel = &tex[(y*pitch+x)*texel_width];
 		switch(format)
 		{
 			case BR_R8G8B8A8:
@@ -712,7 +1998,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 		{
 			case BR_R8G8B8A8:
 			tex32 = (uint32_t*) texture;
-			texel32 = tex32[y*width+x];
+			texel32 = tex32[y*pitch+x];
 			col->x = _BR_R8G8B8A8_R(texel32)*_INV_255;
 			col->y = _BR_R8G8B8A8_G(texel32)*_INV_255;
 			col->z = _BR_R8G8B8A8_B(texel32)*_INV_255;
@@ -720,7 +2006,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_R8G8B8:
 			tex32 = (uint32_t*) texture;
-			texel32 = tex32[y*width+x];
+			texel32 = tex32[y*pitch+x];
 			col->x = _BR_R8G8B8_R(texel32)*_INV_255;
 			col->y = _BR_R8G8B8_G(texel32)*_INV_255;
 			col->z = _BR_R8G8B8_B(texel32)*_INV_255;
@@ -728,7 +2014,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_A8B8G8R8:
 			tex32 = (uint32_t*) texture;
-			texel32 = tex32[y*width+x];
+			texel32 = tex32[y*pitch+x];
 			col->x = _BR_A8B8G8R8_R(texel32)*_INV_255;
 			col->y = _BR_A8B8G8R8_G(texel32)*_INV_255;
 			col->z = _BR_A8B8G8R8_B(texel32)*_INV_255;
@@ -736,7 +2022,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_B8G8R8:
 			tex32 = (uint32_t*) texture;
-			texel32 = tex32[y*width+x];
+			texel32 = tex32[y*pitch+x];
 			col->x = _BR_B8G8R8_R(texel32)*_INV_255;
 			col->y = _BR_B8G8R8_G(texel32)*_INV_255;
 			col->z = _BR_B8G8R8_B(texel32)*_INV_255;
@@ -744,7 +2030,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_R5G5B5A1:
 			tex16 = (uint16_t*) texture;
-			texel16 = tex16[y*width+x];
+			texel16 = tex16[y*pitch+x];
 			col->x = _BR_R5G5B5A1_R(texel16)*_INV_31;
 			col->y = _BR_R5G5B5A1_G(texel16)*_INV_31;
 			col->z = _BR_R5G5B5A1_B(texel16)*_INV_31;
@@ -752,7 +2038,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_R5G5B5:
 			tex16 = (uint16_t*) texture;
-			texel16 = tex16[y*width+x];
+			texel16 = tex16[y*pitch+x];
 			col->x = _BR_R5G5B5_R(texel16)*_INV_31;
 			col->y = _BR_R5G5B5_G(texel16)*_INV_31;
 			col->z = _BR_R5G5B5_B(texel16)*_INV_31;
@@ -760,7 +2046,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_A1B5G5R5:
 			tex16 = (uint16_t*) texture;
-			texel16 = tex16[y*width+x];
+			texel16 = tex16[y*pitch+x];
 			col->x = _BR_A1B5G5R5_R(texel16)*_INV_31;
 			col->y = _BR_A1B5G5R5_G(texel16)*_INV_31;
 			col->z = _BR_A1B5G5R5_B(texel16)*_INV_31;
@@ -768,7 +2054,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_B5G5R5:
 			tex16 = (uint16_t*) texture;
-			texel16 = tex16[y*width+x];
+			texel16 = tex16[y*pitch+x];
 			col->x = _BR_A1B5G5R5_R(texel16)*_INV_31;
 			col->y = _BR_A1B5G5R5_G(texel16)*_INV_31;
 			col->z = _BR_A1B5G5R5_B(texel16)*_INV_31;
@@ -776,7 +2062,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_R3G2B2A1:
 			tex8 = (uint8_t*) texture;
-			texel8 = tex8[y*width+x];
+			texel8 = tex8[y*pitch+x];
 			col->x = _BR_R3G2B2A1_R(texel8)*_INV_7;
 			col->y = _BR_R3G2B2A1_G(texel8)*_INV_3;
 			col->z = _BR_R3G2B2A1_B(texel8)*_INV_3;
@@ -784,7 +2070,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_R3G3B2:
 			tex8 = (uint8_t*) texture;
-			texel8 = tex8[y*width+x];
+			texel8 = tex8[y*pitch+x];
 			col->x = _BR_R3G3B2_R(texel8)*_INV_7;
 			col->y = _BR_R3G3B2_G(texel8)*_INV_7;
 			col->z = _BR_R3G3B2_B(texel8)*_INV_3;
@@ -792,7 +2078,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_A1B2G2R3:
 			tex8 = (uint8_t*) texture;
-			texel8 = tex8[y*width+x];
+			texel8 = tex8[y*pitch+x];
 			col->x = _BR_R3G2B2A1_R(texel8)*_INV_7;
 			col->y = _BR_R3G2B2A1_G(texel8)*_INV_3;
 			col->z = _BR_R3G2B2A1_B(texel8)*_INV_3;
@@ -800,7 +2086,7 @@ void _get_texel(int x, int y, brvec4* col, void* texture, uint32_t format, uint3
 			return;
 			case BR_B2G3R3:
 			tex8 = (uint8_t*) texture;
-			texel8 = tex8[y*width+x];
+			texel8 = tex8[y*pitch+x];
 			col->x = _BR_R3G3B2_R(texel8)*_INV_7;
 			col->y = _BR_R3G3B2_G(texel8)*_INV_7;
 			col->z = _BR_R3G3B2_B(texel8)*_INV_3;
@@ -859,21 +2145,25 @@ brvec4 _vertex_pass(_vertex_t* vertex)
 {
 	brvec4 out;
 	
+	_BR_STAT(vertices_shaded, 1);
 	if(!_brcontext->vshader)
 		return vertex->position;
 	else
 	{
-		void* data = NULL;
+		_BR_STAT_TIME(start);
+		// the attribute block is built on the stack; vertices may be shaded on job threads (see BR_JOBS),
+		// where the allocator (see brSetAllocator) mustn't be called. it holds every attribute, at most.
+		uint64_t block[(2*sizeof(uint32_t) + 2*sizeof(brvec4) + 3*sizeof(void*) + 7) / 8];
+		void* data = block;
 		uint32_t attrib_count = 0;
-		uint32_t size = 0;
 		
-		if(_brcontext->sh_vtype)		{ attrib_count += 1; size += sizeof(uint32_t);}
-		if(_brcontext->sh_vposition)	{ attrib_count += 1; size += sizeof(brvec4);  }
-		if(_brcontext->sh_vcolor)		{ attrib_count += 1; size += sizeof(brvec4*); }
-		if(_brcontext->sh_vnormals)		{ attrib_count += 1; size += sizeof(brvec3*); }
-		if(_brcontext->sh_vtcoords)		{ attrib_count += 1; size += sizeof(brvec2*); }
-		
-		data = malloc(size);
+		if(_brcontext->sh_vtype)		attrib_count += 1;
+		if(_brcontext->sh_vposition)	attrib_count += 1;
+		if(_brcontext->sh_vcolor)		attrib_count += 1;
+		if(_brcontext->sh_vnormals)		attrib_count += 1;
+		if(_brcontext->sh_vtcoords)		attrib_count += 1;
+		if(_brcontext->sh_instance_id)	attrib_count += 1;
+		if(_brcontext->sh_instance_attrib)	attrib_count += 1;
 		
 		uint32_t format[attrib_count];
 		uint32_t i = 0;
@@ -883,11 +2173,14 @@ brvec4 _vertex_pass(_vertex_t* vertex)
 		if(_brcontext->sh_vcolor)		{ format[i] = BR_VERTEX_COLOR; *((brvec4**)(data+offset)) = vertex->color; offset += sizeof(brvec4*); i += 1; }
 		if(_brcontext->sh_vnormals)		{ format[i] = BR_VERTEX_NORMALS; *((brvec3**)(data+offset)) = vertex->normals; offset += sizeof(brvec3*); i += 1; }
 		if(_brcontext->sh_vtcoords)		{ format[i] = BR_VERTEX_TEXTURE_COORDINATES; *((brvec2**)(data+offset)) = vertex->tcoords; offset += sizeof(brvec2*); i += 1; }
+		if(_brcontext->sh_instance_id)	{ format[i] = BR_INSTANCE_ID; *((uint32_t*)(data+offset)) = _brcontext->instance_id; offset += sizeof(uint32_t); i += 1; }
+		if(_brcontext->sh_instance_attrib)	{ format[i] = BR_INSTANCE_ATTRIBUTE; *((brvec4*)(data+offset)) = _brcontext->instance_attrib; offset += sizeof(brvec4); i += 1; }
 		
 		if(attrib_count)
 			out = _brcontext->vshader(data, format, attrib_count);
 		else
 			out = _brcontext->vshader(NULL, NULL, 0);
+		_BR_STAT_ELAPSED(vertex_ns, start);
 	}
 	
 	return out;
@@ -926,7 +2219,7 @@ void _init_fragment(_fragment_t* fragment)
 	if(_brcontext->sh_fposition)	{ fragment->pass_attrib_count += 1; data_size += sizeof(brvec2i); }
 	if(_brcontext->sh_fdepth)		{ fragment->pass_attrib_count += 1; data_size += sizeof(float); }
 	
-	fragment->pass_attribs = (uint32_t*) calloc(fragment->pass_attrib_count, sizeof(uint32_t));
+	fragment->pass_attribs = (uint32_t*) _br_calloc(fragment->pass_attrib_count, sizeof(uint32_t));
 	uint32_t* attribs = fragment->pass_attribs;
 	if(_brcontext->sh_prim_color)	{ attribs[i] = BR_PRIMITIVE_COLOR; i += 1; }
 	if(_brcontext->sh_tex_color)	{ attribs[i] = BR_TEXTURE_COLOR;   i += 1; }
@@ -937,7 +2230,7 @@ void _init_fragment(_fragment_t* fragment)
 	if(_brcontext->sh_fdepth)		{ attribs[i] = BR_FRAGMENT_DEPTH;    i += 1; }
 	
 	if(data_size)
-		fragment->pass_data = malloc(data_size);
+		fragment->pass_data = _br_malloc(data_size);
 }
 
 // pass a fragment (see _init_fragment and _fragment_t) through the fragment shader.
@@ -973,6 +2266,9 @@ struct _triangle_t
 	// texture coordinates (0-1), origin in bottom left
 	brvec2 tcoords0, tcoords1, tcoords2;
 	
+	// texture unit sampled
+	uint32_t texture;
+	
 	// pointer to a triangle that this triangle may have been built off of, otherwise NULL.
 	// for original (parent) triangles, this should be NULL.
 	// for processed (clipped) triangles (handled internally) this will point to the original triangle.
@@ -989,15 +2285,9 @@ struct _raster_triangle_t
 	// will change per sub-triangle
 	float x0, x1, x2;
 	float y0, y1, y2;
-	// original 24.8 fixed-point raster-space coordinates of vertices (sorted @ triangle processing)
-	// for accuracy. This is the region through which bary are interpolated 
-	// and the triangle's edge slopes are calculated. Will not vary among clipped triangles.
+	// original 24.8 fixed-point raster-space coordinates of vertices
+	// for accuracy. This is the region through which bary are interpolated. Will not vary among clipped triangles.
 	brvec2i orig_v0, orig_v1, orig_v2;
-	// overrides barycentric coordinates of vertices
-	// used for sorting vertices during spliting of triangles
-	brvec3 bary0;
-	brvec3 bary1;
-	brvec3 bary2;
 	// vertex z and w; w is in clip-space and z in raster-space
 	int64_t z0, z1, z2;
 	float w0, w1, w2;
@@ -1007,18 +2297,104 @@ struct _raster_triangle_t
 	brvec4ui rgba2;
 	// 16.16 fixed-point texel coordinates (*65536)
 	brvec2ui tx0, tx1, tx2;
-	// whether or not to draw top row
-	bool draw_top;
 	// texture unit information @ time of raster
 	void* texture;
 	uint32_t texture_width;
 	uint32_t texture_height;
+	_texel_address_t texture_address[2];
+	uint32_t texture_pitch;
 	uint32_t texture_format;
 	bool texture_compressed;
 	bool complete_texture_unit;
 };
 
-// raster a flat bottomed or flat topped triangle
+// the edges of a triangle of 24.8 fixed-point vertices, wound so that its interior is on their positive side.
+// a pixel is covered when its sample (x<<8, y<<8) is on the positive side of all three edges; samples exactly on
+// an edge are covered only if it is a top or left edge, so pixels on an edge shared by two triangles are drawn once.
+// every triangle rasterizer decides coverage this way.
+typedef struct _triangle_edges_t _triangle_edges_t;
+struct _triangle_edges_t
+{
+	brvec2i v[3];		// vertices; the last two are swapped if needed to give a positive area
+	bool swapped;
+	int64_t area;		// twice the area of the triangle, in 24.8 units squared
+	int bias[3];		// 0 if edge v[i+1] -> v[i+2] (the edge opposite v[i]) owns samples on it, otherwise -1
+};
+
+// set up the edges of the triangle v0, v1, v2; false if it has no area.
+bool _setup_triangle_edges(brvec2i v0, brvec2i v1, brvec2i v2, _triangle_edges_t* edges)
+{
+	int64_t area = (int64_t)(v1.x - v0.x) * (v2.y - v0.y) - (int64_t)(v1.y - v0.y) * (v2.x - v0.x);
+	if(!area)
+		return false;
+	edges->swapped = area < 0;
+	edges->v[0] = v0;
+	edges->v[1] = edges->swapped ? v2 : v1;
+	edges->v[2] = edges->swapped ? v1 : v2;
+	edges->area = area < 0 ? -area : area;
+	for(uint32_t i = 0; i < 3; i += 1)
+	{
+		brvec2i b = edges->v[(i+1)%3], c = edges->v[(i+2)%3];
+		// raster y points down, so with a positive area left edges run up and top edges run right
+		edges->bias[i] = ((c.y - b.y) < 0 || ((c.y - b.y) == 0 && (c.x - b.x) > 0)) ? 0 : -1;
+	}
+	return true;
+}
+
+// the edge function of the edge opposite v[i] at the 24.8 point (px, py); twice the area of the triangle
+// the point makes with that edge, so the weight of v[i] in the point's barycentric coordinates.
+static inline int64_t _edge_function(_triangle_edges_t* edges, uint32_t i, int px, int py)
+{
+	brvec2i b = edges->v[(i+1)%3], c = edges->v[(i+2)%3];
+	return (int64_t)(c.x - b.x) * (py - b.y) - (int64_t)(c.y - b.y) * (px - b.x);
+}
+
+// whether or not the 24.8 point (px, py) is covered by the triangle.
+static inline bool _edges_cover(_triangle_edges_t* edges, int px, int py)
+{
+	return _edge_function(edges, 0, px, py) + edges->bias[0] >= 0 && _edge_function(edges, 1, px, py) + edges->bias[1] >= 0
+		&& _edge_function(edges, 2, px, py) + edges->bias[2] >= 0;
+}
+
+// narrow [*first, *last] to the pixels of row y that the triangle covers (as _edges_cover decides at their samples).
+// false if it covers none of them.
+bool _covered_span(_triangle_edges_t* edges, int y, int* first, int* last)
+{
+	int64_t lo = *first, hi = *last;
+	for(uint32_t i = 0; i < 3; i += 1)
+	{
+		brvec2i b = edges->v[(i+1)%3], c = edges->v[(i+2)%3];
+		// the edge function is k - dy*px, so the sample is covered where dy*(x<<8) <= k
+		int64_t dy = c.y - b.y;
+		int64_t k = (int64_t)(c.x - b.x) * ((y<<8) - b.y) + dy * b.x + edges->bias[i];
+		if(dy > 0)
+		{
+			// x <= floor(k / (dy*256))
+			int64_t m = dy * 256;
+			int64_t x = k / m - (k % m < 0);
+			if(x < hi)
+				hi = x;
+		}
+		else if(dy < 0)
+		{
+			// x >= ceil(k / (dy*256)) = -floor(k / (-dy*256))
+			int64_t m = -dy * 256;
+			int64_t x = -(k / m - (k % m < 0));
+			if(x > lo)
+				lo = x;
+		}
+		else if(k < 0)
+			return false;
+		if(lo > hi)
+			return false;
+	}
+	*first = lo;
+	*last = hi;
+	return true;
+}
+
+// raster a triangle a scanline at a time. coverage is tested against x0..y2 (see _triangle_edges_t), and
+// attributes are interpolated across orig_v0..orig_v2, so clipped triangles are handled too.
 void _raster_triangle(_raster_triangle_t* params)
 {
 	if(!params)
@@ -1027,22 +2403,54 @@ void _raster_triangle(_raster_triangle_t* params)
 		return;
 		
 	bool depth_test = (_brcontext->depth_test && _brcontext->db);
-	bool plot_color = _brcontext->cb;
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
 	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
 	bool textured = (_brcontext->texture && params->complete_texture_unit);
+	// without color writes or a fragment shader (that may discard), only depth is needed
+	bool depth_only = (!plot_color && !_brcontext->fshader);
+	uint64_t samples = 0;
+	
+	// 24.8 fixed point coverage triangle
+	brvec2i v0 = { (int)(params->x0 * 256.0f), (int)(params->y0 * 256.0f) };
+	brvec2i v1 = { (int)(params->x1 * 256.0f), (int)(params->y1 * 256.0f) };
+	brvec2i v2 = { (int)(params->x2 * 256.0f), (int)(params->y2 * 256.0f) };
+	_triangle_edges_t edges;
+	if(!_setup_triangle_edges(v0, v1, v2, &edges))
+		return;
+	int min_y = v0.y < v1.y ? (v0.y < v2.y ? v0.y : v2.y) : (v1.y < v2.y ? v1.y : v2.y);
+	int max_y = v0.y > v1.y ? (v0.y > v2.y ? v0.y : v2.y) : (v1.y > v2.y ? v1.y : v2.y);
+	min_y = (min_y + 255) >> 8;
+	max_y = max_y >> 8;
+	if(min_y < _brcontext->clip_y0) min_y = _brcontext->clip_y0;
+	if(max_y >= _brcontext->clip_y1) max_y = _brcontext->clip_y1 - 1;
+	if(min_y > max_y)
+		return;
+	
+	// 16.16 linear barycentric coordinates are measured across the original (unclipped) triangle,
+	// and step by a constant amount from pixel to pixel
+	brvec2i orig[3] = { params->orig_v0, params->orig_v1, params->orig_v2 };
+	int64_t orig_area = (int64_t)(orig[1].x - orig[0].x) * (orig[2].y - orig[0].y) - (int64_t)(orig[1].y - orig[0].y) * (orig[2].x - orig[0].x);
+	if(!orig_area)
+		return;
+	float inv_area = 65536.0f / orig_area;
+	float inc_bx = -(orig[2].y - orig[1].y) * 256 * inv_area;
+	float inc_by = -(orig[0].y - orig[2].y) * 256 * inv_area;
+	float inc_bz = -(orig[1].y - orig[0].y) * 256 * inv_area;
+	
+	// blended 8-bit RGBA color is gathered per scanline and blended as a span
+	uint32_t* span = NULL;
+	uint8_t* span_mask = NULL;
+	if(plot_color && _brcontext->blend && (_brcontext->cb_type == BR_R8G8B8A8 || _brcontext->cb_type == BR_A8B8G8R8))
+	{
+		span = _brcontext->blend_span;
+		span_mask = _brcontext->blend_span_mask;
+	}
 	
 	// for fragment passes
 	_fragment_t frag_pass;
 	if(_brcontext->fshader)
 		_init_fragment(&frag_pass);
 		
-	// 24.8 fixed point
-	int x0 = params->x0 * 256.0f;
-	int x1 = params->x1 * 256.0f;
-	int x2 = params->x2 * 256.0f;
-	int y0 = params->y0 * 256.0f;
-	int y1 = params->y1 * 256.0f;
-	int y2 = params->y2 * 256.0f;
 	// 16.16 fixed point attributes
 	uint32_t r0 = params->rgba0.x;
 	uint32_t g0 = params->rgba0.y;
@@ -1062,16 +2470,6 @@ void _raster_triangle(_raster_triangle_t* params)
 	uint32_t ty0 = params->tx0.y;
 	uint32_t ty1 = params->tx1.y;
 	uint32_t ty2 = params->tx2.y;
-
-	// for bary interpolation
-	brvec2i a,b;
-	a.x = (params->orig_v1.x>>8) - (params->orig_v0.x>>8);
-	a.y = (params->orig_v1.y>>8) - (params->orig_v0.y>>8);
-	b.x = (params->orig_v2.x>>8) - (params->orig_v0.x>>8);
-	b.y = (params->orig_v2.y>>8) - (params->orig_v0.y>>8);
-	float den = _fdiv(256.0f, (a.x*b.y-b.x*a.y));
-	
-	int64_t depth = 0;
 	
 	// X Y coordinates are 24.8
 	// interpolate attribs as 16.16 fixed point
@@ -1086,491 +2484,470 @@ void _raster_triangle(_raster_triangle_t* params)
 		inv_v2_w = _fdiv(1.0f, fabs(params->w2));
 	}
 
-	// flat bottom
-	if(y1 == y2 && x1 != x2)
+	for(int y = min_y; y <= max_y; y += 1)
 	{
-//		int invslope1 = ((float)(params->orig_v1.x - params->orig_v0.x) / (float)(params->orig_v1.y - params->orig_v0.y)) * 256.0f;
-//		int invslope2 = ((float)(params->orig_v2.x - params->orig_v0.x) / (float)(params->orig_v2.y - params->orig_v0.y)) * 256.0f;
-		int invslope1 = _idiv(params->orig_v1.x - params->orig_v0.x, (params->orig_v1.y - params->orig_v0.y)>>8);
-		int invslope2 = _idiv(params->orig_v2.x - params->orig_v0.x, (params->orig_v2.y - params->orig_v0.y)>>8);
-
-		// 24.8 scanline left and right x
-		int curfx1 = x0;
-		int curfx2 = x0;
-
-		int y1_int = y1 >> 8;
+		int first = _brcontext->clip_x0, last = _brcontext->clip_x1 - 1;
+		if(!_covered_span(&edges, y, &first, &last))
+			continue;
+
+		// linear bary at the first pixel of the scanline
+		int px = first<<8, py = y<<8;
+		float bx = ((int64_t)(orig[2].x - orig[1].x) * (py - orig[1].y) - (int64_t)(orig[2].y - orig[1].y) * (px - orig[1].x)) * inv_area;
+		float by = ((int64_t)(orig[0].x - orig[2].x) * (py - orig[2].y) - (int64_t)(orig[0].y - orig[2].y) * (px - orig[2].x)) * inv_area;
+		float bz = ((int64_t)(orig[1].x - orig[0].x) * (py - orig[0].y) - (int64_t)(orig[1].y - orig[0].y) * (px - orig[0].x)) * inv_area;
+		
+		uint32_t pixel_index = y * _brcontext->rb_pitch + first;
+		uint32_t span_length = 0;
+		if(span)
+		{
+			span_length = last - first + 1;
+			memset(span_mask, 0, span_length);
+		}
 
-		for(int y = (y0>>8)+1; y <= y1_int; y += 1)
+		for(int x = first; x <= last; x += 1, pixel_index += 1, bx += inc_bx, by += inc_by, bz += inc_bz)
 		{
-			if(y < 0)
+			// samples on an edge may land just outside of it
+			brvec3ui linear_bary = { (uint32_t)(bx > 0 ? bx : 0), (uint32_t)(by > 0 ? by : 0), (uint32_t)(bz > 0 ? bz : 0) };
+			brvec3ui bary = linear_bary;
+			if(_brcontext->persp_corr)
 			{
-				curfx1 += invslope1;
-				curfx2 += invslope2;
-				continue;
+				float w = 65536.0f / ((int)(bary.x*inv_v0_w + bary.y*inv_v1_w + bary.z*inv_v2_w));
+				bary.x *= inv_v0_w * w;
+				bary.y *= inv_v1_w * w;
+				bary.z *= inv_v2_w * w;
 			}
-			if(y >= _brcontext->rb_height)
-				break;
 
-			int cx1, cx2;
-			int sx1, sx2;
-			cx1 = curfx1;
-			cx2 = curfx2;
-			if(cx1 > cx2)
+			brvec3 flt_bary = { (float)bary.x * _INV_65536, 
+				(float)bary.y * _INV_65536, (float)bary.z * _INV_65536 };
+
+			// safest to floating-point interpolate depths; they are in a large range and do not fit nicely to 16.16 fixed-point
+			int64_t depth = 0;
+			depth = params->z0 * flt_bary.x + params->z1 * flt_bary.y + params->z2 * flt_bary.z;
+
+			_BR_STAT(fragments_generated, 1);
+			if(depth_test)
 			{
-				int tmp = cx1;
-				cx1 = cx2;
-				cx2 = tmp;
+				int64_t dst = _get_depth(pixel_index);
+				if(!_is_valid_depth(depth) || depth > dst)
+				{
+					_BR_STAT(depth_failed, 1);
+					continue;
+				}
+				_BR_STAT(depth_passed, 1);
 			}
-			sx1 = (cx1-128)>>8;
-			sx2 = (cx2+128)>>8;
-
-			if(sx1 > sx2)
+			
+			if(depth_only)
 			{
-				curfx1 += invslope1;
-				curfx2 += invslope2;
+				samples += 1;
+				if(plot_depth && _is_valid_depth(depth))
+					_plot_depth(pixel_index, depth);
 				continue;
 			}
-			int sy = y;
 
-			if(sx1 < 0)
-				sx1 = 0;
-			if(sx1 >= _brcontext->rb_width)
+			// 16.16 attributes multiplied by 16.16 barycentric coordinates
+			uint32_t r = (((uint64_t)r0 * bary.x)>>16) + (((uint64_t)r1 * bary.y)>>16) + (((uint64_t)r2 * bary.z)>>16);
+			uint32_t g = (((uint64_t)g0 * bary.x)>>16) + (((uint64_t)g1 * bary.y)>>16) + (((uint64_t)g2 * bary.z)>>16);
+			uint32_t b = (((uint64_t)b0 * bary.x)>>16) + (((uint64_t)b1 * bary.y)>>16) + (((uint64_t)b2 * bary.z)>>16);
+			uint32_t a = (((uint64_t)a0 * bary.x)>>16) + (((uint64_t)a1 * bary.y)>>16) + (((uint64_t)a2 * bary.z)>>16);
+			uint32_t tx = 0;
+			uint32_t ty = 0;
+			if(params->complete_texture_unit)
 			{
-				curfx1 += invslope1;
-				curfx2 += invslope2;
-				continue;
+				tx = (((uint64_t)tx0 * bary.x)>>16) + (((uint64_t)tx1 * bary.y)>>16) + (((uint64_t)tx2 * bary.z)>>16);
+				ty = (((uint64_t)ty0 * bary.x)>>16) + (((uint64_t)ty1 * bary.y)>>16) + (((uint64_t)ty2 * bary.z)>>16);
 			}
 
-			int slength = (sx2-sx1)+1;
-
-			// do scanline sx1->sx2 @ y sy
-			// calculate 24.8 bary coords for start and end of scanline
-			// if _brcontext->persp_corr, perspective correct bary
-			// convert bary to 16.16 to interpolate 16.16 fixed point attributes
-			// for texel coordinates, discard last 16 bits.
-			// to convert from 16.16 to float, divide by 65536 (use _INV_65536).
+			// actual texel coordinates
+			tx = tx>>16;
+			ty = ty>>16;
 
-			// if appropriate, scanline beginning/end will be offset by 256 (1 pixel; working with 1/256 coordinates)
-			// in order to avoid sub-pixels that fall outside of triangle given Y increases by a full pixel
-			// If this fails to generate valid barycentric coordinates, a loop will be run to iterate by half a pixel
-			// until valid bary coordinates are generated.
+			// fragment shading operations
+			brvec4ui rgba = { r, g, b, a };
+			if(_brcontext->fshader || textured)
+			{
+				brvec4 primary = { r*_INV_65536, g*_INV_65536, b*_INV_65536, a*_INV_65536 };
+				brvec4 secondary = { 0,0,0,0 };
+				if(textured)
+					_get_texel(tx, ty, &secondary, params->texture, params->texture_format, 
+						params->texture_address, params->texture_pitch, params->texture_compressed);
+				if(_brcontext->fshader)
+				{
+					if(textured)	frag_pass.color = secondary;
+					else			frag_pass.color = primary;
+					frag_pass.primitive_color = primary;
+					frag_pass.texture_color = secondary;
+					frag_pass.linear_bary.x = linear_bary.x * _INV_65536;
+					frag_pass.linear_bary.y = linear_bary.y * _INV_65536;
+					frag_pass.linear_bary.z = linear_bary.z * _INV_65536;
+					frag_pass.bary = flt_bary;
+					frag_pass.position.x = x;
+					frag_pass.position.y = y;
+					frag_pass.discard = false;
 
-			brvec3 bary_s1;
-			brvec2i c;
-			if(sx1 != sx2)
-				c.x = ((sx1<<8)+256) - params->orig_v0.x;
-			else
-				c.x = cx1 - params->orig_v0.x;
-			c.y = (y<<8) - params->orig_v0.y;
-			bary_s1.y = (c.x*b.y-b.x*c.y)*den;
-			bary_s1.z = (a.x*c.y-c.x*a.y)*den;
-			bary_s1.x = 65536.0f - bary_s1.y - bary_s1.z;
-			if(bary_s1.x < 0.0f || bary_s1.y < 0.0f || bary_s1.z < 0.0f) {
-				int x = (sx1<<8)+384;
-				bool cont = false;
-				while(bary_s1.x < 0.0f || bary_s1.y < 0.0f || bary_s1.z < 0.0f) {
-					c.x = x - params->orig_v0.x;
-					bary_s1.y = (c.x*b.y-b.x*c.y)*den;
-					bary_s1.z = (a.x*c.y-c.x*a.y)*den;
-					bary_s1.x = 65536.0f - bary_s1.y - bary_s1.z;
-					x += 128;
-					if(x > cx2) {
-						curfx1 += invslope1;
-						curfx2 += invslope2;
-						cont = true;
-						break;
-					}
+					// convert result fragment to 16.16, setting 'rgba'
+					brvec4 color = _fragment_pass(&frag_pass);
+					if(frag_pass.discard)
+						continue;
+					rgba.x = color.x * 65536.0f;
+					rgba.y = color.y * 65536.0f;
+					rgba.z = color.z * 65536.0f;
+					rgba.w = color.w * 65536.0f;
+				}
+				else
+				{
+					// convert secondary color to 16.16, setting 'rgba'
+					rgba.x = secondary.x * 65536.0f;
+					rgba.y = secondary.y * 65536.0f;	
+					rgba.z = secondary.z * 65536.0f;
+					rgba.w = secondary.w * 65536.0f;
 				}
-				if(cont) continue;
 			}
+
+			samples += 1;
+			if(span)
 			{
-				float bx = bary_s1.x;
-				float by = bary_s1.y;
-				float bz = bary_s1.z;
-				bary_s1.x = bx * (params->bary0.x) + by * (params->bary1.x) + bz * (params->bary2.x);
-				bary_s1.y = bx * (params->bary0.y) + by * (params->bary1.y) + bz * (params->bary2.y);
-				bary_s1.z = bx * (params->bary0.z) + by * (params->bary1.z) + bz * (params->bary2.z);
+				span[x-first] = _pack_rgba8(rgba, _brcontext->cb_type);
+				span_mask[x-first] = 1;
 			}
+			else if(plot_color)
+				_plot_pixel(pixel_index, rgba, _brcontext->blend);
 
-			brvec3 bary_s2;
-			if(sx1 != sx2)
-				c.x = ((sx2<<8)-256) - params->orig_v0.x;
-			else
-				c.x = cx2 - params->orig_v0.x;
-			bary_s2.y = (c.x*b.y-b.x*c.y)*den;
-			bary_s2.z = (a.x*c.y-c.x*a.y)*den;
-			bary_s2.x = 65536.0f - bary_s2.y - bary_s2.z;
-			if(bary_s2.x < 0.0f || bary_s2.y < 0.0f || bary_s2.z < 0.0f) {
-				int x = (sx2<<8)-384;
-				bool cont = false;
-				while(bary_s2.x < 0.0f || bary_s2.y < 0.0f || bary_s2.z < 0.0f) {
-					c.x = x - params->orig_v0.x;
-					bary_s2.y = (c.x*b.y-b.x*c.y)*den;
-					bary_s2.z = (a.x*c.y-c.x*a.y)*den;
-					bary_s2.x = 65536.0f - bary_s2.y - bary_s2.z;
-					x -= 128;
-					if(x < cx1) {
-						curfx1 += invslope1;
-						curfx2 += invslope2;
-						cont = true;
-						break;
-					}
-				}
-				if(cont) continue;
-			}
+			if(plot_depth && _is_valid_depth(depth))
+				_plot_depth(pixel_index, depth);
+		}
+		if(span)
+			_blend_span_rgba8(y * _brcontext->rb_pitch + first, span, span_mask, span_length);
+	}
+	
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
+	if(_brcontext->fshader) {
+	if(frag_pass.pass_data)
+		_br_free(frag_pass.pass_data);
+	if(frag_pass.pass_attribs)
+		_br_free(frag_pass.pass_attribs);
+	}
+}
+
+// raster a small triangle (bounding box within BR_SMALL_TRIANGLE_SIZE pixels) in one pass, taking barycentric
+// coordinates straight from the edge functions that decide its coverage (see _triangle_edges_t).
+// the triangle must not be clipped (orig_v0..orig_v2 are its own vertices).
+void _raster_small_triangle(_raster_triangle_t* params)
+{
+	bool depth_test = (_brcontext->depth_test && _brcontext->db);
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
+	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
+	bool textured = (_brcontext->texture && params->complete_texture_unit);
+	bool depth_only = (!plot_color && !_brcontext->fshader);
+	uint64_t samples = 0;
+	
+	// 24.8 fixed point vertices; edges.v[1] & edges.v[2] are v1 & v2, swapped (via index) to give a positive area
+	_triangle_edges_t edges;
+	if(!_setup_triangle_edges(params->orig_v0, params->orig_v1, params->orig_v2, &edges))
+		return;
+	uint32_t i1 = edges.swapped ? 2 : 1, i2 = edges.swapped ? 1 : 2;
+	brvec2i* v = edges.v;
+	
+	int min_x = v[0].x < v[1].x ? (v[0].x < v[2].x ? v[0].x : v[2].x) : (v[1].x < v[2].x ? v[1].x : v[2].x);
+	int min_y = v[0].y < v[1].y ? (v[0].y < v[2].y ? v[0].y : v[2].y) : (v[1].y < v[2].y ? v[1].y : v[2].y);
+	int max_x = v[0].x > v[1].x ? (v[0].x > v[2].x ? v[0].x : v[2].x) : (v[1].x > v[2].x ? v[1].x : v[2].x);
+	int max_y = v[0].y > v[1].y ? (v[0].y > v[2].y ? v[0].y : v[2].y) : (v[1].y > v[2].y ? v[1].y : v[2].y);
+	min_x = (min_x + 255) >> 8;
+	min_y = (min_y + 255) >> 8;
+	max_x = max_x >> 8;
+	max_y = max_y >> 8;
+	if(min_x < _brcontext->clip_x0) min_x = _brcontext->clip_x0;
+	if(min_y < _brcontext->clip_y0) min_y = _brcontext->clip_y0;
+	if(max_x >= _brcontext->clip_x1) max_x = _brcontext->clip_x1 - 1;
+	if(max_y >= _brcontext->clip_y1) max_y = _brcontext->clip_y1 - 1;
+	if(min_x > max_x || min_y > max_y)
+		return;
+	
+	// per-vertex attributes in the order of v
+	brvec4ui rgba[3] = { params->rgba0, params->rgba1, params->rgba2 };
+	brvec2ui tx[3] = { params->tx0, params->tx1, params->tx2 };
+	int64_t z[3] = { params->z0, params->z1, params->z2 };
+	float inv_w[3] = { 0, 0, 0 };
+	if(_brcontext->persp_corr)
+	{
+		inv_w[0] = _fdiv(1.0f, fabs(params->w0));
+		inv_w[1] = _fdiv(1.0f, fabs(params->w1));
+		inv_w[2] = _fdiv(1.0f, fabs(params->w2));
+	}
+	float inv_area = 65536.0f / edges.area;
+	
+	_fragment_t frag_pass;
+	if(_brcontext->fshader)
+		_init_fragment(&frag_pass);
+	
+	for(int y = min_y; y <= max_y; y += 1)
+	{
+		int first = min_x, last = max_x;
+		if(!_covered_span(&edges, y, &first, &last))
+			continue;
+		uint32_t pixel_index = y * _brcontext->rb_pitch + first;
+		for(int x = first; x <= last; x += 1, pixel_index += 1)
+		{
+			int px = x<<8, py = y<<8;
+			// 16.16 linear bary of v0, v1, v2
+			uint32_t lb[3];
+			lb[0]  = _edge_function(&edges, 0, px, py) * inv_area;
+			lb[i1] = _edge_function(&edges, 1, px, py) * inv_area;
+			lb[i2] = _edge_function(&edges, 2, px, py) * inv_area;
+			brvec3ui linear_bary = { lb[0], lb[1], lb[2] };
+			
+			brvec3ui bary = linear_bary;
+			if(_brcontext->persp_corr)
 			{
-				float bx = bary_s2.x;
-				float by = bary_s2.y;
-				float bz = bary_s2.z;
-				bary_s2.x = bx * (params->bary0.x) + by * (params->bary1.x) + bz * (params->bary2.x);
-				bary_s2.y = bx * (params->bary0.y) + by * (params->bary1.y) + bz * (params->bary2.y);
-				bary_s2.z = bx * (params->bary0.z) + by * (params->bary1.z) + bz * (params->bary2.z);
+				float w = 65536.0f / ((int)(bary.x*inv_w[0] + bary.y*inv_w[1] + bary.z*inv_w[2]));
+				bary.x *= inv_w[0] * w;
+				bary.y *= inv_w[1] * w;
+				bary.z *= inv_w[2] * w;
 			}
 			
-			int inc_bx = (bary_s2.x - bary_s1.x)/slength;
-			int inc_by = (bary_s2.y - bary_s1.y)/slength;
-			int inc_bz = (bary_s2.z - bary_s1.z)/slength;
+			brvec3 flt_bary = { (float)bary.x * _INV_65536, 
+				(float)bary.y * _INV_65536, (float)bary.z * _INV_65536 };
 			
-			uint32_t pixel_index = y * _brcontext->rb_width + sx1;
-
-			brvec3ui linear_bary;
-			linear_bary.x = bary_s1.x;
-			linear_bary.y = bary_s1.y;
-			linear_bary.z = bary_s1.z;
-			for(int x = sx1; x <= sx2; x += 1)
+			int64_t depth = z[0] * flt_bary.x + z[1] * flt_bary.y + z[2] * flt_bary.z;
+			_BR_STAT(fragments_generated, 1);
+			if(depth_test)
 			{
-				if(x >= _brcontext->rb_width)
-					break;
-
-				if((x<<8) >= cx2/* || (y<<8) >= params->orig_v2.y*/)
-					break;
-
-				brvec3ui bary = linear_bary;
-				if(_brcontext->persp_corr)
-				{
-					float w = 65536.0f / ((int)(bary.x*inv_v0_w + bary.y*inv_v1_w + bary.z*inv_v2_w));
-					bary.x *= inv_v0_w * w;
-					bary.y *= inv_v1_w * w;
-					bary.z *= inv_v2_w * w;
-				}
-
-				brvec3 flt_bary = { (float)bary.x * _INV_65536, 
-					(float)bary.y * _INV_65536, (float)bary.z * _INV_65536 };
-
-				// safest to floating-point interpolate depths; they are in a large range and do not fit nicely to 16.16 fixed-point
-				int64_t depth = 0;
-				depth = params->z0 * flt_bary.x + params->z1 * flt_bary.y + params->z2 * flt_bary.z;
-
-				if(depth_test)
+				if(!_is_valid_depth(depth) || depth > _get_depth(pixel_index))
 				{
-					int64_t dst = _get_depth(pixel_index);
-					if(!_is_valid_depth(depth) || depth > dst)
-					{
-						linear_bary.x += inc_bx;
-						linear_bary.y += inc_by;
-						linear_bary.z += inc_bz;
-						pixel_index += 1;
-						continue;
-					}
+					_BR_STAT(depth_failed, 1);
+					continue;
 				}
-
-				// 16.16 attributes multiplied by 16.16 barycentric coordinates
-				uint32_t r = (((uint32_t)r0 * bary.x)>>16) + (((uint32_t)r1 * bary.y)>>16) + (((uint32_t)r2 * bary.z)>>16);
-				uint32_t g = (((uint32_t)g0 * bary.x)>>16) + (((uint32_t)g1 * bary.y)>>16) + (((uint32_t)g2 * bary.z)>>16);
-				uint32_t b = (((uint32_t)b0 * bary.x)>>16) + (((uint32_t)b1 * bary.y)>>16) + (((uint32_t)b2 * bary.z)>>16);
-				uint32_t a = (((uint32_t)a0 * bary.x)>>16) + (((uint32_t)a1 * bary.y)>>16) + (((uint32_t)a2 * bary.z)>>16);
-				uint32_t tx = 0;
-				uint32_t ty = 0;
-				if(params->complete_texture_unit)
+				_BR_STAT(depth_passed, 1);
+			}
+			
+			if(depth_only)
+			{
+				samples += 1;
+				if(plot_depth && _is_valid_depth(depth))
+					_plot_depth(pixel_index, depth);
+				continue;
+			}
+			
+			// 16.16 attributes multiplied by 16.16 barycentric coordinates
+			uint32_t r = (((uint64_t)rgba[0].x * bary.x)>>16) + (((uint64_t)rgba[1].x * bary.y)>>16) + (((uint64_t)rgba[2].x * bary.z)>>16);
+			uint32_t g = (((uint64_t)rgba[0].y * bary.x)>>16) + (((uint64_t)rgba[1].y * bary.y)>>16) + (((uint64_t)rgba[2].y * bary.z)>>16);
+			uint32_t bl = (((uint64_t)rgba[0].z * bary.x)>>16) + (((uint64_t)rgba[1].z * bary.y)>>16) + (((uint64_t)rgba[2].z * bary.z)>>16);
+			uint32_t al = (((uint64_t)rgba[0].w * bary.x)>>16) + (((uint64_t)rgba[1].w * bary.y)>>16) + (((uint64_t)rgba[2].w * bary.z)>>16);
+			brvec4ui color = { r, g, bl, al };
+			
+			if(_brcontext->fshader || textured)
+			{
+				brvec4 primary = { r*_INV_65536, g*_INV_65536, bl*_INV_65536, al*_INV_65536 };
+				brvec4 secondary = { 0,0,0,0 };
+				if(textured)
 				{
-					tx = (((uint64_t)tx0 * bary.x)>>16) + (((uint64_t)tx1 * bary.y)>>16) + (((uint64_t)tx2 * bary.z)>>16);
-					ty = (((uint64_t)ty0 * bary.x)>>16) + (((uint64_t)ty1 * bary.y)>>16) + (((uint64_t)ty2 * bary.z)>>16);
+					uint32_t tx_x = (((uint64_t)tx[0].x * bary.x)>>16) + (((uint64_t)tx[1].x * bary.y)>>16) + (((uint64_t)tx[2].x * bary.z)>>16);
+					uint32_t tx_y = (((uint64_t)tx[0].y * bary.x)>>16) + (((uint64_t)tx[1].y * bary.y)>>16) + (((uint64_t)tx[2].y * bary.z)>>16);
+					_get_texel(tx_x>>16, tx_y>>16, &secondary, params->texture, params->texture_format, 
+						params->texture_address, params->texture_pitch, params->texture_compressed);
 				}
-
-				// actual texel coordinates
-				tx = tx>>16;
-				ty = ty>>16;
-
-				// fragment shading operations
-				brvec4ui rgba = { r, g, b, a };
-				if(_brcontext->fshader || textured)
+				if(_brcontext->fshader)
 				{
-					brvec4 primary = { r*_INV_65536, g*_INV_65536, b*_INV_65536, a*_INV_65536 };
-					brvec4 secondary = { 0,0,0,0 };
-					if(textured)
-						_get_texel(tx, ty, &secondary, params->texture, params->texture_format, 
-							params->texture_width, params->texture_height, params->texture_compressed);
-					if(_brcontext->fshader)
-					{
-						if(textured)	frag_pass.color = secondary;
-						else			frag_pass.color = primary;
-						frag_pass.primitive_color = primary;
-						frag_pass.texture_color = secondary;
-						frag_pass.linear_bary.x = linear_bary.x * _INV_65536;
-						frag_pass.linear_bary.y = linear_bary.y * _INV_65536;
-						frag_pass.linear_bary.z = linear_bary.z * _INV_65536;
-						frag_pass.bary = flt_bary;
-						frag_pass.position.x = x;
-						frag_pass.position.y = y;
-						frag_pass.discard = false;
-
-						// convert result fragment to 16.16, setting 'rgba'
-						brvec4 color = _fragment_pass(&frag_pass);
-						if(frag_pass.discard)
-						{
-							linear_bary.x += inc_bx;
-							linear_bary.y += inc_by;
-							linear_bary.z += inc_bz;
-							pixel_index += 1;
-							continue;
-						}
-						rgba.x = color.x * 65536.0f;
-						rgba.y = color.y * 65536.0f;
-						rgba.z = color.z * 65536.0f;
-						rgba.w = color.w * 65536.0f;
-					}
-					else
-					{
-						// convert secondary color to 16.16, setting 'rgba'
-						rgba.x = secondary.x * 65536.0f;
-						rgba.y = secondary.y * 65536.0f;	
-						rgba.z = secondary.z * 65536.0f;
-						rgba.w = secondary.w * 65536.0f;
-					}
+					if(textured)	frag_pass.color = secondary;
+					else			frag_pass.color = primary;
+					frag_pass.primitive_color = primary;
+					frag_pass.texture_color = secondary;
+					frag_pass.linear_bary.x = linear_bary.x * _INV_65536;
+					frag_pass.linear_bary.y = linear_bary.y * _INV_65536;
+					frag_pass.linear_bary.z = linear_bary.z * _INV_65536;
+					frag_pass.bary = flt_bary;
+					frag_pass.position.x = x;
+					frag_pass.position.y = y;
+					frag_pass.discard = false;
+					
+					brvec4 shaded = _fragment_pass(&frag_pass);
+					if(frag_pass.discard)
+						continue;
+					color.x = shaded.x * 65536.0f;
+					color.y = shaded.y * 65536.0f;
+					color.z = shaded.z * 65536.0f;
+					color.w = shaded.w * 65536.0f;
+				}
+				else
+				{
+					color.x = secondary.x * 65536.0f;
+					color.y = secondary.y * 65536.0f;
+					color.z = secondary.z * 65536.0f;
+					color.w = secondary.w * 65536.0f;
 				}
-
-				if(plot_color)
-					_plot_pixel(pixel_index, rgba, _brcontext->blend);
-
-				if(plot_depth && _is_valid_depth(depth))
-					_plot_depth(pixel_index, depth);
-
-				linear_bary.x += inc_bx;
-				linear_bary.y += inc_by;
-				linear_bary.z += inc_bz;
-				pixel_index += 1;
 			}
-
-			curfx1 += invslope1;
-			curfx2 += invslope2;
+			
+			samples += 1;
+			if(plot_color)
+				_plot_pixel(pixel_index, color, _brcontext->blend);
+			if(plot_depth && _is_valid_depth(depth))
+				_plot_depth(pixel_index, depth);
 		}
 	}
-	// flat topped
-	if(y0 == y1 && x0 != x1)
-	{
-//		int invslope1 = ((float)(params->orig_v2.x - params->orig_v0.x) / (float)(params->orig_v2.y - params->orig_v0.y)) * 256.0f;
-//		int invslope2 = ((float)(params->orig_v2.x - params->orig_v1.x) / (float)(params->orig_v2.y - params->orig_v1.y)) * 256.0f;
-		int invslope1 = _idiv(params->orig_v2.x - params->orig_v0.x, (params->orig_v2.y - params->orig_v0.y)>>8);
-		int invslope2 = _idiv(params->orig_v2.x - params->orig_v1.x, (params->orig_v2.y - params->orig_v1.y)>>8);
+	
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
+	if(_brcontext->fshader) {
+	if(frag_pass.pass_data)
+		_br_free(frag_pass.pass_data);
+	if(frag_pass.pass_attribs)
+		_br_free(frag_pass.pass_attribs);
+	}
+}
 
-		// 24.8 scanline left and right x
-		int curfx1 = x2;
-		int curfx2 = x2;
+// 16.16 linear & perspective-correct barycentric coordinates of the 24.8 point (px, py) across the triangle o,
+// given 65536 / its signed area & the reciprocals of its vertex w (all 0 without perspective correction).
+void _triangle_bary(brvec2i* o, int px, int py, float inv_area, float* inv_w, brvec3ui* linear_bary, brvec3ui* bary)
+{
+	float l0 = ((int64_t)(o[2].x - o[1].x) * (py - o[1].y) - (int64_t)(o[2].y - o[1].y) * (px - o[1].x)) * inv_area;
+	float l1 = ((int64_t)(o[0].x - o[2].x) * (py - o[2].y) - (int64_t)(o[0].y - o[2].y) * (px - o[2].x)) * inv_area;
+	float l2 = ((int64_t)(o[1].x - o[0].x) * (py - o[0].y) - (int64_t)(o[1].y - o[0].y) * (px - o[0].x)) * inv_area;
+	// samples on an edge may land just outside of it
+	*linear_bary = { (uint32_t)(l0 > 0 ? l0 : 0), (uint32_t)(l1 > 0 ? l1 : 0), (uint32_t)(l2 > 0 ? l2 : 0) };
+	*bary = *linear_bary;
+	if(_brcontext->persp_corr)
+	{
+		float w = 65536.0f / ((int)(bary->x*inv_w[0] + bary->y*inv_w[1] + bary->z*inv_w[2]));
+		bary->x *= inv_w[0] * w;
+		bary->y *= inv_w[1] * w;
+		bary->z *= inv_w[2] * w;
+	}
+}
 
-		
-		int y0_int = y0 >> 8;
-		if(params->draw_top)
-			y0_int -= 1;
-		for(int y = (y2>>8); y > y0_int; y -= 1)
+// raster a triangle into the sample buffers (see brSampleCount).
+// coverage & depth are evaluated at every sample position, but the fragment is shaded once per pixel: at the
+// pixel's sample point if all of its samples are covered, otherwise at its first covered sample.
+// coverage is tested against x0..y2, and attributes are interpolated across orig_v0..orig_v2, so clipped
+// triangles are handled too.
+void _raster_msaa_triangle(_raster_triangle_t* params)
+{
+	bool depth_test = (_brcontext->depth_test && _brcontext->db);
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
+	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
+	bool textured = (_brcontext->texture && params->complete_texture_unit);
+	bool depth_only = (!plot_color && !_brcontext->fshader);
+	uint64_t samples = 0;
+	uint32_t n = _brcontext->sample_count;
+	uint32_t all_samples = (1<<n) - 1;
+	const brvec2i* positions = _sample_positions();
+	
+	// 24.8 fixed point coverage triangle
+	brvec2i a = { (int)(params->x0 * 256.0f), (int)(params->y0 * 256.0f) };
+	brvec2i b = { (int)(params->x1 * 256.0f), (int)(params->y1 * 256.0f) };
+	brvec2i c = { (int)(params->x2 * 256.0f), (int)(params->y2 * 256.0f) };
+	_triangle_edges_t edges;
+	if(!_setup_triangle_edges(a, b, c, &edges))
+		return;
+	
+	// samples lie within half a pixel of the pixel's sample point
+	int min_x = a.x < b.x ? (a.x < c.x ? a.x : c.x) : (b.x < c.x ? b.x : c.x);
+	int min_y = a.y < b.y ? (a.y < c.y ? a.y : c.y) : (b.y < c.y ? b.y : c.y);
+	int max_x = a.x > b.x ? (a.x > c.x ? a.x : c.x) : (b.x > c.x ? b.x : c.x);
+	int max_y = a.y > b.y ? (a.y > c.y ? a.y : c.y) : (b.y > c.y ? b.y : c.y);
+	min_x = (min_x + 127) >> 8;
+	min_y = (min_y + 127) >> 8;
+	max_x = (max_x + 128) >> 8;
+	max_y = (max_y + 128) >> 8;
+	if(min_x < _brcontext->clip_x0) min_x = _brcontext->clip_x0;
+	if(min_y < _brcontext->clip_y0) min_y = _brcontext->clip_y0;
+	if(max_x >= _brcontext->clip_x1) max_x = _brcontext->clip_x1 - 1;
+	if(max_y >= _brcontext->clip_y1) max_y = _brcontext->clip_y1 - 1;
+	if(min_x > max_x || min_y > max_y)
+		return;
+	
+	// barycentric coordinates are measured across the original (unclipped) triangle
+	brvec2i orig[3] = { params->orig_v0, params->orig_v1, params->orig_v2 };
+	int64_t orig_area = (int64_t)(orig[1].x - orig[0].x) * (orig[2].y - orig[0].y) - (int64_t)(orig[1].y - orig[0].y) * (orig[2].x - orig[0].x);
+	if(!orig_area)
+		return;
+	float inv_area = 65536.0f / orig_area;
+	
+	brvec4ui rgba[3] = { params->rgba0, params->rgba1, params->rgba2 };
+	brvec2ui tx[3] = { params->tx0, params->tx1, params->tx2 };
+	int64_t z[3] = { params->z0, params->z1, params->z2 };
+	float inv_w[3] = { 0, 0, 0 };
+	if(_brcontext->persp_corr)
+	{
+		inv_w[0] = _fdiv(1.0f, fabs(params->w0));
+		inv_w[1] = _fdiv(1.0f, fabs(params->w1));
+		inv_w[2] = _fdiv(1.0f, fabs(params->w2));
+	}
+	
+	_fragment_t frag_pass;
+	if(_brcontext->fshader)
+		_init_fragment(&frag_pass);
+	
+	for(int y = min_y; y <= max_y; y += 1)
+	{
+		uint32_t pixel_index = y * _brcontext->rb_pitch + min_x;
+		for(int x = min_x; x <= max_x; x += 1, pixel_index += 1)
 		{
-			if(y < 0)
-				break;
-			if(y >= _brcontext->rb_height)
+			uint32_t covered = 0;
+			for(uint32_t s = 0; s < n; s += 1)
 			{
-				curfx1 -= invslope1;
-				curfx2 -= invslope2;
-				continue;
-			}
-			
-			int cx1, cx2;
-			int sx1, sx2;
-			cx1 = curfx1;
-			cx2 = curfx2;
-			if(cx1 > cx2)
-			{
-				int tmp = cx1;
-				cx1 = cx2;
-				cx2 = tmp;
-			}
-			sx1 = (cx1-128)>>8;
-			sx2 = (cx2+128)>>8;
-			
-			if(sx1 > sx2)
-			{
-				curfx1 -= invslope1;
-				curfx2 -= invslope2;
-				continue;
+				if(_edges_cover(&edges, (x<<8) + positions[s].x, (y<<8) + positions[s].y))
+					covered |= 1<<s;
 			}
-			int sy = y;
-
-			if(sx1 < 0)
-				sx1 = 0;
-			if(sx1 >= _brcontext->rb_width)
-			{
-				curfx1 -= invslope1;
-				curfx2 -= invslope2;
+			if(!covered)
 				continue;
-			}
-
-			int slength = (sx2-sx1)+1;
-
-			// do scanline sx1->sx2 @ y sy
-			// calculate 24.8 bary coords for start and end of scanline
-			// if _brcontext->persp_corr, perspective correct bary
-			// convert bary to 16.16 to interpolate 16.16 fixed point attributes
-			// for texel coordinates, discard last 16 bits.
-			// to convert from 16.16 to float, divide by 65536 (use _INV_65536).
 			
-			// if appropriate, scanline beginning/end will be offset by 256 (1 pixel; working with 1/256 coordinates)
-			// in order to avoid sub-pixels that fall outside of triangle given Y increases by a full pixel
-			// If this fails to generate valid barycentric coordinates, a loop will be run to iterate by half a pixel
-			// until valid bary coordinates are generated.
-
-			brvec3 bary_s1;
-			brvec2i c;
-			if(sx1 != sx2)
-				c.x = ((sx1<<8)+256) - params->orig_v0.x;
-			else
-				c.x = cx1 - params->orig_v0.x;
-			c.y = (y<<8) - params->orig_v0.y;
-			bary_s1.y = (c.x*b.y-b.x*c.y)*den;
-			bary_s1.z = (a.x*c.y-c.x*a.y)*den;
-			bary_s1.x = 65536.0f - bary_s1.y - bary_s1.z;
-			if(bary_s1.x < 0.0f || bary_s1.y < 0.0f || bary_s1.z < 0.0f) {
-				int x = (sx1<<8)+384;
-				bool cont = false;
-				while(bary_s1.x < 0.0f || bary_s1.y < 0.0f || bary_s1.z < 0.0f) {
-					c.x = x - params->orig_v0.x;
-					bary_s1.y = (c.x*b.y-b.x*c.y)*den;
-					bary_s1.z = (a.x*c.y-c.x*a.y)*den;
-					bary_s1.x = 65536.0f - bary_s1.y - bary_s1.z;
-					x += 128;
-					if(x > cx2) {
-						curfx1 -= invslope1;
-						curfx2 -= invslope2;
-						cont = true;
-						break;
-					}
-				}
-				if(cont) continue;
-			}
+			// depth of each covered sample
+			uint32_t* sample_depths = _brcontext->msaa_depth + pixel_index*n;
+			int64_t depths[8];
+			uint32_t passed = covered;
+			for(uint32_t s = 0; s < n; s += 1)
 			{
-				float bx = bary_s1.x;
-				float by = bary_s1.y;
-				float bz = bary_s1.z;
-				bary_s1.x = bx * (params->bary0.x) + by * (params->bary1.x) + bz * (params->bary2.x);
-				bary_s1.y = bx * (params->bary0.y) + by * (params->bary1.y) + bz * (params->bary2.y);
-				bary_s1.z = bx * (params->bary0.z) + by * (params->bary1.z) + bz * (params->bary2.z);
-			}
-
-			brvec3 bary_s2;
-			if(sx1 != sx2)
-				c.x = ((sx2<<8)-256) - params->orig_v0.x;
-			else
-				c.x = cx2 - params->orig_v0.x;
-			bary_s2.y = (c.x*b.y-b.x*c.y)*den;
-			bary_s2.z = (a.x*c.y-c.x*a.y)*den;
-			bary_s2.x = 65536.0f - bary_s2.y - bary_s2.z;
-			if(bary_s2.x < 0.0f || bary_s2.y < 0.0f || bary_s2.z < 0.0f) {
-				int x = (sx2<<8)-384;
-				bool cont = false;
-				while(bary_s2.x < 0.0f || bary_s2.y < 0.0f || bary_s2.z < 0.0f) {
-					c.x = x - params->orig_v0.x;
-					bary_s2.y = (c.x*b.y-b.x*c.y)*den;
-					bary_s2.z = (a.x*c.y-c.x*a.y)*den;
-					bary_s2.x = 65536.0f - bary_s2.y - bary_s2.z;
-					x -= 128;
-					if(x < cx1) {
-						curfx1 -= invslope1;
-						curfx2 -= invslope2;
-						cont = true;
-						break;
-					}
-				}
-				if(cont) continue;
+				if(!(covered & (1<<s)))
+					continue;
+				brvec3ui linear_bary, bary;
+				_triangle_bary(orig, (x<<8) + positions[s].x, (y<<8) + positions[s].y, inv_area, inv_w, &linear_bary, &bary);
+				depths[s] = z[0] * (bary.x * _INV_65536) + z[1] * (bary.y * _INV_65536) + z[2] * (bary.z * _INV_65536);
+				if(depth_test && (!_is_valid_depth(depths[s]) || depths[s] > sample_depths[s]))
+					passed &= ~(1<<s);
 			}
+			_BR_STAT(fragments_generated, 1);
+			if(!passed)
 			{
-				float bx = bary_s2.x;
-				float by = bary_s2.y;
-				float bz = bary_s2.z;
-				bary_s2.x = bx * (params->bary0.x) + by * (params->bary1.x) + bz * (params->bary2.x);
-				bary_s2.y = bx * (params->bary0.y) + by * (params->bary1.y) + bz * (params->bary2.y);
-				bary_s2.z = bx * (params->bary0.z) + by * (params->bary1.z) + bz * (params->bary2.z);
+				_BR_STAT(depth_failed, 1);
+				continue;
 			}
+			if(depth_test)
+				_BR_STAT(depth_passed, 1);
 			
-			int inc_bx = (bary_s2.x - bary_s1.x)/slength;
-			int inc_by = (bary_s2.y - bary_s1.y)/slength;
-			int inc_bz = (bary_s2.z - bary_s1.z)/slength;
-						
-			uint32_t pixel_index = y * _brcontext->rb_width + sx1;
-
-			brvec3ui linear_bary;
-			linear_bary.x = bary_s1.x;
-			linear_bary.y = bary_s1.y;
-			linear_bary.z = bary_s1.z;
-			for(int x = sx1; x <= sx2; x += 1)
+			brvec4ui color;
+			if(!depth_only)
 			{
-				if(x >= _brcontext->rb_width)
-					break;
-
-				if((x<<8) >= cx2/* || (y<<8) >= params->orig_v2.y*/)
-					break;
-
-				brvec3ui bary = linear_bary;
-				if(_brcontext->persp_corr)
+				uint32_t shade_sample = 0;
+				while(!(covered & (1<<shade_sample)))
+					shade_sample += 1;
+				int px = x<<8, py = y<<8;
+				if(covered != all_samples)
 				{
-					float w = 65536.0f / ((int)(bary.x*inv_v0_w + bary.y*inv_v1_w + bary.z*inv_v2_w));
-					bary.x *= inv_v0_w * w;
-					bary.y *= inv_v1_w * w;
-					bary.z *= inv_v2_w * w;
+					px += positions[shade_sample].x;
+					py += positions[shade_sample].y;
 				}
-
+				brvec3ui linear_bary, bary;
+				_triangle_bary(orig, px, py, inv_area, inv_w, &linear_bary, &bary);
 				brvec3 flt_bary = { (float)bary.x * _INV_65536, 
 					(float)bary.y * _INV_65536, (float)bary.z * _INV_65536 };
-
-				// safest to floating-point interpolate depths; they are in a large range and do not fit nicely to 16.16 fixed-point
-				int64_t depth = 0;
-				depth = params->z0 * flt_bary.x + params->z1 * flt_bary.y + params->z2 * flt_bary.z;
-
-				if(depth_test)
-				{
-					int64_t dst = _get_depth(pixel_index);
-					if(!_is_valid_depth(depth) || depth > dst)
-					{
-						linear_bary.x += inc_bx;
-						linear_bary.y += inc_by;
-						linear_bary.z += inc_bz;
-						pixel_index += 1;
-						continue;
-					}
-				}
-
+				
 				// 16.16 attributes multiplied by 16.16 barycentric coordinates
-				uint32_t r = (((uint32_t)r0 * bary.x)>>16) + (((uint32_t)r1 * bary.y)>>16) + (((uint32_t)r2 * bary.z)>>16);
-				uint32_t g = (((uint32_t)g0 * bary.x)>>16) + (((uint32_t)g1 * bary.y)>>16) + (((uint32_t)g2 * bary.z)>>16);
-				uint32_t b = (((uint32_t)b0 * bary.x)>>16) + (((uint32_t)b1 * bary.y)>>16) + (((uint32_t)b2 * bary.z)>>16);
-				uint32_t a = (((uint32_t)a0 * bary.x)>>16) + (((uint32_t)a1 * bary.y)>>16) + (((uint32_t)a2 * bary.z)>>16);
-				uint32_t tx = 0;
-				uint32_t ty = 0;
-				if(params->complete_texture_unit)
-				{
-					tx = (((uint64_t)tx0 * bary.x)>>16) + (((uint64_t)tx1 * bary.y)>>16) + (((uint64_t)tx2 * bary.z)>>16);
-					ty = (((uint64_t)ty0 * bary.x)>>16) + (((uint64_t)ty1 * bary.y)>>16) + (((uint64_t)ty2 * bary.z)>>16);
-				}
-
-				// actual texel coordinates
-				tx = tx>>16;
-				ty = ty>>16;
-
-				// fragment shading operations
-				brvec4ui rgba = { r, g, b, a };
+				color.x = (((uint64_t)rgba[0].x * bary.x)>>16) + (((uint64_t)rgba[1].x * bary.y)>>16) + (((uint64_t)rgba[2].x * bary.z)>>16);
+				color.y = (((uint64_t)rgba[0].y * bary.x)>>16) + (((uint64_t)rgba[1].y * bary.y)>>16) + (((uint64_t)rgba[2].y * bary.z)>>16);
+				color.z = (((uint64_t)rgba[0].z * bary.x)>>16) + (((uint64_t)rgba[1].z * bary.y)>>16) + (((uint64_t)rgba[2].z * bary.z)>>16);
+				color.w = (((uint64_t)rgba[0].w * bary.x)>>16) + (((uint64_t)rgba[1].w * bary.y)>>16) + (((uint64_t)rgba[2].w * bary.z)>>16);
+				
 				if(_brcontext->fshader || textured)
 				{
-					brvec4 primary = { r*_INV_65536, g*_INV_65536, b*_INV_65536, a*_INV_65536 };
+					brvec4 primary = { color.x*_INV_65536, color.y*_INV_65536, color.z*_INV_65536, color.w*_INV_65536 };
 					brvec4 secondary = { 0,0,0,0 };
 					if(textured)
-						_get_texel(tx, ty, &secondary, params->texture, params->texture_format, 
-							params->texture_width, params->texture_height, params->texture_compressed);
+					{
+						uint32_t tx_x = (((uint64_t)tx[0].x * bary.x)>>16) + (((uint64_t)tx[1].x * bary.y)>>16) + (((uint64_t)tx[2].x * bary.z)>>16);
+						uint32_t tx_y = (((uint64_t)tx[0].y * bary.x)>>16) + (((uint64_t)tx[1].y * bary.y)>>16) + (((uint64_t)tx[2].y * bary.z)>>16);
+						_get_texel(tx_x>>16, tx_y>>16, &secondary, params->texture, params->texture_format, 
+							params->texture_address, params->texture_pitch, params->texture_compressed);
+					}
 					if(_brcontext->fshader)
 					{
 						if(textured)	frag_pass.color = secondary;
@@ -1584,148 +2961,44 @@ void _raster_triangle(_raster_triangle_t* params)
 						frag_pass.position.x = x;
 						frag_pass.position.y = y;
 						frag_pass.discard = false;
-
-						// convert result fragment to 16.16, setting 'rgba'
-						brvec4 color = _fragment_pass(&frag_pass);
+						
+						brvec4 shaded = _fragment_pass(&frag_pass);
 						if(frag_pass.discard)
-						{
-							linear_bary.x += inc_bx;
-							linear_bary.y += inc_by;
-							linear_bary.z += inc_bz;
-							pixel_index += 1;
 							continue;
-						}
-						rgba.x = color.x * 65536.0f;
-						rgba.y = color.y * 65536.0f;
-						rgba.z = color.z * 65536.0f;
-						rgba.w = color.w * 65536.0f;
+						color.x = shaded.x * 65536.0f;
+						color.y = shaded.y * 65536.0f;
+						color.z = shaded.z * 65536.0f;
+						color.w = shaded.w * 65536.0f;
 					}
 					else
 					{
-						// convert secondary color to 16.16, setting 'rgba'
-						rgba.x = secondary.x * 65536.0f;
-						rgba.y = secondary.y * 65536.0f;	
-						rgba.z = secondary.z * 65536.0f;
-						rgba.w = secondary.w * 65536.0f;
+						color.x = secondary.x * 65536.0f;
+						color.y = secondary.y * 65536.0f;
+						color.z = secondary.z * 65536.0f;
+						color.w = secondary.w * 65536.0f;
 					}
 				}
-
-				if(plot_color)
-					_plot_pixel(pixel_index, rgba, _brcontext->blend);
-
-				if(plot_depth && _is_valid_depth(depth))
-					_plot_depth(pixel_index, depth);
-
-				linear_bary.x += inc_bx;
-				linear_bary.y += inc_by;
-				linear_bary.z += inc_bz;
-				pixel_index += 1;
 			}
-
-			curfx1 -= invslope1;
-			curfx2 -= invslope2;
+			
+			samples += 1;
+			if(plot_color)
+				_plot_samples(pixel_index, passed, color, _brcontext->blend);
+			if(plot_depth)
+			{
+				for(uint32_t s = 0; s < n; s += 1)
+					if((passed & (1<<s)) && _is_valid_depth(depths[s]))
+						sample_depths[s] = depths[s];
+			}
 		}
 	}
 	
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
 	if(_brcontext->fshader) {
 	if(frag_pass.pass_data)
-		free(frag_pass.pass_data);
+		_br_free(frag_pass.pass_data);
 	if(frag_pass.pass_attribs)
-		free(frag_pass.pass_attribs);
-	}
-}
-
-// split a triangle and raster both halves
-void _split_raster_triangle(_raster_triangle_t* triangle)
-{
-	// sort vertices v0.y <= v1.y <= v2.y
-	// swap raster position & barycentric coordinates
-	
-	if(triangle->y2 < triangle->y1)
-	{
-		// swap v2 with v1
-		float tmp = triangle->x1;
-		triangle->x1 = triangle->x2;
-		triangle->x2 = tmp;
-		tmp = triangle->y1;
-		triangle->y1 = triangle->y2;
-		triangle->y2 = tmp;
-		
-		brvec3 tmp_bary = triangle->bary1;
-		triangle->bary1 = triangle->bary2;
-		triangle->bary2 = tmp_bary;
-		
-		brvec2i tmp_orig = triangle->orig_v1;
-		triangle->orig_v1 = triangle->orig_v2;
-		triangle->orig_v2 = tmp_orig;
-	}
-	
-	if(triangle->y1 < triangle->y0)
-	{
-		// swap v1 with v0
-		float tmp = triangle->x0;
-		triangle->x0 = triangle->x1;
-		triangle->x1 = tmp;
-		tmp = triangle->y0;
-		triangle->y0 = triangle->y1;
-		triangle->y1 = tmp;
-		
-		brvec3 tmp_bary = triangle->bary0;
-		triangle->bary0 = triangle->bary1;
-		triangle->bary1 = tmp_bary;
-		
-		brvec2i tmp_orig = triangle->orig_v0;
-		triangle->orig_v0 = triangle->orig_v1;
-		triangle->orig_v1 = tmp_orig;
-	}
-	
-	if(triangle->y2 < triangle->y1)
-	{
-		// swap v2 with v1
-		float tmp = triangle->x1;
-		triangle->x1 = triangle->x2;
-		triangle->x2 = tmp;
-		tmp = triangle->y1;
-		triangle->y1 = triangle->y2;
-		triangle->y2 = tmp;
-		
-		brvec3 tmp_bary = triangle->bary1;
-		triangle->bary1 = triangle->bary2;
-		triangle->bary2 = tmp_bary;
-		
-		brvec2i tmp_orig = triangle->orig_v1;
-		triangle->orig_v1 = triangle->orig_v2;
-		triangle->orig_v2 = tmp_orig;
-	}
-	
-	triangle->draw_top = false;
-	
-	if(triangle->y1 == triangle->y2)			// flat-bottomed
-		_raster_triangle(triangle);
-	else if(triangle->y0 == triangle->y1)		// flat-topped
-	{
-		triangle->draw_top = true;
-		_raster_triangle(triangle);
-	}
-	else
-	{
-		// split 'triangle' in half and raster both halves
-		brvec2 v;
-		v.x = triangle->x0 + ((triangle->y1 - triangle->y0) / (triangle->y2 - triangle->y0)) * (triangle->x2 - triangle->x0);
-		v.y = triangle->y1;
-
-		_raster_triangle_t second_half = *triangle;
-		
-		// top half: construct triangle as v0, v1, v
-		
-		triangle->x2 = v.x;
-		triangle->y2 = v.y;
-		second_half.x0 = second_half.x1;
-		second_half.y0 = second_half.y1;
-		second_half.x1 = v.x;
-		second_half.y1 = v.y;
-		_raster_triangle(triangle);
-		_raster_triangle(&second_half);
+		_br_free(frag_pass.pass_attribs);
 	}
 }
 
@@ -1889,13 +3162,13 @@ void add_vert_to_list(brvec4** array, uint32_t* ecount, brvec4 vertex)
 {
 	if(!(*array))
 	{
-		*array = (brvec4*) calloc(*ecount+1, sizeof(brvec4));
+		*array = (brvec4*) _br_calloc(*ecount+1, sizeof(brvec4));
 		(*array) [*ecount] = vertex;
 		(*ecount)++;
 	}
 	else
 	{
-		*array = (brvec4*) realloc(*array, (*ecount+1)*sizeof(brvec4));
+		*array = (brvec4*) _br_realloc(*array, (*ecount+1)*sizeof(brvec4));
 		(*array) [*ecount] = vertex;
 		(*ecount)++;
 	}
@@ -1903,7 +3176,7 @@ void add_vert_to_list(brvec4** array, uint32_t* ecount, brvec4 vertex)
 
 void clear_vert_list(brvec4** array, uint32_t* ecount)
 {
-	free(*array);
+	_br_free(*array);
 	*array = 0;
 	*ecount = 0;
 }
@@ -2051,6 +3324,22 @@ struct _raster_point_t
 	float w;
 };
 void _raster_point(_raster_point_t* params);
+void _setup_texture_unit(_raster_triangle_t* raster_triangle, uint32_t tunit);
+void _setup_raster_triangle(_triangle_t* triangle, _raster_triangle_t* raster_triangle);
+
+// signed area of a clip-space triangle from the homogeneous (x,y,w) determinant of its vertices.
+// equal to the 2D cross product for w=1, and of the same sign as the projected cross product when all w are positive.
+static inline float _triangle_det(float x0, float y0, float w0, float x1, float y1, float w1, float x2, float y2, float w2)
+{
+	return x0 * (y1*w2 - y2*w1) - y0 * (x1*w2 - x2*w1) + w0 * (x1*y2 - x2*y1);
+}
+
+// true if a triangle of signed area 'det' (see _triangle_det) faces away under the current cull state.
+static inline bool _cull_winding(float det)
+{
+	bool cw = det > 0.0f;
+	return _brcontext->cull && ((cw && _brcontext->cull_winding == BR_CW) || (!cw && _brcontext->cull_winding == BR_CCW));
+}
 
 // post-process and raster a triangle (vertex shader pass, _vertex_pass, not performed here)
 // will cause harm to contents of 'triangle'
@@ -2061,31 +3350,26 @@ void _process_triangle(_triangle_t* triangle)
 	
 	// perform primitive processing of 'triangle'
 	
-	float half_width  = _brcontext->rb_width  * 0.5f;
-	float half_height = _brcontext->rb_height * 0.5f;
+	float center_x = _brcontext->viewport_center_x;
+	float center_y = _brcontext->viewport_center_y;
+	float half_width  = _brcontext->viewport_half_width;
+	float half_height = _brcontext->viewport_half_height;
 	
 	// cull parent triangles when appropriate
-	if(_brcontext->cull && !triangle->parent)
-	{
-		brvec3 n;
-		bool cw = false;
-		brvec3 w_v0 = { triangle->v0.x, triangle->v0.y, 0 };
-		brvec3 w_v1 = { triangle->v1.x, triangle->v1.y, 0 };
-		brvec3 w_v2 = { triangle->v2.x, triangle->v2.y, 0 };
-		n = _cross_vec3(_sub_vec3(w_v1, w_v0), _sub_vec3(w_v2, w_v0));
-		if(n.z > 0)
-			cw = true;
-			
-		if(cw && _brcontext->cull_winding == BR_CW)
-			return;
-		if(!cw && _brcontext->cull_winding == BR_CCW)
-			return;
+	if(!triangle->parent && _cull_winding(_triangle_det(triangle->v0.x, triangle->v0.y, triangle->v0.w,
+		triangle->v1.x, triangle->v1.y, triangle->v1.w, triangle->v2.x, triangle->v2.y, triangle->v2.w)))
+	{
+		_BR_STAT(primitives_culled, 1);
+		return;
 	}
 	
 	// this is a parent triangle that is completely on the wrong side of one of the clipping planes
 	if(_brcontext->clip && !triangle->parent && 
 	!in_frustum(triangle->v0) && !in_frustum(triangle->v1) && !in_frustum(triangle->v2))
+	{
+		_BR_STAT(primitives_culled, 1);
 		return;
+	}
 	
 	// this is a parent triangle that needs to be clipped (atleast one vertex not in clip bounds)
 	// this will only be run once (all clipping is done at once)
@@ -2094,12 +3378,13 @@ void _process_triangle(_triangle_t* triangle)
 	( !in_frustum(triangle->v0) || !in_frustum(triangle->v1) || !in_frustum(triangle->v2) ) )
 	{
 		//printf("clipping triangle\n");
+		_BR_STAT(primitives_clipped, 1);
 
 		_triangle_t child = *triangle;
 		child.parent = triangle;
 		
 		// this will be the vertex list prior to clipping
-		brvec4* verts = (brvec4*) calloc(3, sizeof(brvec4));
+		brvec4* verts = (brvec4*) _br_calloc(3, sizeof(brvec4));
 		verts[0] = triangle->v0;
 		verts[1] = triangle->v1;
 		verts[2] = triangle->v2;
@@ -2135,14 +3420,14 @@ void _process_triangle(_triangle_t* triangle)
 		}
 		
 		triangle->parent_orig_v0 =
-			{ (half_width  + ( triangle->v0.x * half_width))  * 256.0f,
-			  (half_height + (-triangle->v0.y * half_height)) * 256.0f};
+			{ (center_x + ( triangle->v0.x * half_width))  * 256.0f,
+			  (center_y + (-triangle->v0.y * half_height)) * 256.0f};
 		triangle->parent_orig_v1 =
-			{ (half_width  + ( triangle->v1.x * half_width))  * 256.0f,
-			  (half_height + (-triangle->v1.y * half_height)) * 256.0f};
+			{ (center_x + ( triangle->v1.x * half_width))  * 256.0f,
+			  (center_y + (-triangle->v1.y * half_height)) * 256.0f};
 		triangle->parent_orig_v2 =
-			{ (half_width  + ( triangle->v2.x * half_width))  * 256.0f,
-			  (half_height + (-triangle->v2.y * half_height)) * 256.0f};
+			{ (center_x + ( triangle->v2.x * half_width))  * 256.0f,
+			  (center_y + (-triangle->v2.y * half_height)) * 256.0f};
 		
 		// generate, read, and process clipped triangles using the clip-space verts list
 		// (create copies of 'child', fill with vertices, send through _process_triangle)
@@ -2169,10 +3454,6 @@ void _process_triangle(_triangle_t* triangle)
 	
 	_raster_triangle_t raster_triangle;
 	
-	raster_triangle.bary0 = { 1, 0, 0 };
-	raster_triangle.bary1 = { 0, 1, 0 };
-	raster_triangle.bary2 = { 0, 0, 1 };
-	
 	if(_brcontext->persp_div && triangle->v0.w != 0.0f && triangle->v0.w != 1.0f)
 	{
 		float inv_v0_w = _fdiv(1.0f, triangle->v0.w);
@@ -2201,59 +3482,67 @@ void _process_triangle(_triangle_t* triangle)
 		triangle->v2.z *= 0.5f + 0.5f;
 	}
 	
-	uint32_t tunit = _brcontext->texture_unit;
-	raster_triangle.complete_texture_unit = ( _brcontext->textures[tunit] && _brcontext->texture_widths[tunit] > 0
-		&& _brcontext->texture_heights[tunit] > 0 && _is_pixel_format(_brcontext->texture_formats[tunit]) );
-	if(raster_triangle.complete_texture_unit)
-	{
-		raster_triangle.texture        = _brcontext->textures[_brcontext->texture_unit];
-		raster_triangle.texture_width  = _brcontext->texture_widths[_brcontext->texture_unit];
-		raster_triangle.texture_height     = _brcontext->texture_heights[_brcontext->texture_unit];
-		raster_triangle.texture_format     = _brcontext->texture_formats[_brcontext->texture_unit];
-		raster_triangle.texture_compressed = _brcontext->texture_compressed_booleans[_brcontext->texture_unit];
-		raster_triangle.tx0.x = triangle->tcoords0.x * (raster_triangle.texture_width - 1) * 65536;
-		raster_triangle.tx0.y = (1.0f - triangle->tcoords0.y) * (raster_triangle.texture_height - 1) * 65536;
-		raster_triangle.tx1.x = triangle->tcoords1.x * (raster_triangle.texture_width - 1) * 65536;
-		raster_triangle.tx1.y = (1.0f - triangle->tcoords1.y) * (raster_triangle.texture_height - 1) * 65536;
-		raster_triangle.tx2.x = triangle->tcoords2.x * (raster_triangle.texture_width - 1) * 65536;
-		raster_triangle.tx2.y = (1.0f - triangle->tcoords2.y) * (raster_triangle.texture_height - 1) * 65536;
-	}
-	
-	raster_triangle.x0 = half_width  + ( triangle->v0.x * half_width);
-	raster_triangle.y0 = half_height + (-triangle->v0.y * half_height);
-	raster_triangle.x1 = half_width  + ( triangle->v1.x * half_width);
-	raster_triangle.y1 = half_height + (-triangle->v1.y * half_height);
-	raster_triangle.x2 = half_width  + ( triangle->v2.x * half_width);
-	raster_triangle.y2 = half_height + (-triangle->v2.y * half_height);
-	
-	_raster_point_t pt;
-	pt.x = raster_triangle.x0;
-	pt.y = raster_triangle.y0;
-	pt.rgba = { 65536, 65536, 65536, 65536 };
-	pt.r = 2;
-	pt.z = 0;
-	pt.w = 1;
-	_raster_point(&pt);
-	pt.x = raster_triangle.x1;
-	pt.y = raster_triangle.y1;
-	pt.rgba = { 65536, 65536, 65536, 65536 };
-	pt.r = 2;
-	pt.z = 0;
-	pt.w = 1;
-	_raster_point(&pt);
-	pt.x = raster_triangle.x2;
-	pt.y = raster_triangle.y2;
-	pt.rgba = { 65536, 65536, 65536, 65536 };
-	pt.r = 2;
-	pt.z = 0;
-	pt.w = 1;
-	_raster_point(&pt);
+	_setup_texture_unit(&raster_triangle, triangle->texture);
+	
+	raster_triangle.x0 = center_x + ( triangle->v0.x * half_width);
+	raster_triangle.y0 = center_y + (-triangle->v0.y * half_height);
+	raster_triangle.x1 = center_x + ( triangle->v1.x * half_width);
+	raster_triangle.y1 = center_y + (-triangle->v1.y * half_height);
+	raster_triangle.x2 = center_x + ( triangle->v2.x * half_width);
+	raster_triangle.y2 = center_y + (-triangle->v2.y * half_height);
+	
+	_setup_raster_triangle(triangle, &raster_triangle);
+}
+
+// set up the texture unit information of a raster triangle from texture unit 'tunit'.
+void _setup_texture_unit(_raster_triangle_t* raster_triangle, uint32_t tunit)
+{
+	raster_triangle->complete_texture_unit = ( _brcontext->textures[tunit] && _brcontext->texture_widths[tunit] > 0
+		&& _brcontext->texture_heights[tunit] > 0 && _is_texture_format(_brcontext->texture_formats[tunit]) );
+	if(raster_triangle->complete_texture_unit)
+	{
+		raster_triangle->texture            = _brcontext->textures[tunit];
+		raster_triangle->texture_width      = _brcontext->texture_widths[tunit];
+		raster_triangle->texture_height     = _brcontext->texture_heights[tunit];
+		raster_triangle->texture_pitch      = _brcontext->texture_pitches[tunit];
+		raster_triangle->texture_format     = _brcontext->texture_formats[tunit];
+		raster_triangle->texture_compressed = _brcontext->texture_compressed_booleans[tunit];
+		_setup_texel_address(&raster_triangle->texture_address[0], raster_triangle->texture_width, _brcontext->texture_wraps[tunit][0]);
+		_setup_texel_address(&raster_triangle->texture_address[1], raster_triangle->texture_height, _brcontext->texture_wraps[tunit][1]);
+	}
+}
+
+// finish setup of a raster triangle and raster it.
+// 'triangle' must be perspective divided, and 'raster_triangle' must have its raster-space
+// positions (x0..y2) and texture unit information (see _setup_texture_unit) set.
+void _setup_raster_triangle(_triangle_t* triangle, _raster_triangle_t* raster_triangle)
+{
+	float x0 = raster_triangle->x0, x1 = raster_triangle->x1, x2 = raster_triangle->x2;
+	float y0 = raster_triangle->y0, y1 = raster_triangle->y1, y2 = raster_triangle->y2;
+	if(!_touch_bounds(x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2), y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2),
+		x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2), y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2)))
+	{
+		_BR_STAT(primitives_culled, 1);
+		return;
+	}
+	
+	if(raster_triangle->complete_texture_unit)
+	{
+		float s[3] = { triangle->tcoords0.x, triangle->tcoords1.x, triangle->tcoords2.x };
+		float t[3] = { 1.0f - triangle->tcoords0.y, 1.0f - triangle->tcoords1.y, 1.0f - triangle->tcoords2.y };
+		uint32_t x[3], y[3];
+		_texel_coords(s, 3, &raster_triangle->texture_address[0], x);
+		_texel_coords(t, 3, &raster_triangle->texture_address[1], y);
+		raster_triangle->tx0 = { x[0], y[0] };
+		raster_triangle->tx1 = { x[1], y[1] };
+		raster_triangle->tx2 = { x[2], y[2] };
+	}
 	
 	if(triangle->parent)	// is a child (clipped) triangle
 	{
-		raster_triangle.orig_v0 = triangle->parent->parent_orig_v0;
-		raster_triangle.orig_v1 = triangle->parent->parent_orig_v1;
-		raster_triangle.orig_v2 = triangle->parent->parent_orig_v2;
+		raster_triangle->orig_v0 = triangle->parent->parent_orig_v0;
+		raster_triangle->orig_v1 = triangle->parent->parent_orig_v1;
+		raster_triangle->orig_v2 = triangle->parent->parent_orig_v2;
 		triangle->v0.z = triangle->parent->v0.z;
 		triangle->v1.z = triangle->parent->v1.z;
 		triangle->v2.z = triangle->parent->v2.z;
@@ -2263,35 +3552,209 @@ void _process_triangle(_triangle_t* triangle)
 	}
 	else	// clipping was not performed
 	{
-		raster_triangle.orig_v0 = { raster_triangle.x0 * 256.0f, raster_triangle.y0 * 256.0f };
-		raster_triangle.orig_v1 = { raster_triangle.x1 * 256.0f, raster_triangle.y1 * 256.0f };
-		raster_triangle.orig_v2 = { raster_triangle.x2 * 256.0f, raster_triangle.y2 * 256.0f };
+		raster_triangle->orig_v0 = { raster_triangle->x0 * 256.0f, raster_triangle->y0 * 256.0f };
+		raster_triangle->orig_v1 = { raster_triangle->x1 * 256.0f, raster_triangle->y1 * 256.0f };
+		raster_triangle->orig_v2 = { raster_triangle->x2 * 256.0f, raster_triangle->y2 * 256.0f };
 	}
 
 	// these will not be modified from their original values via clipping;
 	// interpolated Z and W depend on the barycentric region, which is, in fact, between the original coordinates 
 	// of the original triangle; therefore sub-triangles only need to worry about their 2D coordinates (x,y).
-	raster_triangle.z0 = _convert_depth(triangle->v0.z);
-	raster_triangle.z1 = _convert_depth(triangle->v1.z);
-	raster_triangle.z2 = _convert_depth(triangle->v2.z);
-	raster_triangle.w0 = triangle->v0.w;
-	raster_triangle.w1 = triangle->v1.w;
-	raster_triangle.w2 = triangle->v2.w;
-	
-	raster_triangle.rgba0.x = triangle->rgba0.x * 65536.0f;
-	raster_triangle.rgba0.y = triangle->rgba0.y * 65536.0f;
-	raster_triangle.rgba0.z = triangle->rgba0.z * 65536.0f;
-	raster_triangle.rgba0.w = triangle->rgba0.w * 65536.0f;
-	raster_triangle.rgba1.x = triangle->rgba1.x * 65536.0f;
-	raster_triangle.rgba1.y = triangle->rgba1.y * 65536.0f;
-	raster_triangle.rgba1.z = triangle->rgba1.z * 65536.0f;
-	raster_triangle.rgba1.w = triangle->rgba1.w * 65536.0f;
-	raster_triangle.rgba2.x = triangle->rgba2.x * 65536.0f;
-	raster_triangle.rgba2.y = triangle->rgba2.y * 65536.0f;
-	raster_triangle.rgba2.z = triangle->rgba2.z * 65536.0f;
-	raster_triangle.rgba2.w = triangle->rgba2.w * 65536.0f;
-	
-	_split_raster_triangle(&raster_triangle);
+	raster_triangle->z0 = _convert_depth(triangle->v0.z);
+	raster_triangle->z1 = _convert_depth(triangle->v1.z);
+	raster_triangle->z2 = _convert_depth(triangle->v2.z);
+	raster_triangle->w0 = triangle->v0.w;
+	raster_triangle->w1 = triangle->v1.w;
+	raster_triangle->w2 = triangle->v2.w;
+	
+	raster_triangle->rgba0.x = triangle->rgba0.x * 65536.0f;
+	raster_triangle->rgba0.y = triangle->rgba0.y * 65536.0f;
+	raster_triangle->rgba0.z = triangle->rgba0.z * 65536.0f;
+	raster_triangle->rgba0.w = triangle->rgba0.w * 65536.0f;
+	raster_triangle->rgba1.x = triangle->rgba1.x * 65536.0f;
+	raster_triangle->rgba1.y = triangle->rgba1.y * 65536.0f;
+	raster_triangle->rgba1.z = triangle->rgba1.z * 65536.0f;
+	raster_triangle->rgba1.w = triangle->rgba1.w * 65536.0f;
+	raster_triangle->rgba2.x = triangle->rgba2.x * 65536.0f;
+	raster_triangle->rgba2.y = triangle->rgba2.y * 65536.0f;
+	raster_triangle->rgba2.z = triangle->rgba2.z * 65536.0f;
+	raster_triangle->rgba2.w = triangle->rgba2.w * 65536.0f;
+	
+	if(_brcontext->msaa_color)
+	{
+		_BR_STAT(primitives_rasterized, 1);
+		_BR_STAT_TIME(start);
+		_raster_msaa_triangle(raster_triangle);
+		_BR_STAT_ELAPSED(raster_ns, start);
+		return;
+	}
+	
+	if(!triangle->parent)
+	{
+		brvec2i a = raster_triangle->orig_v0, b = raster_triangle->orig_v1, c = raster_triangle->orig_v2;
+		int min_x = a.x < b.x ? (a.x < c.x ? a.x : c.x) : (b.x < c.x ? b.x : c.x);
+		int min_y = a.y < b.y ? (a.y < c.y ? a.y : c.y) : (b.y < c.y ? b.y : c.y);
+		int max_x = a.x > b.x ? (a.x > c.x ? a.x : c.x) : (b.x > c.x ? b.x : c.x);
+		int max_y = a.y > b.y ? (a.y > c.y ? a.y : c.y) : (b.y > c.y ? b.y : c.y);
+		
+		// no sample (integer raster coordinate) within the bounding box
+		if(((min_x+255)>>8) > (max_x>>8) || ((min_y+255)>>8) > (max_y>>8))
+		{
+			_BR_STAT(primitives_culled, 1);
+			return;
+		}
+		
+		if(max_x - min_x <= (BR_SMALL_TRIANGLE_SIZE<<8) && max_y - min_y <= (BR_SMALL_TRIANGLE_SIZE<<8))
+		{
+			_BR_STAT(primitives_rasterized, 1);
+			_BR_STAT_TIME(start);
+			_raster_small_triangle(raster_triangle);
+			_BR_STAT_ELAPSED(raster_ns, start);
+			return;
+		}
+	}
+	
+	_BR_STAT(primitives_rasterized, 1);
+	_BR_STAT_TIME(start);
+	_raster_triangle(raster_triangle);
+	_BR_STAT_ELAPSED(raster_ns, start);
+}
+
+// a block of triangles awaiting setup.
+// clip-space positions are kept as structure-of-arrays ([vertex][triangle]) so that
+// culling, frustum tests and the viewport transform run over the whole block at once.
+typedef struct _triangle_batch_t _triangle_batch_t;
+struct _triangle_batch_t
+{
+	uint32_t count;
+	_triangle_t triangles[BR_SETUP_BATCH_SIZE];
+	float x[3][BR_SETUP_BATCH_SIZE];
+	float y[3][BR_SETUP_BATCH_SIZE];
+	float z[3][BR_SETUP_BATCH_SIZE];
+	float w[3][BR_SETUP_BATCH_SIZE];
+};
+
+// set up & raster all triangles in a batch, in submission order.
+// triangles entirely inside the frustum are culled, perspective divided and viewport transformed
+// here; triangles needing clipping go through _process_triangle.
+void _setup_triangle_batch(_triangle_batch_t* batch)
+{
+	uint32_t n = batch->count;
+	batch->count = 0;
+	if(!n)
+		return;
+	
+	float center_x = _brcontext->viewport_center_x;
+	float center_y = _brcontext->viewport_center_y;
+	float half_width  = _brcontext->viewport_half_width;
+	float half_height = _brcontext->viewport_half_height;
+	
+	uint8_t outcode_and[BR_SETUP_BATCH_SIZE];
+	uint8_t outcode_or[BR_SETUP_BATCH_SIZE];
+	bool positive_w[BR_SETUP_BATCH_SIZE];
+	float det[BR_SETUP_BATCH_SIZE];
+	
+	// outcodes (see get_outcode)
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		outcode_and[i] = 0x3F;
+		outcode_or[i] = 0;
+		positive_w[i] = true;
+	}
+	for(uint32_t v = 0; v < 3; v += 1)
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		float x = batch->x[v][i], y = batch->y[v][i], z = batch->z[v][i], w = batch->w[v][i];
+		uint8_t outcode = (x < -w) * LEFT_BIT | (x > w) * RIGHT_BIT | (y < -w) * BOTTOM_BIT
+			| (y > w) * TOP_BIT | (z < -w) * NEAR_BIT | (z > w) * FAR_BIT;
+		outcode_and[i] &= outcode;
+		outcode_or[i] |= outcode;
+		positive_w[i] = positive_w[i] && (w > 0.0f);
+	}
+	
+	// signed areas; the same winding test as _process_triangle
+	for(uint32_t i = 0; i < n; i += 1)
+		det[i] = _triangle_det(batch->x[0][i], batch->y[0][i], batch->w[0][i],
+			batch->x[1][i], batch->y[1][i], batch->w[1][i], batch->x[2][i], batch->y[2][i], batch->w[2][i]);
+	
+	// perspective division & viewport transform (results are only used for accepted triangles)
+	float rx[3][BR_SETUP_BATCH_SIZE];
+	float ry[3][BR_SETUP_BATCH_SIZE];
+	float rz[3][BR_SETUP_BATCH_SIZE];
+	bool persp_div = _brcontext->persp_div;
+	for(uint32_t v = 0; v < 3; v += 1)
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		float w = batch->w[v][i];
+		float inv_w = (persp_div && w != 0.0f) ? 1.0f / w : 1.0f;
+		float x = batch->x[v][i] * inv_w;
+		float y = batch->y[v][i] * inv_w;
+		rz[v][i] = batch->z[v][i] * inv_w;
+		rx[v][i] = center_x + ( x * half_width);
+		ry[v][i] = center_y + (-y * half_height);
+	}
+	
+	_raster_triangle_t raster_triangle;
+	uint32_t tunit = batch->triangles[0].texture;
+	_setup_texture_unit(&raster_triangle, tunit);
+	
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		_triangle_t* triangle = &batch->triangles[i];
+		if(triangle->texture != tunit)
+			_setup_texture_unit(&raster_triangle, tunit = triangle->texture);
+		
+		// trivial reject: all vertices outside of the same clipping plane
+		if(_brcontext->clip && outcode_and[i])
+		{
+			_BR_STAT(primitives_culled, 1);
+			continue;
+		}
+		
+		// not trivially accepted; cull & clip the usual way
+		if(outcode_or[i] || !positive_w[i])
+		{
+			_process_triangle(triangle);
+			continue;
+		}
+		
+		// zero-area triangles cover no pixels
+		if(det[i] == 0.0f)
+		{
+			_BR_STAT(primitives_culled, 1);
+			continue;
+		}
+		if(_cull_winding(det[i]))
+		{
+			_BR_STAT(primitives_culled, 1);
+			continue;
+		}
+		
+		triangle->v0.z = rz[0][i];
+		triangle->v1.z = rz[1][i];
+		triangle->v2.z = rz[2][i];
+		raster_triangle.x0 = rx[0][i];
+		raster_triangle.y0 = ry[0][i];
+		raster_triangle.x1 = rx[1][i];
+		raster_triangle.y1 = ry[1][i];
+		raster_triangle.x2 = rx[2][i];
+		raster_triangle.y2 = ry[2][i];
+		_setup_raster_triangle(triangle, &raster_triangle);
+	}
+}
+
+// add a (parent) triangle to a batch, setting up the batch once full.
+void _batch_triangle(_triangle_batch_t* batch, _triangle_t* triangle)
+{
+	uint32_t i = batch->count;
+	batch->triangles[i] = *triangle;
+	batch->x[0][i] = triangle->v0.x, batch->y[0][i] = triangle->v0.y, batch->z[0][i] = triangle->v0.z, batch->w[0][i] = triangle->v0.w;
+	batch->x[1][i] = triangle->v1.x, batch->y[1][i] = triangle->v1.y, batch->z[1][i] = triangle->v1.z, batch->w[1][i] = triangle->v1.w;
+	batch->x[2][i] = triangle->v2.x, batch->y[2][i] = triangle->v2.y, batch->z[2][i] = triangle->v2.z, batch->w[2][i] = triangle->v2.w;
+	batch->count += 1;
+	
+	if(batch->count == BR_SETUP_BATCH_SIZE)
+		_setup_triangle_batch(batch);
 }
 
 // a line ready for post-processing
@@ -2306,6 +3769,9 @@ struct _line_t
 	
 	// texture coordinates (0-1), origin in bottom left
 	brvec2 tcoords0, tcoords1;
+	
+	// texture unit sampled
+	uint32_t texture;
 };
 
 // a line ready for rasterization
@@ -2332,12 +3798,16 @@ struct _raster_line_t
 	void* texture;
 	uint32_t texture_width;
 	uint32_t texture_height;
+	_texel_address_t texture_address[2];
+	uint32_t texture_pitch;
 	uint32_t texture_format;
 	bool texture_compressed;
 	bool complete_texture_unit;
 };
 
-// raster a line
+// raster a line with a fixed-point DDA; one fragment (or span of fragments, see BR_LINE_WIDTH) per
+// pixel along the major axis. the last pixel is not drawn, so that connected lines do not overlap.
+// positions, barycentric coordinates, colors, texel coordinates and depth step as integers.
 void _raster_line(_raster_line_t* params)
 {
 	if(!params)
@@ -2346,132 +3816,132 @@ void _raster_line(_raster_line_t* params)
 		return;
 		
 	bool depth_test = (_brcontext->depth_test && _brcontext->db);
-	bool plot_color = _brcontext->cb;
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
 	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
 	bool textured = (_brcontext->texture && params->complete_texture_unit);
+	bool persp_corr = _brcontext->persp_corr;
+	uint64_t samples = 0;
 	
-	// for fragment passes
-	_fragment_t frag_pass;
-	if(_brcontext->fshader)
-		_init_fragment(&frag_pass);
-		
-	// 24.8 fixed point
-	int x0 = params->x0 * 256.0f;
-	int x1 = params->x1 * 256.0f;
-	int y0 = params->y0 * 256.0f;
-	int y1 = params->y1 * 256.0f;
-	// 16.16 fixed point attributes
-	uint32_t r0 = params->rgba0.x;
-	uint32_t g0 = params->rgba0.y;
-	uint32_t b0 = params->rgba0.z;
-	uint32_t a0 = params->rgba0.w;
-	uint32_t r1 = params->rgba1.x;
-	uint32_t g1 = params->rgba1.y;
-	uint32_t b1 = params->rgba1.z;
-	uint32_t a1 = params->rgba1.w;
-	uint32_t tx0 = params->tx0.x;
-	uint32_t tx1 = params->tx1.x;
-	uint32_t ty0 = params->tx0.y;
-	uint32_t ty1 = params->tx1.y;
+	// 16.16 fixed point positions
+	int64_t x = params->x0 * 65536.0f;
+	int64_t y = params->y0 * 65536.0f;
+	int64_t dx = (int64_t)(params->x1 * 65536.0f) - x;
+	int64_t dy = (int64_t)(params->y1 * 65536.0f) - y;
+	
+	// length along the major axis & number of pixels covered
+	bool x_major = llabs(dx) >= llabs(dy);
+	int64_t length = x_major ? llabs(dx) : llabs(dy);
+	uint32_t n = (length + 0x8000) >> 16;
+	if(!n)
+		return;
+	
+	// 16.16 parameter step per pixel; the only divide per line
+	int64_t dt = ((int64_t)1 << 32) / length;
+	int64_t step_x = (dx * dt) >> 16;
+	int64_t step_y = (dy * dt) >> 16;
+	
+	// wide lines are drawn as spans across the major axis
+	int32_t span = _brcontext->line_width + 0.5f;
+	if(span < 1)
+		span = 1;
+	int32_t span_lo = -(span - 1) / 2;
+	int32_t span_hi = span_lo + span - 1;
+	
+	// 16.16 linear barycentric coordinates, relative to the original line
+	int64_t bx0 = params->bary0.x * 65536.0f, bx1 = params->bary1.x * 65536.0f;
+	int64_t by0 = params->bary0.y * 65536.0f, by1 = params->bary1.y * 65536.0f;
+	
+	// 16.16 attributes at the endpoints of this (sub-)line: r, g, b, a, texel x, texel y
+	int64_t attr0[6], attr1[6];
+	uint32_t v0[6] = { params->rgba0.x, params->rgba0.y, params->rgba0.z, params->rgba0.w, params->tx0.x, params->tx0.y };
+	uint32_t v1[6] = { params->rgba1.x, params->rgba1.y, params->rgba1.z, params->rgba1.w, params->tx1.x, params->tx1.y };
+	uint32_t attr_count = params->complete_texture_unit ? 6 : 4;
+	for(uint32_t i = 0; i < attr_count; i += 1)
+	{
+		attr0[i] = ((v0[i] * bx0) >> 16) + ((v1[i] * by0) >> 16);
+		attr1[i] = ((v0[i] * bx1) >> 16) + ((v1[i] * by1) >> 16);
+	}
+	
+	// current values & steps
+	int64_t t = 0;
+	int64_t bx = bx0, step_bx = ((bx1 - bx0) * dt) >> 16;
+	int64_t by = by0, step_by = ((by1 - by0) * dt) >> 16;
+	int64_t attr[6] = { 0, 0, 0, 0, 0, 0 }, step_attr[6];
+	for(uint32_t i = 0; i < attr_count; i += 1)
+	{
+		attr[i] = attr0[i];
+		step_attr[i] = ((attr1[i] - attr0[i]) * dt) >> 16;
+	}
+	// raster-space depth is linear along the line; 32.16 fixed point
+	int64_t z = params->z0 << 16;
+	int64_t step_z = (params->z1 - params->z0) * dt;
 	
-	float length = sqrt(pow(params->x0 - params->x1, 2) + pow(params->y0 - params->y1, 2));
-	if(length == 0.0f)
-		return;
-	float inv_length = 1.0f / length;
-	int p = 0;
-		
 	float inv_v0_w = 0;
 	float inv_v1_w = 0;
-	if(_brcontext->persp_corr)
+	if(persp_corr)
 	{
 		inv_v0_w = _fdiv(1.0f, params->w0);
 		inv_v1_w = _fdiv(1.0f, params->w1);
 	}
 	
-	int dx = abs(x1-x0), sx = x0 < x1 ? 1 : -1;
-	int dy = abs(y1-y0), sy = y0 < y1 ? 1 : -1;
-	int err = (dx>dy ? dx : -dy)/2, e2;
-		
-	int x = params->x0;
-	int y = params->y0;
+	// for fragment passes
+	_fragment_t frag_pass;
+	if(_brcontext->fshader)
+		_init_fragment(&frag_pass);
 	
-	uint32_t y_index = y * _brcontext->rb_width;
-
-	for(;;)
+	for(uint32_t i = 0; i < n; i += 1, t += dt, x += step_x, y += step_y, z += step_z, bx += step_bx, by += step_by)
 	{
-		int lengthp = sqrt(pow(x - params->x0, 2) + pow(y - params->y0, 2));
-		if(lengthp >= (int)length)
-			break;	// this is possibly the least optimal way to do this
+		// attributes of this step; stepped linearly, or perspective-corrected from 't'
+		brvec3i bary = { (int32_t)bx, (int32_t)by, 0 };
+		uint32_t r, g, b, a, tx = 0, ty = 0;
+		if(!persp_corr)
+		{
+			r = attr[0]; g = attr[1]; b = attr[2]; a = attr[3];
+			tx = attr[4]; ty = attr[5];
+			for(uint32_t j = 0; j < attr_count; j += 1)
+				attr[j] += step_attr[j];
+		}
+		else
+		{
+			float ft = t * _INV_65536;
+			int64_t u = _fdiv(ft * inv_v1_w, (1.0f - ft) * inv_v0_w + ft * inv_v1_w) * 65536.0f;
+			bary.x = bx0 + (((bx1 - bx0) * u) >> 16);
+			bary.y = by0 + (((by1 - by0) * u) >> 16);
+			for(uint32_t j = 0; j < attr_count; j += 1)
+				attr[j] = attr0[j] + (((attr1[j] - attr0[j]) * u) >> 16);
+			r = attr[0]; g = attr[1]; b = attr[2]; a = attr[3];
+			tx = attr[4]; ty = attr[5];
+		}
+		
+		// actual texel coordinates
+		tx = tx>>16;
+		ty = ty>>16;
 		
-		if(x >= 0 && x < _brcontext->rb_width && y >= 0 && y < _brcontext->rb_height)
+		int64_t depth = z >> 16;
+		brvec3 flt_bary = { (float)bary.x * _INV_65536, (float)bary.y * _INV_65536, 0 };
+		
+		int32_t px = x >> 16;
+		int32_t py = y >> 16;
+		for(int32_t k = span_lo; k <= span_hi; k += 1)
 		{
-			uint32_t pixel_index = y_index + x;
-
-			brvec3 bc;
-			brvec3i bary, linear_bary;
-			bc.x = (length - p) * inv_length;	// percent of v0
-			bc.y = 1.0f - bc.x;		// percent of v1
-			bc.z = 0.0f;
-			{
-				float bx = bc.x;
-				float by = bc.y;
-				bc.x = bx * params->bary0.x + by * params->bary1.x;
-				bc.y = bx * params->bary0.y + by * params->bary1.y;
-			}
-			
-			// bary to 16.16 fixed point
-			bc.x = bc.x*65536.0f;
-			bc.y = bc.y*65536.0f;
-			bc.z = bc.z*65536.0f;
-			
-			linear_bary = { bc.x, bc.y, bc.z };
-			bary = linear_bary;
-			if(_brcontext->persp_corr)
-			{
-				float w = _fdiv(65536.0f, (bary.x*inv_v0_w + bary.y*inv_v1_w));
-				bary.x *= inv_v0_w;
-				bary.y *= inv_v1_w;
-				bary.x *= w;
-				bary.y *= w;
-			}
+			int32_t fx = x_major ? px : px + k;
+			int32_t fy = x_major ? py + k : py;
+			if(fx < _brcontext->clip_x0 || fx >= _brcontext->clip_x1 || fy < _brcontext->clip_y0 || fy >= _brcontext->clip_y1)
+				continue;
+			uint32_t pixel_index = fy * _brcontext->rb_pitch + fx;
 			
-			brvec3 flt_bary = { (float)bary.x * _INV_65536, 
-				(float)bary.y * _INV_65536, 0 };
-
-			// safest to floating-point interpolate depths; they are in a large range and do not fit nicely to 16.16 fixed-point
-			int64_t depth = 0;
-			depth = params->z0 * flt_bary.x + params->z1 * flt_bary.y;
-
+			_BR_STAT(fragments_generated, 1);
 			if(depth_test)
 			{
 				int64_t dst = _get_depth(pixel_index);
 				if(!_is_valid_depth(depth) || depth > dst)
 				{
-					p += 1;
-					e2 = err;
-					if(e2 > -dx) { err -= dy; x += sx; }
-					if(e2 <  dy) { err += dx; y += sy; y_index += sy * _brcontext->rb_width; }
+					_BR_STAT(depth_failed, 1);
 					continue;
 				}
+				_BR_STAT(depth_passed, 1);
 			}
-
-			// 16.16 attributes multiplied by 16.16 barycentric coordinates
-			uint32_t r = (((uint32_t)r0 * bary.x)>>16) + (((uint32_t)r1 * bary.y)>>16);
-			uint32_t g = (((uint32_t)g0 * bary.x)>>16) + (((uint32_t)g1 * bary.y)>>16);
-			uint32_t b = (((uint32_t)b0 * bary.x)>>16) + (((uint32_t)b1 * bary.y)>>16);
-			uint32_t a = (((uint32_t)a0 * bary.x)>>16) + (((uint32_t)a1 * bary.y)>>16);
-			uint32_t tx = 0;
-			uint32_t ty = 0;
-			if(params->complete_texture_unit)
-			{
-				tx = (((uint64_t)tx0 * bary.x)>>16) + (((uint64_t)tx1 * bary.y)>>16);
-				ty = (((uint64_t)ty0 * bary.x)>>16) + (((uint64_t)ty1 * bary.y)>>16);
-			}
-
-			// actual texel coordinates
-			tx = tx>>16;
-			ty = ty>>16;
-		
+			
 			// fragment shading operations
 			brvec4ui rgba = { r, g, b, a };
 			if(_brcontext->fshader || textured)
@@ -2480,31 +3950,25 @@ void _raster_line(_raster_line_t* params)
 				brvec4 secondary = { 0,0,0,0 };
 				if(textured)
 					_get_texel(tx, ty, &secondary, params->texture, params->texture_format, 
-						params->texture_width, params->texture_height, params->texture_compressed);
+						params->texture_address, params->texture_pitch, params->texture_compressed);
 				if(_brcontext->fshader)
 				{
 					if(textured)	frag_pass.color = secondary;
 					else			frag_pass.color = primary;
 					frag_pass.primitive_color = primary;
 					frag_pass.texture_color = secondary;
-					frag_pass.linear_bary.x = linear_bary.x * _INV_65536;
-					frag_pass.linear_bary.y = linear_bary.y * _INV_65536;
-					frag_pass.linear_bary.z = linear_bary.z * _INV_65536;
+					frag_pass.linear_bary.x = bx * _INV_65536;
+					frag_pass.linear_bary.y = by * _INV_65536;
+					frag_pass.linear_bary.z = 0;
 					frag_pass.bary = flt_bary;
-					frag_pass.position.x = x;
-					frag_pass.position.y = y;
+					frag_pass.position.x = fx;
+					frag_pass.position.y = fy;
 					frag_pass.discard = false;
-
+					
 					// convert result fragment to 16.16, setting 'rgba'
 					brvec4 color = _fragment_pass(&frag_pass);
 					if(frag_pass.discard)
-					{
-						p += 1;
-						e2 = err;
-						if(e2 > -dx) { err -= dy; x += sx; }
-						if(e2 <  dy) { err += dx; y += sy; y_index += sy * _brcontext->rb_width; }
 						continue;
-					}
 					rgba.x = color.x * 65536.0f;
 					rgba.y = color.y * 65536.0f;
 					rgba.z = color.z * 65536.0f;
@@ -2519,25 +3983,88 @@ void _raster_line(_raster_line_t* params)
 					rgba.w = secondary.w * 65536.0f;
 				}
 			}
-				
+			
+			samples += 1;
 			if(plot_color)
 				_plot_pixel(pixel_index, rgba, _brcontext->blend);
-
+			
 			if(plot_depth && _is_valid_depth(depth))
 				_plot_depth(pixel_index, depth);
 		}
-		p += 1;
-		e2 = err;
-		if(e2 > -dx) { err -= dy; x += sx; }
-		if(e2 <  dy) { err += dx; y += sy; y_index += sy * _brcontext->rb_width; }
 	}
 	
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
 	if(_brcontext->fshader) {
 	if(frag_pass.pass_data)
-		free(frag_pass.pass_data);
+		_br_free(frag_pass.pass_data);
 	if(frag_pass.pass_attribs)
-		free(frag_pass.pass_attribs);
+		_br_free(frag_pass.pass_attribs);
+	}
+}
+
+// set texture unit information of a raster line from texture unit 'tunit'.
+void _setup_line_texture_unit(_raster_line_t* raster_line, uint32_t tunit)
+{
+	raster_line->complete_texture_unit = ( _brcontext->textures[tunit] && _brcontext->texture_widths[tunit] > 0
+		&& _brcontext->texture_heights[tunit] > 0 && _is_texture_format(_brcontext->texture_formats[tunit]) );
+	if(raster_line->complete_texture_unit)
+	{
+		raster_line->texture            = _brcontext->textures[tunit];
+		raster_line->texture_width      = _brcontext->texture_widths[tunit];
+		raster_line->texture_height     = _brcontext->texture_heights[tunit];
+		raster_line->texture_pitch      = _brcontext->texture_pitches[tunit];
+		raster_line->texture_format     = _brcontext->texture_formats[tunit];
+		raster_line->texture_compressed = _brcontext->texture_compressed_booleans[tunit];
+		_setup_texel_address(&raster_line->texture_address[0], raster_line->texture_width, _brcontext->texture_wraps[tunit][0]);
+		_setup_texel_address(&raster_line->texture_address[1], raster_line->texture_height, _brcontext->texture_wraps[tunit][1]);
+	}
+}
+
+// finish setup of a raster line and raster it.
+// 'line' must be perspective divided, and 'raster_line' must have its raster-space positions (x0..y1),
+// barycentric coordinates and texture unit information (see _setup_line_texture_unit) set.
+void _setup_raster_line(_line_t* line, _raster_line_t* raster_line)
+{
+	if(raster_line->complete_texture_unit)
+	{
+		float s[2] = { line->tcoords0.x, line->tcoords1.x };
+		float t[2] = { 1.0f - line->tcoords0.y, 1.0f - line->tcoords1.y };
+		uint32_t x[2], y[2];
+		_texel_coords(s, 2, &raster_line->texture_address[0], x);
+		_texel_coords(t, 2, &raster_line->texture_address[1], y);
+		raster_line->tx0 = { x[0], y[0] };
+		raster_line->tx1 = { x[1], y[1] };
 	}
+	
+	raster_line->z0 = _convert_depth(line->v0.z);
+	raster_line->z1 = _convert_depth(line->v1.z);
+	raster_line->w0 = line->v0.w;
+	raster_line->w1 = line->v1.w;
+	
+	raster_line->rgba0.x = line->rgba0.x * 65536.0f;
+	raster_line->rgba0.y = line->rgba0.y * 65536.0f;
+	raster_line->rgba0.z = line->rgba0.z * 65536.0f;
+	raster_line->rgba0.w = line->rgba0.w * 65536.0f;
+	raster_line->rgba1.x = line->rgba1.x * 65536.0f;
+	raster_line->rgba1.y = line->rgba1.y * 65536.0f;
+	raster_line->rgba1.z = line->rgba1.z * 65536.0f;
+	raster_line->rgba1.w = line->rgba1.w * 65536.0f;
+	
+	float half = _brcontext->line_width * 0.5f;
+	if(!_touch_bounds((raster_line->x0 < raster_line->x1 ? raster_line->x0 : raster_line->x1) - half, 
+		(raster_line->y0 < raster_line->y1 ? raster_line->y0 : raster_line->y1) - half,
+		(raster_line->x0 > raster_line->x1 ? raster_line->x0 : raster_line->x1) + half, 
+		(raster_line->y0 > raster_line->y1 ? raster_line->y0 : raster_line->y1) + half))
+	{
+		_BR_STAT(primitives_culled, 1);
+		return;
+	}
+	
+	_BR_STAT(primitives_rasterized, 1);
+	_BR_STAT_TIME(start);
+	_raster_line(raster_line);
+	_BR_STAT_ELAPSED(raster_ns, start);
 }
 
 // post-process and raster a line (vertex shader pass, _vertex_pass, not performed here)
@@ -2561,8 +4088,16 @@ void _process_line(_line_t* line)
 		// if 'clipped' is true.
 		
 		if(!in_frustum(line->v0) && !in_frustum(line->v1))
+		{
+			_BR_STAT(primitives_culled, 1);
 			return;
+		}
 		
+		if(!in_frustum(line->v0) || !in_frustum(line->v1))
+		{
+			_BR_STAT(primitives_clipped, 1);
+			clipped = true;
+		}
 		clip_line(&line->v0, &line->v1);
 	}
 	
@@ -2576,24 +4111,28 @@ void _process_line(_line_t* line)
 	}
 	else	// line was clipped
 	{
-		// calculate LINEAR barycentric coordinates relative to the original line
-		float length_v0p;	// where 'p' is a new endpoint and 'v0' is the original v0
-		float length = sqrt(pow(orig_v0.x - orig_v1.x, 2) + pow(orig_v0.y - orig_v1.y, 2));
-
+		// calculate LINEAR barycentric coordinates relative to the original line;
+		// the new endpoints lie on the original (clip-space) line, so take their parameter along
+		// its largest component
+		brvec4 d = { orig_v1.x - orig_v0.x, orig_v1.y - orig_v0.y, orig_v1.z - orig_v0.z, orig_v1.w - orig_v0.w };
+		int32_t comp = 0;
+		for(int32_t i = 1; i < 4; i += 1)
+			if(fabsf(get_comp(d, i)) > fabsf(get_comp(d, comp)))
+				comp = i;
+		float length = get_comp(d, comp);
+		
 		if(length == 0.0f)
 			return;
 		float inv_length = 1.0f / length;
 		
-		length_v0p = sqrt(pow(orig_v0.x - line->v0.x, 2) + pow(orig_v0.y - line->v0.y, 2));
-
-		raster_line.bary0.x = (length - length_v0p) * inv_length;
-		raster_line.bary0.y = 1.0f - raster_line.bary0.x;
+		float t = (get_comp(line->v0, comp) - get_comp(orig_v0, comp)) * inv_length;
+		raster_line.bary0.x = 1.0f - t;
+		raster_line.bary0.y = t;
 		raster_line.bary0.z = 0.0f;
 		
-		length_v0p = sqrt(pow(orig_v0.x - line->v1.x, 2) + pow(orig_v0.y - line->v1.y, 2));
-		
-		raster_line.bary1.x = (length - length_v0p) * inv_length;
-		raster_line.bary1.y = 1.0f - raster_line.bary1.x;
+		t = (get_comp(line->v1, comp) - get_comp(orig_v0, comp)) * inv_length;
+		raster_line.bary1.x = 1.0f - t;
+		raster_line.bary1.y = t;
 		raster_line.bary1.z = 0.0f;
 	}
 	
@@ -2618,61 +4157,135 @@ void _process_line(_line_t* line)
 		line->v1.z *= 0.5f + 0.5f;
 	}
 	
-	uint32_t tunit = _brcontext->texture_unit;
-	raster_line.complete_texture_unit = ( _brcontext->textures[tunit] && _brcontext->texture_widths[tunit] > 0
-		&& _brcontext->texture_heights[tunit] > 0 && _is_pixel_format(_brcontext->texture_formats[tunit]) );
-	if(raster_line.complete_texture_unit)
-	{
-		raster_line.texture        = _brcontext->textures[_brcontext->texture_unit];
-		raster_line.texture_width  = _brcontext->texture_widths[_brcontext->texture_unit];
-		raster_line.texture_height     = _brcontext->texture_heights[_brcontext->texture_unit];
-		raster_line.texture_format     = _brcontext->texture_formats[_brcontext->texture_unit];
-		raster_line.texture_compressed = _brcontext->texture_compressed_booleans[_brcontext->texture_unit];
-		raster_line.tx0.x = line->tcoords0.x * (raster_line.texture_width - 1) * 65536;
-		raster_line.tx0.y = (1.0f - line->tcoords0.y) * (raster_line.texture_height - 1) * 65536;
-		raster_line.tx1.x = line->tcoords1.x * (raster_line.texture_width - 1) * 65536;
-		raster_line.tx1.y = (1.0f - line->tcoords1.y) * (raster_line.texture_height - 1) * 65536;
-	}
-	
-	float half_width  = _brcontext->rb_width  * 0.5f;
-	float half_height = _brcontext->rb_height * 0.5f;
-	
-	raster_line.x0 = half_width  + ( line->v0.x * half_width);
-	raster_line.y0 = half_height + (-line->v0.y * half_height);
-	raster_line.x1 = half_width  + ( line->v1.x * half_width);
-	raster_line.y1 = half_height + (-line->v1.y * half_height);
-
-	raster_line.z0 = _convert_depth(line->v0.z);
-	raster_line.z1 = _convert_depth(line->v1.z);
-	raster_line.w0 = line->v0.w;
-	raster_line.w1 = line->v1.w;
-	
-	raster_line.rgba0.x = line->rgba0.x * 65536.0f;
-	raster_line.rgba0.y = line->rgba0.y * 65536.0f;
-	raster_line.rgba0.z = line->rgba0.z * 65536.0f;
-	raster_line.rgba0.w = line->rgba0.w * 65536.0f;
-	raster_line.rgba1.x = line->rgba1.x * 65536.0f;
-	raster_line.rgba1.y = line->rgba1.y * 65536.0f;
-	raster_line.rgba1.z = line->rgba1.z * 65536.0f;
-	raster_line.rgba1.w = line->rgba1.w * 65536.0f;
-	
-	_raster_point_t pt;
-	pt.x = raster_line.x0;
-	pt.y = raster_line.y0;
-	pt.rgba = { 65536, 65536, 65536, 65536 };
-	pt.r = 2;
-	pt.z = 0;
-	pt.w = 1;
-	_raster_point(&pt);
-	pt.x = raster_line.x1;
-	pt.y = raster_line.y1;
-	pt.rgba = { 65536, 65536, 65536, 65536 };
-	pt.r = 2;
-	pt.z = 0;
-	pt.w = 1;
-	_raster_point(&pt);
-	
-	_raster_line(&raster_line);
+	float center_x = _brcontext->viewport_center_x;
+	float center_y = _brcontext->viewport_center_y;
+	float half_width  = _brcontext->viewport_half_width;
+	float half_height = _brcontext->viewport_half_height;
+	
+	raster_line.x0 = center_x + ( line->v0.x * half_width);
+	raster_line.y0 = center_y + (-line->v0.y * half_height);
+	raster_line.x1 = center_x + ( line->v1.x * half_width);
+	raster_line.y1 = center_y + (-line->v1.y * half_height);
+	
+	_setup_line_texture_unit(&raster_line, line->texture);
+	_setup_raster_line(line, &raster_line);
+}
+
+// a block of lines awaiting setup; see _triangle_batch_t.
+// wireframes submit many short lines, so frustum tests, perspective division and the viewport
+// transform run over the whole block at once.
+typedef struct _line_batch_t _line_batch_t;
+struct _line_batch_t
+{
+	uint32_t count;
+	_line_t lines[BR_SETUP_BATCH_SIZE];
+	float x[2][BR_SETUP_BATCH_SIZE];
+	float y[2][BR_SETUP_BATCH_SIZE];
+	float z[2][BR_SETUP_BATCH_SIZE];
+	float w[2][BR_SETUP_BATCH_SIZE];
+};
+
+// set up & raster all lines in a batch, in submission order.
+// lines entirely inside the frustum are perspective divided and viewport transformed here;
+// lines needing clipping go through _process_line.
+void _setup_line_batch(_line_batch_t* batch)
+{
+	uint32_t n = batch->count;
+	batch->count = 0;
+	if(!n)
+		return;
+	
+	float center_x = _brcontext->viewport_center_x;
+	float center_y = _brcontext->viewport_center_y;
+	float half_width  = _brcontext->viewport_half_width;
+	float half_height = _brcontext->viewport_half_height;
+	
+	uint8_t outcode_and[BR_SETUP_BATCH_SIZE];
+	uint8_t outcode_or[BR_SETUP_BATCH_SIZE];
+	bool positive_w[BR_SETUP_BATCH_SIZE];
+	
+	// outcodes (see get_outcode)
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		outcode_and[i] = 0x3F;
+		outcode_or[i] = 0;
+		positive_w[i] = true;
+	}
+	for(uint32_t v = 0; v < 2; v += 1)
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		float x = batch->x[v][i], y = batch->y[v][i], z = batch->z[v][i], w = batch->w[v][i];
+		uint8_t outcode = (x < -w) * LEFT_BIT | (x > w) * RIGHT_BIT | (y < -w) * BOTTOM_BIT
+			| (y > w) * TOP_BIT | (z < -w) * NEAR_BIT | (z > w) * FAR_BIT;
+		outcode_and[i] &= outcode;
+		outcode_or[i] |= outcode;
+		positive_w[i] = positive_w[i] && (w > 0.0f);
+	}
+	
+	// perspective division & viewport transform (results are only used for accepted lines)
+	float rx[2][BR_SETUP_BATCH_SIZE];
+	float ry[2][BR_SETUP_BATCH_SIZE];
+	float rz[2][BR_SETUP_BATCH_SIZE];
+	bool persp_div = _brcontext->persp_div;
+	for(uint32_t v = 0; v < 2; v += 1)
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		float w = batch->w[v][i];
+		float inv_w = (persp_div && w != 0.0f) ? 1.0f / w : 1.0f;
+		float x = batch->x[v][i] * inv_w;
+		float y = batch->y[v][i] * inv_w;
+		rz[v][i] = batch->z[v][i] * inv_w;
+		rx[v][i] = center_x + ( x * half_width);
+		ry[v][i] = center_y + (-y * half_height);
+	}
+	
+	_raster_line_t raster_line;
+	uint32_t tunit = batch->lines[0].texture;
+	_setup_line_texture_unit(&raster_line, tunit);
+	raster_line.bary0 = { 1, 0, 0 };
+	raster_line.bary1 = { 0, 1, 0 };
+	
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		_line_t* line = &batch->lines[i];
+		if(line->texture != tunit)
+			_setup_line_texture_unit(&raster_line, tunit = line->texture);
+		
+		// trivial reject: both vertices outside of the same clipping plane
+		if(_brcontext->clip && outcode_and[i])
+		{
+			_BR_STAT(primitives_culled, 1);
+			continue;
+		}
+		
+		// not trivially accepted; clip the usual way
+		if(outcode_or[i] || !positive_w[i])
+		{
+			_process_line(line);
+			continue;
+		}
+		
+		line->v0.z = rz[0][i];
+		line->v1.z = rz[1][i];
+		raster_line.x0 = rx[0][i];
+		raster_line.y0 = ry[0][i];
+		raster_line.x1 = rx[1][i];
+		raster_line.y1 = ry[1][i];
+		_setup_raster_line(line, &raster_line);
+	}
+}
+
+// add a line to a batch, setting up the batch once full.
+void _batch_line(_line_batch_t* batch, _line_t* line)
+{
+	uint32_t i = batch->count;
+	batch->lines[i] = *line;
+	batch->x[0][i] = line->v0.x, batch->y[0][i] = line->v0.y, batch->z[0][i] = line->v0.z, batch->w[0][i] = line->v0.w;
+	batch->x[1][i] = line->v1.x, batch->y[1][i] = line->v1.y, batch->z[1][i] = line->v1.z, batch->w[1][i] = line->v1.w;
+	batch->count += 1;
+	
+	if(batch->count == BR_SETUP_BATCH_SIZE)
+		_setup_line_batch(batch);
 }
 
 // a point ready for post-processing
@@ -2704,68 +4317,46 @@ struct _raster_point_t
 	float w;
 };*/
 
-// raster a fragment of a point; used by point rasterization algorithm
-void _raster_point_fragment(int x, int y, _raster_point_t* point, _fragment_t* frag_pass)
+// return the span table of a point of radius 'r': the half-width of each row, from the center row out.
+// the rows are those of a midpoint circle. the table is kept until a point of another radius is drawn.
+uint32_t* _point_span_table(uint32_t r)
 {
-	if(!_brcontext || (x < 0 || x >= _brcontext->rb_width || y < 0 || y >= _brcontext->rb_height))
-		return;
+	if(_brcontext->point_spans && _brcontext->point_span_radius == r)
+		return _brcontext->point_spans;
 	
-	bool depth_test = (_brcontext->depth_test && _brcontext->db);
-	bool plot_color = _brcontext->cb;
-	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
+	uint32_t* spans = (uint32_t*) _br_realloc(_brcontext->point_spans, (r+1) * sizeof(uint32_t));
+	if(!spans)
+		return NULL;
+	memset(spans, 0, (r+1) * sizeof(uint32_t));
+	_brcontext->point_spans = spans;
+	_brcontext->point_span_radius = r;
 	
-	uint32_t pixel_index = y * _brcontext->rb_width + x;
+	int f = 1 - r;
+	int dx = 0;
+	int dy = -2 * r;
+	int x2 = 0;
+	int y2 = r;
 	
-	int64_t depth = point->z;
-
-	if(depth_test)
-	{
-		int64_t dst = _get_depth(pixel_index);
-		if(!_is_valid_depth(depth) || depth > dst)
-			return;
-	}
-
-	// 16.16 attributes
-	uint32_t r = point->rgba.x;
-	uint32_t g = point->rgba.y;
-	uint32_t b = point->rgba.z;
-	uint32_t a = point->rgba.w;
-	uint32_t tx = 0;
-	uint32_t ty = 0;
-		
-	// fragment shading operations
-	brvec4ui rgba = { r, g, b, a };
-	if(_brcontext->fshader)
+	spans[0] = r;
+	while(x2 < y2)
 	{
-		brvec4 primary = { r*_INV_65536, g*_INV_65536, b*_INV_65536, a*_INV_65536 };
-		brvec4 secondary = { 0,0,0,0 };
-		frag_pass->color = primary;
-		frag_pass->primitive_color = primary;
-		frag_pass->texture_color = secondary;
-		frag_pass->linear_bary = { 0,0,0 };
-		frag_pass->bary = { 0,0,0 };
-		frag_pass->position.x = x;
-		frag_pass->position.y = y;
-		frag_pass->discard = false;
-
-		// convert result fragment to 16.16, setting 'rgba'
-		brvec4 color = _fragment_pass(frag_pass);
-		if(frag_pass->discard)
-			return;
-		rgba.x = color.x * 65536.0f;
-		rgba.y = color.y * 65536.0f;
-		rgba.z = color.z * 65536.0f;
-		rgba.w = color.w * 65536.0f;
+		if(f >= 0)
+		{
+			y2 -= 1;
+			dy += 2;
+			f += dy;
+		}
+		x2 += 1;
+		dx += 2;
+		f += dx + 1;
+		if(spans[y2] < (uint32_t)x2)	spans[y2] = x2;
+		if(spans[x2] < (uint32_t)y2)	spans[x2] = y2;
 	}
-				
-	if(plot_color)
-		_plot_pixel(pixel_index, rgba, _brcontext->blend);
-			
-	if(plot_depth && _is_valid_depth(depth))
-		_plot_depth(pixel_index, depth);
+	return spans;
 }
 
-// raster a point
+// raster a point as horizontal spans (see _point_span_table).
+// uses the fragment context of the draw (point_frag) when there is one.
 void _raster_point(_raster_point_t* params)
 {
 	if(!params)
@@ -2773,71 +4364,106 @@ void _raster_point(_raster_point_t* params)
 	if(!_brcontext)
 		return;
 	
-	// for fragment passes
-	_fragment_t frag_pass;
-	if(_brcontext->fshader)
-		_init_fragment(&frag_pass);
-	
 	uint32_t r = params->r;
 	if(r <= 0) 
 		return;
-		
-	int f = 1 - r;
-	int dx = 0;
-	int dy = -2 * r;
-	int x2 = 0;
-	int y2 = r;
+	uint32_t* spans = _point_span_table(r);
+	if(!spans)
+		return;
+	
+	bool depth_test = (_brcontext->depth_test && _brcontext->db);
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
+	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
+	
+	int64_t depth = params->z;
+	bool valid_depth = _is_valid_depth(depth);
+	uint64_t samples = 0;
+	
+	// for fragment passes
+	_fragment_t local_frag_pass = {};
+	_fragment_t* frag_pass = _brcontext->point_frag;
+	if(_brcontext->fshader && !frag_pass)
+	{
+		_init_fragment(&local_frag_pass);
+		frag_pass = &local_frag_pass;
+	}
+	
+	// all fragments of a point share its color
+	brvec4ui point_rgba = params->rgba;
+	brvec4 primary = { point_rgba.x*_INV_65536, point_rgba.y*_INV_65536, point_rgba.z*_INV_65536, point_rgba.w*_INV_65536 };
 	
 	int point_x = params->x;
 	int point_y = params->y;
+	int pitch  = _brcontext->rb_pitch;
 	
-/*	if(point_x - r >= _brcontext->rb_width)
-		return;
-	if(point_x + r < 0)
-		return;
-	if(point_y - r >= _brcontext->rb_height)
-		return;
-	if(point_y + r < 0)
-		return;*/
+	for(int dy = -(int)r; dy <= (int)r; dy += 1)
+	{
+		int y = point_y + dy;
+		if(y < _brcontext->clip_y0 || y >= _brcontext->clip_y1)
+			continue;
 		
-	_raster_point_fragment(point_x, point_y + r, params, &frag_pass);
-	_raster_point_fragment(point_x, point_y - r, params, &frag_pass);
-
-	for(int x = point_x - r; x <= point_x + r; x += 1)
-		_raster_point_fragment(x, point_y, params, &frag_pass);
+		int half = spans[dy < 0 ? -dy : dy];
+		int x0 = point_x - half;
+		int x1 = point_x + half;
+		if(x0 < _brcontext->clip_x0)	x0 = _brcontext->clip_x0;
+		if(x1 >= _brcontext->clip_x1)	x1 = _brcontext->clip_x1 - 1;
+		if(x0 > x1)
+			continue;
 		
-	while(x2 < y2)
-	{
-		if(f >= 0)
+		_BR_STAT(fragments_generated, x1 - x0 + 1);
+		uint32_t pixel_index = y * pitch + x0;
+		for(int x = x0; x <= x1; x += 1, pixel_index += 1)
 		{
-			y2 -= 1;
-			dy += 2;
-			f += dy;
+			if(depth_test)
+			{
+				int64_t dst = _get_depth(pixel_index);
+				if(!valid_depth || depth > dst)
+				{
+					_BR_STAT(depth_failed, 1);
+					continue;
+				}
+				_BR_STAT(depth_passed, 1);
+			}
+			
+			// fragment shading operations
+			brvec4ui rgba = point_rgba;
+			if(_brcontext->fshader)
+			{
+				frag_pass->color = primary;
+				frag_pass->primitive_color = primary;
+				frag_pass->texture_color = { 0,0,0,0 };
+				frag_pass->linear_bary = { 0,0,0 };
+				frag_pass->bary = { 0,0,0 };
+				frag_pass->position.x = x;
+				frag_pass->position.y = y;
+				frag_pass->discard = false;
+				
+				// convert result fragment to 16.16, setting 'rgba'
+				brvec4 color = _fragment_pass(frag_pass);
+				if(frag_pass->discard)
+					continue;
+				rgba.x = color.x * 65536.0f;
+				rgba.y = color.y * 65536.0f;
+				rgba.z = color.z * 65536.0f;
+				rgba.w = color.w * 65536.0f;
+			}
+			
+			samples += 1;
+			if(plot_color)
+				_plot_pixel(pixel_index, rgba, _brcontext->blend);
+			
+			if(plot_depth && valid_depth)
+				_plot_depth(pixel_index, depth);
 		}
-		x2 += 1;
-		dx += 2;
-		f += dx + 1;
-		int x0 = point_x - x2;
-		int x1 = point_x + x2;
-		int sx = (x0 < x1) ? 1 : -1; 
-		for(int x = x0; x != x1+sx; x += sx)
-			_raster_point_fragment(x, point_y + y2, params, &frag_pass);
-		for(int x = x0; x != x1+sx; x += sx)
-			_raster_point_fragment(x, point_y - y2, params, &frag_pass);
-		x0 = point_x - y2;
-		x1 = point_x + y2;
-		sx = (x0 < x1) ? 1 : -1; 
-		for(int x = x0; x != x1+sx; x += sx)
-			_raster_point_fragment(x, point_y + x2, params, &frag_pass);
-		for(int x = x0; x != x1+sx; x += sx)
-			_raster_point_fragment(x, point_y - x2, params, &frag_pass);
 	}
 	
-	if(_brcontext->fshader) {
-	if(frag_pass.pass_data)
-		free(frag_pass.pass_data);
-	if(frag_pass.pass_attribs)
-		free(frag_pass.pass_attribs);
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
+	if(frag_pass == &local_frag_pass) {
+	if(local_frag_pass.pass_data)
+		_br_free(local_frag_pass.pass_data);
+	if(local_frag_pass.pass_attribs)
+		_br_free(local_frag_pass.pass_attribs);
 	}
 }
 
@@ -2853,18 +4479,13 @@ void _process_point(_point_t* point)
 	{
 		// clip against -w <= (x,y,z) <= w
 
-		if(-point->pos.w > point->pos.x)
-			return;
-		if(point->pos.x > point->pos.w)
-			return;
-		if(-point->pos.w > point->pos.y)
-			return;
-		if(point->pos.y > point->pos.w)
-			return;
-		if(-point->pos.w > point->pos.z)
-			return;
-		if(point->pos.z > point->pos.w)
+		if(-point->pos.w > point->pos.x || point->pos.x > point->pos.w ||
+		-point->pos.w > point->pos.y || point->pos.y > point->pos.w ||
+		-point->pos.w > point->pos.z || point->pos.z > point->pos.w)
+		{
+			_BR_STAT(primitives_culled, 1);
 			return;
+		}
 	}
 	
 	_raster_point_t raster_point;
@@ -2880,11 +4501,13 @@ void _process_point(_point_t* point)
 	if(_brcontext->scale_z)
 		point->pos.z *= 0.5f + 0.5f;
 	
-	float half_width  = _brcontext->rb_width  * 0.5f;
-	float half_height = _brcontext->rb_height * 0.5f;
+	float center_x = _brcontext->viewport_center_x;
+	float center_y = _brcontext->viewport_center_y;
+	float half_width  = _brcontext->viewport_half_width;
+	float half_height = _brcontext->viewport_half_height;
 	
-	raster_point.x = half_width  + ( point->pos.x * half_width);
-	raster_point.y = half_height + (-point->pos.y * half_height);
+	raster_point.x = center_x + ( point->pos.x * half_width);
+	raster_point.y = center_y + (-point->pos.y * half_height);
 
 	raster_point.z = _convert_depth(point->pos.z);
 	raster_point.w = point->pos.w;
@@ -2895,8 +4518,17 @@ void _process_point(_point_t* point)
 	raster_point.rgba.w = point->rgba.w * 65536.0f;
 	
 	raster_point.r = _brcontext->point_radius + .5f;
+	if(!_touch_bounds(raster_point.x - raster_point.r, raster_point.y - raster_point.r, 
+		raster_point.x + raster_point.r, raster_point.y + raster_point.r))
+	{
+		_BR_STAT(primitives_culled, 1);
+		return;
+	}
 	
+	_BR_STAT(primitives_rasterized, 1);
+	_BR_STAT_TIME(start);
 	_raster_point(&raster_point);
+	_BR_STAT_ELAPSED(raster_ns, start);
 }
 
 
@@ -2915,11 +4547,91 @@ void _process_point(_point_t* point)
 
 
 
+// set the allocator used for all memory allocated by Bear, including contexts & renderbuffers.
+// pass NULL to restore the default (aligned_alloc & free). blocks are always released through
+// the allocator they came from, so this may be called at any time.
+void brSetAllocator(brallocator* allocator)
+{
+	if(allocator && allocator->alloc && allocator->free)
+		_brallocator = *allocator;
+	else
+	{
+		_brallocator.alloc = _br_default_alloc;
+		_brallocator.free = _br_default_free;
+		_brallocator.user = NULL;
+	}
+}
+
+// huge page allocation callbacks; see brHugePageAllocator.
+// every block of BR_HUGE_PAGE_SIZE bytes or more is mapped, whatever its alignment, as _br_huge_page_free
+// tells blocks apart by size alone.
+void* _br_huge_page_alloc(size_t size, size_t alignment, void* user)
+{
+#ifdef __linux__
+	if(size >= BR_HUGE_PAGE_SIZE)
+	{
+		size = (size + BR_HUGE_PAGE_SIZE-1) & ~(size_t)(BR_HUGE_PAGE_SIZE-1);
+		// explicit huge pages, if the system has any reserved; they're aligned to BR_HUGE_PAGE_SIZE
+		if(alignment <= BR_HUGE_PAGE_SIZE)
+		{
+			void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if(ptr != MAP_FAILED)
+				return ptr;
+		}
+		// otherwise map an aligned range and ask for transparent huge pages
+		if(alignment < BR_HUGE_PAGE_SIZE)
+			alignment = BR_HUGE_PAGE_SIZE;
+		uint8_t* base = (uint8_t*) mmap(NULL, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(base == MAP_FAILED)
+			return NULL;
+		uint8_t* aligned = (uint8_t*)(((uintptr_t)base + alignment-1) & ~(uintptr_t)(alignment-1));
+		if(aligned != base)
+			munmap(base, aligned - base);
+		munmap(aligned + size, base + alignment - aligned);
+		madvise(aligned, size, MADV_HUGEPAGE);
+		return aligned;
+	}
+#endif
+	return _br_default_alloc(size, alignment, user);
+}
+
+void _br_huge_page_free(void* ptr, size_t size, void* user)
+{
+#ifdef __linux__
+	if(size >= BR_HUGE_PAGE_SIZE)
+	{
+		munmap(ptr, (size + BR_HUGE_PAGE_SIZE-1) & ~(size_t)(BR_HUGE_PAGE_SIZE-1));
+		return;
+	}
+#endif
+	_br_default_free(ptr, size, user);
+}
+
+// return an allocator that backs allocations of BR_HUGE_PAGE_SIZE bytes or more (e.g. large
+// renderbuffers) with huge pages, to reduce TLB misses; smaller allocations use the default allocator.
+// huge pages are only used on linux; elsewhere this behaves like the default allocator.
+brallocator* brHugePageAllocator()
+{
+	static brallocator allocator = { _br_huge_page_alloc, _br_huge_page_free, NULL };
+	return &allocator;
+}
+
 // allocate, initialize and return a context.
 brcontext* brCreateContext()
 {
 	brcontext* context;
-	context = (brcontext*) malloc(sizeof(brcontext));
+	context = (brcontext*) _br_alloc_unaccounted(sizeof(brcontext), 64);
+	if(!context)
+		return NULL;
+	context->account = (_alloc_account_t*) _br_alloc_unaccounted(sizeof(_alloc_account_t), 16);
+	if(!context->account)
+	{
+		_br_free_unaccounted(context);
+		return NULL;
+	}
+	context->account->allocated_bytes = sizeof(brcontext);
+	context->account->peak_allocated_bytes = sizeof(brcontext);
+	context->account->references = 1;
 	
 	context->cb = NULL;
 	context->db = NULL;
@@ -2933,35 +4645,61 @@ brcontext* brCreateContext()
 	context->rb_height = 0;
 	context->rb2_width = 0;
 	context->rb2_height = 0;
+	context->rb_pitch = 0;
+	context->rb2_pitch = 0;
 	context->clear_color = {0,0,0,0};
 	context->clear_depth = 1;
 	context->point_radius = 1;
+	context->line_width = 1;
 	context->double_buffer = false;
 	context->depth_write = true;
+	context->color_write = true;
 	context->depth_test = true;
 	context->persp_corr = true;
 	context->texture = true;
 	context->blend = false;
+	context->blend_src = BR_SRC_ALPHA;
+	context->blend_dst = BR_ONE_MINUS_SRC_ALPHA;
+	context->blend_eq = BR_FUNC_ADD;
 	context->cull = false;
 	context->cull_winding = BR_CW;
 	context->clip = true;
 	context->persp_div = true;
 	context->scale_z = true;
 	context->poly_mode = BR_FILL;
+	context->primitive_restart = false;
+	context->restart_index = 0xFFFFFFFF;
 	context->vertex_array = false;
 	context->color_array = false;
 	context->normal_array = false;
 	context->tcoord_array = false;
+	context->texture_index_array = false;
 	context->vertex_stride = 0;
 	context->color_stride = 0;
 	context->normal_stride = 0;
 	context->tcoord_stride = 0;
+	context->texture_index_stride = 0;
 	context->vertex_offset = NULL;
 	context->color_offset = NULL;
 	context->normal_offset = NULL;
 	context->tcoord_offset = NULL;
+	context->texture_index_offset = NULL;
 	context->vertex_count = 0;
 	context->color_count = 0;
+	context->instance_array = false;
+	context->instance_stride = 0;
+	context->instance_offset = NULL;
+	context->instance_count = 0;
+	context->instance_id = 0;
+	context->instance_attrib = { 0, 0, 0, 1 };
+	context->point_frag = NULL;
+	context->point_spans = NULL;
+	context->point_span_radius = 0;
+	context->splat_buffer = NULL;
+	context->splat_storage = NULL;
+	context->splat_size = 0;
+	context->splat_width = 0;
+	context->splat_height = 0;
 	context->texture_unit = 0;
 	for(uint32_t i = 0; i < BR_NUM_TEXTURE_UNITS; i += 1)
 	{
@@ -2969,6 +4707,9 @@ brcontext* brCreateContext()
 		context->texture_widths[i] = 0;
 		context->texture_heights[i] = 0;
 		context->texture_formats[i] = 0;
+		context->texture_pitches[i] = 0;
+		context->texture_wraps[i][0] = BR_CLAMP;
+		context->texture_wraps[i][1] = BR_CLAMP;
 		context->texture_compressed_booleans[i] = false;
 	}
 	context->vshader = NULL;
@@ -2976,6 +4717,8 @@ brcontext* brCreateContext()
 	context->sh_vposition = false;
 	context->sh_vcolor = false;
 	context->sh_vtcoords = false;
+	context->sh_instance_id = false;
+	context->sh_instance_attrib = false;
 	context->sh_vnormals = false;
 	context->sh_vtype = false;
 	context->sh_prim_color = false;
@@ -2985,6 +4728,35 @@ brcontext* brCreateContext()
 	context->sh_bary_persp = false;
 	context->sh_fposition = false;
 	context->sh_fdepth = false;
+	context->query_statistics = false;
+	memset(&context->statistics, 0, sizeof(brstatistics));
+	context->query_samples = false;
+	context->samples_passed = 0;
+	context->sample_count = 1;
+	context->msaa_color = NULL;
+	context->msaa_depth = NULL;
+	context->msaa_size = 0;
+	context->blend_span = NULL;
+	context->blend_span_mask = NULL;
+	context->blend_span_width = 0;
+	context->swap_chain = NULL;
+	context->swap_image = -1;
+	context->viewport = { 0, 0, 0, 0 };
+	context->viewport_center_x = context->viewport_center_y = 0;
+	context->viewport_half_width = context->viewport_half_height = 0;
+	context->scissor_test = false;
+	context->scissor_rect = { 0, 0, 0, 0 };
+	context->redraw = false;
+	context->redraw_rect = { 0, 0, 0, 0 };
+	context->clip_x0 = context->clip_y0 = 0;
+	context->clip_x1 = context->clip_y1 = 0;
+	context->draw_x0 = context->draw_y0 = INT32_MAX;
+	context->draw_x1 = context->draw_y1 = INT32_MIN;
+	context->damage_count = 0;
+	context->render_thread = NULL;
+	context->fence_issued = 0;
+	context->fence_signaled = 0;
+	context->jobs = false;
 
 	return context;
 }
@@ -2996,24 +4768,39 @@ void brBindContext(brcontext* context)
 		_brcontext = context;
 }
 
+void brStopRenderThread();
+
 // free the resources allocated by a context, including the context itself.
+// its render thread, if any, is stopped first.
 void brFreeContext(brcontext* context)
 {
 	if(!context)
 		return;
 
-	if(context == _brcontext)
-		_brcontext = NULL;
-
-	free(context);
+	// free the context's resources while it is bound; e.g. brStopRenderThread stops the bound context's thread
+	brcontext* bound = _brcontext == context ? NULL : _brcontext;
+	_brcontext = context;
+	brStopRenderThread();
+	if(context->point_spans)
+		_br_free(context->point_spans);
+	if(context->splat_storage)
+		_br_free(context->splat_storage);
+	_br_free(context->msaa_color);
+	_br_free(context->msaa_depth);
+	_br_free(context->blend_span);
+	_br_free(context->blend_span_mask);
+	_brcontext = bound;
+	// give the image being rendered back to the swap chain
+	if(context->swap_chain && context->swap_image >= 0)
+		__atomic_store_n(&context->swap_chain->shared->state[context->swap_image], _BR_IMAGE_FREE, __ATOMIC_RELEASE);
+	// blocks still charged to the context (e.g. renderbuffers) keep its account until they're freed
+	_release_account(context->account);
+	_br_free_unaccounted(context);
 }
 
-// allocate a renderbuffer.
-void brCreateRenderbuffer(uint32_t type, uint32_t width, uint32_t height, void** buffer)
+// return the size of a pixel of a color or depth format, or 0 if the format is unknown.
+size_t _pixel_size(uint32_t type)
 {
-	if(width < 1 || height < 1)
-		return;
-
 	switch(type)
 	{
 		case BR_R8G8B8A8:
@@ -3021,33 +4808,64 @@ void brCreateRenderbuffer(uint32_t type, uint32_t width, uint32_t height, void**
 		case BR_A8B8G8R8:
 		case BR_B8G8R8:
 		case BR_D32:
-			*((uint32_t**)buffer) = (uint32_t*) calloc(width*height, sizeof(uint32_t));
-			break;
+			return sizeof(uint32_t);
 		case BR_R5G5B5A1:
 		case BR_R5G5B5:
 		case BR_A1B5G5R5:
 		case BR_B5G5R5:
 		case BR_D16:
-			*((uint16_t**)buffer) = (uint16_t*) calloc(width*height, sizeof(uint16_t));
-				break;
+			return sizeof(uint16_t);
 		case BR_R3G2B2A1:
 		case BR_R3G3B2:
 		case BR_A1B2G2R3:
 		case BR_B2G3R3:
-			*((uint8_t**)buffer) = (uint8_t*) calloc(width*height, sizeof(uint8_t));
-				break;
+			return sizeof(uint8_t);
 	}
+	return 0;
+}
+
+// return the row pitch, in pixels, of a renderbuffer allocated by brCreateRenderbuffer; pass it to
+// brBindRenderbufferPitch to bind the buffer with aligned rows.
+uint32_t brRenderbufferPitch(uint32_t width)
+{
+	return (width + BR_ROW_ALIGNMENT-1) & ~(BR_ROW_ALIGNMENT-1);
+}
+
+// allocate a zeroed renderbuffer, aligned to BR_RENDERBUFFER_ALIGNMENT bytes.
+// rows are padded to a multiple of BR_ROW_ALIGNMENT pixels (see brRenderbufferPitch); free with brFreeRenderbuffer.
+// allocated through the current allocator (see brSetAllocator) and accounted to the current context, if any.
+void brCreateRenderbuffer(uint32_t type, uint32_t width, uint32_t height, void** buffer)
+{
+	if(width < 1 || height < 1)
+		return;
+
+	size_t pixel_size = _pixel_size(type);
+	if(!pixel_size)
+		return;
+	
+	size_t size = (size_t)brRenderbufferPitch(width) * height * pixel_size;
+	void* data = _br_alloc(size, BR_RENDERBUFFER_ALIGNMENT);
+	if(data)
+		memset(data, 0, size);
+	*buffer = data;
 }
 
-// bind a renderbuffer to front set.
-void brBindRenderbuffer(uint32_t type, uint32_t width, uint32_t height, void* buffer)
+// free a renderbuffer allocated by brCreateRenderbuffer; credited to the context it was accounted to.
+void brFreeRenderbuffer(void* buffer)
+{
+	_br_free(buffer);
+}
+
+// bind a renderbuffer with rows 'pitch' pixels apart to front set; e.g. a sub-rectangle of a larger
+// surface, or a buffer provided by a driver. color & depth buffers bound together must share a pitch.
+void brBindRenderbufferPitch(uint32_t type, uint32_t width, uint32_t height, uint32_t pitch, void* buffer)
 {
-	if(!_brcontext || !buffer || width < 1 || height < 1)
+	if(!_brcontext || !buffer || width < 1 || height < 1 || pitch < width)
 		return;
 
 	if(_brcontext->cb || _brcontext->db)
 	{
-		if(width != _brcontext->rb_width || height != _brcontext->rb_height)
+		if(width != _brcontext->rb_width || height != _brcontext->rb_height || pitch != _brcontext->rb_pitch)
 			return;
 	}
 
@@ -3078,6 +4896,18 @@ void brBindRenderbuffer(uint32_t type, uint32_t width, uint32_t height, void* bu
 	}
 	_brcontext->rb_width = width;
 	_brcontext->rb_height = height;
+	_brcontext->rb_pitch = pitch;
+	_update_sample_buffers();
+	_update_blend_span();
+	_update_viewport();
+	_update_clip();
+}
+
+// bind a renderbuffer with tightly packed rows (a pitch of 'width' pixels) to front set.
+// buffers allocated by brCreateRenderbuffer may be bound either way; see brRenderbufferPitch for aligned rows.
+void brBindRenderbuffer(uint32_t type, uint32_t width, uint32_t height, void* buffer)
+{
+	brBindRenderbufferPitch(type, width, height, width, buffer);
 }
 
 // unbind renderbuffer(s) from front set.
@@ -3101,7 +4931,527 @@ void brUnbindRenderbuffer(uint32_t buffers)
 	{
 		_brcontext->rb_width = 0;
 		_brcontext->rb_height = 0;
+		_brcontext->rb_pitch = 0;
+	}
+	_update_sample_buffers();
+	_update_blend_span();
+	_update_viewport();
+	_update_clip();
+}
+
+// return the color buffer of swap chain image 'image'; its depth buffer (if any) follows at color_size bytes.
+uint8_t* _swap_chain_image(brswapchain* chain, uint32_t image)
+{
+	return (uint8_t*)chain->shared + _BR_SWAP_CHAIN_PAGE + image * chain->shared->image_size;
+}
+
+// take an image of a swap chain for rendering: a free one, or else the oldest unread frame (which is dropped).
+// returns -1 if a consumer is reading every other image.
+int32_t _acquire_swap_chain_image(brswapchain* chain)
+{
+	_swap_chain_shared_t* shared = chain->shared;
+	for(uint32_t attempt = 0; attempt < 4; attempt += 1)
+	{
+		int32_t oldest = -1;
+		for(uint32_t i = 0; i < shared->count; i += 1)
+		{
+			uint32_t state = __atomic_load_n(&shared->state[i], __ATOMIC_ACQUIRE);
+			if(state == _BR_IMAGE_FREE)
+			{
+				if(__atomic_compare_exchange_n(&shared->state[i], &state, _BR_IMAGE_RENDERING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+					return i;
+			}
+			else if(state == _BR_IMAGE_READY && (oldest < 0 || shared->sequence[i] < shared->sequence[oldest]))
+				oldest = i;
+		}
+		uint32_t ready = _BR_IMAGE_READY;
+		if(oldest >= 0 && __atomic_compare_exchange_n(&shared->state[oldest], &ready, _BR_IMAGE_RENDERING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return oldest;
+	}
+	return -1;
+}
+
+// bind swap chain image 'image' as the front set.
+void _bind_swap_chain_image(brswapchain* chain, int32_t image)
+{
+	_swap_chain_shared_t* shared = chain->shared;
+	brUnbindRenderbuffer(BR_COLOR_BUFFER_BIT | BR_DEPTH_BUFFER_BIT);
+	_brcontext->swap_image = image;
+	if(image < 0)
+		return;
+	uint8_t* data = _swap_chain_image(chain, image);
+	brBindRenderbufferPitch(shared->color_type, shared->width, shared->height, shared->pitch, data);
+	if(shared->depth_type)
+		brBindRenderbufferPitch(shared->depth_type, shared->width, shared->height, shared->pitch, data + shared->color_size);
+}
+
+// present the image being rendered & bind the next one (see brSwapBuffers).
+void _present_swap_chain()
+{
+	brswapchain* chain = _brcontext->swap_chain;
+	_swap_chain_shared_t* shared = chain->shared;
+	int32_t image = _brcontext->swap_image;
+	int32_t next = _acquire_swap_chain_image(chain);
+	if(next < 0)
+		return;		// nowhere to render the next frame; keep rendering into this image and drop this frame
+	if(image >= 0)
+	{
+		shared->frame += 1;
+		__atomic_store_n(&shared->sequence[image], shared->frame, __ATOMIC_RELAXED);
+		__atomic_store_n(&shared->state[image], _BR_IMAGE_READY, __ATOMIC_RELEASE);
+	}
+	_bind_swap_chain_image(chain, next);
+}
+
+// map a swap chain's shared memory; returns NULL on failure.
+brswapchain* _map_swap_chain(int fd, size_t size)
+{
+#ifdef __linux__
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(data == MAP_FAILED)
+		return NULL;
+	brswapchain* chain = (brswapchain*) _br_malloc(sizeof(brswapchain));
+	if(!chain)
+	{
+		munmap(data, size);
+		return NULL;
+	}
+	chain->fd = fd;
+	chain->size = size;
+	chain->shared = (_swap_chain_shared_t*) data;
+	return chain;
+#else
+	return NULL;
+#endif
+}
+
+// create a swap chain of 'count' (2 to BR_MAX_SWAP_CHAIN_IMAGES) images with a color buffer of 'color_type' and,
+// if 'depth_type' is not 0, a depth buffer. images are backed by 'fd' (e.g. from shm_open, or an open file to
+// memory-map), which is resized to fit & owned by the chain; if fd is < 0, an anonymous memfd is created.
+// the images' rows are padded like those of brCreateRenderbuffer. linux only; returns NULL on failure.
+brswapchain* brCreateSwapChain(int fd, uint32_t count, uint32_t color_type, uint32_t depth_type, uint32_t width, uint32_t height)
+{
+#ifdef __linux__
+	if(count < 2 || count > BR_MAX_SWAP_CHAIN_IMAGES || width < 1 || height < 1)
+		return NULL;
+	size_t color_pixel = _pixel_size(color_type);
+	size_t depth_pixel = _pixel_size(depth_type);
+	if(!color_pixel || color_type == BR_D16 || color_type == BR_D32)
+		return NULL;
+	if(depth_type && depth_type != BR_D16 && depth_type != BR_D32)
+		return NULL;
+	
+	uint32_t pitch = brRenderbufferPitch(width);
+	uint64_t color_size = ((uint64_t)pitch * height * color_pixel + _BR_SWAP_CHAIN_PAGE-1) & ~(uint64_t)(_BR_SWAP_CHAIN_PAGE-1);
+	uint64_t depth_size = ((uint64_t)pitch * height * depth_pixel + _BR_SWAP_CHAIN_PAGE-1) & ~(uint64_t)(_BR_SWAP_CHAIN_PAGE-1);
+	size_t size = _BR_SWAP_CHAIN_PAGE + count * (color_size + depth_size);
+	
+	bool created = fd < 0;
+	if(created)
+	{
+		// not close-on-exec, so the chain can be handed to a child process
+		fd = memfd_create("bear swap chain", 0);
+		if(fd < 0)
+			return NULL;
+	}
+	brswapchain* chain = NULL;
+	if(ftruncate(fd, size) == 0)
+		chain = _map_swap_chain(fd, size);
+	if(!chain)
+	{
+		if(created)
+			close(fd);
+		return NULL;
+	}
+	
+	_swap_chain_shared_t* shared = chain->shared;
+	memset(shared, 0, sizeof(_swap_chain_shared_t));
+	shared->count = count;
+	shared->width = width;
+	shared->height = height;
+	shared->pitch = pitch;
+	shared->color_type = color_type;
+	shared->depth_type = depth_type;
+	shared->color_size = color_size;
+	shared->image_size = color_size + depth_size;
+	for(uint32_t i = 0; i < count; i += 1)
+		shared->state[i] = _BR_IMAGE_FREE;
+	__atomic_store_n(&shared->magic, _BR_SWAP_CHAIN_MAGIC, __ATOMIC_RELEASE);
+	return chain;
+#else
+	return NULL;
+#endif
+}
+
+// map a swap chain created by brCreateSwapChain (possibly in another process) from its file descriptor,
+// which is then owned by the returned chain. returns NULL if fd does not hold a swap chain.
+brswapchain* brOpenSwapChain(int fd)
+{
+#ifdef __linux__
+	struct stat info;
+	if(fstat(fd, &info) || info.st_size < _BR_SWAP_CHAIN_PAGE)
+		return NULL;
+	brswapchain* chain = _map_swap_chain(fd, info.st_size);
+	if(!chain)
+		return NULL;
+	_swap_chain_shared_t* shared = chain->shared;
+	if(__atomic_load_n(&shared->magic, __ATOMIC_ACQUIRE) != _BR_SWAP_CHAIN_MAGIC || shared->count > BR_MAX_SWAP_CHAIN_IMAGES
+		|| _BR_SWAP_CHAIN_PAGE + shared->count * shared->image_size > chain->size)
+	{
+		munmap(chain->shared, chain->size);
+		_br_free(chain);
+		return NULL;
+	}
+	return chain;
+#else
+	return NULL;
+#endif
+}
+
+// bind a swap chain to the current context. an image of the chain becomes the front set, and brSwapBuffers
+// presents it & binds the next (regardless of BR_DOUBLE_BUFFER). pass NULL to unbind the bound chain.
+void brBindSwapChain(brswapchain* chain)
+{
+	if(!_brcontext || chain == _brcontext->swap_chain)
+		return;
+	
+	if(_brcontext->swap_chain)
+	{
+		if(_brcontext->swap_image >= 0)
+			__atomic_store_n(&_brcontext->swap_chain->shared->state[_brcontext->swap_image], _BR_IMAGE_FREE, __ATOMIC_RELEASE);
+		_bind_swap_chain_image(_brcontext->swap_chain, -1);
+	}
+	_brcontext->swap_chain = chain;
+	if(chain)
+		_bind_swap_chain_image(chain, _acquire_swap_chain_image(chain));
+}
+
+// acquire the newest presented frame of a swap chain for reading. older unread frames are skipped & given back to
+// the producer. returns the image index to pass to brReleaseFrame, or -1 if no new frame has been presented.
+// 'color' & 'depth' (either may be NULL) receive the image's buffers; see chain->shared for their format & pitch.
+int32_t brAcquireFrame(brswapchain* chain, void** color, void** depth)
+{
+	if(!chain)
+		return -1;
+	_swap_chain_shared_t* shared = chain->shared;
+	int32_t newest;
+	for(;;)
+	{
+		newest = -1;
+		for(uint32_t i = 0; i < shared->count; i += 1)
+		{
+			if(__atomic_load_n(&shared->state[i], __ATOMIC_ACQUIRE) != _BR_IMAGE_READY)
+				continue;
+			if(newest < 0 || __atomic_load_n(&shared->sequence[i], __ATOMIC_RELAXED) > __atomic_load_n(&shared->sequence[newest], __ATOMIC_RELAXED))
+				newest = i;
+		}
+		if(newest < 0)
+			return -1;
+		// the producer may have taken the frame back to render into; look again
+		uint32_t ready = _BR_IMAGE_READY;
+		if(__atomic_compare_exchange_n(&shared->state[newest], &ready, _BR_IMAGE_READING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+	}
+	
+	uint64_t sequence = __atomic_load_n(&shared->sequence[newest], __ATOMIC_RELAXED);
+	for(uint32_t i = 0; i < shared->count; i += 1)
+	{
+		uint32_t ready = _BR_IMAGE_READY;
+		if(i != (uint32_t)newest && __atomic_load_n(&shared->sequence[i], __ATOMIC_RELAXED) < sequence)
+			__atomic_compare_exchange_n(&shared->state[i], &ready, _BR_IMAGE_FREE, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+	}
+	
+	uint8_t* data = _swap_chain_image(chain, newest);
+	if(color)
+		*color = data;
+	if(depth)
+		*depth = shared->depth_type ? data + shared->color_size : NULL;
+	return newest;
+}
+
+// give a frame acquired by brAcquireFrame back to the producer.
+void brReleaseFrame(brswapchain* chain, int32_t image)
+{
+	if(!chain || image < 0 || (uint32_t)image >= chain->shared->count)
+		return;
+	__atomic_store_n(&chain->shared->state[image], _BR_IMAGE_FREE, __ATOMIC_RELEASE);
+}
+
+// unmap a swap chain & close its file descriptor, unbinding it from the current context if bound.
+void brFreeSwapChain(brswapchain* chain)
+{
+	if(!chain)
+		return;
+	if(_brcontext && _brcontext->swap_chain == chain)
+		brBindSwapChain(NULL);
+#ifdef __linux__
+	munmap(chain->shared, chain->size);
+	close(chain->fd);
+#endif
+	_br_free(chain);
+}
+
+// wake any threads sleeping on a render thread's condition; called after publishing head, tail or a fence.
+void _wake_render_thread(_render_thread_t* thread)
+{
+#ifdef __linux__
+	if(!__atomic_load_n(&thread->sleepers, __ATOMIC_SEQ_CST))
+		return;
+	pthread_mutex_lock(&thread->lock);
+	pthread_cond_broadcast(&thread->cond);
+	pthread_mutex_unlock(&thread->lock);
+#endif
+}
+
+// sleep on a render thread's condition until 'ready' returns true for 'arg', or until 'deadline' (if not NULL) passes.
+// returns whether or not 'ready' returned true.
+bool _wait_render_thread(_render_thread_t* thread, bool (*ready)(_render_thread_t* thread, uint64_t arg), uint64_t arg, 
+	struct timespec* deadline)
+{
+#ifdef __linux__
+	if(ready(thread, arg))
+		return true;
+	bool result = true;
+	pthread_mutex_lock(&thread->lock);
+	__atomic_add_fetch(&thread->sleepers, 1, __ATOMIC_SEQ_CST);
+	while(!ready(thread, arg))
+	{
+		if(!deadline)
+			pthread_cond_wait(&thread->cond, &thread->lock);
+		else if(pthread_cond_timedwait(&thread->cond, &thread->lock, deadline))
+		{
+			result = ready(thread, arg);
+			break;
+		}
+	}
+	__atomic_sub_fetch(&thread->sleepers, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&thread->lock);
+	return result;
+#else
+	return ready(thread, arg);
+#endif
+}
+
+// a command in a ring, followed by its data. a NULL command skips the rest of the ring.
+typedef struct _command_t _command_t;
+struct _command_t
+{
+	brcommand command;
+	size_t size;			// bytes of data, rounded up to a multiple of sizeof(_command_t)
+};
+
+// wait conditions
+bool _ring_has_commands(_render_thread_t* thread, uint64_t arg)
+{
+	(void)arg;
+	return __atomic_load_n(&thread->head, __ATOMIC_SEQ_CST) != thread->tail || __atomic_load_n(&thread->stop, __ATOMIC_SEQ_CST);
+}
+bool _ring_has_space(_render_thread_t* thread, uint64_t bytes)
+{
+	return thread->ring_size - (thread->head - __atomic_load_n(&thread->tail, __ATOMIC_SEQ_CST)) >= bytes;
+}
+bool _fence_signaled(_render_thread_t* thread, uint64_t sync)
+{
+	return __atomic_load_n(thread->fence_signaled, __ATOMIC_SEQ_CST) >= sync;
+}
+
+// signal the fence in 'data' (see brFenceSync).
+void _signal_fence(void* data)
+{
+	__atomic_store_n(&_brcontext->fence_signaled, *(brsync*)data, __ATOMIC_SEQ_CST);
+	_wake_render_thread(_brcontext->render_thread);
+}
+
+// run the commands of a ring as they arrive, until stopped.
+void* _render_thread_main(void* arg)
+{
+	_render_thread_t* thread = (_render_thread_t*) arg;
+	for(;;)
+	{
+		_wait_render_thread(thread, _ring_has_commands, 0, NULL);
+		uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+		if(head == thread->tail)
+			break;	// stopped & empty
+		
+		// run every command published so far, then make their space available at once
+		uint64_t tail = thread->tail;
+		while(tail != head)
+		{
+			size_t offset = tail & (thread->ring_size - 1);
+			_command_t* command = (_command_t*)(thread->ring + offset);
+			if(!command->command)
+			{
+				tail += thread->ring_size - offset;
+				continue;
+			}
+			command->command(command + 1);
+			tail += sizeof(_command_t) + command->size;
+		}
+		__atomic_store_n(&thread->tail, tail, __ATOMIC_SEQ_CST);
+		_wake_render_thread(thread);
+	}
+	return NULL;
+}
+
+// start a render thread for the bound context, with a command ring of 'ring_size' bytes (rounded up to a power
+// of two; 0 is BR_COMMAND_RING_SIZE). from then on the context belongs to the render thread & must stay bound:
+// the app thread records work with brSubmit & paces itself with fences (see brFenceSync), e.g. recording frame
+// N+1 while frame N rasterizes. linux only; returns false if no thread was started.
+bool brStartRenderThread(size_t ring_size)
+{
+#ifdef __linux__
+	if(!_brcontext || _brcontext->render_thread)
+		return false;
+	if(!ring_size)
+		ring_size = BR_COMMAND_RING_SIZE;
+	size_t size = 4 * sizeof(_command_t);
+	while(size < ring_size)
+		size <<= 1;
+	
+	_render_thread_t* thread = (_render_thread_t*) _br_calloc(1, sizeof(_render_thread_t));
+	if(!thread)
+		return false;
+	thread->ring = (uint8_t*) _br_alloc(size, BR_RENDERBUFFER_ALIGNMENT);
+	thread->ring_size = size;
+	thread->fence_signaled = &_brcontext->fence_signaled;
+	if(!thread->ring)
+	{
+		_br_free(thread);
+		return false;
+	}
+	pthread_mutex_init(&thread->lock, NULL);
+	pthread_cond_init(&thread->cond, NULL);
+	_brcontext->render_thread = thread;
+	if(pthread_create(&thread->thread, NULL, _render_thread_main, thread))
+	{
+		_brcontext->render_thread = NULL;
+		pthread_cond_destroy(&thread->cond);
+		pthread_mutex_destroy(&thread->lock);
+		_br_free(thread->ring);
+		_br_free(thread);
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+// run all commands submitted to the bound context's render thread & stop it. the context then belongs to the
+// calling thread again.
+void brStopRenderThread()
+{
+	if(!_brcontext || !_brcontext->render_thread)
+		return;
+	_render_thread_t* thread = _brcontext->render_thread;
+#ifdef __linux__
+	__atomic_store_n(&thread->stop, true, __ATOMIC_SEQ_CST);
+	_wake_render_thread(thread);
+	pthread_join(thread->thread, NULL);
+	pthread_cond_destroy(&thread->cond);
+	pthread_mutex_destroy(&thread->lock);
+#endif
+	_brcontext->render_thread = NULL;
+	_br_free(thread->ring);
+	_br_free(thread);
+}
+
+// submit 'command' to the bound context's render thread, with a copy of the 'size' bytes of 'data'; the copy is
+// what the command receives. commands run in the order submitted, with the context bound, & may call any br
+// function. waits for space in the ring when it is full. without a render thread, the command is run now with
+// 'data' itself. returns false if the command does not fit in the ring (more than half of it).
+bool brSubmit(brcommand command, const void* data, size_t size)
+{
+	if(!_brcontext || !command)
+		return false;
+	_render_thread_t* thread = _brcontext->render_thread;
+	if(!thread)
+	{
+		command((void*)data);
+		return true;
+	}
+	
+	size_t padded = (size + sizeof(_command_t) - 1) / sizeof(_command_t) * sizeof(_command_t);
+	size_t bytes = sizeof(_command_t) + padded;
+	if(bytes > thread->ring_size / 2)
+		return false;
+	
+	// a command is never split across the end of the ring; the rest of the ring is skipped instead
+	uint64_t head = thread->head;
+	size_t offset = head & (thread->ring_size - 1);
+	size_t skip = offset + bytes > thread->ring_size ? thread->ring_size - offset : 0;
+	_wait_render_thread(thread, _ring_has_space, skip + bytes, NULL);
+	
+	if(skip)
+	{
+		((_command_t*)(thread->ring + offset))->command = NULL;
+		offset = 0;
+	}
+	_command_t* record = (_command_t*)(thread->ring + offset);
+	record->command = command;
+	record->size = padded;
+	if(size)
+		memcpy(record + 1, data, size);
+	
+	__atomic_store_n(&thread->head, head + skip + bytes, __ATOMIC_SEQ_CST);
+	_wake_render_thread(thread);
+	return true;
+}
+
+// make a fence after all commands submitted so far (see brSubmit); it is signaled once they have run.
+// without a render thread, fences are signaled as they are made.
+brsync brFenceSync()
+{
+	if(!_brcontext)
+		return 0;
+	brsync sync = ++_brcontext->fence_issued;
+	if(!_brcontext->render_thread || !brSubmit(_signal_fence, &sync, sizeof(brsync)))
+		__atomic_store_n(&_brcontext->fence_signaled, sync, __ATOMIC_SEQ_CST);
+	return sync;
+}
+
+// wait up to 'timeout' nanoseconds (or BR_TIMEOUT_IGNORED) for 'sync' to be signaled. returns BR_ALREADY_SIGNALED
+// if it was signaled before the call, BR_CONDITION_SATISFIED if it was signaled while waiting, or BR_TIMEOUT_EXPIRED.
+uint32_t brClientWaitSync(brsync sync, uint64_t timeout)
+{
+	if(!_brcontext || __atomic_load_n(&_brcontext->fence_signaled, __ATOMIC_SEQ_CST) >= sync)
+		return BR_ALREADY_SIGNALED;
+	_render_thread_t* thread = _brcontext->render_thread;
+	if(!thread || !timeout)
+		return BR_TIMEOUT_EXPIRED;
+	
+	struct timespec* deadline = NULL;
+#ifdef __linux__
+	struct timespec time;
+	if(timeout != BR_TIMEOUT_IGNORED)
+	{
+		clock_gettime(CLOCK_REALTIME, &time);
+		uint64_t ns = time.tv_nsec + timeout % 1000000000;
+		time.tv_sec += timeout / 1000000000 + ns / 1000000000;
+		time.tv_nsec = ns % 1000000000;
+		deadline = &time;
 	}
+#endif
+	return _wait_render_thread(thread, _fence_signaled, sync, deadline) ? BR_CONDITION_SATISFIED : BR_TIMEOUT_EXPIRED;
+}
+
+// wait for all commands submitted to the bound context's render thread to run.
+void brFinish()
+{
+	brClientWaitSync(brFenceSync(), BR_TIMEOUT_IGNORED);
+}
+
+// set the threads the job scheduler runs on, counting the thread starting work; 0 uses one per CPU. contexts with
+// BR_JOBS enabled split clears, resolves and vertex processing into jobs, which may then call the bound vertex
+// shader from several threads at once. must not be called while any context is drawing.
+void brJobThreads(uint32_t count)
+{
+#ifdef __linux__
+	pthread_mutex_lock(&_brjob_lock);
+	_stop_job_pool();
+	_brjob_threads = count;
+	pthread_mutex_unlock(&_brjob_lock);
+#endif
 }
 
 // set polygon mode.
@@ -3150,6 +5500,86 @@ void brPointSize(float radius)
 		_brcontext->point_radius = 0.0f;
 }
 
+// set width of lines, in pixels. lines wider than one pixel are drawn as spans across their major axis.
+void brLineWidth(float width)
+{
+	if(!_brcontext)
+		return;
+	
+	if(width >= 1.0f)
+		_brcontext->line_width = width;
+	else
+		_brcontext->line_width = 1.0f;
+}
+
+// set the samples per pixel (1, 2, 4 or 8) of triangles rastered to the front set. with more than 1,
+// triangles are rastered into sample buffers kept by the context (covering & depth testing each sample, but
+// shading once per pixel), and brResolve writes the anti-aliased result to the front set. other primitives
+// cover every sample of their pixels, and are depth tested against each pixel's first sample.
+void brSampleCount(uint32_t count)
+{
+	if(!_brcontext)
+		return;
+	if(count != 1 && count != 2 && count != 4 && count != 8)
+		return;
+	
+	_brcontext->sample_count = count;
+	// sample layout depends on the count; start over
+	_brcontext->msaa_size = 0;
+	_update_sample_buffers();
+}
+
+// set the rect of pixels normalized device coordinates map to, the top-left being (x, y); it may extend past the 
+// front set, e.g. for split-screen or tile-by-tile rendering. a width or height of 0 maps to the whole front set
+// (the default), as it is bound.
+void brViewport(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	if(!_brcontext || width < 0 || height < 0)
+		return;
+	_brcontext->viewport = { x, y, width, height };
+	_update_viewport();
+}
+
+// set the rect of pixels that rasterization & clears are limited to while BR_SCISSOR_TEST is enabled.
+// primitives outside it are rejected at setup, and only the rows and spans within it are rastered.
+void brScissor(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	if(!_brcontext || width < 0 || height < 0)
+		return;
+	_brcontext->scissor_rect = { x, y, width, height };
+	_update_clip();
+}
+
+// set blend factors.
+void brBlendFunc(uint32_t src, uint32_t dst)
+{
+	if(!_brcontext)
+		return;
+	
+	if(src < BR_ZERO || src > BR_ONE_MINUS_DST_ALPHA || dst < BR_ZERO || dst > BR_ONE_MINUS_DST_ALPHA)
+		return;
+	
+	_brcontext->blend_src = src;
+	_brcontext->blend_dst = dst;
+}
+
+// set blend equation.
+void brBlendEquation(uint32_t equation)
+{
+	if(!_brcontext)
+		return;
+	
+	switch(equation)
+	{
+		case BR_FUNC_ADD:
+		case BR_FUNC_SUBTRACT:
+		case BR_FUNC_REVERSE_SUBTRACT:
+		case BR_MIN:
+		case BR_MAX:
+		_brcontext->blend_eq = equation;
+	}
+}
+
 // enable a toggled state.
 void brEnable(uint32_t state)
 {
@@ -3164,6 +5594,9 @@ void brEnable(uint32_t state)
 		case BR_DEPTH_WRITE:
 			_brcontext->depth_write = true;
 			break;
+		case BR_COLOR_WRITE:
+			_brcontext->color_write = true;
+			break;
 		case BR_DEPTH_TEST:
 			_brcontext->depth_test = true;
 			break;
@@ -3182,6 +5615,16 @@ void brEnable(uint32_t state)
 		case BR_CLIP:
 			_brcontext->clip = true;
 			break;
+		case BR_PRIMITIVE_RESTART:
+			_brcontext->primitive_restart = true;
+			break;
+		case BR_SCISSOR_TEST:
+			_brcontext->scissor_test = true;
+			_update_clip();
+			break;
+		case BR_JOBS:
+			_brcontext->jobs = true;
+			break;
 		case BR_PERSPECTIVE_DIVISION:
 			_brcontext->persp_div = true;
 			break;
@@ -3200,6 +5643,12 @@ void brEnable(uint32_t state)
 		case BR_TEXCOORD_ARRAY:
 			_brcontext->tcoord_array = true;
 			break;
+		case BR_TEXTURE_INDEX_ARRAY:
+			_brcontext->texture_index_array = true;
+			break;
+		case BR_INSTANCE_ARRAY:
+			_brcontext->instance_array = true;
+			break;
 		case BR_VERTEX_TYPE:
 			_brcontext->sh_vtype = true;
 			break;
@@ -3215,6 +5664,12 @@ void brEnable(uint32_t state)
 		case BR_VERTEX_TEXTURE_COORDINATES:
 			_brcontext->sh_vtcoords = true;
 			break;
+		case BR_INSTANCE_ID:
+			_brcontext->sh_instance_id = true;
+			break;
+		case BR_INSTANCE_ATTRIBUTE:
+			_brcontext->sh_instance_attrib = true;
+			break;
 		case BR_PRIMITIVE_COLOR:
 			_brcontext->sh_prim_color = true;
 			break;
@@ -3253,6 +5708,9 @@ void brDisable(uint32_t state)
 		case BR_DEPTH_WRITE:
 			_brcontext->depth_write = false;
 			break;
+		case BR_COLOR_WRITE:
+			_brcontext->color_write = false;
+			break;
 		case BR_DEPTH_TEST:
 			_brcontext->depth_test = false;
 			break;
@@ -3271,6 +5729,16 @@ void brDisable(uint32_t state)
 		case BR_CLIP:
 			_brcontext->clip = false;
 			break;
+		case BR_PRIMITIVE_RESTART:
+			_brcontext->primitive_restart = false;
+			break;
+		case BR_SCISSOR_TEST:
+			_brcontext->scissor_test = false;
+			_update_clip();
+			break;
+		case BR_JOBS:
+			_brcontext->jobs = false;
+			break;
 		case BR_PERSPECTIVE_DIVISION:
 			_brcontext->persp_div = false;
 			break;
@@ -3289,6 +5757,12 @@ void brDisable(uint32_t state)
 		case BR_TEXCOORD_ARRAY:
 			_brcontext->tcoord_array = false;
 			break;
+		case BR_TEXTURE_INDEX_ARRAY:
+			_brcontext->texture_index_array = false;
+			break;
+		case BR_INSTANCE_ARRAY:
+			_brcontext->instance_array = false;
+			break;
 		case BR_VERTEX_TYPE:
 			_brcontext->sh_vtype = false;
 			break;
@@ -3304,6 +5778,12 @@ void brDisable(uint32_t state)
 		case BR_VERTEX_TEXTURE_COORDINATES:
 			_brcontext->sh_vtcoords = false;
 			break;
+		case BR_INSTANCE_ID:
+			_brcontext->sh_instance_id = false;
+			break;
+		case BR_INSTANCE_ATTRIBUTE:
+			_brcontext->sh_instance_attrib = false;
+			break;
 		case BR_PRIMITIVE_COLOR:
 			_brcontext->sh_prim_color = false;
 			break;
@@ -3340,6 +5820,8 @@ bool brIsEnabled(uint32_t state)
 			return _brcontext->double_buffer;
 		case BR_DEPTH_WRITE:
 			return _brcontext->depth_write;
+		case BR_COLOR_WRITE:
+			return _brcontext->color_write;
 		case BR_DEPTH_TEST:
 			return _brcontext->depth_test;
 		case BR_PERSPECTIVE_CORRECTION:
@@ -3352,6 +5834,12 @@ bool brIsEnabled(uint32_t state)
 			return _brcontext->cull;
 		case BR_CLIP:
 			return _brcontext->clip;
+		case BR_PRIMITIVE_RESTART:
+			return _brcontext->primitive_restart;
+		case BR_SCISSOR_TEST:
+			return _brcontext->scissor_test;
+		case BR_JOBS:
+			return _brcontext->jobs;
 		case BR_PERSPECTIVE_DIVISION:
 			return _brcontext->persp_div;
 		case BR_SCALE_Z:
@@ -3364,6 +5852,10 @@ bool brIsEnabled(uint32_t state)
 			return _brcontext->normal_array;
 		case BR_TEXCOORD_ARRAY:
 			return _brcontext->tcoord_array;
+		case BR_TEXTURE_INDEX_ARRAY:
+			return _brcontext->texture_index_array;
+		case BR_INSTANCE_ARRAY:
+			return _brcontext->instance_array;
 		case BR_VERTEX_TYPE:
 			return _brcontext->sh_vtype;
 		case BR_VERTEX_POSITION:
@@ -3374,6 +5866,10 @@ bool brIsEnabled(uint32_t state)
 			return _brcontext->sh_vnormals;
 		case BR_VERTEX_TEXTURE_COORDINATES:
 			return _brcontext->sh_vtcoords;
+		case BR_INSTANCE_ID:
+			return _brcontext->sh_instance_id;
+		case BR_INSTANCE_ATTRIBUTE:
+			return _brcontext->sh_instance_attrib;
 		case BR_PRIMITIVE_COLOR:
 			return _brcontext->sh_prim_color;
 		case BR_TEXTURE_COLOR:
@@ -3410,9 +5906,17 @@ void brBindShader(uint32_t type, void* shader)
 }
 
 // swap back and front renderbuffers, if double-buffering is enabled.
+// if a swap chain is bound, present the front set to it & bind its next image instead (see brBindSwapChain).
 void brSwapBuffers()
 {
-	if(!_brcontext || !_brcontext->double_buffer)
+	if(!_brcontext)
+		return;
+	if(_brcontext->swap_chain)
+	{
+		_present_swap_chain();
+		return;
+	}
+	if(!_brcontext->double_buffer)
 		return;
 
 	void* cb = _brcontext->cb;
@@ -3421,6 +5925,7 @@ void brSwapBuffers()
 	uint32_t db_type = _brcontext->db_type;
 	uint32_t width = _brcontext->rb_width;
 	uint32_t height = _brcontext->rb_height;
+	uint32_t pitch = _brcontext->rb_pitch;
 	
 	_brcontext->cb = _brcontext->cb2;
 	_brcontext->db = _brcontext->db2;
@@ -3428,6 +5933,7 @@ void brSwapBuffers()
 	_brcontext->db_type = _brcontext->db2_type;
 	_brcontext->rb_width = _brcontext->rb2_width;
 	_brcontext->rb_height = _brcontext->rb2_height;
+	_brcontext->rb_pitch = _brcontext->rb2_pitch;
 
 	_brcontext->cb2 = cb;
 	_brcontext->db2 = db;
@@ -3435,6 +5941,11 @@ void brSwapBuffers()
 	_brcontext->db2_type = db_type;
 	_brcontext->rb2_width = width;
 	_brcontext->rb2_height = height;
+	_brcontext->rb2_pitch = pitch;
+	_update_sample_buffers();
+	_update_blend_span();
+	_update_viewport();
+	_update_clip();
 }
 
 // set active texture unit
@@ -3453,21 +5964,75 @@ void brTexture(void* data, uint32_t format, uint32_t width, uint32_t height, boo
 	if(!_brcontext)
 		return;
 	uint32_t unit = _brcontext->texture_unit;
-	if(!data || !_is_pixel_format(format) || width < 1 || height < 1)
+	if(!data || !_is_texture_format(format) || width < 1 || height < 1)
 	{
 		_brcontext->textures[unit] = NULL;
 		_brcontext->texture_widths[unit] = 0;
 		_brcontext->texture_heights[unit] = 0;
 		_brcontext->texture_formats[unit] = 0;
+		_brcontext->texture_pitches[unit] = 0;
 		_brcontext->texture_compressed_booleans[unit] = false;
 		return;
 	}
 
-	_brcontext->textures[unit] = data;
-	_brcontext->texture_widths[unit] = width;
-	_brcontext->texture_heights[unit] = height;
-	_brcontext->texture_formats[unit] = format;
-	_brcontext->texture_compressed_booleans[unit] = compressed;
+	_brcontext->textures[unit] = data;
+	_brcontext->texture_widths[unit] = width;
+	_brcontext->texture_heights[unit] = height;
+	_brcontext->texture_formats[unit] = format;
+	_brcontext->texture_pitches[unit] = width;
+	// depth textures are always packed
+	_brcontext->texture_compressed_booleans[unit] = compressed || format == BR_D16 || format == BR_D32;
+}
+
+// set how texture coordinates outside of [0,1] address the texture of the active texture unit, along s (x) & t (y):
+// BR_CLAMP (the default) clamps to the edge texels, BR_REPEAT tiles the texture and BR_MIRROR tiles it, mirroring
+// every other tile. textures with power-of-two sizes wrap with a mask instead of a division.
+// texel coordinates are unsigned 16.16 fixed-point, so a primitive may span at most 65535 texels along each axis
+// and, with BR_CLAMP, may not go below texel 0; vertices outside that are clamped per vertex (distorting the texture
+// across the primitive).
+void brTextureWrap(uint32_t s, uint32_t t)
+{
+	if(!_brcontext)
+		return;
+	uint32_t unit = _brcontext->texture_unit;
+	if(s == BR_CLAMP || s == BR_REPEAT || s == BR_MIRROR)
+		_brcontext->texture_wraps[unit][0] = s;
+	if(t == BR_CLAMP || t == BR_REPEAT || t == BR_MIRROR)
+		_brcontext->texture_wraps[unit][1] = t;
+}
+
+// create a surface (see brsurface) of a pixel or depth format, allocated like brCreateRenderbuffer.
+// surface->data is NULL on failure.
+void brCreateSurface(uint32_t format, uint32_t width, uint32_t height, brsurface* surface)
+{
+	surface->data = NULL;
+	surface->format = format;
+	surface->width = width;
+	surface->height = height;
+	surface->pitch = brRenderbufferPitch(width);
+	brCreateRenderbuffer(format, width, height, &surface->data);
+}
+
+// free a surface created by brCreateSurface.
+void brFreeSurface(brsurface* surface)
+{
+	brFreeRenderbuffer(surface->data);
+	surface->data = NULL;
+}
+
+// bind a surface to the front set, as its color or depth buffer (by its format).
+void brBindSurface(brsurface* surface)
+{
+	brBindRenderbufferPitch(surface->format, surface->width, surface->height, surface->pitch, surface->data);
+}
+
+// use a surface as the texture of the active texture unit. no copy is made, so what is rendered to the
+// surface is what is sampled; it should not be bound to the front set while drawing with it.
+void brTextureSurface(brsurface* surface)
+{
+	brTexture(surface->data, surface->format, surface->width, surface->height, true);
+	if(_brcontext && _brcontext->textures[_brcontext->texture_unit])
+		_brcontext->texture_pitches[_brcontext->texture_unit] = surface->pitch;
 }
 
 // set buffer clear color
@@ -3504,19 +6069,22 @@ void brClearDepth(float depth)
 	_brcontext->clear_depth = depth;
 }
 
-// clear back (if BR_DOUBLE_BUFFER is enabled) or front renderbuffer(s).
-// OR together buffer constants.
-void brClear(uint32_t buffers)
+// clear rows [row0, row1) of the cleared rect (see brClear); 'data' points to the buffer bits.
+void _clear_rows(void* data, uint32_t row0, uint32_t row1)
 {
-	if(!_brcontext)
-		return;
-
+	uint32_t buffers = *(uint32_t*)data;
 	if(_brcontext->double_buffer)
 	{
 		bool clear_cb = _brcontext->cb2 && (buffers & BR_COLOR_BUFFER_BIT);
 		bool clear_db = _brcontext->db2 && (buffers & BR_DEPTH_BUFFER_BIT);
 
-		uint64_t pixels = _brcontext->rb2_width*_brcontext->rb2_height;
+		// rows may be padded (see brBindRenderbufferPitch); only the pixels within each row 
+		// (and the redraw region) are cleared
+		brrect rect = _clip_rect(_brcontext->rb2_width, _brcontext->rb2_height);
+		uint64_t width = rect.width;
+		uint64_t pitch = _brcontext->rb2_pitch;
+		uint64_t start = pitch*(rect.y + row0) + rect.x;
+		uint64_t end = pitch*(rect.y + row1);
 
 		if(clear_cb && clear_db)
 		{
@@ -3545,7 +6113,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFF) d = 0xFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3560,7 +6129,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3591,7 +6161,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFF) d = 0xFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3606,7 +6177,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3637,7 +6209,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFF) d = 0xFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3652,7 +6225,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3681,7 +6255,8 @@ void brClear(uint32_t buffers)
 						if(_brcontext->cb2_type == BR_B8G8R8)
 							color = _BR_B8G8R8((uint8_t)(_brcontext->clear_color.x*255.0f), (uint8_t)(_brcontext->clear_color.y*255.0f), (uint8_t)(_brcontext->clear_color.z*255.0f));
 						uint32_t* cb = (uint32_t*) _brcontext->cb2;
-						for(uint64_t i = 0; i < pixels; i += 1)
+						for(uint64_t row = start; row < end; row += pitch)
+						for(uint64_t i = row; i < row + width; i += 1)
 							cb[i] = color;
 					}
 					break;
@@ -3700,7 +6275,8 @@ void brClear(uint32_t buffers)
 						if(_brcontext->cb2_type == BR_B5G5R5)
 							color = _BR_B5G5R5((uint8_t)(_brcontext->clear_color.x*31.0f), (uint8_t)(_brcontext->clear_color.y*31.0f), (uint8_t)(_brcontext->clear_color.z*31.0f));
 						uint16_t* cb = (uint16_t*) _brcontext->cb2;
-						for(uint64_t i = 0; i < pixels; i += 1)
+						for(uint64_t row = start; row < end; row += pitch)
+						for(uint64_t i = row; i < row + width; i += 1)
 							cb[i] = color;
 					}
 					break;
@@ -3719,7 +6295,8 @@ void brClear(uint32_t buffers)
 						if(_brcontext->cb2_type == BR_B2G3R3)
 							color = _BR_B2G3R3((uint8_t)(_brcontext->clear_color.x*8.0f), (uint8_t)(_brcontext->clear_color.y*8.0f), (uint8_t)(_brcontext->clear_color.z*4.0f));
 						uint8_t* cb = (uint8_t*) _brcontext->cb2;
-						for(uint64_t i = 0; i < pixels; i += 1)
+						for(uint64_t row = start; row < end; row += pitch)
+						for(uint64_t i = row; i < row + width; i += 1)
 							cb[i] = color;
 					}
 					break;
@@ -3737,7 +6314,8 @@ void brClear(uint32_t buffers)
 					if(d > 0xFFFF) d = 0xFFFF;
 					if(d < 0) d = 0;
 					depth = d;
-					for(uint64_t i = 0; i < pixels; i += 1)
+					for(uint64_t row = start; row < end; row += pitch)
+					for(uint64_t i = row; i < row + width; i += 1)
 						db[i] = depth;
 				}
 				break;
@@ -3749,7 +6327,8 @@ void brClear(uint32_t buffers)
 					if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 					if(d < 0) d = 0;
 					depth = d;
-					for(uint64_t i = 0; i < pixels; i += 1)
+					for(uint64_t row = start; row < end; row += pitch)
+					for(uint64_t i = row; i < row + width; i += 1)
 						db[i] = depth;
 				}
 				break;
@@ -3761,7 +6340,13 @@ void brClear(uint32_t buffers)
 		bool clear_cb = _brcontext->cb && (buffers & BR_COLOR_BUFFER_BIT);
 		bool clear_db = _brcontext->db && (buffers & BR_DEPTH_BUFFER_BIT);
 
-		uint64_t pixels = _brcontext->rb_width*_brcontext->rb_height;
+		// rows may be padded (see brBindRenderbufferPitch); only the pixels within each row 
+		// (and the redraw region) are cleared
+		brrect rect = _clip_rect(_brcontext->rb_width, _brcontext->rb_height);
+		uint64_t width = rect.width;
+		uint64_t pitch = _brcontext->rb_pitch;
+		uint64_t start = pitch*(rect.y + row0) + rect.x;
+		uint64_t end = pitch*(rect.y + row1);
 
 		if(clear_cb && clear_db)
 		{
@@ -3790,7 +6375,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFF) d = 0xFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3805,7 +6391,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3836,7 +6423,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFF) d = 0xFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3851,7 +6439,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3882,7 +6471,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFF) d = 0xFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3897,7 +6487,8 @@ void brClear(uint32_t buffers)
 							if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 							if(d < 0) d = 0;
 							depth = d;
-							for(uint64_t i = 0; i < pixels; i += 1)
+							for(uint64_t row = start; row < end; row += pitch)
+							for(uint64_t i = row; i < row + width; i += 1)
 							{
 								cb[i] = color;
 								db[i] = depth;
@@ -3926,7 +6517,8 @@ void brClear(uint32_t buffers)
 						if(_brcontext->cb_type == BR_B8G8R8)
 							color = _BR_B8G8R8((uint8_t)(_brcontext->clear_color.x*255.0f), (uint8_t)(_brcontext->clear_color.y*255.0f), (uint8_t)(_brcontext->clear_color.z*255.0f));
 						uint32_t* cb = (uint32_t*) _brcontext->cb;
-						for(uint64_t i = 0; i < pixels; i += 1)
+						for(uint64_t row = start; row < end; row += pitch)
+						for(uint64_t i = row; i < row + width; i += 1)
 							cb[i] = color;
 					}
 					break;
@@ -3945,7 +6537,8 @@ void brClear(uint32_t buffers)
 						if(_brcontext->cb_type == BR_B5G5R5)
 							color = _BR_B5G5R5((uint8_t)(_brcontext->clear_color.x*31.0f), (uint8_t)(_brcontext->clear_color.y*31.0f), (uint8_t)(_brcontext->clear_color.z*31.0f));
 						uint16_t* cb = (uint16_t*) _brcontext->cb;
-						for(uint64_t i = 0; i < pixels; i += 1)
+						for(uint64_t row = start; row < end; row += pitch)
+						for(uint64_t i = row; i < row + width; i += 1)
 							cb[i] = color;
 					}
 					break;
@@ -3964,7 +6557,8 @@ void brClear(uint32_t buffers)
 						if(_brcontext->cb_type == BR_B2G3R3)
 							color = _BR_B2G3R3((uint8_t)(_brcontext->clear_color.x*8.0f), (uint8_t)(_brcontext->clear_color.y*8.0f), (uint8_t)(_brcontext->clear_color.z*4.0f));
 						uint8_t* cb = (uint8_t*) _brcontext->cb;
-						for(uint64_t i = 0; i < pixels; i += 1)
+						for(uint64_t row = start; row < end; row += pitch)
+						for(uint64_t i = row; i < row + width; i += 1)
 							cb[i] = color;
 					}
 					break;
@@ -3982,7 +6576,8 @@ void brClear(uint32_t buffers)
 					if(d > 0xFFFF) d = 0xFFFF;
 					if(d < 0) d = 0;
 					depth = d;
-					for(uint64_t i = 0; i < pixels; i += 1)
+					for(uint64_t row = start; row < end; row += pitch)
+					for(uint64_t i = row; i < row + width; i += 1)
 						db[i] = depth;
 				}
 				break;
@@ -3994,7 +6589,8 @@ void brClear(uint32_t buffers)
 					if(d > 0xFFFFFFFF) d = 0xFFFFFFFF;
 					if(d < 0) d = 0;
 					depth = d;
-					for(uint64_t i = 0; i < pixels; i += 1)
+					for(uint64_t row = start; row < end; row += pitch)
+					for(uint64_t i = row; i < row + width; i += 1)
 						db[i] = depth;
 				}
 				break;
@@ -4003,6 +6599,165 @@ void brClear(uint32_t buffers)
 	}
 }
 
+// clear back (if BR_DOUBLE_BUFFER is enabled) or front renderbuffer(s).
+// OR together buffer constants.
+// when multisampling (see brSampleCount), the sample buffers are cleared as well.
+// with BR_JOBS enabled, rows are cleared as jobs.
+void brClear(uint32_t buffers)
+{
+	if(!_brcontext)
+		return;
+
+	if(_brcontext->msaa_color)
+		_clear_samples(buffers);
+
+	bool db = _brcontext->double_buffer;
+	bool clear_cb = (db ? _brcontext->cb2 : _brcontext->cb) && (buffers & BR_COLOR_BUFFER_BIT);
+	bool clear_db = (db ? _brcontext->db2 : _brcontext->db) && (buffers & BR_DEPTH_BUFFER_BIT);
+	brrect rect = db ? _clip_rect(_brcontext->rb2_width, _brcontext->rb2_height) : _clip_rect(_brcontext->rb_width, _brcontext->rb_height);
+	if(clear_cb || clear_db)
+	{
+		_add_damage(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height);
+		_br_parallel_for(rect.height, BR_JOB_ROWS, _clear_rows, &buffers);
+	}
+}
+
+// resolve rows [row0, row1) of the clip rect (see brResolve).
+void _resolve_rows(void* data, uint32_t row0, uint32_t row1)
+{
+	(void)data;
+	uint32_t n = _brcontext->sample_count;
+	uint32_t shift = n == 8 ? 3 : (n == 4 ? 2 : 1);
+	uint32_t x0 = _brcontext->clip_x0, x1 = _brcontext->clip_x1;
+	uint32_t y0 = _brcontext->clip_y0 + row0, y1 = _brcontext->clip_y0 + row1;
+	uint32_t pitch = _brcontext->rb_pitch;
+	
+	if(_brcontext->cb)
+	{
+		bool rgba8 = _brcontext->cb_type == BR_R8G8B8A8 || _brcontext->cb_type == BR_A8B8G8R8;
+		bool abgr = _brcontext->cb_type == BR_A8B8G8R8;
+		for(uint32_t y = y0; y < y1; y += 1)
+		{
+			uint32_t index = y * pitch;
+			uint32_t x = x0;
+#ifdef __SSE2__
+			// samples are summed in 16-bit lanes, one pixel at a time
+			if(rgba8)
+			{
+				__m128i zero = _mm_setzero_si128();
+				__m128i round = _mm_set1_epi16(n>>1);
+				for(; x < x1; x += 1)
+				{
+					uint32_t* samples = _brcontext->msaa_color + (index + x)*n;
+					__m128i sum;
+					if(n == 2)
+						sum = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)samples), zero);
+					else
+					{
+						__m128i s = _mm_loadu_si128((__m128i*)samples);
+						sum = _mm_add_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpackhi_epi8(s, zero));
+						if(n == 8)
+						{
+							s = _mm_loadu_si128((__m128i*)(samples+4));
+							sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpackhi_epi8(s, zero)));
+						}
+					}
+					sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+					sum = _mm_srli_epi16(_mm_add_epi16(sum, round), shift);
+					uint32_t pixel = _mm_cvtsi128_si32(_mm_packus_epi16(sum, zero));
+					if(abgr)
+						pixel = _BR_A8B8G8R8(_BR_R8G8B8A8_R(pixel), _BR_R8G8B8A8_G(pixel), _BR_R8G8B8A8_B(pixel), _BR_R8G8B8A8_A(pixel));
+					((uint32_t*)_brcontext->cb)[index + x] = pixel;
+				}
+			}
+#endif
+			for(; x < x1; x += 1)
+			{
+				uint32_t* samples = _brcontext->msaa_color + (index + x)*n;
+				uint32_t r = 0, g = 0, b = 0, a = 0;
+				for(uint32_t s = 0; s < n; s += 1)
+				{
+					r += _BR_R8G8B8A8_R(samples[s]);
+					g += _BR_R8G8B8A8_G(samples[s]);
+					b += _BR_R8G8B8A8_B(samples[s]);
+					a += _BR_R8G8B8A8_A(samples[s]);
+				}
+				r = (r + (n>>1)) >> shift;
+				g = (g + (n>>1)) >> shift;
+				b = (b + (n>>1)) >> shift;
+				a = (a + (n>>1)) >> shift;
+				brvec4ui rgba = { _BR_FROM8(r), _BR_FROM8(g), _BR_FROM8(b), _BR_FROM8(a) };
+				_store_pixel(index + x, rgba);
+			}
+		}
+	}
+	
+	if(_brcontext->db)
+	{
+		for(uint32_t y = y0; y < y1; y += 1)
+		{
+			for(uint32_t index = y * pitch + x0; index < y * pitch + x1; index += 1)
+			{
+				uint32_t* samples = _brcontext->msaa_depth + index*n;
+				uint32_t depth = samples[0];
+				for(uint32_t s = 1; s < n; s += 1)
+					if(samples[s] < depth)
+						depth = samples[s];
+				if(_brcontext->db_type == BR_D16)
+					((uint16_t*)_brcontext->db)[index] = depth;
+				else
+					((uint32_t*)_brcontext->db)[index] = depth;
+			}
+		}
+	}
+}
+
+// resolve the sample buffers (see brSampleCount) to the front set, within the redraw region (see brRedrawRegion).
+// each pixel's color is the average of its samples (a box filter) and its depth the nearest of its samples.
+// the sample buffers are left as they are. with BR_JOBS enabled, rows are resolved as jobs.
+void brResolve()
+{
+	if(!_brcontext || !_brcontext->msaa_color)
+		return;
+	
+	uint32_t rows = _brcontext->clip_y1 > _brcontext->clip_y0 ? _brcontext->clip_y1 - _brcontext->clip_y0 : 0;
+	_br_parallel_for(rows, BR_JOB_ROWS, _resolve_rows, NULL);
+}
+
+// limit rasterization, clears & resolves to the pixels of 'rect' (a redraw region), e.g. to redraw only the part
+// of an otherwise unchanged frame that has changed by drawing all of it again: primitives outside the region
+// are rejected at setup. pass NULL to draw to the whole front set again.
+void brRedrawRegion(brrect* rect)
+{
+	if(!_brcontext)
+		return;
+	_brcontext->redraw = rect != NULL;
+	if(rect)
+		_brcontext->redraw_rect = *rect;
+	_update_clip();
+}
+
+// get the rects of pixels damaged (drawn to or cleared) since brClearDamage, up to 'max' of them, e.g. so that
+// only they are presented. each draw damages the bounds of the primitives it rasterized. returns the number of 
+// rects, at most BR_MAX_DAMAGE_RECTS; no two overlap.
+uint32_t brGetDamage(brrect* rects, uint32_t max)
+{
+	if(!_brcontext)
+		return 0;
+	uint32_t count = _brcontext->damage_count;
+	for(uint32_t i = 0; i < count && i < max; i += 1)
+		rects[i] = _brcontext->damage[i];
+	return count;
+}
+
+// forget the damage so far (see brGetDamage), e.g. once a frame has been presented.
+void brClearDamage()
+{
+	if(!_brcontext)
+		return;
+	_brcontext->damage_count = 0;
+}
+
 // define where vertex position is located within the vertex layout of arrays.
 // count is 2, 3, or 4.
 void brVertexPointer(uint32_t count, void* offset, void* stride)
@@ -4018,641 +6773,835 @@ void brVertexPointer(uint32_t count, void* offset, void* stride)
 // count is 3 or 4.
 void brColorPointer(uint32_t count, void* offset, void* stride)
 {
-	if(count != 3 && count != 4)
-		return;
-	_brcontext->color_count = count;
-	_brcontext->color_offset = offset;
-	_brcontext->color_stride = (size_t)stride;
+	if(count != 3 && count != 4)
+		return;
+	_brcontext->color_count = count;
+	_brcontext->color_offset = offset;
+	_brcontext->color_stride = (size_t)stride;
+}
+
+// define where vertex normal is located within the vertex layout of arrays.
+void brNormalPointer(void* offset, void* stride)
+{
+	_brcontext->normal_offset = offset;
+	_brcontext->normal_stride = (size_t)stride;
+}
+
+// define where vertex texture coordinate in located within the vertex layout of arrays.
+void brTexCoordPointer(void* offset, void* stride)
+{
+	_brcontext->tcoord_offset = offset;
+	_brcontext->tcoord_stride = (size_t)stride;
+}
+
+// define where vertex texture index is located within the vertex layout of arrays (BR_TEXTURE_INDEX_ARRAY).
+// it is one float naming the texture unit sampled by the primitives of which the vertex is the last (provoking)
+// vertex, so a draw may select any texture unit per primitive rather than only the active one. indices outside
+// of [0, BR_NUM_TEXTURE_UNITS) select the active texture unit.
+void brTextureIndexPointer(void* offset, void* stride)
+{
+	_brcontext->texture_index_offset = offset;
+	_brcontext->texture_index_stride = (size_t)stride;
+}
+
+// define where the instance attribute is located within arrays; it is advanced by stride once per instance.
+// count is 1 to 4; the attribute defaults to (0,0,0,1).
+void brInstancePointer(uint32_t count, void* offset, void* stride)
+{
+	if(count > 4 || count < 1)
+		return;
+	_brcontext->instance_count = count;
+	_brcontext->instance_offset = offset;
+	_brcontext->instance_stride = (size_t)stride;
+}
+
+// vertex attributes fetched from an array
+typedef struct _vertex_attribs_t _vertex_attribs_t;
+struct _vertex_attribs_t
+{
+	brvec4 position;
+	brvec4 color;
+	brvec3 normal;
+	brvec2 tcoord;
+	uint32_t texture;	// texture unit of primitives it provokes (see brTextureIndexPointer)
+	bool restart;	// primitive restart (not a vertex)
+};
+
+// fetch the attributes of vertex 'index' of an array, per the vertex layout.
+void _fetch_vertex(float* array, uint32_t index, _vertex_attribs_t* out)
+{
+	void* vertex_offset = _brcontext->vertex_offset + (_brcontext->vertex_stride*index);
+	void* color_offset  = _brcontext->color_offset  + (_brcontext->color_stride*index);
+	void* normal_offset = _brcontext->normal_offset + (_brcontext->normal_stride*index);
+	void* tcoord_offset = _brcontext->tcoord_offset + (_brcontext->tcoord_stride*index);
+	void* texture_index_offset = _brcontext->texture_index_offset + (_brcontext->texture_index_stride*index);
+	
+	out->position = { 0, 0, 0, 1 };
+	out->color    = { 0, 0, 0, 1 };
+	out->normal   = { 0, 0, 0 };
+	out->tcoord   = { 0, 0 };
+	out->texture  = _brcontext->texture_unit;
+	out->restart  = false;
+	
+	if(_brcontext->vertex_array) {
+		if(_brcontext->vertex_count == 2)
+			out->position = { *(float*)((void*)array + (size_t)vertex_offset),
+				*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
+				out->position.z, out->position.w };
+		if(_brcontext->vertex_count == 3)
+			out->position = { *(float*)((void*)array + (size_t)vertex_offset),
+				*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
+				*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
+				out->position.w };
+		if(_brcontext->vertex_count == 4)
+			out->position = { *(float*)((void*)array + (size_t)vertex_offset),
+				*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
+				*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
+				*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
+	}
+	if(_brcontext->color_array) {
+		if(_brcontext->color_count == 3)
+			out->color = { *(float*)((void*)array + (size_t)color_offset),
+				*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
+				*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
+				out->color.w };
+		if(_brcontext->color_count == 4)
+			out->color = { *(float*)((void*)array + (size_t)color_offset),
+				*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
+				*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
+				*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
+	}
+	if(_brcontext->normal_array) {
+		out->normal = { *(float*)((void*)array + (size_t)normal_offset),
+			*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
+			*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
+	}
+	if(_brcontext->tcoord_array) {
+		out->tcoord = { *(float*)((void*)array + (size_t)tcoord_offset),
+			*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
+	}
+	if(_brcontext->texture_index_array) {
+		float unit = *(float*)((void*)array + (size_t)texture_index_offset);
+		if(unit >= 0.0f && unit < BR_NUM_TEXTURE_UNITS)
+			out->texture = unit;
+	}
+}
+
+// fetch the instance attribute of instance 'instance' of an array, per the instance layout.
+void _fetch_instance(float* array, uint32_t instance)
+{
+	_brcontext->instance_id = instance;
+	_brcontext->instance_attrib = { 0, 0, 0, 1 };
+	if(!_brcontext->instance_array)
+		return;
+	
+	float* attrib = (float*)((void*)array + (size_t)_brcontext->instance_offset + (_brcontext->instance_stride*instance));
+	if(_brcontext->instance_count > 0)	_brcontext->instance_attrib.x = attrib[0];
+	if(_brcontext->instance_count > 1)	_brcontext->instance_attrib.y = attrib[1];
+	if(_brcontext->instance_count > 2)	_brcontext->instance_attrib.z = attrib[2];
+	if(_brcontext->instance_count > 3)	_brcontext->instance_attrib.w = attrib[3];
+}
+
+// vertex shade a fetched vertex in place; its color, normals & texture coordinates may be written by the shader.
+void _shade_vertex(uint32_t type, _vertex_attribs_t* vertex)
+{
+	_vertex_t pass;
+	pass.type = type;
+	pass.position = vertex->position;
+	pass.color = &vertex->color;
+	pass.normals = &vertex->normal;
+	pass.tcoords = &vertex->tcoord;
+	vertex->position = _vertex_pass(&pass);
+}
+
+// process a point of shaded vertices.
+void _draw_point(_vertex_attribs_t* v0)
+{
+	_BR_STAT(primitives_in, 1);
+	_point_t point;
+	point.pos = v0->position;
+	point.rgba = v0->color;
+	_process_point(&point);
+}
+
+// process a line of shaded vertices, per the polygon mode. lines are added to 'line_batch'.
+// primitives sample the texture unit of their last (provoking) vertex.
+void _draw_line(_vertex_attribs_t* v0, _vertex_attribs_t* v1, _line_batch_t* line_batch)
+{
+	_BR_STAT(primitives_in, 1);
+	if(_brcontext->poly_mode == BR_FILL
+	|| _brcontext->poly_mode == BR_LINE) {
+		_line_t line;
+		line.v0 = v0->position;
+		line.v1 = v1->position;
+		line.rgba0 = v0->color;
+		line.rgba1 = v1->color;
+		line.tcoords0 = v0->tcoord;
+		line.tcoords1 = v1->tcoord;
+		line.texture = v1->texture;
+		_batch_line(line_batch, &line);
+	}
+	
+	if(_brcontext->poly_mode == BR_POINT) {
+		_point_t point;
+		point.pos = v0->position;
+		point.rgba = v0->color;
+		_process_point(&point);
+		point.pos = v1->position;
+		point.rgba = v1->color;
+		_process_point(&point);
+	}
+}
+
+// process a triangle of shaded vertices, per the polygon mode. filled triangles are added to 'batch',
+// and outlines (BR_LINE) to 'line_batch'.
+void _draw_triangle(_vertex_attribs_t* v0, _vertex_attribs_t* v1, _vertex_attribs_t* v2, _triangle_batch_t* batch, _line_batch_t* line_batch)
+{
+	_BR_STAT(primitives_in, 1);
+	if(_brcontext->poly_mode == BR_FILL) {
+		_triangle_t tri;
+		tri.v0 = v0->position;
+		tri.v1 = v1->position;
+		tri.v2 = v2->position;
+		tri.rgba0 = v0->color;
+		tri.rgba1 = v1->color;
+		tri.rgba2 = v2->color;
+		tri.tcoords0 = v0->tcoord;
+		tri.tcoords1 = v1->tcoord;
+		tri.tcoords2 = v2->tcoord;
+		tri.texture = v2->texture;
+		tri.parent = NULL;
+		_batch_triangle(batch, &tri);
+	}
+	
+	if(_brcontext->poly_mode == BR_LINE) {
+		_line_t line;
+		line.texture = v2->texture;
+		line.v0 = v0->position;
+		line.v1 = v1->position;
+		line.rgba0 = v0->color;
+		line.rgba1 = v1->color;
+		line.tcoords0 = v0->tcoord;
+		line.tcoords1 = v1->tcoord;
+		_batch_line(line_batch, &line);
+		line.v0 = v1->position;
+		line.v1 = v2->position;
+		line.rgba0 = v1->color;
+		line.rgba1 = v2->color;
+		line.tcoords0 = v1->tcoord;
+		line.tcoords1 = v2->tcoord;
+		_batch_line(line_batch, &line);
+		line.v0 = v2->position;
+		line.v1 = v0->position;
+		line.rgba0 = v2->color;
+		line.rgba1 = v0->color;
+		line.tcoords0 = v2->tcoord;
+		line.tcoords1 = v0->tcoord;
+		_batch_line(line_batch, &line);
+	}
+	
+	if(_brcontext->poly_mode == BR_POINT) {
+		_point_t point;
+		point.pos = v0->position;
+		point.rgba = v0->color;
+		_process_point(&point);
+		point.pos = v1->position;
+		point.rgba = v1->color;
+		_process_point(&point);
+		point.pos = v2->position;
+		point.rgba = v2->color;
+		_process_point(&point);
+	}
+}
+
+// return the vertex type (BR_TRIANGLE, BR_LINE or BR_POINT) passed to the vertex shader for a primitive type.
+uint32_t _vertex_type(uint32_t ptype)
+{
+	if(ptype == BR_TRIANGLES || ptype == BR_TRIANGLE_STRIP || ptype == BR_TRIANGLE_FAN)
+		return BR_TRIANGLE;
+	if(ptype == BR_LINES || ptype == BR_LINE_STRIP || ptype == BR_LINE_LOOP)
+		return BR_LINE;
+	return BR_POINT;
+}
+
+// vertices to vertex shade as jobs (see _draw_instances).
+typedef struct _shade_job_t _shade_job_t;
+struct _shade_job_t
+{
+	uint32_t type;
+	_vertex_attribs_t* vertices;
+};
+
+void _shade_vertices(void* data, uint32_t begin, uint32_t end)
+{
+	_shade_job_t* job = (_shade_job_t*)data;
+	for(uint32_t i = begin; i < end; i += 1)
+		if(!job->vertices[i].restart)
+			_shade_vertex(job->type, &job->vertices[i]);
+}
+
+// primitive assembly state, kept between the blocks of vertices of a draw (see _draw_vertices).
+typedef struct _assembly_t _assembly_t;
+struct _assembly_t
+{
+	_vertex_attribs_t first;	// first vertex of a fan or loop
+	_vertex_attribs_t prev[2];	// two previous vertices; prev[1] is the most recent
+	uint32_t v;					// vertex # within the current primitive (or strip, fan or loop)
+};
+
+// assemble fetched vertices to primitives, vertex shade & process them. triangles are added to 'batch',
+// lines to 'line_batch'. vertices may be passed a block at a time; 'assembly' carries over between blocks
+// and starts with a v of 0. finish a draw with _end_assembly.
+// each vertex is shaded once; strips, fans & loops reuse the previously shaded vertices.
+// 'shaded' vertices were already vertex shaded (see _shade_vertices).
+// a restart vertex (see BR_PRIMITIVE_RESTART) ends the current strip, fan or loop.
+void _draw_vertices(uint32_t ptype, _vertex_attribs_t* vertices, uint32_t count, bool shaded, _assembly_t* assembly, 
+	_triangle_batch_t* batch, _line_batch_t* line_batch)
+{
+	uint32_t type = _vertex_type(ptype);
+	
+	_vertex_attribs_t* first = &assembly->first;
+	_vertex_attribs_t* prev = assembly->prev;
+	uint32_t v = assembly->v;
+	
+	for(uint32_t i = 0; i < count; i += 1)
+	{
+		if(vertices[i].restart)
+		{
+			if(ptype == BR_LINE_LOOP && v > 1)
+				_draw_line(&prev[1], first, line_batch);
+			v = 0;
+			continue;
+		}
+		
+		_vertex_attribs_t vertex = vertices[i];
+		if(!shaded)
+			_shade_vertex(type, &vertex);
+		
+		switch(ptype)
+		{
+			case BR_POINTS:
+				_draw_point(&vertex);
+				break;
+			case BR_LINES:
+				if(v & 1)
+					_draw_line(&prev[1], &vertex, line_batch);
+				break;
+			case BR_LINE_STRIP:
+			case BR_LINE_LOOP:
+				if(v == 0)
+					*first = vertex;
+				else
+					_draw_line(&prev[1], &vertex, line_batch);
+				break;
+			case BR_TRIANGLES:
+				if(v % 3 == 2)
+					_draw_triangle(&prev[0], &prev[1], &vertex, batch, line_batch);
+				break;
+			case BR_TRIANGLE_STRIP:
+				// odd triangles are swapped to keep the winding of the strip
+				if(v >= 2 && !(v & 1))
+					_draw_triangle(&prev[0], &prev[1], &vertex, batch, line_batch);
+				if(v >= 2 && (v & 1))
+					_draw_triangle(&prev[1], &prev[0], &vertex, batch, line_batch);
+				break;
+			case BR_TRIANGLE_FAN:
+				if(v == 0)
+					*first = vertex;
+				if(v >= 2)
+					_draw_triangle(first, &prev[1], &vertex, batch, line_batch);
+				break;
+		}
+		
+		prev[0] = prev[1];
+		prev[1] = vertex;
+		v += 1;
+	}
+	assembly->v = v;
+}
+
+// finish the primitive assembly of a draw; closes a line loop.
+void _end_assembly(uint32_t ptype, _assembly_t* assembly, _line_batch_t* line_batch)
+{
+	if(ptype == BR_LINE_LOOP && assembly->v > 1)
+		_draw_line(&assembly->prev[1], &assembly->first, line_batch);
+	assembly->v = 0;
+}
+
+// vertices to fetch as jobs; 'elements' of 'type' index 'array', or are NULL to fetch vertices in order.
+// vertex i is fetched to vertices[i - base].
+typedef struct _fetch_job_t _fetch_job_t;
+struct _fetch_job_t
+{
+	float* array;
+	uint32_t type;
+	void* elements;
+	_vertex_attribs_t* vertices;
+	uint32_t base;
+};
+
+void _fetch_vertices(void* data, uint32_t begin, uint32_t end);
+
+// fetch all vertices of a draw ahead of assembly when they're reused by several instances or can be fetched
+// as jobs. otherwise fetch->vertices is left NULL, and the draw is streamed (see _draw_instances).
+// returns false if the vertices could not be allocated.
+bool _prefetch_vertices(_fetch_job_t* fetch, uint32_t count, uint32_t instances)
+{
+	fetch->vertices = NULL;
+	fetch->base = 0;
+	if(instances == 1 && !(_brcontext->jobs && count > BR_JOB_VERTICES))
+		return true;
+	
+	fetch->vertices = (_vertex_attribs_t*) _br_malloc(count * sizeof(_vertex_attribs_t));
+	if(!fetch->vertices)
+		return false;
+	_br_parallel_for(count, BR_JOB_VERTICES, _fetch_vertices, fetch);
+	return true;
+}
+
+// draw the vertices of 'fetch' (see _prefetch_vertices) once per instance.
+// prefetched vertices are only fetched once; they are vertex shaded per instance, as jobs when BR_JOBS is enabled.
+// a draw without prefetched vertices is streamed: fetched, shaded & assembled BR_STREAM_VERTICES at a time.
+void _draw_instances(uint32_t ptype, _fetch_job_t* fetch, uint32_t count, float* array, uint32_t instances)
+{
+	_vertex_attribs_t* vertices = fetch->vertices;
+	
+	// vertices are shaded ahead of assembly when the shader can run as jobs
+	_shade_job_t shade = { _vertex_type(ptype), NULL };
+	if(vertices && _brcontext->jobs && _brcontext->vshader && count > BR_JOB_VERTICES)
+		shade.vertices = (_vertex_attribs_t*) _br_malloc(count * sizeof(_vertex_attribs_t));
+	
+	_triangle_batch_t batch;
+	batch.count = 0;
+	_line_batch_t line_batch;
+	line_batch.count = 0;
+	
+	// points of the draw share one fragment context
+	_fragment_t point_frag = {};
+	if(_brcontext->fshader)
+	{
+		_init_fragment(&point_frag);
+		_brcontext->point_frag = &point_frag;
+	}
+	
+	_assembly_t assembly;
+	assembly.v = 0;
+	if(!vertices)
+	{
+		_vertex_attribs_t block[BR_STREAM_VERTICES];
+		_fetch_job_t stream = *fetch;
+		stream.vertices = block;
+		_fetch_instance(array, 0);
+		for(uint32_t begin = 0; begin < count; begin += BR_STREAM_VERTICES)
+		{
+			uint32_t end = count - begin > BR_STREAM_VERTICES ? begin + BR_STREAM_VERTICES : count;
+			stream.base = begin;
+			_fetch_vertices(&stream, begin, end);
+			_draw_vertices(ptype, block, end - begin, false, &assembly, &batch, &line_batch);
+		}
+		_end_assembly(ptype, &assembly, &line_batch);
+	}
+	
+	for(uint32_t instance = 0; vertices && instance < instances; instance += 1)
+	{
+		_fetch_instance(array, instance);
+		if(shade.vertices)
+		{
+			memcpy(shade.vertices, vertices, count * sizeof(_vertex_attribs_t));
+			_br_parallel_for(count, BR_JOB_VERTICES, _shade_vertices, &shade);
+			_draw_vertices(ptype, shade.vertices, count, true, &assembly, &batch, &line_batch);
+		}
+		else
+			_draw_vertices(ptype, vertices, count, false, &assembly, &batch, &line_batch);
+		_end_assembly(ptype, &assembly, &line_batch);
+	}
+	if(shade.vertices)
+		_br_free(shade.vertices);
+	
+	_setup_triangle_batch(&batch);
+	_setup_line_batch(&line_batch);
+	_damage_draw();
+	
+	_brcontext->point_frag = NULL;
+	if(point_frag.pass_data)
+		_br_free(point_frag.pass_data);
+	if(point_frag.pass_attribs)
+		_br_free(point_frag.pass_attribs);
+	_fetch_instance(array, 0);
+}
+
+// set the element that restarts strips, fans & loops in brDrawElements when BR_PRIMITIVE_RESTART is enabled.
+// 8 & 16-bit elements are compared as-is, so use an index within their range (e.g. 0xFF or 0xFFFF) for them.
+void brPrimitiveRestartIndex(uint32_t index)
+{
+	if(!_brcontext)
+		return;
+	_brcontext->restart_index = index;
+}
+
+// draw an array 'instances' times.
+void brDrawArrayInstanced(uint32_t ptype, uint32_t indices, float* array, uint32_t instances)
+{
+	if(!_brcontext || !indices || !instances)
+		return;
+	
+	_BR_STAT_TIME(draw_start);
+	_fetch_job_t fetch = { array, 0, NULL, NULL, 0 };
+	if(!_prefetch_vertices(&fetch, indices, instances))
+		// out of memory; nothing is drawn
+		return;
+	
+	_draw_instances(ptype, &fetch, indices, array, instances);
+	
+	if(fetch.vertices)
+		_br_free(fetch.vertices);
+	_BR_STAT_ELAPSED(draw_ns, draw_start);
+}
+
+// fetch the vertices of elements [begin, end) (or of indices, without elements) of a _fetch_job_t; a loop
+// per element type.
+void _fetch_vertices(void* data, uint32_t begin, uint32_t end)
+{
+	_fetch_job_t* job = (_fetch_job_t*)data;
+	float* array = job->array;
+	void* elements = job->elements;
+	_vertex_attribs_t* vertices = job->vertices;
+	uint32_t base = job->base;
+	bool restart = _brcontext->primitive_restart;
+	uint32_t restart_index = _brcontext->restart_index;
+	
+	switch(elements ? job->type : 0)
+	{
+		case 0:
+			for(uint32_t i = begin; i < end; i += 1)
+				_fetch_vertex(array, i, &vertices[i - base]);
+			break;
+		case BR_UNSIGNED_BYTE:
+			for(uint32_t i = begin; i < end; i += 1)
+			{
+				uint8_t element = ((uint8_t*)elements)[i];
+				vertices[i - base].restart = restart && element == restart_index;
+				if(!vertices[i - base].restart)
+					_fetch_vertex(array, element, &vertices[i - base]);
+			}
+			break;
+		case BR_UNSIGNED_SHORT:
+			for(uint32_t i = begin; i < end; i += 1)
+			{
+				uint16_t element = ((uint16_t*)elements)[i];
+				vertices[i - base].restart = restart && element == restart_index;
+				if(!vertices[i - base].restart)
+					_fetch_vertex(array, element, &vertices[i - base]);
+			}
+			break;
+		case BR_UNSIGNED_INT:
+			for(uint32_t i = begin; i < end; i += 1)
+			{
+				uint32_t element = ((uint32_t*)elements)[i];
+				vertices[i - base].restart = restart && element == restart_index;
+				if(!vertices[i - base].restart)
+					_fetch_vertex(array, element, &vertices[i - base]);
+			}
+			break;
+	}
+}
+
+// draw an array using elements 'instances' times.
+// type is the element type: BR_UNSIGNED_BYTE, BR_UNSIGNED_SHORT or BR_UNSIGNED_INT.
+void brDrawElementsInstanced(uint32_t ptype, uint32_t indices, float* array, uint32_t type, void* elements, uint32_t instances)
+{
+	if(!_brcontext || !indices || !instances)
+		return;
+	if(type != BR_UNSIGNED_BYTE && type != BR_UNSIGNED_SHORT && type != BR_UNSIGNED_INT)
+		return;
+	
+	_BR_STAT_TIME(draw_start);
+	_fetch_job_t fetch = { array, type, elements, NULL, 0 };
+	if(!_prefetch_vertices(&fetch, indices, instances))
+		// out of memory; nothing is drawn
+		return;
+	
+	_draw_instances(ptype, &fetch, indices, array, instances);
+	
+	if(fetch.vertices)
+		_br_free(fetch.vertices);
+	_BR_STAT_ELAPSED(draw_ns, draw_start);
+}
+
+// draw an array.
+void brDrawArray(uint32_t ptype, uint32_t indices, float* array)
+{
+	brDrawArrayInstanced(ptype, indices, array, 1);
 }
 
-// define where vertex normal is located within the vertex layout of arrays.
-void brNormalPointer(void* offset, void* stride)
+// draw an array using elements.
+void brDrawElements(uint32_t ptype, uint32_t indices, float* array, uint32_t* elements)
 {
-	_brcontext->normal_offset = offset;
-	_brcontext->normal_stride = (size_t)stride;
+	brDrawElementsInstanced(ptype, indices, array, BR_UNSIGNED_INT, elements, 1);
 }
 
-// define where vertex texture coordinate in located within the vertex layout of arrays.
-void brTexCoordPointer(void* offset, void* stride)
+// draw an array using elements of type 'type' (BR_UNSIGNED_BYTE, BR_UNSIGNED_SHORT or BR_UNSIGNED_INT).
+void brDrawElementsTyped(uint32_t ptype, uint32_t indices, float* array, uint32_t type, void* elements)
 {
-	_brcontext->tcoord_offset = offset;
-	_brcontext->tcoord_stride = (size_t)stride;
+	brDrawElementsInstanced(ptype, indices, array, type, elements, 1);
 }
 
-// draw an array.
-void brDrawArray(uint32_t ptype, uint32_t indices, float* array)
+// transform a block of point cloud points to raster space. 'x', 'y' & 'z' hold object-space positions
+// and receive raster-space positions & depths; points outside of the frustum (when clipping) are marked
+// in 'culled'. loops run over the whole block so that they vectorize.
+void _transform_splat_batch(uint32_t n, float* x, float* y, float* z, bool* culled, brmat4* m)
 {
-	uint32_t v = 0;	// current vertex #
-	brvec4 position0;
-	brvec4 color0;
-	brvec3 normal0;
-	brvec2 tcoord0;
-	brvec4 position1;
-	brvec4 color1;
-	brvec3 normal1;
-	brvec2 tcoord1;
-	brvec4 position2;
-	brvec4 color2;
-	brvec3 normal2;
-	brvec2 tcoord2;
-	
-	void* vertex_offset = _brcontext->vertex_offset;
-	void* color_offset  = _brcontext->color_offset;
-	void* normal_offset = _brcontext->normal_offset;
-	void* tcoord_offset = _brcontext->tcoord_offset;
-	
-	for(uint32_t i = 0; i < indices; i += 1)
-	{
-		// load to vertex
-		if(v == 0) {
-			position0 = { 0, 0, 0, 1 };
-			color0    = { 0, 0, 0, 1 };
-			normal0   = { 0, 0, 0 };
-			tcoord0   = { 0, 0 };
-			
-			if(_brcontext->vertex_array) {
-				if(_brcontext->vertex_count == 2)
-					position0 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						position0.z, position0.w };
-				if(_brcontext->vertex_count == 3)
-					position0 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						position0.w };
-				if(_brcontext->vertex_count == 4)
-					position0 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->color_array) {
-				if(_brcontext->color_count == 3)
-					color0 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
-						color0.w };
-				if(_brcontext->color_count == 4)
-					color0 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->normal_array) {
-				normal0 = { *(float*)((void*)array + (size_t)normal_offset),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
-			}
-			if(_brcontext->tcoord_array) {
-				tcoord0 = { *(float*)((void*)array + (size_t)tcoord_offset),
-					*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
-			}
-		}
-		if(v == 1) {
-			position1 = { 0, 0, 0, 1 };
-			color1    = { 0, 0, 0, 1 };
-			normal1   = { 0, 0, 0 };
-			tcoord1   = { 0, 0 };
-			
-			if(_brcontext->vertex_array) {
-				if(_brcontext->vertex_count == 2)
-					position1 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						position1.z, position1.w };
-				if(_brcontext->vertex_count == 3)
-					position1 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						position1.w };
-				if(_brcontext->vertex_count == 4)
-					position1 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->color_array) {
-				if(_brcontext->color_count == 3)
-					color1 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
-						color1.w };
-				if(_brcontext->color_count == 4)
-					color1 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->normal_array) {
-				normal1 = { *(float*)((void*)array + (size_t)normal_offset),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
-			}
-			if(_brcontext->tcoord_array) {
-				tcoord1 = { *(float*)((void*)array + (size_t)tcoord_offset),
-					*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
-			}
-		}
-		if(v == 2) {
-			position2 = { 0, 0, 0, 1 };
-			color2    = { 0, 0, 0, 1 };
-			normal2   = { 0, 0, 0 };
-			tcoord2   = { 0, 0 };
-			
-			if(_brcontext->vertex_array) {
-				if(_brcontext->vertex_count == 2)
-					position2 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						position2.z, position2.w };
-				if(_brcontext->vertex_count == 3)
-					position2 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						position2.w };
-				if(_brcontext->vertex_count == 4)
-					position2 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->color_array) {
-				if(_brcontext->color_count == 3)
-					color2 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
-						color2.w };
-				if(_brcontext->color_count == 4)
-					color2 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->normal_array) {
-				normal2 = { *(float*)((void*)array + (size_t)normal_offset),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
-			}
-			if(_brcontext->tcoord_array) {
-				tcoord2 = { *(float*)((void*)array + (size_t)tcoord_offset),
-					*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
-			}
-		}
-		
-		if(ptype == BR_TRIANGLES && v == 2)
-		{
-			_vertex_t vertex;
-			vertex.type = BR_TRIANGLE;
-			vertex.position = position0;
-			vertex.color = &color0;
-			vertex.normals = &normal0;
-			vertex.tcoords = &tcoord0;
-			position0 = _vertex_pass(&vertex);
-			
-			vertex.position = position1;
-			vertex.color = &color1;
-			vertex.normals = &normal1;
-			vertex.tcoords = &tcoord1;
-			position1 = _vertex_pass(&vertex);
-			
-			vertex.position = position2;
-			vertex.color = &color2;
-			vertex.normals = &normal2;
-			vertex.tcoords = &tcoord2;
-			position2 = _vertex_pass(&vertex);
-			
-			if(_brcontext->poly_mode == BR_FILL) {
-				_triangle_t tri;
-				tri.v0 = position0;
-				tri.v1 = position1;
-				tri.v2 = position2;
-				tri.rgba0 = color0;
-				tri.rgba1 = color1;
-				tri.rgba2 = color2;
-				tri.tcoords0 = tcoord0;
-				tri.tcoords1 = tcoord1;
-				tri.tcoords2 = tcoord2;
-				tri.parent = NULL;
-				_process_triangle(&tri);
-			}
-			
-			if(_brcontext->poly_mode == BR_LINE) {
-				_line_t line;
-				line.v0 = position0;
-				line.v1 = position1;
-				line.rgba0 = color0;
-				line.rgba1 = color1;
-				line.tcoords0 = tcoord0;
-				line.tcoords1 = tcoord1;
-				_process_line(&line);
-				line.v0 = position1;
-				line.v1 = position2;
-				line.rgba0 = color1;
-				line.rgba1 = color2;
-				line.tcoords0 = tcoord1;
-				line.tcoords1 = tcoord2;
-				_process_line(&line);
-				line.v0 = position2;
-				line.v1 = position0;
-				line.rgba0 = color2;
-				line.rgba1 = color0;
-				line.tcoords0 = tcoord2;
-				line.tcoords1 = tcoord0;
-				_process_line(&line);
-			}
-			
-			if(_brcontext->poly_mode == BR_POINT) {
-				_point_t point;
-				point.pos = position0;
-				point.rgba = color0;
-				_process_point(&point);
-				point.pos = position1;
-				point.rgba = color1;
-				_process_point(&point);
-				point.pos = position2;
-				point.rgba = color2;
-				_process_point(&point);
-			}
-		}
-		if(ptype == BR_LINES && v == 1)
-		{
-			_vertex_t vertex;
-			vertex.type = BR_LINE;
-			vertex.position = position0;
-			vertex.color = &color0;
-			vertex.normals = &normal0;
-			vertex.tcoords = &tcoord0;
-			position0 = _vertex_pass(&vertex);
-			
-			vertex.position = position1;
-			vertex.color = &color1;
-			vertex.normals = &normal1;
-			vertex.tcoords = &tcoord1;
-			position1 = _vertex_pass(&vertex);
-			
-			if(_brcontext->poly_mode == BR_FILL
-			|| _brcontext->poly_mode == BR_LINE) {
-				_line_t line;
-				line.v0 = position0;
-				line.v1 = position1;
-				line.rgba0 = color0;
-				line.rgba1 = color1;
-				line.tcoords0 = tcoord0;
-				line.tcoords1 = tcoord1;
-				_process_line(&line);
-			}
-			
-			if(_brcontext->poly_mode == BR_POINT) {
-				_point_t point;
-				point.pos = position0;
-				point.rgba = color0;
-				_process_point(&point);
-				point.pos = position1;
-				point.rgba = color1;
-				_process_point(&point);
-			}
-		}
-		if(ptype == BR_POINTS)
-		{
-			_vertex_t vertex;
-			vertex.type = BR_POINT;
-			vertex.position = position0;
-			vertex.color = &color0;
-			vertex.normals = &normal0;
-			vertex.tcoords = &tcoord0;
-			position0 = _vertex_pass(&vertex);
-			
-			_point_t point;
-			point.pos = position0;
-			point.rgba = color0;
-			_process_point(&point);
-		}
-		
-		v += 1;
-		if(ptype == BR_TRIANGLES)
-		{
-			if(v > 2)
-				v = 0;
-		}
-		if(ptype == BR_LINES)
+	float cx[BR_SPLAT_BATCH_SIZE], cy[BR_SPLAT_BATCH_SIZE], cz[BR_SPLAT_BATCH_SIZE], cw[BR_SPLAT_BATCH_SIZE];
+	if(m)
+	{
+		for(uint32_t i = 0; i < n; i += 1)
 		{
-			if(v > 1)
-				v = 0;
+			cx[i] = m->m00 * x[i] + m->m01 * y[i] + m->m02 * z[i] + m->m03;
+			cy[i] = m->m10 * x[i] + m->m11 * y[i] + m->m12 * z[i] + m->m13;
+			cz[i] = m->m20 * x[i] + m->m21 * y[i] + m->m22 * z[i] + m->m23;
+			cw[i] = m->m30 * x[i] + m->m31 * y[i] + m->m32 * z[i] + m->m33;
 		}
-		if(ptype == BR_POINTS)
-			v = 0;
-			
-		vertex_offset += _brcontext->vertex_stride;
-		color_offset  += _brcontext->color_stride;
-		normal_offset += _brcontext->normal_stride;
-		tcoord_offset += _brcontext->tcoord_stride;
+	}
+	else
+	{
+		for(uint32_t i = 0; i < n; i += 1)
+			cx[i] = x[i], cy[i] = y[i], cz[i] = z[i], cw[i] = 1.0f;
+	}
+	
+	bool clip = _brcontext->clip;
+	for(uint32_t i = 0; i < n; i += 1)
+		culled[i] = clip && (cx[i] < -cw[i] || cx[i] > cw[i] || cy[i] < -cw[i] || cy[i] > cw[i] || cz[i] < -cw[i] || cz[i] > cw[i]);
+	
+	float center_x = _brcontext->viewport_center_x;
+	float center_y = _brcontext->viewport_center_y;
+	float half_width  = _brcontext->viewport_half_width;
+	float half_height = _brcontext->viewport_half_height;
+	bool persp_div = _brcontext->persp_div;
+	for(uint32_t i = 0; i < n; i += 1)
+	{
+		float inv_w = (persp_div && cw[i] != 0.0f) ? 1.0f / cw[i] : 1.0f;
+		x[i] = center_x + ( cx[i] * inv_w * half_width);
+		y[i] = center_y + (-cy[i] * inv_w * half_height);
+		z[i] = cz[i] * inv_w;
+		// points with NaN coordinates are culled too
+		culled[i] = culled[i] || x[i] != x[i] || y[i] != y[i] || z[i] != z[i];
 	}
 }
 
-// draw an array using elements.
-void brDrawElements(uint32_t ptype, uint32_t indices, float* array, uint32_t* elements)
+// draw a point cloud of 'count' one-pixel points. 'positions' holds 3 floats (x,y,z) per point, 'colors'
+// one BR_R8G8B8A8 packed color per point & 'transform' (may be NULL) transforms positions to clip-space.
+// points bypass the vertex & fragment shaders, blending and point size; they are only depth tested.
+// between brBeginPointCloud & brEndPointCloud, points are splatted with a 64-bit atomic min of packed
+// depth & color instead, and brDrawPointCloud may be called from several threads at once.
+void brDrawPointCloud(uint32_t count, float* positions, uint32_t* colors, brmat4* transform)
 {
-	uint32_t v = 0;	// current vertex #
-	brvec4 position0;
-	brvec4 color0;
-	brvec3 normal0;
-	brvec2 tcoord0;
-	brvec4 position1;
-	brvec4 color1;
-	brvec3 normal1;
-	brvec2 tcoord1;
-	brvec4 position2;
-	brvec4 color2;
-	brvec3 normal2;
-	brvec2 tcoord2;
+	if(!_brcontext || !positions || !colors)
+		return;
 	
-	void* vertex_offset;
-	void* color_offset;
-	void* normal_offset;
-	void* tcoord_offset;
+	bool splat = _brcontext->splat_buffer != NULL;
+	bool depth_test = (_brcontext->depth_test && _brcontext->db);
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
+	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
+	uint32_t width  = splat ? _brcontext->splat_width : _brcontext->rb_width;
+	uint32_t pitch  = _brcontext->rb_pitch;
+	float clip_x0 = _brcontext->clip_x0, clip_y0 = _brcontext->clip_y0;
+	float clip_x1 = _brcontext->clip_x1, clip_y1 = _brcontext->clip_y1;
+	if(splat)
+	{
+		// splats stay within the renderbuffer splatting began with
+		if(clip_x1 > _brcontext->splat_width)	clip_x1 = _brcontext->splat_width;
+		if(clip_y1 > _brcontext->splat_height)	clip_y1 = _brcontext->splat_height;
+	}
+	uint64_t samples = 0;
+	
+	float x[BR_SPLAT_BATCH_SIZE], y[BR_SPLAT_BATCH_SIZE], z[BR_SPLAT_BATCH_SIZE];
+	bool culled[BR_SPLAT_BATCH_SIZE];
 	
-	for(uint32_t i = 0; i < indices; i += 1)
+	for(uint32_t first = 0; first < count; first += BR_SPLAT_BATCH_SIZE)
 	{
-		vertex_offset = _brcontext->vertex_offset + (_brcontext->vertex_stride*elements[i]);
-		color_offset  = _brcontext->color_offset  + (_brcontext->color_stride*elements[i]);
-		normal_offset = _brcontext->normal_offset + (_brcontext->normal_stride*elements[i]);
-		tcoord_offset = _brcontext->tcoord_offset + (_brcontext->tcoord_stride*elements[i]);
-		
-		// load to vertex
-		if(v == 0) {
-			position0 = { 0, 0, 0, 1 };
-			color0    = { 0, 0, 0, 1 };
-			normal0   = { 0, 0, 0 };
-			tcoord0   = { 0, 0 };
-			
-			if(_brcontext->vertex_array) {
-				if(_brcontext->vertex_count == 2)
-					position0 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						position0.z, position0.w };
-				if(_brcontext->vertex_count == 3)
-					position0 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						position0.w };
-				if(_brcontext->vertex_count == 4)
-					position0 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->color_array) {
-				if(_brcontext->color_count == 3)
-					color0 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
-						color0.w };
-				if(_brcontext->color_count == 4)
-					color0 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->normal_array) {
-				normal0 = { *(float*)((void*)array + (size_t)normal_offset),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
-			}
-			if(_brcontext->tcoord_array) {
-				tcoord0 = { *(float*)((void*)array + (size_t)tcoord_offset),
-					*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
-			}
-		}
-		if(v == 1) {
-			position1 = { 0, 0, 0, 1 };
-			color1    = { 0, 0, 0, 1 };
-			normal1   = { 0, 0, 0 };
-			tcoord1   = { 0, 0 };
-			
-			if(_brcontext->vertex_array) {
-				if(_brcontext->vertex_count == 2)
-					position1 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						position1.z, position1.w };
-				if(_brcontext->vertex_count == 3)
-					position1 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						position1.w };
-				if(_brcontext->vertex_count == 4)
-					position1 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->color_array) {
-				if(_brcontext->color_count == 3)
-					color1 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
-						color1.w };
-				if(_brcontext->color_count == 4)
-					color1 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->normal_array) {
-				normal1 = { *(float*)((void*)array + (size_t)normal_offset),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
-			}
-			if(_brcontext->tcoord_array) {
-				tcoord1 = { *(float*)((void*)array + (size_t)tcoord_offset),
-					*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
-			}
-		}
-		if(v == 2) {
-			position2 = { 0, 0, 0, 1 };
-			color2    = { 0, 0, 0, 1 };
-			normal2   = { 0, 0, 0 };
-			tcoord2   = { 0, 0 };
-			
-			if(_brcontext->vertex_array) {
-				if(_brcontext->vertex_count == 2)
-					position2 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						position2.z, position2.w };
-				if(_brcontext->vertex_count == 3)
-					position2 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						position2.w };
-				if(_brcontext->vertex_count == 4)
-					position2 = { *(float*)((void*)array + (size_t)vertex_offset),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)vertex_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->color_array) {
-				if(_brcontext->color_count == 3)
-					color2 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2), 
-						color2.w };
-				if(_brcontext->color_count == 4)
-					color2 = { *(float*)((void*)array + (size_t)color_offset),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*2),
-						*(float*)((void*)array + (size_t)color_offset + sizeof(float)*3) };
-			}
-			if(_brcontext->normal_array) {
-				normal2 = { *(float*)((void*)array + (size_t)normal_offset),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)),
-					*(float*)((void*)array + (size_t)normal_offset + sizeof(float)*2) };
-			}
-			if(_brcontext->tcoord_array) {
-				tcoord2 = { *(float*)((void*)array + (size_t)tcoord_offset),
-					*(float*)((void*)array + (size_t)tcoord_offset + sizeof(float)) };
-			}
-		}
+		uint32_t n = count - first < BR_SPLAT_BATCH_SIZE ? count - first : BR_SPLAT_BATCH_SIZE;
+		float* p = positions + first * 3;
+		for(uint32_t i = 0; i < n; i += 1)
+			x[i] = p[i*3], y[i] = p[i*3+1], z[i] = p[i*3+2];
+		_transform_splat_batch(n, x, y, z, culled, transform);
 		
-		if(ptype == BR_TRIANGLES && v == 2)
+		for(uint32_t i = 0; i < n; i += 1)
 		{
-			_vertex_t vertex;
-			vertex.type = BR_TRIANGLE;
-			vertex.position = position0;
-			vertex.color = &color0;
-			vertex.normals = &normal0;
-			vertex.tcoords = &tcoord0;
-			position0 = _vertex_pass(&vertex);
-			
-			vertex.position = position1;
-			vertex.color = &color1;
-			vertex.normals = &normal1;
-			vertex.tcoords = &tcoord1;
-			position1 = _vertex_pass(&vertex);
-			
-			vertex.position = position2;
-			vertex.color = &color2;
-			vertex.normals = &normal2;
-			vertex.tcoords = &tcoord2;
-			position2 = _vertex_pass(&vertex);
-			
-			if(_brcontext->poly_mode == BR_FILL) {
-				_triangle_t tri;
-				tri.v0 = position0;
-				tri.v1 = position1;
-				tri.v2 = position2;
-				tri.rgba0 = color0;
-				tri.rgba1 = color1;
-				tri.rgba2 = color2;
-				tri.tcoords0 = tcoord0;
-				tri.tcoords1 = tcoord1;
-				tri.tcoords2 = tcoord2;
-				tri.parent = NULL;
-				_process_triangle(&tri);
-			}
+			if(culled[i] || !(x[i] >= clip_x0 && y[i] >= clip_y0 && x[i] < clip_x1 && y[i] < clip_y1))
+				continue;
+			uint32_t pixel_index = (uint32_t)y[i] * pitch + (uint32_t)x[i];
+			uint32_t color = colors[first + i];
 			
-			if(_brcontext->poly_mode == BR_LINE) {
-				_line_t line;
-				line.v0 = position0;
-				line.v1 = position1;
-				line.rgba0 = color0;
-				line.rgba1 = color1;
-				line.tcoords0 = tcoord0;
-				line.tcoords1 = tcoord1;
-				_process_line(&line);
-				line.v0 = position1;
-				line.v1 = position2;
-				line.rgba0 = color1;
-				line.rgba1 = color2;
-				line.tcoords0 = tcoord1;
-				line.tcoords1 = tcoord2;
-				_process_line(&line);
-				line.v0 = position2;
-				line.v1 = position0;
-				line.rgba0 = color2;
-				line.rgba1 = color0;
-				line.tcoords0 = tcoord2;
-				line.tcoords1 = tcoord0;
-				_process_line(&line);
+			int64_t depth = 0;
+			if(_brcontext->db)
+			{
+				depth = _convert_depth(z[i]);
+				if(!_is_valid_depth(depth))
+					continue;
 			}
 			
-			if(_brcontext->poly_mode == BR_POINT) {
-				_point_t point;
-				point.pos = position0;
-				point.rgba = color0;
-				_process_point(&point);
-				point.pos = position1;
-				point.rgba = color1;
-				_process_point(&point);
-				point.pos = position2;
-				point.rgba = color2;
-				_process_point(&point);
+			if(splat)
+			{
+				// keep the closest point; ties go to the smaller color. a depth of all ones is reserved
+				// for empty pixels, so the farthest 32-bit depth is splatted one closer.
+				if(depth == 0xFFFFFFFF)
+					depth = 0xFFFFFFFE;
+				uint64_t value = ((uint64_t)depth << 32) | color;
+				uint64_t* dst = &_brcontext->splat_buffer[(uint32_t)y[i] * width + (uint32_t)x[i]];
+				uint64_t old = __atomic_load_n(dst, __ATOMIC_RELAXED);
+				while(value < old && !__atomic_compare_exchange_n(dst, &old, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+				continue;
 			}
-		}
-		if(ptype == BR_LINES && v == 1)
-		{
-			_vertex_t vertex;
-			vertex.type = BR_LINE;
-			vertex.position = position0;
-			vertex.color = &color0;
-			vertex.normals = &normal0;
-			vertex.tcoords = &tcoord0;
-			position0 = _vertex_pass(&vertex);
-			
-			vertex.position = position1;
-			vertex.color = &color1;
-			vertex.normals = &normal1;
-			vertex.tcoords = &tcoord1;
-			position1 = _vertex_pass(&vertex);
 			
-			if(_brcontext->poly_mode == BR_FILL
-			|| _brcontext->poly_mode == BR_LINE) {
-				_line_t line;
-				line.v0 = position0;
-				line.v1 = position1;
-				line.rgba0 = color0;
-				line.rgba1 = color1;
-				line.tcoords0 = tcoord0;
-				line.tcoords1 = tcoord1;
-				_process_line(&line);
-			}
+			if(depth_test && depth > _get_depth(pixel_index))
+				continue;
 			
-			if(_brcontext->poly_mode == BR_POINT) {
-				_point_t point;
-				point.pos = position0;
-				point.rgba = color0;
-				_process_point(&point);
-				point.pos = position1;
-				point.rgba = color1;
-				_process_point(&point);
+			samples += 1;
+			_touch_bounds(x[i], y[i], x[i], y[i]);
+			if(plot_color)
+			{
+				brvec4ui rgba = { _BR_FROM8(_BR_R8G8B8A8_R(color)), _BR_FROM8(_BR_R8G8B8A8_G(color)),
+					_BR_FROM8(_BR_R8G8B8A8_B(color)), _BR_FROM8(_BR_R8G8B8A8_A(color)) };
+				_plot_pixel(pixel_index, rgba, false);
 			}
+			if(plot_depth)
+				_plot_depth(pixel_index, depth);
 		}
-		if(ptype == BR_POINTS)
-		{
-			_vertex_t vertex;
-			vertex.type = BR_POINT;
-			vertex.position = position0;
-			vertex.color = &color0;
-			vertex.normals = &normal0;
-			vertex.tcoords = &tcoord0;
-			position0 = _vertex_pass(&vertex);
-			
-			_point_t point;
-			point.pos = position0;
-			point.rgba = color0;
-			_process_point(&point);
-		}
+	}
+	// splats are accounted by brEndPointCloud; the context mustn't be written while splatting
+	if(splat)
+		return;
+	_damage_draw();
+	
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
+}
+
+// begin splatting point clouds (see brDrawPointCloud) for the bound renderbuffer.
+void brBeginPointCloud()
+{
+	if(!_brcontext)
+		return;
+	
+	size_t size = (size_t)_brcontext->rb_width * _brcontext->rb_height * sizeof(uint64_t);
+	if(!size)
+		return;
+	if(size != _brcontext->splat_size)
+	{
+		_br_free(_brcontext->splat_storage);
+		_brcontext->splat_storage = (uint64_t*) _br_malloc(size);
+		_brcontext->splat_size = _brcontext->splat_storage ? size : 0;
+		if(!_brcontext->splat_storage)
+			return;
+	}
+	
+	// a depth of all ones is an empty pixel
+	memset(_brcontext->splat_storage, 0xFF, size);
+	_brcontext->splat_buffer = _brcontext->splat_storage;
+	_brcontext->splat_width = _brcontext->rb_width;
+	_brcontext->splat_height = _brcontext->rb_height;
+}
+
+// end splatting point clouds, depth testing the closest point of each pixel against the bound
+// renderbuffer & plotting it. all brDrawPointCloud calls must have returned.
+void brEndPointCloud()
+{
+	if(!_brcontext || !_brcontext->splat_buffer)
+		return;
+	
+	uint64_t* splats = _brcontext->splat_buffer;
+	_brcontext->splat_buffer = NULL;
+	
+	bool depth_test = (_brcontext->depth_test && _brcontext->db);
+	bool plot_color = (_brcontext->color_write && _brcontext->cb);
+	bool plot_depth = (_brcontext->depth_write && _brcontext->db);
+	uint32_t width  = _brcontext->splat_width;
+	uint32_t pitch  = _brcontext->rb_pitch;
+	uint64_t samples = 0;
+	
+	// splats outside the clip rect were never drawn. the splatted area is limited to the renderbuffer
+	// splatting began with, in case another of a different size has been bound since.
+	uint32_t x1 = (uint32_t)_brcontext->clip_x1 < width ? (uint32_t)_brcontext->clip_x1 : width;
+	uint32_t y1 = (uint32_t)_brcontext->clip_y1 < _brcontext->splat_height ? (uint32_t)_brcontext->clip_y1 : _brcontext->splat_height;
+	for(uint32_t y = _brcontext->clip_y0; y < y1; y += 1)
+	for(uint32_t x = _brcontext->clip_x0; x < x1; x += 1)
+	{
+		uint64_t value = splats[y * width + x];
+		if((value >> 32) == 0xFFFFFFFF)
+			continue;
+		uint32_t pixel_index = y * pitch + x;
 		
-		v += 1;
-		if(ptype == BR_TRIANGLES)
-		{
-			if(v > 2)
-				v = 0;
-		}
-		if(ptype == BR_LINES)
+		int64_t depth = value >> 32;
+		uint32_t color = value & 0xFFFFFFFF;
+		if(depth_test && depth > _get_depth(pixel_index))
+			continue;
+		
+		samples += 1;
+		_touch_bounds(x, y, x, y);
+		if(plot_color)
 		{
-			if(v > 1)
-				v = 0;
+			brvec4ui rgba = { _BR_FROM8(_BR_R8G8B8A8_R(color)), _BR_FROM8(_BR_R8G8B8A8_G(color)),
+				_BR_FROM8(_BR_R8G8B8A8_B(color)), _BR_FROM8(_BR_R8G8B8A8_A(color)) };
+			_plot_pixel(pixel_index, rgba, false);
 		}
-		if(ptype == BR_POINTS)
-			v = 0;
+		if(plot_depth)
+			_plot_depth(pixel_index, depth);
+	}
+	_damage_draw();
+	
+	if(_brcontext->query_samples)
+		_brcontext->samples_passed += samples;
+}
+
+// begin a query. results are reset & gathered until brEndQuery.
+// BR_SAMPLES_PASSED counts samples passing the depth test (occlusion query).
+// (BR_PIPELINE_STATISTICS gathers nothing unless BR_ENABLE_STATISTICS is defined)
+void brBeginQuery(uint32_t target)
+{
+	if(!_brcontext)
+		return;
+	
+	if(target == BR_PIPELINE_STATISTICS)
+	{
+		memset(&_brcontext->statistics, 0, sizeof(brstatistics));
+		_brcontext->query_statistics = true;
 	}
+	if(target == BR_SAMPLES_PASSED)
+	{
+		_brcontext->samples_passed = 0;
+		_brcontext->query_samples = true;
+	}
+}
+
+// end a query.
+void brEndQuery(uint32_t target)
+{
+	if(!_brcontext)
+		return;
+	
+	if(target == BR_PIPELINE_STATISTICS)
+		_brcontext->query_statistics = false;
+	if(target == BR_SAMPLES_PASSED)
+		_brcontext->query_samples = false;
+}
+
+// get the result of the current (or last) query.
+// for BR_PIPELINE_STATISTICS, ret is a brstatistics*; for BR_SAMPLES_PASSED, ret is a uint64_t*.
+void brGetQueryResult(uint32_t target, void* ret)
+{
+	if(!_brcontext || !ret)
+		return;
+	
+	if(target == BR_PIPELINE_STATISTICS)
+	{
+		brstatistics stats = _brcontext->statistics;
+		// setup is whatever is left of the draw after vertex shading & rasterization
+		uint64_t timed = stats.vertex_ns + stats.raster_ns;
+		stats.setup_ns = stats.draw_ns > timed ? stats.draw_ns - timed : 0;
+		*(brstatistics*)ret = stats;
+	}
+	if(target == BR_SAMPLES_PASSED)
+		*(uint64_t*)ret = _brcontext->samples_passed;
 }
 
 // query state.
@@ -4662,6 +7611,8 @@ void brGetState(uint32_t type, uint32_t state, void* ret)
 	{
 		if(state == BR_CONTEXT_ADDRESS)
 			*(void**)ret = _brcontext;
+		if(state == BR_JOB_THREADS)
+			*(uint32_t*)ret = _brjobs ? _brjobs->count + 1 : _brjob_threads;
 		return;
 	}
 	if(!_brcontext)
@@ -4692,6 +7643,9 @@ void brGetState(uint32_t type, uint32_t state, void* ret)
 				a[0] = _brcontext->rb_width;
 				a[1] = _brcontext->rb_height;
 				break;
+			case BR_FRONT_PITCH:
+				*(uint32_t*)ret = _brcontext->rb_pitch;
+				break;
 			case BR_BACK_COLOR_TYPE:
 				if(_brcontext->cb2)
 					*(uint32_t*)ret = _brcontext->cb2_type;
@@ -4711,6 +7665,9 @@ void brGetState(uint32_t type, uint32_t state, void* ret)
 				a[0] = _brcontext->rb2_width;
 				a[1] = _brcontext->rb2_height;
 				break;
+			case BR_BACK_PITCH:
+				*(uint32_t*)ret = _brcontext->rb2_pitch;
+				break;
 			case BR_CLEAR_COLOR:
 				*(brvec4*)ret = _brcontext->clear_color;
 				break;
@@ -4727,6 +7684,18 @@ void brGetState(uint32_t type, uint32_t state, void* ret)
 			case BR_POINT_SIZE:
 				*(float*)ret = _brcontext->point_radius;
 				break;
+			case BR_LINE_WIDTH:
+				*(float*)ret = _brcontext->line_width;
+				break;
+			case BR_SAMPLE_COUNT:
+				*(uint32_t*)ret = _brcontext->sample_count;
+				break;
+			case BR_VIEWPORT:
+				*(brrect*)ret = _brcontext->viewport;
+				break;
+			case BR_SCISSOR_BOX:
+				*(brrect*)ret = _brcontext->scissor_rect;
+				break;
 			case BR_CULL_WINDING:
 				*(uint32_t*)ret = _brcontext->cull_winding;
 				break;
@@ -4739,6 +7708,18 @@ void brGetState(uint32_t type, uint32_t state, void* ret)
 			case BR_FRAGMENT_SHADER_ADDRESS:
 				*(void**)ret = (void*) _brcontext->fshader;
 				break;
+			case BR_BLEND_SRC:
+				*(uint32_t*)ret = _brcontext->blend_src;
+				break;
+			case BR_BLEND_DST:
+				*(uint32_t*)ret = _brcontext->blend_dst;
+				break;
+			case BR_BLEND_EQUATION:
+				*(uint32_t*)ret = _brcontext->blend_eq;
+				break;
+			case BR_PRIMITIVE_RESTART_INDEX:
+				*(uint32_t*)ret = _brcontext->restart_index;
+				break;
 		}
 	}
 	
@@ -4778,6 +7759,19 @@ void brGetState(uint32_t type, uint32_t state, void* ret)
 				break;
 		}
 	}
+	
+	if(type == BR_MEMORY_STATE)
+	{
+		switch(state)
+		{
+			case BR_ALLOCATED_BYTES:
+				*(uint64_t*)ret = __atomic_load_n(&_brcontext->account->allocated_bytes, __ATOMIC_RELAXED);
+				break;
+			case BR_PEAK_ALLOCATED_BYTES:
+				*(uint64_t*)ret = __atomic_load_n(&_brcontext->account->peak_allocated_bytes, __ATOMIC_RELAXED);
+				break;
+		}
+	}
 }
 
 // get an identity matrix.
@@ -4803,10 +7797,80 @@ brmat4 brIdentity()
 	return id;
 }
 
+// 4-wide vectors for matrix math. products are sums of rows (or columns) scaled by broadcast elements, added in
+// the same order as the scalar code, so both give identical results as long as the compiler doesn't contract
+// the scalar code to fused multiply-adds.
+#if defined(__SSE2__)
+#define _BR_SIMD_MATH
+typedef __m128 _br_f4;
+#define _BR_LOAD4(p)		_mm_loadu_ps(p)
+#define _BR_STORE4(p,v)		_mm_storeu_ps(p, v)
+#define _BR_LANE4(v,i)		_mm_shuffle_ps(v, v, _MM_SHUFFLE(i,i,i,i))
+#define _BR_ADD4(a,b)		_mm_add_ps(a, b)
+#define _BR_MUL4(a,b)		_mm_mul_ps(a, b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define _BR_SIMD_MATH
+typedef float32x4_t _br_f4;
+#define _BR_LOAD4(p)		vld1q_f32(p)
+#define _BR_STORE4(p,v)		vst1q_f32(p, v)
+#define _BR_LANE4(v,i)		vdupq_n_f32(vgetq_lane_f32(v, i))
+#define _BR_ADD4(a,b)		vaddq_f32(a, b)
+#define _BR_MUL4(a,b)		vmulq_f32(a, b)
+#endif
+
+#ifdef _BR_SIMD_MATH
+// (x*c0 + y*c1) + z*c2 + w*c3, where x,y,z,w are the elements of 'v'.
+static inline _br_f4 _combine4(_br_f4 v, _br_f4 c0, _br_f4 c1, _br_f4 c2, _br_f4 c3)
+{
+	return _BR_ADD4(_BR_ADD4(_BR_ADD4(_BR_MUL4(_BR_LANE4(v,0), c0), _BR_MUL4(_BR_LANE4(v,1), c1)),
+		_BR_MUL4(_BR_LANE4(v,2), c2)), _BR_MUL4(_BR_LANE4(v,3), c3));
+}
+
+// p = a * b, of row-major matrices; 'p' may be 'a' or 'b'. each row of p is the rows of b scaled by a row of a.
+void _mat4_mul(const float* a, const float* b, float* p)
+{
+#ifdef __AVX__
+	// two rows at once
+	__m256 b0 = _mm256_broadcast_ps((const __m128*)(b));
+	__m256 b1 = _mm256_broadcast_ps((const __m128*)(b+4));
+	__m256 b2 = _mm256_broadcast_ps((const __m128*)(b+8));
+	__m256 b3 = _mm256_broadcast_ps((const __m128*)(b+12));
+	for(uint32_t i = 0; i < 16; i += 8)
+	{
+		__m256 r = _mm256_loadu_ps(a + i);
+		r = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(r, 0x00), b0),
+			_mm256_mul_ps(_mm256_permute_ps(r, 0x55), b1)), _mm256_mul_ps(_mm256_permute_ps(r, 0xAA), b2)),
+			_mm256_mul_ps(_mm256_permute_ps(r, 0xFF), b3));
+		_mm256_storeu_ps(p + i, r);
+	}
+#else
+	_br_f4 b0 = _BR_LOAD4(b), b1 = _BR_LOAD4(b+4), b2 = _BR_LOAD4(b+8), b3 = _BR_LOAD4(b+12);
+	for(uint32_t i = 0; i < 16; i += 4)
+		_BR_STORE4(p + i, _combine4(_BR_LOAD4(a + i), b0, b1, b2, b3));
+#endif
+}
+
+// get the columns of a row-major matrix.
+void _mat4_columns(const float* m, _br_f4* c)
+{
+#if defined(__SSE2__)
+	__m128 r0 = _mm_loadu_ps(m), r1 = _mm_loadu_ps(m+4), r2 = _mm_loadu_ps(m+8), r3 = _mm_loadu_ps(m+12);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	c[0] = r0, c[1] = r1, c[2] = r2, c[3] = r3;
+#else
+	float32x4x4_t t = vld4q_f32(m);
+	c[0] = t.val[0], c[1] = t.val[1], c[2] = t.val[2], c[3] = t.val[3];
+#endif
+}
+#endif
+
 // multiply matrix a * b.
 brmat4 brMat4Mat4(brmat4 a, brmat4 b)
 {
 	brmat4 p;
+#ifdef _BR_SIMD_MATH
+	_mat4_mul(&a.m00, &b.m00, &p.m00);
+#else
 	p.m00 = a.m00*b.m00 + a.m01*b.m10 + a.m02*b.m20 + a.m03*b.m30;
 	p.m01 = a.m00*b.m01 + a.m01*b.m11 + a.m02*b.m21 + a.m03*b.m31;
 	p.m02 = a.m00*b.m02 + a.m01*b.m12 + a.m02*b.m22 + a.m03*b.m32;
@@ -4823,6 +7887,7 @@ brmat4 brMat4Mat4(brmat4 a, brmat4 b)
 	p.m31 = a.m30*b.m01 + a.m31*b.m11 + a.m32*b.m21 + a.m33*b.m31;
 	p.m32 = a.m30*b.m02 + a.m31*b.m12 + a.m32*b.m22 + a.m33*b.m32;
 	p.m33 = a.m30*b.m03 + a.m31*b.m13 + a.m32*b.m23 + a.m33*b.m33;	
+#endif
 	return p;
 }
 
@@ -4830,13 +7895,67 @@ brmat4 brMat4Mat4(brmat4 a, brmat4 b)
 brvec4 brMat4Vec4(brmat4 m, brvec4 v)
 {
 	brvec4 prod;
+#ifdef _BR_SIMD_MATH
+	_br_f4 c[4];
+	_mat4_columns(&m.m00, c);
+	_BR_STORE4(&prod.x, _combine4(_BR_LOAD4(&v.x), c[0], c[1], c[2], c[3]));
+#else
 	prod.x = m.m00 * v.x + m.m01 * v.y + m.m02 * v.z + m.m03 * v.w;
 	prod.y = m.m10 * v.x + m.m11 * v.y + m.m12 * v.z + m.m13 * v.w;
 	prod.z = m.m20 * v.x + m.m21 * v.y + m.m22 * v.z + m.m23 * v.w;
 	prod.w = m.m30 * v.x + m.m31 * v.y + m.m32 * v.z + m.m33 * v.w;
+#endif
 	return prod;
 }
 
+// multiply 'count' vectors by one matrix: out[i] = m * in[i]; 'out' may be 'in'. e.g. skinning or culling
+// many points by one transform. arrays of brvec4a are best.
+void brMat4Vec4Array(brmat4* m, brvec4* in, brvec4* out, uint32_t count)
+{
+	if(!m || !in || !out)
+		return;
+	uint32_t i = 0;
+#ifdef _BR_SIMD_MATH
+	_br_f4 c[4];
+	_mat4_columns(&m->m00, c);
+#ifdef __AVX__
+	// two vectors at once
+	__m256 c0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[0]), c[0], 1);
+	__m256 c1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[1]), c[1], 1);
+	__m256 c2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[2]), c[2], 1);
+	__m256 c3 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[3]), c[3], 1);
+	for(; i + 2 <= count; i += 2)
+	{
+		__m256 v = _mm256_loadu_ps(&in[i].x);
+		v = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(v, 0x00), c0),
+			_mm256_mul_ps(_mm256_permute_ps(v, 0x55), c1)), _mm256_mul_ps(_mm256_permute_ps(v, 0xAA), c2)),
+			_mm256_mul_ps(_mm256_permute_ps(v, 0xFF), c3));
+		_mm256_storeu_ps(&out[i].x, v);
+	}
+#endif
+	for(; i < count; i += 1)
+		_BR_STORE4(&out[i].x, _combine4(_BR_LOAD4(&in[i].x), c[0], c[1], c[2], c[3]));
+#endif
+	for(; i < count; i += 1)
+		out[i] = brMat4Vec4(*m, in[i]);
+}
+
+// multiply 'count' pairs of matrices: out[i] = a[i] * b[i]; 'out' may be 'a' or 'b'. e.g. concatenating the
+// transforms of a scene graph's nodes. arrays of brmat4a are best.
+void brMat4Mat4Array(brmat4* a, brmat4* b, brmat4* out, uint32_t count)
+{
+	if(!a || !b || !out)
+		return;
+	for(uint32_t i = 0; i < count; i += 1)
+	{
+#ifdef _BR_SIMD_MATH
+		_mat4_mul(&a[i].m00, &b[i].m00, &out[i].m00);
+#else
+		out[i] = brMat4Mat4(a[i], b[i]);
+#endif
+	}
+}
+
 // calculate a symmetrical-frustum projection matrix, foyv provided in degrees.
 brmat4 brPerspective(float fovy, float aspect, float near, float far)
 {
@@ -4868,6 +7987,103 @@ brmat4 brFrustum(float left, float right, float top, float bottom, float near, f
 	return m;
 }
 
+// get the 6 planes (a,b,c,d) of the frustum of a transform to clip-space; points within have a*x + b*y + c*z + d >= 0.
+// planes are normalized, so distances are in the units of the transform's input.
+void _frustum_planes(brmat4* m, float planes[6][4])
+{
+	float rows[4][4] = {
+		{ m->m00, m->m01, m->m02, m->m03 },
+		{ m->m10, m->m11, m->m12, m->m13 },
+		{ m->m20, m->m21, m->m22, m->m23 },
+		{ m->m30, m->m31, m->m32, m->m33 } };
+	// -w <= x, y, z <= w: left & right, bottom & top, near & far
+	for(uint32_t i = 0; i < 6; i += 1)
+	{
+		float sign = (i & 1) ? -1.0f : 1.0f;
+		for(uint32_t j = 0; j < 4; j += 1)
+			planes[i][j] = rows[3][j] + sign * rows[i >> 1][j];
+		float length = sqrt(planes[i][0]*planes[i][0] + planes[i][1]*planes[i][1] + planes[i][2]*planes[i][2]);
+		float inv = length > 0.0f ? 1.0f / length : 1.0f;
+		for(uint32_t j = 0; j < 4; j += 1)
+			planes[i][j] *= inv;
+	}
+}
+
+// get the visibility bits of a block of up to 32 bounding volumes centered at 'x', 'y' & 'z': spheres of
+// radii 'r' or, when 'ex' isn't NULL, boxes of half extents 'ex', 'ey' & 'ez' ('r' then receives each box's
+// radius along a plane). a volume is culled when it is wholly outside of a plane. loops run over the whole
+// block so that they vectorize.
+uint32_t _cull_batch(uint32_t n, float planes[6][4], float* x, float* y, float* z, float* r, float* ex, float* ey, float* ez)
+{
+	bool inside[32];
+	for(uint32_t i = 0; i < n; i += 1)
+		inside[i] = true;
+	for(uint32_t p = 0; p < 6; p += 1)
+	{
+		float a = planes[p][0], b = planes[p][1], c = planes[p][2], d = planes[p][3];
+		if(ex)
+		{
+			float abs_a = fabs(a), abs_b = fabs(b), abs_c = fabs(c);
+			for(uint32_t i = 0; i < n; i += 1)
+				r[i] = abs_a*ex[i] + abs_b*ey[i] + abs_c*ez[i];
+		}
+		for(uint32_t i = 0; i < n; i += 1)
+			inside[i] &= a*x[i] + b*y[i] + c*z[i] + d >= -r[i];
+	}
+	
+	uint32_t mask = 0;
+	for(uint32_t i = 0; i < n; i += 1)
+		mask |= (uint32_t)inside[i] << i;
+	return mask;
+}
+
+// frustum cull 'count' bounding spheres, 4 floats (x,y,z,radius) each, against the frustum of 'transform'
+// (e.g. a brPerspective or brFrustum projection times the view & model matrices) before drawing what they bound.
+// bit i % 32 of visible[i / 32] is set when sphere i may be visible; 'visible' holds (count + 31) / 32 words.
+// spheres are tested 32 at a time.
+void brCullSpheres(uint32_t count, float* spheres, brmat4* transform, uint32_t* visible)
+{
+	if(!spheres || !transform || !visible)
+		return;
+	
+	float planes[6][4];
+	_frustum_planes(transform, planes);
+	float x[32], y[32], z[32], r[32];
+	for(uint32_t first = 0; first < count; first += 32)
+	{
+		uint32_t n = count - first < 32 ? count - first : 32;
+		float* s = spheres + first * 4;
+		for(uint32_t i = 0; i < n; i += 1)
+			x[i] = s[i*4], y[i] = s[i*4+1], z[i] = s[i*4+2], r[i] = s[i*4+3];
+		visible[first / 32] = _cull_batch(n, planes, x, y, z, r, NULL, NULL, NULL);
+	}
+}
+
+// frustum cull 'count' axis-aligned bounding boxes, 6 floats (min x,y,z then max x,y,z) each, against the
+// frustum of 'transform' (see brCullSpheres). bit i % 32 of visible[i / 32] is set when box i may be visible.
+// boxes are tested 32 at a time.
+void brCullAABBs(uint32_t count, float* boxes, brmat4* transform, uint32_t* visible)
+{
+	if(!boxes || !transform || !visible)
+		return;
+	
+	float planes[6][4];
+	_frustum_planes(transform, planes);
+	float x[32], y[32], z[32], r[32], ex[32], ey[32], ez[32];
+	for(uint32_t first = 0; first < count; first += 32)
+	{
+		uint32_t n = count - first < 32 ? count - first : 32;
+		float* b = boxes + first * 6;
+		for(uint32_t i = 0; i < n; i += 1)
+		{
+			x[i] = (b[i*6]   + b[i*6+3]) * 0.5f, ex[i] = (b[i*6+3] - b[i*6])   * 0.5f;
+			y[i] = (b[i*6+1] + b[i*6+4]) * 0.5f, ey[i] = (b[i*6+4] - b[i*6+1]) * 0.5f;
+			z[i] = (b[i*6+2] + b[i*6+5]) * 0.5f, ez[i] = (b[i*6+5] - b[i*6+2]) * 0.5f;
+		}
+		visible[first / 32] = _cull_batch(n, planes, x, y, z, r, ex, ey, ez);
+	}
+}
+
 // calculate a look-at matrix.
 brmat4 brLookAt(brvec3 eye, brvec3 center, brvec3 up)
 {
@@ -50,6 +50,8 @@
 // RL_COLOR_ARRAY : vertex RGBA, default (0,0,0,1)
 // RL_NORMAL_ARRAY : vertex normals, default (0,0,0)
 // RL_TEXCOORD_ARRAY : texture coordinates, default (0,0)
+// RL_INSTANCE_ID : index of the instance being drawn, 0 for non-instanced draws.
+// RL_INSTANCE_ARRAY : per-instance attribute (up to 4 floats from the instance array), default (0,0,0,1)
 //
 // Fragment attributes:
 // RL_PRIMITIVE_TYPE : primitive type. This will be RL_TRIANGLE, RL_POINT or RL_LINE (affected by polygon mode).
@@ -75,6 +77,8 @@
 //    RL_COLOR_ARRAY is rlVec4, which takes up 16 bytes.
 //    RL_NORMAL_ARRAY is rlVec3, which takes up 12 bytes.
 //    RL_TEXCOORD_ARRAY is rlVec2, which takes up 8 bytes.
+//    RL_INSTANCE_ID is uint32, which takes up 4 bytes.
+//    RL_INSTANCE_ARRAY is rlVec4, which takes up 16 bytes.
 //
 //    Fragment shader:
 //    RL_PRIMITVE_TYPE is uint32, which takes up 4 bytes.
@@ -108,6 +112,23 @@
 #include <stdbool.h>
 #include <limits.h>
 #include <math.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#define RL_HUGE_PAGE_SIZE	(2*1024*1024)	/* allocations this size or larger use huge pages with rlHugePageAllocator */
+
+#define RL_STREAM_VERTICES	64		/* vertices read at a time by single instance draws */
 
 // toggled states
 #define RL_PERSPECTIVE_CORRECTION	0x01	/* generate perspective corrected barycentric coordinates */
@@ -145,6 +166,10 @@
 #define RL_TRIANGLES	0x1B			// denotes triangle descriptions
 #define RL_LINES		0x1C			// denotes line descriptions
 #define RL_POINTS		0x1D			// denotes point descriptions
+#define RL_TRIANGLE_STRIP	0x3C		// denotes a strip of triangles; each vertex after the second adds a triangle
+#define RL_TRIANGLE_FAN		0x3D		// denotes a fan of triangles around the first vertex
+#define RL_LINE_STRIP		0x3E		// denotes a strip of lines; each vertex after the first adds a line
+#define RL_LINE_LOOP		0x3F		// denotes a line strip closed back to its first vertex
 
 // triangle windings
 #define RL_CW  0x1E
@@ -186,6 +211,15 @@
 #define RL_FRONT_BUFFERS	0x38
 #define RL_BACK_BUFFERS 	0x39
 
+// instancing; vertex shader attributes
+#define RL_INSTANCE_ID		0x3A	/* index of the instance being drawn */
+#define RL_INSTANCE_ARRAY	0x3B	/* per-instance attribute */
+
+// index array (element) types
+#define RL_UNSIGNED_BYTE	0x40
+#define RL_UNSIGNED_SHORT	0x41
+#define RL_UNSIGNED_INT		0x42
+
 // bit flags
 #define RL_DEPTH_BUFFER_BIT		0x40000000 
 #define RL_COLOR_BUFFER_BIT		0x20000000
@@ -217,6 +251,7 @@ typedef struct rlVec4ui rlVec4ui;
 typedef struct rlVec3ui rlVec3ui;
 typedef struct rlVec2ui rlVec2ui;
 typedef struct _rlcore_t _rlcore_t;
+typedef struct rlAllocator rlAllocator;
 
 /* allocate, initialize and return a context */
 _rlcore_t* rlCreateContext();
@@ -226,6 +261,12 @@ void rlBindContext(_rlcore_t* context);
 void rlDrawArray(uint32_t primitive_type, uint32_t primitive_count, float* data);
 /* draw primitives described by an array and an index array */
 void rlDrawElements(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t* elements);
+/* draw primitives described by an array instance_count times. instance_data holds instance_width floats per instance (may be NULL) */
+void rlDrawArrayInstanced(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t instance_count, float* instance_data, uint32_t instance_width);
+/* draw primitives described by an array and an index array of type RL_UNSIGNED_BYTE, RL_UNSIGNED_SHORT or RL_UNSIGNED_INT */
+void rlDrawElementsTyped(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t type, void* elements);
+/* draw primitives described by an array and an index array of type 'type' instance_count times. instance_data holds instance_width floats per instance (may be NULL) */
+void rlDrawElementsInstanced(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t type, void* elements, uint32_t instance_count, float* instance_data, uint32_t instance_width);
 /* enable a state. */
 void rlEnable(uint32_t state);
 /* disable a state. */
@@ -240,6 +281,8 @@ void rlCullWinding(uint32_t winding);
 void rlPointSize(float radius);
 /* allocate a display buffer. */
 void rlCreateBuffer(uint32_t type, uint32_t width, uint32_t height, void** buffer);
+/* free a display buffer allocated by rlCreateBuffer. */
+void rlFreeBuffer(void* buffer);
 /* bind a display buffer to front set. Buffer must have same dimensions as any already bound. 'type' is a depth or pixel format. */
 void rlBindBuffer(uint32_t type, uint32_t width, uint32_t height, void* buffer);
 /* unbind a buffer from the front set, if bound. OR together all desired RL_*_BUFFER_BIT bits. May reset dimensions. */
@@ -270,6 +313,10 @@ void rlBindShader(uint32_t type, void* shader);
 rlMat4 rlMat4Mat4(rlMat4 a, rlMat4 b);
 /* compute m * v */
 rlVec4 rlMat4Vec4(rlMat4 m, rlVec4 v);
+/* compute out[i] = m * in[i] for 'count' vectors. 'out' may be 'in' */
+void rlMat4Vec4Array(rlMat4* m, rlVec4* in, rlVec4* out, uint32_t count);
+/* compute out[i] = a[i] * b[i] for 'count' pairs of matrices. 'out' may be 'a' or 'b' */
+void rlMat4Mat4Array(rlMat4* a, rlMat4* b, rlMat4* out, uint32_t count);
 /* calculate a symmetrical-frustum projection matrix */
 rlMat4 rlPerspective(float fovy, float aspect, float near, float far);
 /* calculate a projection matrix */
@@ -288,6 +335,14 @@ rlMat4 rlQuatToMat4(rlVec4 quat);
 rlMat4 rlTranslate(rlVec3 translation);
 /* get an identity matrix */
 rlMat4 rlIdentity();
+/* set the allocator used for all memory allocated by RL. NULL restores the default (aligned_alloc and free) */
+void rlSetAllocator(rlAllocator* allocator);
+/* get an allocator backing allocations of RL_HUGE_PAGE_SIZE bytes or more with huge pages (linux only) */
+rlAllocator* rlHugePageAllocator();
+/* get the bytes currently allocated by the current context, including its buffers */
+uint64_t rlAllocatedBytes();
+/* get the most bytes allocated by the current context at once */
+uint64_t rlPeakAllocatedBytes();
 
 struct rlVec4
 {
@@ -325,6 +380,12 @@ struct rlVec2ui
 {
 	uint32_t x,y;
 };
+struct rlAllocator
+{
+	void* (*alloc)(size_t size, size_t alignment, void* user);	// return size bytes aligned to alignment (a power of two), or NULL
+	void (*free)(void* ptr, size_t size, void* user);			// release a block from alloc; size is the size requested
+	void* user;		// passed to both callbacks
+};
 struct rlMat4
 {
 	// m{row}{col}
@@ -334,6 +395,10 @@ struct rlMat4
 	      m30, m31, m32, m33;
 };
 
+/* 16-byte aligned vectors & matrices; arrays of them never split a vector across cache lines */
+typedef rlVec4 rlVec4a __attribute__((aligned(16)));
+typedef rlMat4 rlMat4a __attribute__((aligned(16)));
+
 // the RL context structure
 struct _rlcore_t
 {
@@ -386,6 +451,8 @@ struct _rlcore_t
 	bool _sh_color_array;		// whether or not to pass vertex color to _vshader
 	bool _sh_normal_array;		// whether or not to pass vertex normals to _vshader
 	bool _sh_texcoord_array;	// whether or not to pass vertex texture coordinates to _vshader
+	bool _sh_instance_id;		// whether or not to pass instance ID to _vshader
+	bool _sh_instance_array;	// whether or not to pass instance attribute to _vshader
 	bool _sh_primary_color;		// whether or not to pass primary colors to _fshader
 	bool _sh_secondary_color;	// whether or not to pass secondary colors to _fshader
 	bool _sh_bary_linear;		// whether or not to pass linear barycentric coordinates to _fshader
@@ -395,11 +462,128 @@ struct _rlcore_t
 	bool _sh_frag_x_coord;	// whether or not to pass fragment x coordinate to _fshader
 	bool _sh_frag_y_coord;	// whether or not to pass fragment y coordinate to _fshader
 	
+	uint32_t _instance_id;		// instance being drawn
+	rlVec4 _instance_attrib;	// attribute of the instance being drawn
+	
+	void* _point_attrib_data;		// fragment data block shared by the points of the draw being drawn
+	uint32_t* _point_attrib_format;
+	uint32_t _point_attrib_count;
+	uint32_t _point_data_size;
+	uint32_t* _point_spans;			// point span table (see _rl_point_span_table)
+	uint32_t _point_span_radius;	// radius of the point span table
+	
+	uint64_t _allocated_bytes;		// bytes allocated for this context (see rlAllocatedBytes)
+	uint64_t _peak_allocated_bytes;	// most bytes allocated at once
+	
 	float _inv_255;
 	float _inv_31;
 };
 _rlcore_t* _rlcore;		// the current context
 
+// default allocation callbacks; aligned_alloc requires a size that is a multiple of the alignment
+void* _rl_default_alloc(size_t size, size_t alignment, void* user)
+{
+	(void)user;
+	return aligned_alloc(alignment, (size + alignment-1) & ~(alignment-1));
+}
+
+void _rl_default_free(void* ptr, size_t size, void* user)
+{
+	(void)size;
+	(void)user;
+	free(ptr);
+}
+
+rlAllocator _rlallocator = { _rl_default_alloc, _rl_default_free, NULL };	// the current allocator
+
+// header preceding every block allocated through _rl_alloc; blocks are released through the allocator they came from
+typedef struct _rl_alloc_header_t _rl_alloc_header_t;
+struct _rl_alloc_header_t
+{
+	void (*free)(void* ptr, size_t size, void* user);
+	void* user;
+	size_t size;		// bytes requested
+	size_t offset;		// bytes from the start of the allocation to the block
+	_rlcore_t* core;	// context charged for the block (credited when it is freed)
+};
+
+// charge (or credit, for negative bytes) a context. not to be used directly
+void _rl_account(_rlcore_t* core, int64_t bytes)
+{
+	if(!core)
+		return;
+	uint64_t total = __atomic_add_fetch(&core->_allocated_bytes, (uint64_t)bytes, __ATOMIC_RELAXED);
+	uint64_t peak = __atomic_load_n(&core->_peak_allocated_bytes, __ATOMIC_RELAXED);
+	while(total > peak && !__atomic_compare_exchange_n(&core->_peak_allocated_bytes, &peak, total, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// allocate size bytes aligned to alignment (a power of two) through the current allocator, without accounting. not to be used directly
+void* _rl_alloc_unaccounted(size_t size, size_t alignment)
+{
+	while(alignment < sizeof(_rl_alloc_header_t))
+		alignment *= 2;
+	size_t offset = (sizeof(_rl_alloc_header_t) + alignment-1) & ~(alignment-1);
+	uint8_t* base = (uint8_t*) _rlallocator.alloc(size + offset, alignment, _rlallocator.user);
+	if(!base)
+		return NULL;
+	_rl_alloc_header_t* header = (_rl_alloc_header_t*)(base + offset) - 1;
+	header->free = _rlallocator.free;
+	header->user = _rlallocator.user;
+	header->size = size;
+	header->offset = offset;
+	header->core = NULL;
+	return base + offset;
+}
+
+// allocate through the current allocator, accounted to the current context. not to be used directly
+void* _rl_alloc(size_t size, size_t alignment)
+{
+	void* ptr = _rl_alloc_unaccounted(size, alignment);
+	if(ptr)
+	{
+		((_rl_alloc_header_t*)ptr - 1)->core = _rlcore;
+		_rl_account(_rlcore, size);
+	}
+	return ptr;
+}
+
+void* _rl_malloc(size_t size)
+{
+	return _rl_alloc(size, 16);
+}
+
+void* _rl_calloc(size_t count, size_t size)
+{
+	if(size && count > SIZE_MAX / size)
+		return NULL;
+	void* ptr = _rl_alloc(count * size, 16);
+	if(ptr)
+		memset(ptr, 0, count * size);
+	return ptr;
+}
+
+void _rl_free(void* ptr)
+{
+	if(!ptr)
+		return;
+	_rl_alloc_header_t* header = (_rl_alloc_header_t*)ptr - 1;
+	_rl_account(header->core, -(int64_t)header->size);
+	header->free((uint8_t*)ptr - header->offset, header->size + header->offset, header->user);
+}
+
+void* _rl_realloc(void* ptr, size_t size)
+{
+	if(!ptr)
+		return _rl_malloc(size);
+	void* data = _rl_malloc(size);
+	if(!data)
+		return NULL;
+	size_t old_size = ((_rl_alloc_header_t*)ptr - 1)->size;
+	memcpy(data, ptr, old_size < size ? old_size : size);
+	_rl_free(ptr);
+	return data;
+}
+
 // safely divide two floats (avoid division-by-zero errors)
 float _safedivf(float a, float b)
 {
@@ -493,597 +677,6 @@ float _dot_vec3(rlVec3 a, rlVec3 b)
 	return (a.x*b.x + a.y*b.y + a.z*b.z);
 }
 	
-// reads a single vertex from an array and returns data
-// based on current vertex layout.
-// position are 4 floats, color 4 floats, normals 3 floats and texcoords 2 floats.
-// not to be used directly
-void _read_vertex(float* data, uint32_t width, uint32_t vertex, uint32_t vertex_read_count,
-	float* v0_position,	float* v1_position,	float* v2_position,
-	float* v0_color,		float* v1_color,		float* v2_color, 
-	float* v0_normals,		float* v1_normals,		float* v2_normals,
-	float* v0_texcoords,	float* v1_texcoords,	float* v2_texcoords)
-{
-	if(!_rlcore)
-		return;
-
-	data += vertex * width;
-
-	if(vertex_read_count == 0)
-		return;
-
-	switch(_rlcore->_vertex_layout)
-	{
-	case RL_V3:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = 1;
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = 1;
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;	
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = 1;
-	}
-	break;
-	case RL_V3_C4:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = 1;
-	v0_color[0]    = data[3];
-	v0_color[1]    = data[4];
-	v0_color[2]    = data[5];
-	v0_color[3]    = data[6];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = 1;
-		v1_color[0]    = data[3];
-		v1_color[1]    = data[4];
-		v1_color[2]    = data[5];
-		v1_color[3]    = data[6];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = 1;
-		v2_color[0]    = data[3];
-		v2_color[1]    = data[4];
-		v2_color[2]    = data[5];
-		v2_color[3]    = data[6];
-	}
-	break;
-	case RL_V3_N3:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = 1;
-	v0_normals[0]  = data[3];
-	v0_normals[1]  = data[4];
-	v0_normals[2]  = data[5];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = 1;
-		v1_normals[0]  = data[3];
-		v1_normals[1]  = data[4];
-		v1_normals[2]  = data[5];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = 1;
-		v2_normals[0]  = data[3];
-		v2_normals[1]  = data[4];
-		v2_normals[2]  = data[5];
-	}
-	break;
-	case RL_V3_T2:
-	v0_position[0]  = data[0];
-	v0_position[1]  = data[1];
-	v0_position[2]  = data[2];
-	v0_position[3]  = 1;
-	v0_texcoords[0] = data[3];
-	v0_texcoords[1] = data[4];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0]  = data[0];
-		v1_position[1]  = data[1];
-		v1_position[2]  = data[2];
-		v1_position[3]  = 1;
-		v1_texcoords[0] = data[3];
-		v1_texcoords[1] = data[4];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0]  = data[0];
-		v2_position[1]  = data[1];
-		v2_position[2]  = data[2];
-		v2_position[3]  = 1;
-		v2_texcoords[0] = data[3];
-		v2_texcoords[1] = data[4];
-	}
-	break;
-	case RL_V3_N3_T2:
-	v0_position[0]  = data[0];
-	v0_position[1]  = data[1];
-	v0_position[2]  = data[2];
-	v0_position[3]  = 1;
-	v0_normals[0]   = data[3];
-	v0_normals[1]   = data[4];
-	v0_normals[2]   = data[5];
-	v0_texcoords[0] = data[6];
-	v0_texcoords[1] = data[7];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0]  = data[0];
-		v1_position[1]  = data[1];
-		v1_position[2]  = data[2];
-		v1_position[3]  = 1;
-		v1_normals[0]   = data[3];
-		v1_normals[1]   = data[4];
-		v1_normals[2]   = data[5];
-		v1_texcoords[0] = data[6];
-		v1_texcoords[1] = data[7];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0]  = data[0];
-		v2_position[1]  = data[1];
-		v2_position[2]  = data[2];
-		v2_position[3]  = 1;
-		v2_normals[0]   = data[3];
-		v2_normals[1]   = data[4];
-		v2_normals[2]   = data[5];
-		v2_texcoords[0] = data[6];
-		v2_texcoords[1] = data[7];
-	}
-	break;
-	case RL_V3_C4_N3:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = 1;
-	v0_color[0]    = data[3];
-	v0_color[1]    = data[4];
-	v0_color[2]    = data[5];
-	v0_color[3]    = data[6];	
-	v0_normals[0]  = data[7];
-	v0_normals[1]  = data[8];
-	v0_normals[2]  = data[9];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = 1;
-		v1_color[0]    = data[3];
-		v1_color[1]    = data[4];
-		v1_color[2]    = data[5];
-		v1_color[3]    = data[6];
-		v1_normals[0]  = data[7];			
-		v1_normals[1]  = data[8];
-		v1_normals[2]  = data[9];	
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = 1;
-		v2_color[0]    = data[3];
-		v2_color[1]    = data[4];
-		v2_color[2]    = data[5];
-		v2_color[3]    = data[6];
-		v2_normals[0]  = data[7];
-		v2_normals[1]  = data[8];	
-		v2_normals[2]  = data[9];
-	}
-	break;
-	case RL_V3_C4_T2:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = 1;
-	v0_color[0] = data[3];
-	v0_color[1] = data[4];
-	v0_color[2] = data[5];
-	v0_color[3] = data[6];
-	v0_texcoords[0] = data[7];
-	v0_texcoords[1] = data[8];
-	if(vertex_read_count > 1)
-	{
-		data += width;	
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = 1;
-		v1_color[0] = data[3];
-		v1_color[1] = data[4];
-		v1_color[2] = data[5];
-		v1_color[3] = data[6];
-		v1_texcoords[0] = data[7];
-		v1_texcoords[1] = data[8];
-	}		
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = 1;
-		v2_color[0] = data[3];
-		v2_color[1] = data[4];
-		v2_color[2] = data[5];
-		v2_color[3] = data[6];
-		v2_texcoords[0] = data[7];
-		v2_texcoords[1] = data[8];
-	}
-	break;
-	case RL_V3_C4_N3_T2:
-	v0_position[0]  = data[0];
-	v0_position[1]  = data[1];
-	v0_position[2]  = data[2];
-	v0_position[3]  = 1;
-	v0_color[0]     = data[3];
-	v0_color[1]     = data[4];
-	v0_color[2]     = data[5];
-	v0_color[3]     = data[6];
-	v0_normals[0]   = data[7];
-	v0_normals[1]   = data[8];
-	v0_normals[2]   = data[9];
-	v0_texcoords[0] = data[10];
-	v0_texcoords[1] = data[11];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0]  = data[0];
-		v1_position[1]  = data[1];
-		v1_position[2]  = data[2];
-		v1_position[3]  = 1;
-		v1_color[0]     = data[3];
-		v1_color[1]     = data[4];
-		v1_color[2]     = data[5];
-		v1_color[3]     = data[6];
-		v1_normals[0]   = data[7];
-		v1_normals[1]   = data[8];
-		v1_normals[2]   = data[9];
-		v1_texcoords[0] = data[10];
-		v1_texcoords[1] = data[11];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0]  = data[0];
-		v2_position[1]  = data[1];
-		v2_position[2]  = data[2];
-		v2_position[3]  = 1;
-		v2_color[0]     = data[3];
-		v2_color[1]     = data[4];
-		v2_color[2]     = data[5];
-		v2_color[3]     = data[6];
-		v2_normals[0]   = data[7];
-		v2_normals[1]   = data[8];
-		v2_normals[2]   = data[9];
-		v2_texcoords[0] = data[10];
-		v2_texcoords[1] = data[11];
-	}
-	break;
-	case RL_V4:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = data[3];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = data[3];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;	
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = data[3];
-	}
-	break;
-	case RL_V4_C4:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = data[3];
-	v0_color[0]    = data[4];
-	v0_color[1]    = data[5];
-	v0_color[2]    = data[6];
-	v0_color[3]    = data[7];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = data[3];
-		v1_color[0]    = data[4];
-		v1_color[1]    = data[5];
-		v1_color[2]    = data[6];
-		v1_color[3]    = data[7];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = data[3];
-		v2_color[0]    = data[4];
-		v2_color[1]    = data[5];
-		v2_color[2]    = data[6];
-		v2_color[3]    = data[7];
-	}
-	break;
-	case RL_V4_N3:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = data[3];
-	v0_normals[0]  = data[4];
-	v0_normals[1]  = data[5];
-	v0_normals[2]  = data[6];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = data[3];
-		v1_normals[0]  = data[4];
-		v1_normals[1]  = data[5];
-		v1_normals[2]  = data[6];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = data[3];
-		v2_normals[0]  = data[4];
-		v2_normals[1]  = data[5];
-		v2_normals[2]  = data[6];
-	}
-	break;
-	case RL_V4_T2:
-	v0_position[0]  = data[0];
-	v0_position[1]  = data[1];
-	v0_position[2]  = data[2];
-	v0_position[3]  = data[3];
-	v0_texcoords[0] = data[4];
-	v0_texcoords[1] = data[5];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0]  = data[0];
-		v1_position[1]  = data[1];
-		v1_position[2]  = data[2];
-		v1_position[3]  = data[3];
-		v1_texcoords[0] = data[4];
-		v1_texcoords[1] = data[5];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0]  = data[0];
-		v2_position[1]  = data[1];
-		v2_position[2]  = data[2];
-		v2_position[3]  = data[3];
-		v2_texcoords[0] = data[4];
-		v2_texcoords[1] = data[5];
-	}
-	break;
-	case RL_V4_N3_T2:
-	v0_position[0]  = data[0];
-	v0_position[1]  = data[1];
-	v0_position[2]  = data[2];
-	v0_position[3]  = data[3];
-	v0_normals[0]   = data[4];
-	v0_normals[1]   = data[5];
-	v0_normals[2]   = data[6];
-	v0_texcoords[0] = data[7];
-	v0_texcoords[1] = data[8];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0]  = data[0];
-		v1_position[1]  = data[1];
-		v1_position[2]  = data[2];
-		v1_position[3]  = data[3];
-		v1_normals[0]   = data[4];
-		v1_normals[1]   = data[5];
-		v1_normals[2]   = data[6];
-		v1_texcoords[0] = data[7];
-		v1_texcoords[1] = data[8];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0]  = data[0];
-		v2_position[1]  = data[1];
-		v2_position[2]  = data[2];
-		v2_position[3]  = data[3];
-		v2_normals[0]   = data[4];
-		v2_normals[1]   = data[5];
-		v2_normals[2]   = data[6];
-		v2_texcoords[0] = data[7];
-		v2_texcoords[1] = data[8];
-	}
-	break;
-	case RL_V4_C4_N3:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = data[3];
-	v0_color[0]    = data[4];
-	v0_color[1]    = data[5];
-	v0_color[2]    = data[6];
-	v0_color[3]    = data[7];	
-	v0_normals[0]  = data[8];
-	v0_normals[1]  = data[9];
-	v0_normals[2]  = data[10];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = data[3];
-		v1_color[0]    = data[4];
-		v1_color[1]    = data[5];
-		v1_color[2]    = data[6];
-		v1_color[3]    = data[7];
-		v1_normals[0]  = data[8];			
-		v1_normals[1]  = data[9];
-		v1_normals[2]  = data[10];	
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = data[3];
-		v2_color[0]    = data[4];
-		v2_color[1]    = data[5];
-		v2_color[2]    = data[6];
-		v2_color[3]    = data[7];
-		v2_normals[0]  = data[8];
-		v2_normals[1]  = data[9];	
-		v2_normals[2]  = data[10];
-	}
-	break;
-	case RL_V4_C4_T2:
-	v0_position[0] = data[0];
-	v0_position[1] = data[1];
-	v0_position[2] = data[2];
-	v0_position[3] = data[3];
-	v0_color[0] = data[4];
-	v0_color[1] = data[5];
-	v0_color[2] = data[6];
-	v0_color[3] = data[7];
-	v0_texcoords[0] = data[8];
-	v0_texcoords[1] = data[9];
-	if(vertex_read_count > 1)
-	{
-		data += width;	
-		v1_position[0] = data[0];
-		v1_position[1] = data[1];
-		v1_position[2] = data[2];
-		v1_position[3] = data[3];
-		v1_color[0] = data[4];
-		v1_color[1] = data[5];
-		v1_color[2] = data[6];
-		v1_color[3] = data[7];
-		v1_texcoords[0] = data[8];
-		v1_texcoords[1] = data[9];
-	}		
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0] = data[0];
-		v2_position[1] = data[1];
-		v2_position[2] = data[2];
-		v2_position[3] = data[3];
-		v2_color[0] = data[4];
-		v2_color[1] = data[5];
-		v2_color[2] = data[6];
-		v2_color[3] = data[7];
-		v2_texcoords[0] = data[8];
-		v2_texcoords[1] = data[9];
-	}
-	break;
-	case RL_V4_C4_N3_T2:
-	v0_position[0]  = data[0];
-	v0_position[1]  = data[1];
-	v0_position[2]  = data[2];
-	v0_position[3]  = data[3];
-	v0_color[0]     = data[4];
-	v0_color[1]     = data[5];
-	v0_color[2]     = data[6];
-	v0_color[3]     = data[7];
-	v0_normals[0]   = data[8];
-	v0_normals[1]   = data[9];
-	v0_normals[2]   = data[10];
-	v0_texcoords[0] = data[11];
-	v0_texcoords[1] = data[12];
-	if(vertex_read_count > 1)
-	{
-		data += width;
-		v1_position[0]  = data[0];
-		v1_position[1]  = data[1];
-		v1_position[2]  = data[2];
-		v1_position[3]  = data[3];
-		v1_color[0]     = data[4];
-		v1_color[1]     = data[5];
-		v1_color[2]     = data[6];
-		v1_color[3]     = data[7];
-		v1_normals[0]   = data[8];
-		v1_normals[1]   = data[9];
-		v1_normals[2]   = data[10];
-		v1_texcoords[0] = data[11];
-		v1_texcoords[1] = data[12];
-	}
-	if(vertex_read_count > 2)
-	{
-		data += width;
-		v2_position[0]  = data[0];
-		v2_position[1]  = data[1];
-		v2_position[2]  = data[2];
-		v2_position[3]  = data[3];
-		v2_color[0]     = data[4];
-		v2_color[1]     = data[5];
-		v2_color[2]     = data[6];
-		v2_color[3]     = data[7];
-		v2_normals[0]   = data[8];
-		v2_normals[1]   = data[9];
-		v2_normals[2]   = data[10];
-		v2_texcoords[0] = data[11];
-		v2_texcoords[1] = data[12];
-	}
-	break;
-	}
-}
-	
 // samples and normalizes a texel from a texture.
 // width is the width of the texture. (x,y) relative to top left.
 // not to be used directly
@@ -1305,8 +898,10 @@ rlVec4 _vertex_pass(uint32_t ptype, rlVec4 position, rlVec4 color, rlVec3 normal
 		if(_rlcore->_sh_color_array)		{ enabled_attribs += 1; size += sizeof(rlVec4); } 
 		if(_rlcore->_sh_normal_array)		{ enabled_attribs += 1; size += sizeof(rlVec3); }
 		if(_rlcore->_sh_texcoord_array)		{ enabled_attribs += 1; size += sizeof(rlVec2); }
+		if(_rlcore->_sh_instance_id)		{ enabled_attribs += 1; size += sizeof(uint32_t); }
+		if(_rlcore->_sh_instance_array)		{ enabled_attribs += 1; size += sizeof(rlVec4); }
 		
-		data = malloc(size);
+		data = _rl_malloc(size);
 		
 		/* ALLOCATE AND FILL DATA WITH ENABLED ATTRIBUTE ARRAYS */
 		uint32_t format[enabled_attribs];	// list of attributes in array
@@ -1323,13 +918,17 @@ rlVec4 _vertex_pass(uint32_t ptype, rlVec4 position, rlVec4 color, rlVec3 normal
 			*((rlVec3*)(data + offset)) = normals; offset += sizeof(rlVec3); }
 		if(_rlcore->_sh_texcoord_array)		{ format[i] = RL_TEXCOORD_ARRAY; i += 1;
 			*((rlVec2*)(data + offset)) = texcoords; offset += sizeof(rlVec2); }
+		if(_rlcore->_sh_instance_id)		{ format[i] = RL_INSTANCE_ID; i += 1;
+			*((uint32_t*)(data + offset)) = _rlcore->_instance_id; offset += sizeof(uint32_t); }
+		if(_rlcore->_sh_instance_array)		{ format[i] = RL_INSTANCE_ARRAY; i += 1;
+			*((rlVec4*)(data + offset)) = _rlcore->_instance_attrib; offset += sizeof(rlVec4); }
 
 		if(enabled_attribs)
 			out = _rlcore->_vshader(data, format, enabled_attribs);
 		else
 			out = _rlcore->_vshader(NULL, NULL, 0);
 			
-		free(data);
+		_rl_free(data);
 	}
 		
 	return out;
@@ -1359,7 +958,7 @@ void* _alloc_fragment_data(uint32_t* enabled_attrib_count, uint32_t* data_size,
 	if(_rlcore->_sh_frag_x_coord)		{ *enabled_attrib_count += 1; *data_size += sizeof(int); }
 	if(_rlcore->_sh_frag_y_coord)		{ *enabled_attrib_count += 1; *data_size += sizeof(int); }
 
-	*data_attrib_format = (uint32_t*) calloc(*enabled_attrib_count, sizeof(uint32_t));
+	*data_attrib_format = (uint32_t*) _rl_calloc(*enabled_attrib_count, sizeof(uint32_t));
 	if(_rlcore->_sh_primitive_type)		{ (*data_attrib_format) [i] = RL_PRIMITIVE_TYPE; i += 1; }
 	if(_rlcore->_sh_color_array)		{ (*data_attrib_format) [i] = RL_COLOR_ARRAY; i += 1; }
 	if(_rlcore->_sh_primary_color)		{ (*data_attrib_format) [i] = RL_PRIMARY_COLOR; i += 1; }
@@ -1372,7 +971,7 @@ void* _alloc_fragment_data(uint32_t* enabled_attrib_count, uint32_t* data_size,
 	if(_rlcore->_sh_frag_y_coord)		{ (*data_attrib_format) [i] = RL_FRAG_Y_COORD; i += 1; }
 			
 	if(*data_size)
-		return malloc(*data_size);
+		return _rl_malloc(*data_size);
 	return NULL;
 }
 	
@@ -1626,8 +1225,8 @@ void _brute_raster(rlVec2 v0, rlVec2 v1, rlVec2 v2, rlVec4 v0_rgba, rlVec4 v1_rg
 	}
 		
 	/* these were used for fragment shader passes */
-	free(attrib_data);
-	free(attrib_format);
+	_rl_free(attrib_data);
+	_rl_free(attrib_format);
 }
 
 // a tile-based rasterizer with 4 bits of sub-pixel precision
@@ -2151,8 +1750,8 @@ void _raster(rlVec2 v0, rlVec2 v1, rlVec2 v2, rlVec4 v0_rgba, rlVec4 v1_rgba, rl
 		}	// cycle tile x
 	}	// cycle tile y
 		
-	free(attrib_data);
-	free(attrib_format);
+	_rl_free(attrib_data);
+	_rl_free(attrib_format);
 }
 	
 // rasterize a screen-space line
@@ -2405,86 +2004,53 @@ void _raster_line(rlVec2 v0, rlVec2 v1, rlVec4 v0_rgba, rlVec4 v1_rgba,
 		if(e2 <  dy) { err += dx; y += sy; y_idx += sy * _rlcore->_width; }
 	}
 
-	free(attrib_data);
-	free(attrib_format);
+	_rl_free(attrib_data);
+	_rl_free(attrib_format);
 }
 	
-// rasters a fragment of a point
-// for use exclusively only in _raster_point
-void _raster_point_fragment(int x, int y, rlVec4 rgba, int64_t z, void* attrib_data, uint32_t* attrib_format,
-	uint32_t enabled_attrib_count, uint32_t data_size, int64_t db_range, float inv_db_range)
+// return the span table of a point of radius r: the half-width of each row, from the center row out.
+// the rows are those of a midpoint circle. the table is kept until a point of another radius is drawn.
+// not to be used directly
+uint32_t* _rl_point_span_table(uint32_t r)
 {
-	float dst_depth = 0;
-	float depth = 0;
+	if(_rlcore->_point_spans && _rlcore->_point_span_radius == r)
+		return _rlcore->_point_spans;
 	
-	if(x < 0 || x >= _rlcore->_width || y < 0 || y >= _rlcore->_height)
-		return;
-			
-	rlVec3 bary, linear_bary;
-	bary.x = 0.0f;
-	bary.y = 0.0f;
-	bary.z = 0.0f;
-	linear_bary = bary;
-		
-	uint32_t pixel_index = 0;
-	pixel_index = y * _rlcore->_width + x;
-		
-	if(_rlcore->_depthbuffer && _rlcore->_db_type == RL_D16)
-	{
-		if(_rlcore->_depth_test && z > ((uint16_t*)_rlcore->_depthbuffer) [pixel_index])
-			return;
-		dst_depth = ((uint16_t*)_rlcore->_depthbuffer) [pixel_index] * inv_db_range;
-		depth = z * inv_db_range;
-	}
-	if(_rlcore->_depthbuffer && _rlcore->_db_type == RL_D32)
-	{
-		if(_rlcore->_depth_test && z > ((uint32_t*)_rlcore->_depthbuffer) [pixel_index])
-			return;
-		dst_depth = ((uint32_t*)_rlcore->_depthbuffer) [pixel_index] * inv_db_range;
-		depth = z * inv_db_range;
-	}
+	uint32_t* spans = (uint32_t*) _rl_realloc(_rlcore->_point_spans, (r+1) * sizeof(uint32_t));
+	if(!spans)
+		// unhandled error: out of memory
+		return NULL;
+	memset(spans, 0, (r+1) * sizeof(uint32_t));
+	_rlcore->_point_spans = spans;
+	_rlcore->_point_span_radius = r;
 	
-	if(_rlcore->_colorbuffer)
-	{
-		rlVec4 primary;		// primary (primitive) color
-		rlVec4 secondary;	// secondary (texture) color
-		primary.x = rgba.x, secondary.x = 0.0f;
-		primary.y = rgba.y, secondary.y = 0.0f;
-		primary.z = rgba.z, secondary.z = 0.0f;
-		primary.w = rgba.w, secondary.w = 0.0f;
-		rlVec4 color = primary;	// color to draw with
-		
-		rlVec2i coord;
-		coord.x = x;
-		coord.y = y;
-		
-		bool discard = false;
-		color = _fragment_pass(attrib_data, enabled_attrib_count, data_size, attrib_format,
-			RL_POINT, primary, secondary, linear_bary, bary, color, dst_depth, depth, coord, &discard);
-		
-		if(discard)
-			return;
-		if(color.x > 1.0f) color.x = 1.0f;			
-		if(color.x < 0.0f) color.x = 0.0f;
-		if(color.y > 1.0f) color.y = 1.0f;
-		if(color.y < 0.0f) color.y = 0.0f;
-		if(color.z > 1.0f) color.z = 1.0f;
-		if(color.z < 0.0f) color.z = 0.0f;
-		if(color.w > 1.0f) color.w = 1.0f;
-		if(color.w < 0.0f) color.w = 0.0f;
-			
-		_plot_pixel(pixel_index, color, _rlcore->_blend);
-	}
-
-	if(_rlcore->_write_depth && _rlcore->_depthbuffer)
+	int f = 1 - r;
+	int dx = 0;
+	int dy = -2 * r;
+	int x2 = 0;
+	int y2 = r;
+	
+	spans[0] = r;
+	while(x2 < y2)
 	{
-		if(_rlcore->_db_type == RL_D16)
-			((uint16_t*)_rlcore->_depthbuffer) [pixel_index] = z;
-		if(_rlcore->_db_type == RL_D32)
-			((uint32_t*)_rlcore->_depthbuffer) [pixel_index] = z;
+		if(f >= 0)
+		{
+			y2 -= 1;
+			dy += 2;
+			f += dy;
+		}
+		x2 += 1;
+		dx += 2;
+		f += dx + 1;
+		if(spans[y2] < (uint32_t)x2)	spans[y2] = x2;
+		if(spans[x2] < (uint32_t)y2)	spans[x2] = y2;
 	}
+	return spans;
 }
-	
+
+// rasters a point as horizontal spans (see _rl_point_span_table)
+// the fragment data block of the draw (_point_attrib_data) is used when there is one
+// not to be used directly
 void _raster_point(rlVec2 pos, rlVec4 rgba, int64_t z)
 {
 	if(!_rlcore)
@@ -2515,81 +2081,107 @@ void _raster_point(rlVec2 pos, rlVec4 rgba, int64_t z)
 			return;
 	}
 	
-	/* USED FOR FRAGMENT SHADER PASSES */
-	void* attrib_data = 0;
-	uint32_t* attrib_format = 0;
-	uint32_t enabled_attrib_count = 0;
-	uint32_t data_size = 0;
-	attrib_data = _alloc_fragment_data(&enabled_attrib_count, &data_size, &attrib_format);
-	
-	float dst_depth = 0;
 	if(z < 0)
 		return;
 	if(_rlcore->_depthbuffer && z > db_range)
 		return;
-		
-	int f = 1 - r;
-	int dx = 0;
-	int dy = -2 * r;
-	int x2 = 0;
-	int y2 = r;
-
-	if(can_raster)
-	{
-		if(pos.x - r >= _rlcore->_width)
-			return;
-		if(pos.x + r < 0)
-			return;
-		if(pos.y - r >= _rlcore->_height)
-			return;
-		if(pos.y + r < 0)
-			return;
-
-		_raster_point_fragment(pos.x, pos.y + r, rgba, z, attrib_data, 
-			attrib_format, enabled_attrib_count, data_size, db_range, inv_db_range);
-		_raster_point_fragment(pos.x, pos.y - r, rgba, z, attrib_data,
-			attrib_format, enabled_attrib_count, data_size, db_range, inv_db_range);
-		_raster_point_fragment(pos.x + r, pos.y, rgba, z, attrib_data,
-			attrib_format, enabled_attrib_count, data_size, db_range, inv_db_range);
-		_raster_point_fragment(pos.x - r, pos.y, rgba, z, attrib_data,
-			attrib_format, enabled_attrib_count, data_size, db_range, inv_db_range);
-		for(int x = pos.x - r; x < pos.x + r; x += 1)
-			_raster_point_fragment(x, pos.y, rgba, z, attrib_data, attrib_format, 
-				enabled_attrib_count, data_size, db_range, inv_db_range);
-	while(x2 < y2)
+	if(!can_raster)
+		return;
+	
+	int point_x = pos.x;
+	int point_y = pos.y;
+	int width  = _rlcore->_width;
+	int height = _rlcore->_height;
+	if(point_x - (int)r >= width || point_x + (int)r < 0 || point_y - (int)r >= height || point_y + (int)r < 0)
+		return;
+	
+	uint32_t* spans = _rl_point_span_table(r);
+	if(!spans)
+		return;
+	
+	/* USED FOR FRAGMENT SHADER PASSES */
+	void* attrib_data = _rlcore->_point_attrib_data;
+	uint32_t* attrib_format = _rlcore->_point_attrib_format;
+	uint32_t enabled_attrib_count = _rlcore->_point_attrib_count;
+	uint32_t data_size = _rlcore->_point_data_size;
+	bool own_attrib_data = !attrib_format;
+	if(own_attrib_data)
+		attrib_data = _alloc_fragment_data(&enabled_attrib_count, &data_size, &attrib_format);
+	
+	rlVec3 bary;
+	bary.x = 0.0f, bary.y = 0.0f, bary.z = 0.0f;
+	rlVec4 secondary;
+	secondary.x = 0.0f, secondary.y = 0.0f, secondary.z = 0.0f, secondary.w = 0.0f;
+	float depth = z * inv_db_range;
+	
+	for(int dy = -(int)r; dy <= (int)r; dy += 1)
 	{
-		if(f >= 0)
+		int y = point_y + dy;
+		if(y < 0 || y >= height)
+			continue;
+		
+		int half = spans[dy < 0 ? -dy : dy];
+		int x0 = point_x - half;
+		int x1 = point_x + half;
+		if(x0 < 0)			x0 = 0;
+		if(x1 >= width)		x1 = width - 1;
+		
+		uint32_t pixel_index = y * width + x0;
+		for(int x = x0; x <= x1; x += 1, pixel_index += 1)
 		{
-			y2 -= 1;
-			dy += 2;
-			f += dy;
+			float dst_depth = 0;
+			if(_rlcore->_depthbuffer && _rlcore->_db_type == RL_D16)
+			{
+				if(depth_test && z > ((uint16_t*)_rlcore->_depthbuffer) [pixel_index])
+					continue;
+				dst_depth = ((uint16_t*)_rlcore->_depthbuffer) [pixel_index] * inv_db_range;
+			}
+			if(_rlcore->_depthbuffer && _rlcore->_db_type == RL_D32)
+			{
+				if(depth_test && z > ((uint32_t*)_rlcore->_depthbuffer) [pixel_index])
+					continue;
+				dst_depth = ((uint32_t*)_rlcore->_depthbuffer) [pixel_index] * inv_db_range;
+			}
+			
+			if(plot_color)
+			{
+				rlVec2i coord;
+				coord.x = x;
+				coord.y = y;
+				
+				bool discard = false;
+				rlVec4 color = _fragment_pass(attrib_data, enabled_attrib_count, data_size, attrib_format,
+					RL_POINT, rgba, secondary, bary, bary, rgba, dst_depth, depth, coord, &discard);
+				
+				if(discard)
+					continue;
+				if(color.x > 1.0f) color.x = 1.0f;			
+				if(color.x < 0.0f) color.x = 0.0f;
+				if(color.y > 1.0f) color.y = 1.0f;
+				if(color.y < 0.0f) color.y = 0.0f;
+				if(color.z > 1.0f) color.z = 1.0f;
+				if(color.z < 0.0f) color.z = 0.0f;
+				if(color.w > 1.0f) color.w = 1.0f;
+				if(color.w < 0.0f) color.w = 0.0f;
+				
+				_plot_pixel(pixel_index, color, _rlcore->_blend);
+			}
+			
+			if(plot_depth)
+			{
+				if(_rlcore->_db_type == RL_D16)
+					((uint16_t*)_rlcore->_depthbuffer) [pixel_index] = z;
+				if(_rlcore->_db_type == RL_D32)
+					((uint32_t*)_rlcore->_depthbuffer) [pixel_index] = z;
+			}
 		}
-		x2 += 1;
-		dx += 2;
-		f += dx + 1;
-		int x0 = pos.x - x2;
-		int x1 = pos.x + x2;
-		int sx = (x0 < x1) ? 1 : -1; 
-		for(int x = x0; x != x1; x += sx)
-			_raster_point_fragment(x, pos.y + y2, rgba, z, attrib_data, attrib_format, 
-				enabled_attrib_count, data_size, db_range, inv_db_range);
-		for(int x = x0; x != x1; x += sx)
-			_raster_point_fragment(x, pos.y - y2, rgba, z, attrib_data, attrib_format, 
-				enabled_attrib_count, data_size, db_range, inv_db_range);
-		x0 = pos.x - y2;
-		x1 = pos.x + y2;
-		sx = (x0 < x1) ? 1 : -1; 
-		for(int x = x0; x != x1; x += sx)
-			_raster_point_fragment(x, pos.y + x2, rgba, z, attrib_data, attrib_format, 
-				enabled_attrib_count, data_size, db_range, inv_db_range);
-		for(int x = x0; x != x1; x += sx)
-			_raster_point_fragment(x, pos.y - x2, rgba, z, attrib_data, attrib_format, 
-				enabled_attrib_count, data_size, db_range, inv_db_range);
-	}
 	}
 	
-	free(attrib_data);
-	free(attrib_format);
+	if(own_attrib_data)
+	{
+		_rl_free(attrib_data);
+		_rl_free(attrib_format);
+	}
 }
 
 // clip a line against an x plane. Returns coordinates of clipped end point.
@@ -3043,7 +2635,11 @@ void _process_triangle(rlVec4 v0, rlVec4 v1, rlVec4 v2, rlVec4 rgba_v0, rlVec4 r
 /* allocate, initialize and return a context */
 _rlcore_t* rlCreateContext()
 {
-	_rlcore_t* context = (_rlcore_t*) malloc(sizeof(_rlcore_t));
+	_rlcore_t* context = (_rlcore_t*) _rl_alloc_unaccounted(sizeof(_rlcore_t), 16);
+	if(!context)
+		return NULL;
+	context->_allocated_bytes = sizeof(_rlcore_t);
+	context->_peak_allocated_bytes = sizeof(_rlcore_t);
 	context->_clear_depth = -1;
 	context->_clear_color = 0;
 	context->_depthbuffer = NULL;
@@ -3085,6 +2681,8 @@ _rlcore_t* rlCreateContext()
 	context->_sh_color_array = false;
 	context->_sh_normal_array = false;
 	context->_sh_texcoord_array = false;
+	context->_sh_instance_id = false;
+	context->_sh_instance_array = false;
 	context->_sh_primary_color = false;
 	context->_sh_secondary_color = false;
 	context->_sh_bary_linear = false;
@@ -3093,6 +2691,14 @@ _rlcore_t* rlCreateContext()
 	context->_sh_frag_depth = false;
 	context->_sh_frag_x_coord = false;
 	context->_sh_frag_y_coord = false;
+	context->_instance_id = 0;
+	context->_instance_attrib.x = 0, context->_instance_attrib.y = 0, context->_instance_attrib.z = 0, context->_instance_attrib.w = 1;
+	context->_point_attrib_data = NULL;
+	context->_point_attrib_format = NULL;
+	context->_point_attrib_count = 0;
+	context->_point_data_size = 0;
+	context->_point_spans = NULL;
+	context->_point_span_radius = 0;
 	context->_inv_255 = 1.0f / 255.0f;
 	context->_inv_31 = 1.0f / 31.0f;
 
@@ -3105,1194 +2711,431 @@ void rlBindContext(_rlcore_t* context)
 	_rlcore = context;
 }
 
-/* draw primitives described by an array */
-void rlDrawArray(uint32_t primitive_type, uint32_t primitive_count, float* data)
-{	
-	if(!_rlcore)
-		return;
+// a vertex read from an array. color, normals and texture coordinates are clamped or defaulted.
+// not to be used directly
+typedef struct _rl_vertex_t _rl_vertex_t;
+struct _rl_vertex_t
+{
+	rlVec4 position;
+	rlVec4 color;
+	rlVec3 normals;
+	rlVec2 tcoords;
+};
 
-	uint32_t vertex_count = 0;
+// get the number of vertices described by primitive_count primitives. returns 0 for an invalid primitive type.
+// strips & fans share vertices between primitives; a line loop of n lines has n vertices.
+// not to be used directly
+uint32_t _primitive_vertex_count(uint32_t primitive_type, uint32_t primitive_count)
+{
 	switch(primitive_type)
 	{
-		case RL_POINTS:
-		vertex_count = primitive_count;
-		break;
-		case RL_LINES:
-		vertex_count = primitive_count * 2;
-		break;
-		case RL_TRIANGLES:
-		vertex_count = primitive_count * 3;
-		break;
-		default:
-		// unhandled error: invalid parameter
-		return;
+		case RL_POINTS:		return primitive_count;
+		case RL_LINES:		return primitive_count * 2;
+		case RL_TRIANGLES:	return primitive_count * 3;
+		case RL_LINE_STRIP:	return primitive_count ? primitive_count + 1 : 0;
+		case RL_LINE_LOOP:	return primitive_count;
+		case RL_TRIANGLE_STRIP:
+		case RL_TRIANGLE_FAN:	return primitive_count ? primitive_count + 2 : 0;
 	}
-	
-	uint32_t vertex_width = 0;
+	return 0;
+}
+
+// where the attributes of a vertex lie in an array, compiled once per draw from the current vertex layout.
+// offsets are in floats from the start of a vertex; attributes absent from the layout have an offset of -1.
+// not to be used directly
+typedef struct _vertex_fetch_t _vertex_fetch_t;
+struct _vertex_fetch_t
+{
+	uint32_t width;				// floats per vertex
+	uint32_t position_size;		// 3 or 4; a w of 1 is assumed for 3
+	int32_t color;
+	int32_t normals;
+	int32_t tcoords;
+};
+
+// compile the current vertex layout into a fetch descriptor. returns false for an unknown layout.
+// not to be used directly
+bool _compile_vertex_fetch(_vertex_fetch_t* fetch)
+{
+	bool color = false, normals = false, tcoords = false;
 	switch(_rlcore->_vertex_layout)
 	{
-		case RL_V3:		vertex_width = 3;	break;
-		case RL_V3_C4:	vertex_width = 7;	break;
-		case RL_V3_N3:	vertex_width = 6;	break;
-		case RL_V3_T2:	vertex_width = 5;	break;
-		case RL_V3_N3_T2:		vertex_width = 8;	break;
-		case RL_V3_C4_N3:		vertex_width = 10;	break;
-		case RL_V3_C4_T2:		vertex_width = 9;	break;
-		case RL_V3_C4_N3_T2:	vertex_width = 12;	break;
-		case RL_V4:		vertex_width = 4;	break;
-		case RL_V4_C4:	vertex_width = 8;	break;
-		case RL_V4_N3:	vertex_width = 7;	break;
-		case RL_V4_T2:	vertex_width = 6;	break;
-		case RL_V4_N3_T2:		vertex_width = 9;	break;
-		case RL_V4_C4_N3:		vertex_width = 11;	break;
-		case RL_V4_C4_T2:		vertex_width = 10;	break;
-		case RL_V4_C4_N3_T2:	vertex_width = 13;	break;
+		case RL_V3:		case RL_V4:		break;
+		case RL_V3_C4:	case RL_V4_C4:	color = true; break;
+		case RL_V3_N3:	case RL_V4_N3:	normals = true; break;
+		case RL_V3_T2:	case RL_V4_T2:	tcoords = true; break;
+		case RL_V3_N3_T2:		case RL_V4_N3_T2:		normals = true, tcoords = true; break;
+		case RL_V3_C4_N3:		case RL_V4_C4_N3:		color = true, normals = true; break;
+		case RL_V3_C4_T2:		case RL_V4_C4_T2:		color = true, tcoords = true; break;
+		case RL_V3_C4_N3_T2:	case RL_V4_C4_N3_T2:	color = true, normals = true, tcoords = true; break;
 		default:
-		// unhandled error: unknown vertex layout
-		return;
+			return false;
 	}
 	
-	bool mode_valid = (_rlcore->_mode == RL_FILL || _rlcore->_mode == RL_POINT || _rlcore->_mode == RL_LINE);
-	
-	uint32_t v = 0;
+	// attributes follow the position in the order color, normals, texcoords
+	fetch->position_size = _rlcore->_vertex_layout >= RL_V4 ? 4 : 3;
+	uint32_t offset = fetch->position_size;
+	fetch->color   = color   ? (int32_t)offset : -1, offset += color   ? 4 : 0;
+	fetch->normals = normals ? (int32_t)offset : -1, offset += normals ? 3 : 0;
+	fetch->tcoords = tcoords ? (int32_t)offset : -1, offset += tcoords ? 2 : 0;
+	fetch->width = offset;
+	return true;
+}
+
+// copy n floats of a vertex attribute, clamped to [0,1].
+// not to be used directly
+static inline void _fetch_attrib(float* in, float* out, uint32_t n)
+{
+	for(uint32_t i = 0; i < n; i += 1)
+		out[i] = in[i] < 0.0f ? 0.0f : (in[i] > 1.0f ? 1.0f : in[i]);
+}
+
+// read a single vertex at 'data' as described by a fetch descriptor.
+// attributes absent from the layout are defaulted, others are clamped to [0,1].
+// not to be used directly
+static inline void _fetch_vertex(float* data, _vertex_fetch_t* fetch, _rl_vertex_t* out)
+{
+	out->position.x = data[0], out->position.y = data[1], out->position.z = data[2];
+	out->position.w = fetch->position_size == 4 ? data[3] : 1;
 	
-	float v0_position[4], v1_position[4], v2_position[4];
-	float v0_color[4], v1_color[4], v2_color[4];
-	float v0_normals[3], v1_normals[3], v2_normals[3];
-	float v0_tcoords[2], v1_tcoords[2], v2_tcoords[2];
+	out->color.x = 0, out->color.y = 0, out->color.z = 0, out->color.w = 1;
+	out->normals.x = 0, out->normals.y = 0, out->normals.z = 0;
+	out->tcoords.x = 0, out->tcoords.y = 0;
+	if(fetch->color >= 0)
+		_fetch_attrib(data + fetch->color, &out->color.x, 4);
+	if(fetch->normals >= 0)
+		_fetch_attrib(data + fetch->normals, &out->normals.x, 3);
+	if(fetch->tcoords >= 0)
+		_fetch_attrib(data + fetch->tcoords, &out->tcoords.x, 2);
+}
+
+// read vertex_count consecutive vertices of an array into 'vertices'.
+// not to be used directly
+void _fetch_vertices(float* data, _vertex_fetch_t* fetch, uint32_t vertex_count, _rl_vertex_t* vertices)
+{
+	for(uint32_t i = 0; i < vertex_count; i += 1, data += fetch->width)
+		_fetch_vertex(data, fetch, &vertices[i]);
+}
+
+// primitive assembly state, kept between the blocks of vertices of a draw (see _draw_vertices).
+// not to be used directly
+typedef struct _rl_assembly_t _rl_assembly_t;
+struct _rl_assembly_t
+{
+	_rl_vertex_t first;		// first vertex of a fan or loop
+	_rl_vertex_t prev[2];	// two previous vertices; prev[1] is the most recent
+	uint32_t v;				// vertex # within the draw
+};
+
+// vertex shade and process primitives described by read vertices.
+// vertices may be passed a block at a time; 'assembly' carries over between blocks and starts with a v of 0.
+// finish a draw with _end_assembly.
+// each vertex is shaded once; strips, fans & loops reuse the previously shaded vertices.
+// not to be used directly
+void _draw_vertices(uint32_t primitive_type, uint32_t vertex_count, _rl_vertex_t* vertices, _rl_assembly_t* assembly)
+{
+	bool mode_valid = (_rlcore->_mode == RL_FILL || _rlcore->_mode == RL_POINT || _rlcore->_mode == RL_LINE);
 	
 	float width_div_2  = _rlcore->_width / 2.0f;
 	float height_div_2 = _rlcore->_height / 2.0f;
-
-	bool has_position = false;
-	bool has_color = false;
-	bool has_normals = false;
-	bool has_tcoords = false;
 	
-	for(uint32_t p = 0; p < primitive_count; p += 1)
+	uint32_t type = RL_POINT;
+	if(primitive_type == RL_TRIANGLES || primitive_type == RL_TRIANGLE_STRIP || primitive_type == RL_TRIANGLE_FAN)
+		type = RL_TRIANGLE;
+	if(primitive_type == RL_LINES || primitive_type == RL_LINE_STRIP || primitive_type == RL_LINE_LOOP)
+		type = RL_LINE;
+	
+	_rl_vertex_t* first = &assembly->first;
+	_rl_vertex_t* prev = assembly->prev;
+	
+	for(uint32_t i = 0; i < vertex_count; i += 1)
 	{
-		if(primitive_type == RL_POINTS)
+		uint32_t v = assembly->v + i;
+		_rl_vertex_t vx = vertices[i];
+		vx.position = _vertex_pass(type, vx.position, vx.color, vx.normals, vx.tcoords);
+		
+		_rl_vertex_t* vx0 = NULL;
+		_rl_vertex_t* vx1 = NULL;
+		_rl_vertex_t* vx2 = NULL;
+		switch(primitive_type)
 		{
-			switch(_rlcore->_vertex_layout)
-			{
-				case RL_V3:
-				case RL_V4:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
+			case RL_POINTS:
+				vx0 = &vx;
 				break;
-				case RL_V3_C4:
-				case RL_V4_C4:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
+			case RL_LINES:
+				if(v & 1)
+					vx0 = &prev[1], vx1 = &vx;
 				break;
-				case RL_V3_N3:
-				case RL_V4_N3:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_normals = true;
+			case RL_LINE_STRIP:
+			case RL_LINE_LOOP:
+				if(v == 0)
+					*first = vx;
+				else
+					vx0 = &prev[1], vx1 = &vx;
 				break;
-				case RL_V3_T2:
-				case RL_V4_T2:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_tcoords = true;
+			case RL_TRIANGLES:
+				if(v % 3 == 2)
+					vx0 = &prev[0], vx1 = &prev[1], vx2 = &vx;
 				break;
-				case RL_V3_N3_T2:
-				case RL_V4_N3_T2:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				has_tcoords = true;
+			case RL_TRIANGLE_STRIP:
+				// odd triangles are swapped to keep the winding of the strip
+				if(v >= 2 && !(v & 1))
+					vx0 = &prev[0], vx1 = &prev[1], vx2 = &vx;
+				if(v >= 2 && (v & 1))
+					vx0 = &prev[1], vx1 = &prev[0], vx2 = &vx;
 				break;
-				case RL_V3_C4_N3:
-				case RL_V4_C4_N3:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
+			case RL_TRIANGLE_FAN:
+				if(v == 0)
+					*first = vx;
+				if(v >= 2)
+					vx0 = first, vx1 = &prev[1], vx2 = &vx;
 				break;
-				case RL_V3_C4_T2:
-				case RL_V4_C4_T2:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3_T2:
-				case RL_V4_C4_N3_T2:
-				_read_vertex(data, vertex_width, v, 1, v0_position, NULL, NULL, v0_color, NULL,
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-			}
-			
-			// process v0
-			// if not has_attrib, default the attribute.
-			
-			rlVec4 color_v0;
-			rlVec3 normals_v0;
-			rlVec2 tcoords_v0;
-			
-			rlVec4 v0;
-			v0.x = v0_position[0];
-			v0.y = v0_position[1];
-			v0.z = v0_position[2];
-			v0.w = v0_position[3];
-			
-			if(has_color)
-			{
-				if(v0_color[0] < 0.0f) v0_color[0] = 0.0f;
-				if(v0_color[0] > 1.0f) v0_color[0] = 1.0f;
-				if(v0_color[1] < 0.0f) v0_color[1] = 0.0f;
-				if(v0_color[1] > 1.0f) v0_color[1] = 1.0f;
-				if(v0_color[2] < 0.0f) v0_color[2] = 0.0f;
-				if(v0_color[2] > 1.0f) v0_color[2] = 1.0f;
-				if(v0_color[3] < 0.0f) v0_color[3] = 0.0f;
-				if(v0_color[3] > 1.0f) v0_color[3] = 1.0f;
-				color_v0.x = v0_color[0];
-				color_v0.y = v0_color[1];
-				color_v0.z = v0_color[2];
-				color_v0.w = v0_color[3];
-			}
-			else
-				color_v0.x = 0, color_v0.y = 0, color_v0.z = 0, color_v0.w = 1;
-			
-			if(has_normals)
-			{
-				if(v0_normals[0] < 0.0f) v0_normals[0] = 0.0f;
-				if(v0_normals[0] > 1.0f) v0_normals[0] = 1.0f;
-				if(v0_normals[1] < 0.0f) v0_normals[1] = 0.0f;
-				if(v0_normals[1] > 1.0f) v0_normals[1] = 1.0f;
-				if(v0_normals[2] < 0.0f) v0_normals[2] = 0.0f;
-				if(v0_normals[2] > 1.0f) v0_normals[2] = 1.0f;
-				normals_v0.x = v0_normals[0];
-				normals_v0.y = v0_normals[1];
-				normals_v0.z = v0_normals[2];
-			}
-			else
-				normals_v0.x = 0, normals_v0.y = 0, normals_v0.z = 0;
-			
-			if(has_tcoords)
-			{
-				if(v0_tcoords[0] < 0.0f) v0_tcoords[0] = 0.0f;
-				if(v0_tcoords[0] > 1.0f) v0_tcoords[0] = 1.0f;
-				if(v0_tcoords[1] < 0.0f) v0_tcoords[1] = 0.0f;
-				if(v0_tcoords[1] > 1.0f) v0_tcoords[1] = 1.0f;
-				tcoords_v0.x = v0_tcoords[0];
-				tcoords_v0.y = v0_tcoords[1];
-			}
-			
-			v0 = _vertex_pass(RL_POINT, v0, color_v0, normals_v0, tcoords_v0);
-			
+		}
+		if(type == RL_POINT && vx0)
+		{
 			if(mode_valid)
 			{
-				_process_point(v0, color_v0, width_div_2, height_div_2);
+				_process_point(vx0->position, vx0->color, width_div_2, height_div_2);
 			}
-			
-			v += 1;
 		}
-		if(primitive_type == RL_LINES)
+		if(type == RL_LINE && vx0)
 		{
-			switch(_rlcore->_vertex_layout)
-			{
-				case RL_V3:
-				case RL_V4:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				break;
-				case RL_V3_C4:
-				case RL_V4_C4:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, v0_color, 
-					v1_color, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				break;
-				case RL_V3_N3:
-				case RL_V4_N3:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, NULL, NULL, 
-					NULL, v0_normals, v1_normals, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				break;
-				case RL_V3_T2:
-				case RL_V4_T2:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v0_tcoords, v1_tcoords, NULL);
-				has_position = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_N3_T2:
-				case RL_V4_N3_T2:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, NULL, NULL, 
-					NULL, v0_normals, v1_normals, NULL, v0_tcoords, v1_tcoords, NULL);
-				has_position = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3:
-				case RL_V4_C4_N3:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, v0_color, 
-					v1_color, NULL, v0_normals, v1_normals, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				break;
-				case RL_V3_C4_T2:
-				case RL_V4_C4_T2:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, v0_color, 
-					v1_color, NULL, NULL, NULL, NULL, v0_tcoords, v1_tcoords, NULL);
-				has_position = true;
-				has_color = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3_T2:
-				case RL_V4_C4_N3_T2:
-				_read_vertex(data, vertex_width, v, 2, v0_position, v1_position, NULL, v0_color, v1_color,
-					NULL, v0_normals, v1_normals, NULL, v0_tcoords, v1_tcoords, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-			}
-			
-			// process v0 & v1
-			// if not has_attrib, default the attribute.
-			
-			rlVec2 raster_v0, raster_v1;
-			rlVec4 color_v0, color_v1;
-			rlVec3 normals_v0, normals_v1;
-			rlVec2 tcoords_v0, tcoords_v1;
-
-			rlVec4 v0, v1;
-			v0.x = v0_position[0];
-			v0.y = v0_position[1];
-			v0.z = v0_position[2];
-			v0.w = v0_position[3];
-			v1.x = v1_position[0];
-			v1.y = v1_position[1];
-			v1.z = v1_position[2];
-			v1.w = v1_position[3];
-			
-			if(has_color)
-			{
-				if(v0_color[0] < 0.0f) v0_color[0] = 0.0f;
-				if(v0_color[0] > 1.0f) v0_color[0] = 1.0f;
-				if(v0_color[1] < 0.0f) v0_color[1] = 0.0f;
-				if(v0_color[1] > 1.0f) v0_color[1] = 1.0f;
-				if(v0_color[2] < 0.0f) v0_color[2] = 0.0f;
-				if(v0_color[2] > 1.0f) v0_color[2] = 1.0f;
-				if(v0_color[3] < 0.0f) v0_color[3] = 0.0f;
-				if(v0_color[3] > 1.0f) v0_color[3] = 1.0f;
-				if(v1_color[0] < 0.0f) v1_color[0] = 0.0f;
-				if(v1_color[0] > 1.0f) v1_color[0] = 1.0f;
-				if(v1_color[1] < 0.0f) v1_color[1] = 0.0f;
-				if(v1_color[1] > 1.0f) v1_color[1] = 1.0f;
-				if(v1_color[2] < 0.0f) v1_color[2] = 0.0f;
-				if(v1_color[2] > 1.0f) v1_color[2] = 1.0f;
-				if(v1_color[3] < 0.0f) v1_color[3] = 0.0f;
-				if(v1_color[3] > 1.0f) v1_color[3] = 1.0f;
-				color_v0.x = v0_color[0], color_v1.x = v1_color[0];
-				color_v0.y = v0_color[1], color_v1.y = v1_color[1];
-				color_v0.z = v0_color[2], color_v1.z = v1_color[2];
-				color_v0.w = v0_color[3], color_v1.w = v1_color[3];
-			}
-			else
-			{
-				color_v0.x = 0, color_v0.y = 0, color_v0.z = 0, color_v0.w = 1;
-				color_v1.x = 0, color_v1.y = 0, color_v1.z = 0, color_v1.w = 1;
-			}
-			
-			if(has_normals)
-			{
-				if(v0_normals[0] < 0.0f) v0_normals[0] = 0.0f;
-				if(v0_normals[0] > 1.0f) v0_normals[0] = 1.0f;
-				if(v0_normals[1] < 0.0f) v0_normals[1] = 0.0f;
-				if(v0_normals[1] > 1.0f) v0_normals[1] = 1.0f;
-				if(v0_normals[2] < 0.0f) v0_normals[2] = 0.0f;
-				if(v0_normals[2] > 1.0f) v0_normals[2] = 1.0f;
-				if(v1_normals[0] < 0.0f) v1_normals[0] = 0.0f;
-				if(v1_normals[0] > 1.0f) v1_normals[0] = 1.0f;
-				if(v1_normals[1] < 0.0f) v1_normals[1] = 0.0f;
-				if(v1_normals[1] > 1.0f) v1_normals[1] = 1.0f;
-				if(v1_normals[2] < 0.0f) v1_normals[2] = 0.0f;
-				if(v1_normals[2] > 1.0f) v1_normals[2] = 1.0f;
-				normals_v0.x = v0_normals[0], normals_v1.x = v1_normals[0];
-				normals_v0.y = v0_normals[1], normals_v1.y = v1_normals[1];
-				normals_v0.z = v0_normals[2], normals_v1.z = v1_normals[2];
-			}
-			else
-			{
-				normals_v0.x = 0, normals_v0.y = 0, normals_v0.z = 0;
-				normals_v1.x = 0, normals_v1.y = 0, normals_v1.z = 0;
-			}
-			
-			if(has_tcoords)
-			{
-				if(v0_tcoords[0] < 0.0f) v0_tcoords[0] = 0.0f;
-				if(v0_tcoords[0] > 1.0f) v0_tcoords[0] = 1.0f;
-				if(v0_tcoords[1] < 0.0f) v0_tcoords[1] = 0.0f;
-				if(v0_tcoords[1] > 1.0f) v0_tcoords[1] = 1.0f;
-				if(v1_tcoords[0] < 0.0f) v1_tcoords[0] = 0.0f;
-				if(v1_tcoords[0] > 1.0f) v1_tcoords[0] = 1.0f;
-				if(v1_tcoords[1] < 0.0f) v1_tcoords[1] = 0.0f;
-				if(v1_tcoords[1] > 1.0f) v1_tcoords[1] = 1.0f;
-				tcoords_v0.x = v0_tcoords[0], tcoords_v1.x = v1_tcoords[0];
-				tcoords_v0.y = v0_tcoords[1], tcoords_v1.y = v1_tcoords[1];
-			}
-			else
-			{
-				tcoords_v0.x = 0, tcoords_v1.x = 0;
-				tcoords_v0.y = 0, tcoords_v1.y = 0;
-			}
-			
-			v0 = _vertex_pass(RL_LINE, v0, color_v0, normals_v0, tcoords_v0);
-			v1 = _vertex_pass(RL_LINE, v1, color_v1, normals_v1, tcoords_v1);
-			
 			if(_rlcore->_mode == RL_LINE || _rlcore->_mode == RL_FILL)
 			{
-				_process_line(v0, v1, color_v0, color_v1, tcoords_v0, tcoords_v1, width_div_2, height_div_2);
+				_process_line(vx0->position, vx1->position, vx0->color, vx1->color, vx0->tcoords, vx1->tcoords, width_div_2, height_div_2);
 			}
 			else if(_rlcore->_mode == RL_POINT)
 			{
-				_process_point(v0, color_v0, width_div_2, height_div_2);
-				_process_point(v1, color_v1, width_div_2, height_div_2);
+				_process_point(vx0->position, vx0->color, width_div_2, height_div_2);
+				_process_point(vx1->position, vx1->color, width_div_2, height_div_2);
 			}
-			
-			v += 2;
 		}
-		if(primitive_type == RL_TRIANGLES)
+		if(type == RL_TRIANGLE && vx0)
 		{
-			switch(_rlcore->_vertex_layout)
-			{
-				case RL_V3:
-				case RL_V4:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				break;
-				case RL_V3_C4:
-				case RL_V4_C4:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, v0_color, 
-					v1_color, v2_color, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				break;
-				case RL_V3_N3:
-				case RL_V4_N3:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, NULL, NULL, 
-					NULL, v0_normals, v1_normals, v2_normals, NULL, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				break;
-				case RL_V3_T2:
-				case RL_V4_T2:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v0_tcoords, v1_tcoords, v2_tcoords);
-				has_position = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_N3_T2:
-				case RL_V4_N3_T2:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, NULL, NULL, 
-					NULL, v0_normals, v1_normals, v2_normals, v0_tcoords, v1_tcoords, v2_tcoords);
-				has_position = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3:
-				case RL_V4_C4_N3:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, v0_color, 
-					v1_color, v2_color, v0_normals, v1_normals, v2_normals, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				break;
-				case RL_V3_C4_T2:
-				case RL_V4_C4_T2:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, v0_color, 
-					v1_color, v2_color, NULL, NULL, NULL, v0_tcoords, v1_tcoords, v2_tcoords);
-				has_position = true;
-				has_color = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3_T2:
-				case RL_V4_C4_N3_T2:
-				_read_vertex(data, vertex_width, v, 3, v0_position, v1_position, v2_position, v0_color, v1_color,
-					v2_color, v0_normals, v1_normals, v2_normals, v0_tcoords, v1_tcoords, v2_tcoords);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-			}
-			
-			// process v0, v1 & v2
-			// if not has_attrib, default the attribute.
-			
-			rlVec4 color_v0, color_v1, color_v2;
-			rlVec3 normals_v0, normals_v1, normals_v2;
-			rlVec2 tcoords_v0, tcoords_v1, tcoords_v2;
-			
-			rlVec4 v0, v1, v2;
-			v0.x = v0_position[0];
-			v0.y = v0_position[1];
-			v0.z = v0_position[2];
-			v0.w = v0_position[3];
-			v1.x = v1_position[0];
-			v1.y = v1_position[1];
-			v1.z = v1_position[2];
-			v1.w = v1_position[3];
-			v2.x = v2_position[0];
-			v2.y = v2_position[1];
-			v2.z = v2_position[2];
-			v2.w = v2_position[3];
-			
-			if(has_color)
-			{
-				if(v0_color[0] < 0.0f) v0_color[0] = 0.0f;
-				if(v0_color[0] > 1.0f) v0_color[0] = 1.0f;
-				if(v0_color[1] < 0.0f) v0_color[1] = 0.0f;
-				if(v0_color[1] > 1.0f) v0_color[1] = 1.0f;
-				if(v0_color[2] < 0.0f) v0_color[2] = 0.0f;
-				if(v0_color[2] > 1.0f) v0_color[2] = 1.0f;
-				if(v0_color[3] < 0.0f) v0_color[3] = 0.0f;
-				if(v0_color[3] > 1.0f) v0_color[3] = 1.0f;
-				if(v1_color[0] < 0.0f) v1_color[0] = 0.0f;
-				if(v1_color[0] > 1.0f) v1_color[0] = 1.0f;
-				if(v1_color[1] < 0.0f) v1_color[1] = 0.0f;
-				if(v1_color[1] > 1.0f) v1_color[1] = 1.0f;
-				if(v1_color[2] < 0.0f) v1_color[2] = 0.0f;
-				if(v1_color[2] > 1.0f) v1_color[2] = 1.0f;
-				if(v1_color[3] < 0.0f) v1_color[3] = 0.0f;
-				if(v1_color[3] > 1.0f) v1_color[3] = 1.0f;
-				if(v2_color[0] < 0.0f) v2_color[0] = 0.0f;
-				if(v2_color[0] > 1.0f) v2_color[0] = 1.0f;
-				if(v2_color[1] < 0.0f) v2_color[1] = 0.0f;
-				if(v2_color[1] > 1.0f) v2_color[1] = 1.0f;
-				if(v2_color[2] < 0.0f) v2_color[2] = 0.0f;
-				if(v2_color[2] > 1.0f) v2_color[2] = 1.0f;
-				if(v2_color[3] < 0.0f) v2_color[3] = 0.0f;
-				if(v2_color[3] > 1.0f) v2_color[3] = 1.0f;
-				color_v0.x = v0_color[0], color_v1.x = v1_color[0], color_v2.x = v2_color[0];
-				color_v0.y = v0_color[1], color_v1.y = v1_color[1], color_v2.y = v2_color[1];
-				color_v0.z = v0_color[2], color_v1.z = v1_color[2], color_v2.z = v2_color[2];
-				color_v0.w = v0_color[3], color_v1.w = v1_color[3], color_v2.w = v2_color[3];
-			}
-			else
-			{
-				color_v0.x = 0, color_v0.y = 0, color_v0.z = 0, color_v0.w = 1;
-				color_v1.x = 0, color_v1.y = 0, color_v1.z = 0, color_v1.w = 1;
-				color_v2.x = 0, color_v2.y = 0, color_v2.z = 0, color_v2.w = 1;
-			}
-			
-			if(has_normals)
-			{
-				if(v0_normals[0] < 0.0f) v0_normals[0] = 0.0f;
-				if(v0_normals[0] > 1.0f) v0_normals[0] = 1.0f;
-				if(v0_normals[1] < 0.0f) v0_normals[1] = 0.0f;
-				if(v0_normals[1] > 1.0f) v0_normals[1] = 1.0f;
-				if(v0_normals[2] < 0.0f) v0_normals[2] = 0.0f;
-				if(v0_normals[2] > 1.0f) v0_normals[2] = 1.0f;
-				if(v1_normals[0] < 0.0f) v1_normals[0] = 0.0f;
-				if(v1_normals[0] > 1.0f) v1_normals[0] = 1.0f;
-				if(v1_normals[1] < 0.0f) v1_normals[1] = 0.0f;
-				if(v1_normals[1] > 1.0f) v1_normals[1] = 1.0f;
-				if(v1_normals[2] < 0.0f) v1_normals[2] = 0.0f;
-				if(v1_normals[2] > 1.0f) v1_normals[2] = 1.0f;
-				if(v2_normals[0] < 0.0f) v2_normals[0] = 0.0f;
-				if(v2_normals[0] > 1.0f) v2_normals[0] = 1.0f;
-				if(v2_normals[1] < 0.0f) v2_normals[1] = 0.0f;
-				if(v2_normals[1] > 1.0f) v2_normals[1] = 1.0f;
-				if(v2_normals[2] < 0.0f) v2_normals[2] = 0.0f;
-				if(v2_normals[2] > 1.0f) v2_normals[2] = 1.0f;
-				normals_v0.x = v0_normals[0], normals_v1.x = v1_normals[0], normals_v2.x = v2_normals[0];
-				normals_v0.y = v0_normals[1], normals_v1.y = v1_normals[1], normals_v2.y = v2_normals[1];
-				normals_v0.z = v0_normals[2], normals_v1.z = v1_normals[2], normals_v2.z = v2_normals[2];
-			}
-			else
-			{
-				normals_v0.x = 0, normals_v0.y = 0, normals_v0.z = 0;
-				normals_v1.x = 0, normals_v1.y = 0, normals_v1.z = 0;
-				normals_v2.x = 0, normals_v2.y = 0, normals_v2.z = 0;
-			}
-			
-			if(has_tcoords)
-			{
-				if(v0_tcoords[0] < 0.0f) v0_tcoords[0] = 0.0f;
-				if(v0_tcoords[0] > 1.0f) v0_tcoords[0] = 1.0f;
-				if(v0_tcoords[1] < 0.0f) v0_tcoords[1] = 0.0f;
-				if(v0_tcoords[1] > 1.0f) v0_tcoords[1] = 1.0f;
-				if(v1_tcoords[0] < 0.0f) v1_tcoords[0] = 0.0f;
-				if(v1_tcoords[0] > 1.0f) v1_tcoords[0] = 1.0f;
-				if(v1_tcoords[1] < 0.0f) v1_tcoords[1] = 0.0f;
-				if(v1_tcoords[1] > 1.0f) v1_tcoords[1] = 1.0f;
-				if(v2_tcoords[0] < 0.0f) v2_tcoords[0] = 0.0f;
-				if(v2_tcoords[0] > 1.0f) v2_tcoords[0] = 1.0f;
-				if(v2_tcoords[1] < 0.0f) v2_tcoords[1] = 0.0f;
-				if(v2_tcoords[1] > 1.0f) v2_tcoords[1] = 1.0f;
-				tcoords_v0.x = v0_tcoords[0], tcoords_v1.x = v1_tcoords[0], tcoords_v2.x = v2_tcoords[0];
-				tcoords_v0.y = v0_tcoords[1], tcoords_v1.y = v1_tcoords[1], tcoords_v2.y = v2_tcoords[1];
-			}
-			else
-			{
-				tcoords_v0.x = 0, tcoords_v1.x = 0, tcoords_v2.x = 0;
-				tcoords_v0.y = 0, tcoords_v1.y = 0, tcoords_v2.y = 0;
-			}
-			
-			v0 = _vertex_pass(RL_TRIANGLE, v0, color_v0, normals_v0, tcoords_v0);
-			v1 = _vertex_pass(RL_TRIANGLE, v1, color_v1, normals_v1, tcoords_v1);
-			v2 = _vertex_pass(RL_TRIANGLE, v2, color_v2, normals_v2, tcoords_v2);
-			
+			rlVec4 v0 = vx0->position, v1 = vx1->position, v2 = vx2->position;
 			if(_rlcore->_mode == RL_FILL)
-				_process_triangle(v0, v1, v2, color_v0, color_v1, color_v2, tcoords_v0, tcoords_v1, tcoords_v2, width_div_2, height_div_2);
+				_process_triangle(v0, v1, v2, vx0->color, vx1->color, vx2->color, vx0->tcoords, vx1->tcoords, vx2->tcoords, width_div_2, height_div_2);
 			if(_rlcore->_mode == RL_LINE)
 			{
-				_process_line(v0, v1, color_v0, color_v1, tcoords_v0, tcoords_v1, width_div_2, height_div_2);
-				_process_line(v1, v2, color_v1, color_v2, tcoords_v1, tcoords_v2, width_div_2, height_div_2);
-				_process_line(v2, v0, color_v2, color_v0, tcoords_v2, tcoords_v0, width_div_2, height_div_2);
+				_process_line(v0, v1, vx0->color, vx1->color, vx0->tcoords, vx1->tcoords, width_div_2, height_div_2);
+				_process_line(v1, v2, vx1->color, vx2->color, vx1->tcoords, vx2->tcoords, width_div_2, height_div_2);
+				_process_line(v2, v0, vx2->color, vx0->color, vx2->tcoords, vx0->tcoords, width_div_2, height_div_2);
 			}
 			else if(_rlcore->_mode == RL_POINT)
 			{
-				_process_point(v0, color_v0, width_div_2, height_div_2);
-				_process_point(v1, color_v1, width_div_2, height_div_2);
-				_process_point(v2, color_v2, width_div_2, height_div_2);
+				_process_point(v0, vx0->color, width_div_2, height_div_2);
+				_process_point(v1, vx1->color, width_div_2, height_div_2);
+				_process_point(v2, vx2->color, width_div_2, height_div_2);
 			}
-			
-			v += 3;
 		}
+		
+		prev[0] = prev[1];
+		prev[1] = vx;
 	}
+	assembly->v += vertex_count;
 }
 
-/* draw primitives described by an array and an index array */
-void rlDrawElements(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t* elements)
-{	
-	if(!_rlcore)
-		return;
+// finish the primitive assembly of a draw; closes a line loop.
+// not to be used directly
+void _end_assembly(uint32_t primitive_type, _rl_assembly_t* assembly)
+{
+	_rl_vertex_t* first = &assembly->first;
+	_rl_vertex_t* last = &assembly->prev[1];
+	float width_div_2  = _rlcore->_width / 2.0f;
+	float height_div_2 = _rlcore->_height / 2.0f;
 	
-	uint32_t vertex_count = 0;
-	switch(primitive_type)
+	// close the loop
+	if(primitive_type == RL_LINE_LOOP && assembly->v > 1)
 	{
-		case RL_POINTS:
-		vertex_count = primitive_count;
-		break;
-		case RL_LINES:
-		vertex_count = primitive_count * 2;
-		break;
-		case RL_TRIANGLES:
-		vertex_count = primitive_count * 3;
-		break;
-		default:
-		// unhandled error: invalid parameter
-		return;
+		if(_rlcore->_mode == RL_LINE || _rlcore->_mode == RL_FILL)
+			_process_line(last->position, first->position, last->color, first->color, last->tcoords, first->tcoords, width_div_2, height_div_2);
+		else if(_rlcore->_mode == RL_POINT)
+		{
+			_process_point(last->position, last->color, width_div_2, height_div_2);
+			_process_point(first->position, first->color, width_div_2, height_div_2);
+		}
 	}
-	
-	uint32_t vertex_width = 0;
-	switch(_rlcore->_vertex_layout)
+	assembly->v = 0;
+}
+
+// read the vertices of an index array; a loop per index type.
+// not to be used directly
+void _fetch_elements(float* data, _vertex_fetch_t* fetch, uint32_t vertex_count, uint32_t type, void* elements, _rl_vertex_t* vertices)
+{
+	uint32_t width = fetch->width;
+	switch(type)
 	{
-		case RL_V3:		vertex_width = 3;	break;
-		case RL_V3_C4:	vertex_width = 7;	break;
-		case RL_V3_N3:	vertex_width = 6;	break;
-		case RL_V3_T2:	vertex_width = 5;	break;
-		case RL_V3_N3_T2:		vertex_width = 8;	break;
-		case RL_V3_C4_N3:		vertex_width = 10;	break;
-		case RL_V3_C4_T2:		vertex_width = 9;	break;
-		case RL_V3_C4_N3_T2:	vertex_width = 12;	break;
-		case RL_V4:		vertex_width = 4;	break;
-		case RL_V4_C4:	vertex_width = 8;	break;
-		case RL_V4_N3:	vertex_width = 7;	break;
-		case RL_V4_T2:	vertex_width = 6;	break;
-		case RL_V4_N3_T2:		vertex_width = 9;	break;
-		case RL_V4_C4_N3:		vertex_width = 11;	break;
-		case RL_V4_C4_T2:		vertex_width = 10;	break;
-		case RL_V4_C4_N3_T2:	vertex_width = 13;	break;
-		default:
-		// unhandled error: unknown vertex layout
+		case RL_UNSIGNED_BYTE:
+			for(uint32_t i = 0; i < vertex_count; i += 1)
+				_fetch_vertex(data + ((uint8_t*)elements)[i] * width, fetch, &vertices[i]);
+			break;
+		case RL_UNSIGNED_SHORT:
+			for(uint32_t i = 0; i < vertex_count; i += 1)
+				_fetch_vertex(data + ((uint16_t*)elements)[i] * width, fetch, &vertices[i]);
+			break;
+		case RL_UNSIGNED_INT:
+			for(uint32_t i = 0; i < vertex_count; i += 1)
+				_fetch_vertex(data + ((uint32_t*)elements)[i] * width, fetch, &vertices[i]);
+			break;
+	}
+}
+
+// where the vertices of a draw are read from: consecutive vertices of 'data', or the vertices
+// indexed by 'elements' of 'type' when elements isn't NULL.
+// not to be used directly
+typedef struct _rl_vertex_source_t _rl_vertex_source_t;
+struct _rl_vertex_source_t
+{
+	float* data;
+	_vertex_fetch_t fetch;
+	uint32_t type;
+	void* elements;
+};
+
+// read vertices [first, first + vertex_count) of a draw into 'vertices'.
+// not to be used directly
+void _fetch_source(_rl_vertex_source_t* source, uint32_t first, uint32_t vertex_count, _rl_vertex_t* vertices)
+{
+	if(!source->elements)
+	{
+		_fetch_vertices(source->data + first * source->fetch.width, &source->fetch, vertex_count, vertices);
 		return;
 	}
 	
-	bool mode_valid = (_rlcore->_mode == RL_FILL || _rlcore->_mode == RL_POINT || _rlcore->_mode == RL_LINE);
-	
-	uint32_t v = 0;
-	
-	float v0_position[4], v1_position[4], v2_position[4];
-	float v0_color[4], v1_color[4], v2_color[4];
-	float v0_normals[3], v1_normals[3], v2_normals[3];
-	float v0_tcoords[2], v1_tcoords[2], v2_tcoords[2];
-	
-	float width_div_2  = _rlcore->_width / 2.0f;
-	float height_div_2 = _rlcore->_height / 2.0f;
+	uint32_t size = source->type == RL_UNSIGNED_BYTE ? 1 : (source->type == RL_UNSIGNED_SHORT ? 2 : 4);
+	_fetch_elements(source->data, &source->fetch, vertex_count, source->type, (uint8_t*)source->elements + first * size, vertices);
+}
 
-	bool has_position = false;
-	bool has_color = false;
-	bool has_normals = false;
-	bool has_tcoords = false;
+// draw the vertices of a source once per instance. the vertices are vertex shaded per instance.
+// several instances read the vertices once, up front; a single instance is streamed instead:
+// read, shaded & processed RL_STREAM_VERTICES at a time.
+// not to be used directly
+void _draw_instances(uint32_t primitive_type, uint32_t vertex_count, _rl_vertex_source_t* source, 
+	uint32_t instance_count, float* instance_data, uint32_t instance_width)
+{
+	_rl_vertex_t* vertices = NULL;
+	if(instance_count > 1)
+	{
+		vertices = (_rl_vertex_t*) _rl_malloc(vertex_count * sizeof(_rl_vertex_t));
+		if(!vertices)
+			// unhandled error: out of memory
+			return;
+		_fetch_source(source, 0, vertex_count, vertices);
+	}
+	
+	// points of the draw share one fragment data block
+	_rlcore->_point_attrib_data = _alloc_fragment_data(&_rlcore->_point_attrib_count, 
+		&_rlcore->_point_data_size, &_rlcore->_point_attrib_format);
 	
-	for(uint32_t p = 0; p < primitive_count; p += 1)
+	_rl_assembly_t assembly;
+	assembly.v = 0;
+	for(uint32_t i = 0; i < instance_count; i += 1)
 	{
-		if(primitive_type == RL_POINTS)
+		rlVec4 attrib;
+		attrib.x = 0, attrib.y = 0, attrib.z = 0, attrib.w = 1;
+		if(instance_data)
 		{
-			switch(_rlcore->_vertex_layout)
-			{
-				case RL_V3:
-				case RL_V4:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				break;
-				case RL_V3_C4:
-				case RL_V4_C4:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				break;
-				case RL_V3_N3:
-				case RL_V4_N3:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				break;
-				case RL_V3_T2:
-				case RL_V4_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_N3_T2:
-				case RL_V4_N3_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3:
-				case RL_V4_C4_N3:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				break;
-				case RL_V3_C4_T2:
-				case RL_V4_C4_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3_T2:
-				case RL_V4_C4_N3_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, NULL,
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-			}
-			
-			// process v0
-			// if not has_attrib, default the attribute.
-			
-			rlVec4 color_v0;
-			rlVec3 normals_v0;
-			rlVec2 tcoords_v0;
-			
-			rlVec4 v0;
-			v0.x = v0_position[0];
-			v0.y = v0_position[1];
-			v0.z = v0_position[2];
-			v0.w = v0_position[3];
-			
-			if(has_color)
-			{
-				if(v0_color[0] < 0.0f) v0_color[0] = 0.0f;
-				if(v0_color[0] > 1.0f) v0_color[0] = 1.0f;
-				if(v0_color[1] < 0.0f) v0_color[1] = 0.0f;
-				if(v0_color[1] > 1.0f) v0_color[1] = 1.0f;
-				if(v0_color[2] < 0.0f) v0_color[2] = 0.0f;
-				if(v0_color[2] > 1.0f) v0_color[2] = 1.0f;
-				if(v0_color[3] < 0.0f) v0_color[3] = 0.0f;
-				if(v0_color[3] > 1.0f) v0_color[3] = 1.0f;
-				color_v0.x = v0_color[0];
-				color_v0.y = v0_color[1];
-				color_v0.z = v0_color[2];
-				color_v0.w = v0_color[3];
-			}
-			else
-				color_v0.x = 0, color_v0.y = 0, color_v0.z = 0, color_v0.w = 1;
-			
-			if(has_normals)
-			{
-				if(v0_normals[0] < 0.0f) v0_normals[0] = 0.0f;
-				if(v0_normals[0] > 1.0f) v0_normals[0] = 1.0f;
-				if(v0_normals[1] < 0.0f) v0_normals[1] = 0.0f;
-				if(v0_normals[1] > 1.0f) v0_normals[1] = 1.0f;
-				if(v0_normals[2] < 0.0f) v0_normals[2] = 0.0f;
-				if(v0_normals[2] > 1.0f) v0_normals[2] = 1.0f;
-				normals_v0.x = v0_normals[0];
-				normals_v0.y = v0_normals[1];
-				normals_v0.z = v0_normals[2];
-			}
-			else
-				normals_v0.x = 0, normals_v0.y = 0, normals_v0.z = 0;
-			
-			if(has_tcoords)
-			{
-				if(v0_tcoords[0] < 0.0f) v0_tcoords[0] = 0.0f;
-				if(v0_tcoords[0] > 1.0f) v0_tcoords[0] = 1.0f;
-				if(v0_tcoords[1] < 0.0f) v0_tcoords[1] = 0.0f;
-				if(v0_tcoords[1] > 1.0f) v0_tcoords[1] = 1.0f;
-				tcoords_v0.x = v0_tcoords[0];
-				tcoords_v0.y = v0_tcoords[1];
-			}
-			
-			v0 = _vertex_pass(RL_POINT, v0, color_v0, normals_v0, tcoords_v0);
-			
-			if(mode_valid)
-			{
-				_process_point(v0, color_v0, width_div_2, height_div_2);
-			}
-			
-			v += 1;
+			float* instance = instance_data + i * instance_width;
+			if(instance_width > 0) attrib.x = instance[0];
+			if(instance_width > 1) attrib.y = instance[1];
+			if(instance_width > 2) attrib.z = instance[2];
+			if(instance_width > 3) attrib.w = instance[3];
 		}
-		if(primitive_type == RL_LINES)
+		_rlcore->_instance_id = i;
+		_rlcore->_instance_attrib = attrib;
+		
+		if(vertices)
+			_draw_vertices(primitive_type, vertex_count, vertices, &assembly);
+		else
 		{
-			switch(_rlcore->_vertex_layout)
-			{
-				case RL_V3:
-				case RL_V4:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				break;
-				case RL_V3_C4:
-				case RL_V4_C4:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				break;
-				case RL_V3_N3:
-				case RL_V4_N3:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL, 
-					NULL, v1_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				break;
-				case RL_V3_T2:
-				case RL_V4_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v1_tcoords, NULL, NULL);
-				has_position = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_N3_T2:
-				case RL_V4_N3_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL, 
-					NULL, v1_normals, NULL, NULL, v1_tcoords, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3:
-				case RL_V4_C4_N3:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, 
-					NULL, NULL, v1_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				break;
-				case RL_V3_C4_T2:
-				case RL_V4_C4_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, 
-					NULL, NULL, NULL, NULL, NULL, v1_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3_T2:
-				case RL_V4_C4_N3_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, NULL,
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, NULL,
-					NULL, v1_normals, NULL, NULL, v1_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-			}
-			
-			// process v0 & v1
-			// if not has_attrib, default the attribute.
-			
-			rlVec2 raster_v0, raster_v1;
-			rlVec4 color_v0, color_v1;
-			rlVec3 normals_v0, normals_v1;
-			rlVec2 tcoords_v0, tcoords_v1;
-
-			rlVec4 v0, v1;
-			v0.x = v0_position[0];
-			v0.y = v0_position[1];
-			v0.z = v0_position[2];
-			v0.w = v0_position[3];
-			v1.x = v1_position[0];
-			v1.y = v1_position[1];
-			v1.z = v1_position[2];
-			v1.w = v1_position[3];
-			
-			if(has_color)
-			{
-				if(v0_color[0] < 0.0f) v0_color[0] = 0.0f;
-				if(v0_color[0] > 1.0f) v0_color[0] = 1.0f;
-				if(v0_color[1] < 0.0f) v0_color[1] = 0.0f;
-				if(v0_color[1] > 1.0f) v0_color[1] = 1.0f;
-				if(v0_color[2] < 0.0f) v0_color[2] = 0.0f;
-				if(v0_color[2] > 1.0f) v0_color[2] = 1.0f;
-				if(v0_color[3] < 0.0f) v0_color[3] = 0.0f;
-				if(v0_color[3] > 1.0f) v0_color[3] = 1.0f;
-				if(v1_color[0] < 0.0f) v1_color[0] = 0.0f;
-				if(v1_color[0] > 1.0f) v1_color[0] = 1.0f;
-				if(v1_color[1] < 0.0f) v1_color[1] = 0.0f;
-				if(v1_color[1] > 1.0f) v1_color[1] = 1.0f;
-				if(v1_color[2] < 0.0f) v1_color[2] = 0.0f;
-				if(v1_color[2] > 1.0f) v1_color[2] = 1.0f;
-				if(v1_color[3] < 0.0f) v1_color[3] = 0.0f;
-				if(v1_color[3] > 1.0f) v1_color[3] = 1.0f;
-				color_v0.x = v0_color[0], color_v1.x = v1_color[0];
-				color_v0.y = v0_color[1], color_v1.y = v1_color[1];
-				color_v0.z = v0_color[2], color_v1.z = v1_color[2];
-				color_v0.w = v0_color[3], color_v1.w = v1_color[3];
-			}
-			else
-			{
-				color_v0.x = 0, color_v0.y = 0, color_v0.z = 0, color_v0.w = 1;
-				color_v1.x = 0, color_v1.y = 0, color_v1.z = 0, color_v1.w = 1;
-			}
-			
-			if(has_normals)
-			{
-				if(v0_normals[0] < 0.0f) v0_normals[0] = 0.0f;
-				if(v0_normals[0] > 1.0f) v0_normals[0] = 1.0f;
-				if(v0_normals[1] < 0.0f) v0_normals[1] = 0.0f;
-				if(v0_normals[1] > 1.0f) v0_normals[1] = 1.0f;
-				if(v0_normals[2] < 0.0f) v0_normals[2] = 0.0f;
-				if(v0_normals[2] > 1.0f) v0_normals[2] = 1.0f;
-				if(v1_normals[0] < 0.0f) v1_normals[0] = 0.0f;
-				if(v1_normals[0] > 1.0f) v1_normals[0] = 1.0f;
-				if(v1_normals[1] < 0.0f) v1_normals[1] = 0.0f;
-				if(v1_normals[1] > 1.0f) v1_normals[1] = 1.0f;
-				if(v1_normals[2] < 0.0f) v1_normals[2] = 0.0f;
-				if(v1_normals[2] > 1.0f) v1_normals[2] = 1.0f;
-				normals_v0.x = v0_normals[0], normals_v1.x = v1_normals[0];
-				normals_v0.y = v0_normals[1], normals_v1.y = v1_normals[1];
-				normals_v0.z = v0_normals[2], normals_v1.z = v1_normals[2];
-			}
-			else
+			_rl_vertex_t block[RL_STREAM_VERTICES];
+			for(uint32_t first = 0; first < vertex_count; first += RL_STREAM_VERTICES)
 			{
-				normals_v0.x = 0, normals_v0.y = 0, normals_v0.z = 0;
-				normals_v1.x = 0, normals_v1.y = 0, normals_v1.z = 0;
+				uint32_t count = vertex_count - first < RL_STREAM_VERTICES ? vertex_count - first : RL_STREAM_VERTICES;
+				_fetch_source(source, first, count, block);
+				_draw_vertices(primitive_type, count, block, &assembly);
 			}
-			
-			if(has_tcoords)
-			{
-				if(v0_tcoords[0] < 0.0f) v0_tcoords[0] = 0.0f;
-				if(v0_tcoords[0] > 1.0f) v0_tcoords[0] = 1.0f;
-				if(v0_tcoords[1] < 0.0f) v0_tcoords[1] = 0.0f;
-				if(v0_tcoords[1] > 1.0f) v0_tcoords[1] = 1.0f;
-				if(v1_tcoords[0] < 0.0f) v1_tcoords[0] = 0.0f;
-				if(v1_tcoords[0] > 1.0f) v1_tcoords[0] = 1.0f;
-				if(v1_tcoords[1] < 0.0f) v1_tcoords[1] = 0.0f;
-				if(v1_tcoords[1] > 1.0f) v1_tcoords[1] = 1.0f;
-				tcoords_v0.x = v0_tcoords[0], tcoords_v1.x = v1_tcoords[0];
-				tcoords_v0.y = v0_tcoords[1], tcoords_v1.y = v1_tcoords[1];
-			}
-			else
-			{
-				tcoords_v0.x = 0, tcoords_v1.x = 0;
-				tcoords_v0.y = 0, tcoords_v1.y = 0;
-			}
-			
-			v0 = _vertex_pass(RL_LINE, v0, color_v0, normals_v0, tcoords_v0);
-			v1 = _vertex_pass(RL_LINE, v1, color_v1, normals_v1, tcoords_v1);
-			
-			if(_rlcore->_mode == RL_LINE || _rlcore->_mode == RL_FILL)
-			{
-				_process_line(v0, v1, color_v0, color_v1, tcoords_v0, tcoords_v1, width_div_2, height_div_2);
-			}
-			else if(_rlcore->_mode == RL_POINT)
-			{
-				_process_point(v0, color_v0, width_div_2, height_div_2);
-				_process_point(v1, color_v1, width_div_2, height_div_2);
-			}
-			
-			v += 2;
-		}
-		if(primitive_type == RL_TRIANGLES)
-		{
-			switch(_rlcore->_vertex_layout)
-			{
-				case RL_V3:
-				case RL_V4:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, NULL, NULL,
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				break;
-				case RL_V3_C4:
-				case RL_V4_C4:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, v2_color, 
-					NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				break;
-				case RL_V3_N3:
-				case RL_V4_N3:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL, 
-					NULL, v1_normals, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, NULL, NULL, 
-					NULL, v2_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				break;
-				case RL_V3_T2:
-				case RL_V4_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v1_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, NULL, NULL, 
-					NULL, NULL, NULL, NULL, v2_tcoords, NULL, NULL);
-				has_position = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_N3_T2:
-				case RL_V4_N3_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, NULL, NULL, 
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, NULL, NULL, 
-					NULL, v1_normals, NULL, NULL, v1_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, NULL, NULL, 
-					NULL, v2_normals, NULL, NULL, v2_tcoords, NULL, NULL);
-				has_position = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3:
-				case RL_V4_C4_N3:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, v0_normals, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, 
-					NULL, NULL, v1_normals, NULL, NULL, NULL, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, v2_color, 
-					NULL, NULL, v2_normals, NULL, NULL, NULL, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				break;
-				case RL_V3_C4_T2:
-				case RL_V4_C4_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, 
-					NULL, NULL, NULL, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, 
-					NULL, NULL, NULL, NULL, NULL, v1_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, v2_color, 
-					NULL, NULL, NULL, NULL, NULL, v2_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_tcoords = true;
-				break;
-				case RL_V3_C4_N3_T2:
-				case RL_V4_C4_N3_T2:
-				_read_vertex(data, vertex_width, elements[v], 1, v0_position, NULL, NULL, v0_color, NULL,
-					NULL, v0_normals, NULL, NULL, v0_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+1], 1, v1_position, NULL, NULL, v1_color, NULL,
-					NULL, v1_normals, NULL, NULL, v1_tcoords, NULL, NULL);
-				_read_vertex(data, vertex_width, elements[v+2], 1, v2_position, NULL, NULL, v2_color, NULL,
-					NULL, v2_normals, NULL, NULL, v2_tcoords, NULL, NULL);
-				has_position = true;
-				has_color = true;
-				has_normals = true;
-				has_tcoords = true;
-				break;
-			}
-			
-			// process v0, v1 & v2
-			// if not has_attrib, default the attribute.
-			
-			rlVec4 color_v0, color_v1, color_v2;
-			rlVec3 normals_v0, normals_v1, normals_v2;
-			rlVec2 tcoords_v0, tcoords_v1, tcoords_v2;
-			
-			rlVec4 v0, v1, v2;
-			v0.x = v0_position[0];
-			v0.y = v0_position[1];
-			v0.z = v0_position[2];
-			v0.w = v0_position[3];
-			v1.x = v1_position[0];
-			v1.y = v1_position[1];
-			v1.z = v1_position[2];
-			v1.w = v1_position[3];
-			v2.x = v2_position[0];
-			v2.y = v2_position[1];
-			v2.z = v2_position[2];
-			v2.w = v2_position[3];
-			
-			if(has_color)
-			{
-				if(v0_color[0] < 0.0f) v0_color[0] = 0.0f;
-				if(v0_color[0] > 1.0f) v0_color[0] = 1.0f;
-				if(v0_color[1] < 0.0f) v0_color[1] = 0.0f;
-				if(v0_color[1] > 1.0f) v0_color[1] = 1.0f;
-				if(v0_color[2] < 0.0f) v0_color[2] = 0.0f;
-				if(v0_color[2] > 1.0f) v0_color[2] = 1.0f;
-				if(v0_color[3] < 0.0f) v0_color[3] = 0.0f;
-				if(v0_color[3] > 1.0f) v0_color[3] = 1.0f;
-				if(v1_color[0] < 0.0f) v1_color[0] = 0.0f;
-				if(v1_color[0] > 1.0f) v1_color[0] = 1.0f;
-				if(v1_color[1] < 0.0f) v1_color[1] = 0.0f;
-				if(v1_color[1] > 1.0f) v1_color[1] = 1.0f;
-				if(v1_color[2] < 0.0f) v1_color[2] = 0.0f;
-				if(v1_color[2] > 1.0f) v1_color[2] = 1.0f;
-				if(v1_color[3] < 0.0f) v1_color[3] = 0.0f;
-				if(v1_color[3] > 1.0f) v1_color[3] = 1.0f;
-				if(v2_color[0] < 0.0f) v2_color[0] = 0.0f;
-				if(v2_color[0] > 1.0f) v2_color[0] = 1.0f;
-				if(v2_color[1] < 0.0f) v2_color[1] = 0.0f;
-				if(v2_color[1] > 1.0f) v2_color[1] = 1.0f;
-				if(v2_color[2] < 0.0f) v2_color[2] = 0.0f;
-				if(v2_color[2] > 1.0f) v2_color[2] = 1.0f;
-				if(v2_color[3] < 0.0f) v2_color[3] = 0.0f;
-				if(v2_color[3] > 1.0f) v2_color[3] = 1.0f;
-				color_v0.x = v0_color[0], color_v1.x = v1_color[0], color_v2.x = v2_color[0];
-				color_v0.y = v0_color[1], color_v1.y = v1_color[1], color_v2.y = v2_color[1];
-				color_v0.z = v0_color[2], color_v1.z = v1_color[2], color_v2.z = v2_color[2];
-				color_v0.w = v0_color[3], color_v1.w = v1_color[3], color_v2.w = v2_color[3];
-			}
-			else
-			{
-				color_v0.x = 0, color_v0.y = 0, color_v0.z = 0, color_v0.w = 1;
-				color_v1.x = 0, color_v1.y = 0, color_v1.z = 0, color_v1.w = 1;
-				color_v2.x = 0, color_v2.y = 0, color_v2.z = 0, color_v2.w = 1;
-			}
-			
-			if(has_normals)
-			{
-				if(v0_normals[0] < 0.0f) v0_normals[0] = 0.0f;
-				if(v0_normals[0] > 1.0f) v0_normals[0] = 1.0f;
-				if(v0_normals[1] < 0.0f) v0_normals[1] = 0.0f;
-				if(v0_normals[1] > 1.0f) v0_normals[1] = 1.0f;
-				if(v0_normals[2] < 0.0f) v0_normals[2] = 0.0f;
-				if(v0_normals[2] > 1.0f) v0_normals[2] = 1.0f;
-				if(v1_normals[0] < 0.0f) v1_normals[0] = 0.0f;
-				if(v1_normals[0] > 1.0f) v1_normals[0] = 1.0f;
-				if(v1_normals[1] < 0.0f) v1_normals[1] = 0.0f;
-				if(v1_normals[1] > 1.0f) v1_normals[1] = 1.0f;
-				if(v1_normals[2] < 0.0f) v1_normals[2] = 0.0f;
-				if(v1_normals[2] > 1.0f) v1_normals[2] = 1.0f;
-				if(v2_normals[0] < 0.0f) v2_normals[0] = 0.0f;
-				if(v2_normals[0] > 1.0f) v2_normals[0] = 1.0f;
-				if(v2_normals[1] < 0.0f) v2_normals[1] = 0.0f;
-				if(v2_normals[1] > 1.0f) v2_normals[1] = 1.0f;
-				if(v2_normals[2] < 0.0f) v2_normals[2] = 0.0f;
-				if(v2_normals[2] > 1.0f) v2_normals[2] = 1.0f;
-				normals_v0.x = v0_normals[0], normals_v1.x = v1_normals[0], normals_v2.x = v2_normals[0];
-				normals_v0.y = v0_normals[1], normals_v1.y = v1_normals[1], normals_v2.y = v2_normals[1];
-				normals_v0.z = v0_normals[2], normals_v1.z = v1_normals[2], normals_v2.z = v2_normals[2];
-			}
-			else
-			{
-				normals_v0.x = 0, normals_v0.y = 0, normals_v0.z = 0;
-				normals_v1.x = 0, normals_v1.y = 0, normals_v1.z = 0;
-				normals_v2.x = 0, normals_v2.y = 0, normals_v2.z = 0;
-			}
-			
-			if(has_tcoords)
-			{
-				if(v0_tcoords[0] < 0.0f) v0_tcoords[0] = 0.0f;
-				if(v0_tcoords[0] > 1.0f) v0_tcoords[0] = 1.0f;
-				if(v0_tcoords[1] < 0.0f) v0_tcoords[1] = 0.0f;
-				if(v0_tcoords[1] > 1.0f) v0_tcoords[1] = 1.0f;
-				if(v1_tcoords[0] < 0.0f) v1_tcoords[0] = 0.0f;
-				if(v1_tcoords[0] > 1.0f) v1_tcoords[0] = 1.0f;
-				if(v1_tcoords[1] < 0.0f) v1_tcoords[1] = 0.0f;
-				if(v1_tcoords[1] > 1.0f) v1_tcoords[1] = 1.0f;
-				if(v2_tcoords[0] < 0.0f) v2_tcoords[0] = 0.0f;
-				if(v2_tcoords[0] > 1.0f) v2_tcoords[0] = 1.0f;
-				if(v2_tcoords[1] < 0.0f) v2_tcoords[1] = 0.0f;
-				if(v2_tcoords[1] > 1.0f) v2_tcoords[1] = 1.0f;
-				tcoords_v0.x = v0_tcoords[0], tcoords_v1.x = v1_tcoords[0], tcoords_v2.x = v2_tcoords[0];
-				tcoords_v0.y = v0_tcoords[1], tcoords_v1.y = v1_tcoords[1], tcoords_v2.y = v2_tcoords[1];
-			}
-			else
-			{
-				tcoords_v0.x = 0, tcoords_v1.x = 0, tcoords_v2.x = 0;
-				tcoords_v0.y = 0, tcoords_v1.y = 0, tcoords_v2.y = 0;
-			}
-			
-			v0 = _vertex_pass(RL_TRIANGLE, v0, color_v0, normals_v0, tcoords_v0);
-			v1 = _vertex_pass(RL_TRIANGLE, v1, color_v1, normals_v1, tcoords_v1);
-			v2 = _vertex_pass(RL_TRIANGLE, v2, color_v2, normals_v2, tcoords_v2);
-			
-			if(_rlcore->_mode == RL_FILL)
-				_process_triangle(v0, v1, v2, color_v0, color_v1, color_v2, tcoords_v0, tcoords_v1, tcoords_v2, width_div_2, height_div_2);
-			if(_rlcore->_mode == RL_LINE)
-			{
-				_process_line(v0, v1, color_v0, color_v1, tcoords_v0, tcoords_v1, width_div_2, height_div_2);
-				_process_line(v1, v2, color_v1, color_v2, tcoords_v1, tcoords_v2, width_div_2, height_div_2);
-				_process_line(v2, v0, color_v2, color_v0, tcoords_v2, tcoords_v0, width_div_2, height_div_2);
-			}
-			else if(_rlcore->_mode == RL_POINT)
-			{
-				_process_point(v0, color_v0, width_div_2, height_div_2);
-				_process_point(v1, color_v1, width_div_2, height_div_2);
-				_process_point(v2, color_v2, width_div_2, height_div_2);
-			}
-			
-			v += 3;
 		}
+		_end_assembly(primitive_type, &assembly);
 	}
+	
+	_rlcore->_instance_id = 0;
+	_rlcore->_instance_attrib.x = 0, _rlcore->_instance_attrib.y = 0, _rlcore->_instance_attrib.z = 0, _rlcore->_instance_attrib.w = 1;
+	
+	_rl_free(_rlcore->_point_attrib_data);
+	_rl_free(_rlcore->_point_attrib_format);
+	_rlcore->_point_attrib_data = NULL;
+	_rlcore->_point_attrib_format = NULL;
+	if(vertices)
+		_rl_free(vertices);
+}
+
+/* draw primitives described by an array instance_count times. instance_data holds instance_width floats per instance (may be NULL) */
+void rlDrawArrayInstanced(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t instance_count, float* instance_data, uint32_t instance_width)
+{
+	if(!_rlcore)
+		return;
+	
+	uint32_t vertex_count = _primitive_vertex_count(primitive_type, primitive_count);
+	if(!vertex_count)
+		// unhandled error: invalid parameter
+		return;
+	
+	_rl_vertex_source_t source;
+	source.data = data, source.type = 0, source.elements = NULL;
+	if(!_compile_vertex_fetch(&source.fetch))
+		// unhandled error: unknown vertex layout
+		return;
+	
+	if(!instance_count)
+		return;
+	
+	_draw_instances(primitive_type, vertex_count, &source, instance_count, instance_data, instance_width);
+}
+
+/* draw primitives described by an array and an index array of type 'type' instance_count times. instance_data holds instance_width floats per instance (may be NULL) */
+void rlDrawElementsInstanced(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t type, void* elements, uint32_t instance_count, float* instance_data, uint32_t instance_width)
+{
+	if(!_rlcore)
+		return;
+	
+	uint32_t vertex_count = _primitive_vertex_count(primitive_type, primitive_count);
+	if(!vertex_count)
+		// unhandled error: invalid parameter
+		return;
+	
+	if(type != RL_UNSIGNED_BYTE && type != RL_UNSIGNED_SHORT && type != RL_UNSIGNED_INT)
+		// unhandled error: invalid parameter
+		return;
+	
+	_rl_vertex_source_t source;
+	source.data = data, source.type = type, source.elements = elements;
+	if(!_compile_vertex_fetch(&source.fetch))
+		// unhandled error: unknown vertex layout
+		return;
+	
+	if(!instance_count)
+		return;
+	
+	_draw_instances(primitive_type, vertex_count, &source, instance_count, instance_data, instance_width);
+}
+
+/* draw primitives described by an array */
+void rlDrawArray(uint32_t primitive_type, uint32_t primitive_count, float* data)
+{
+	rlDrawArrayInstanced(primitive_type, primitive_count, data, 1, NULL, 0);
+}
+
+/* draw primitives described by an array and an index array */
+void rlDrawElements(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t* elements)
+{
+	rlDrawElementsInstanced(primitive_type, primitive_count, data, RL_UNSIGNED_INT, elements, 1, NULL, 0);
+}
+
+/* draw primitives described by an array and an index array of type RL_UNSIGNED_BYTE, RL_UNSIGNED_SHORT or RL_UNSIGNED_INT */
+void rlDrawElementsTyped(uint32_t primitive_type, uint32_t primitive_count, float* data, uint32_t type, void* elements)
+{
+	rlDrawElementsInstanced(primitive_type, primitive_count, data, type, elements, 1, NULL, 0);
 }
 
 /* enable a state. */
@@ -4345,6 +3188,12 @@ void rlEnable(uint32_t state)
 		case RL_TEXCOORD_ARRAY:
 			_rlcore->_sh_texcoord_array = true;
 			break;
+		case RL_INSTANCE_ID:
+			_rlcore->_sh_instance_id = true;
+			break;
+		case RL_INSTANCE_ARRAY:
+			_rlcore->_sh_instance_array = true;
+			break;
 		case RL_PRIMARY_COLOR:
 			_rlcore->_sh_primary_color = true;
 			break;
@@ -4440,6 +3289,12 @@ void rlDisable(uint32_t state)
 		case RL_TEXCOORD_ARRAY:
 			_rlcore->_sh_texcoord_array = false;
 			break;
+		case RL_INSTANCE_ID:
+			_rlcore->_sh_instance_id = false;
+			break;
+		case RL_INSTANCE_ARRAY:
+			_rlcore->_sh_instance_array = false;
+			break;
 		case RL_PRIMARY_COLOR:
 			_rlcore->_sh_primary_color = false;
 			break;
@@ -4521,6 +3376,10 @@ bool rlIsEnabled(uint32_t state)
 			return _rlcore->_sh_normal_array;
 		case RL_TEXCOORD_ARRAY:
 			return _rlcore->_sh_texcoord_array;
+		case RL_INSTANCE_ID:
+			return _rlcore->_sh_instance_id;
+		case RL_INSTANCE_ARRAY:
+			return _rlcore->_sh_instance_array;
 		case RL_PRIMARY_COLOR:
 			return _rlcore->_sh_primary_color;
 		case RL_SECONDARY_COLOR:
@@ -4628,17 +3487,17 @@ void rlCreateBuffer(uint32_t type, uint32_t width, uint32_t height, void** buffe
 	{
 		case RL_RGB16:
 		case RL_RGBA16:
-			*((uint16_t**)buffer) = (uint16_t*) calloc(width*height, sizeof(uint16_t));
+			*((uint16_t**)buffer) = (uint16_t*) _rl_calloc(width*height, sizeof(uint16_t));
 			break;
 		case RL_RGB32:
 		case RL_RGBA32:
-			*((uint32_t**)buffer) = (uint32_t*) calloc(width*height, sizeof(uint32_t));
+			*((uint32_t**)buffer) = (uint32_t*) _rl_calloc(width*height, sizeof(uint32_t));
 			break;
 		case RL_D16:
-			*((uint16_t**)buffer) = (uint16_t*) calloc(width*height, sizeof(uint16_t));
+			*((uint16_t**)buffer) = (uint16_t*) _rl_calloc(width*height, sizeof(uint16_t));
 			break;
 		case RL_D32:
-			*((uint32_t**)buffer) = (uint32_t*) calloc(width*height, sizeof(uint32_t));
+			*((uint32_t**)buffer) = (uint32_t*) _rl_calloc(width*height, sizeof(uint32_t));
 			break;
 		default:
 			// unhandled error: invalid buffer type
@@ -4646,6 +3505,12 @@ void rlCreateBuffer(uint32_t type, uint32_t width, uint32_t height, void** buffe
 	}
 }
 
+/* free a display buffer allocated by rlCreateBuffer. */
+void rlFreeBuffer(void* buffer)
+{
+	_rl_free(buffer);
+}
+
 /* bind a display buffer to front set. Buffer must have same dimensions as any already bound. 'type' is a depth or pixel format. */
 void rlBindBuffer(uint32_t type, uint32_t width, uint32_t height, void* buffer)
 {
@@ -5017,10 +3882,80 @@ void rlBindShader(uint32_t type, void* shader)
 	}
 }
 
+// 4-wide vectors for matrix math. products are sums of rows (or columns) scaled by broadcast elements, added in
+// the same order as the scalar code, so both give identical results as long as the compiler doesn't contract
+// the scalar code to fused multiply-adds.
+#if defined(__SSE2__)
+#define _RL_SIMD_MATH
+typedef __m128 _rl_f4;
+#define _RL_LOAD4(p)		_mm_loadu_ps(p)
+#define _RL_STORE4(p,v)		_mm_storeu_ps(p, v)
+#define _RL_LANE4(v,i)		_mm_shuffle_ps(v, v, _MM_SHUFFLE(i,i,i,i))
+#define _RL_ADD4(a,b)		_mm_add_ps(a, b)
+#define _RL_MUL4(a,b)		_mm_mul_ps(a, b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define _RL_SIMD_MATH
+typedef float32x4_t _rl_f4;
+#define _RL_LOAD4(p)		vld1q_f32(p)
+#define _RL_STORE4(p,v)		vst1q_f32(p, v)
+#define _RL_LANE4(v,i)		vdupq_n_f32(vgetq_lane_f32(v, i))
+#define _RL_ADD4(a,b)		vaddq_f32(a, b)
+#define _RL_MUL4(a,b)		vmulq_f32(a, b)
+#endif
+
+#ifdef _RL_SIMD_MATH
+/* (x*c0 + y*c1) + z*c2 + w*c3, where x,y,z,w are the elements of v */
+static inline _rl_f4 _rl_combine4(_rl_f4 v, _rl_f4 c0, _rl_f4 c1, _rl_f4 c2, _rl_f4 c3)
+{
+	return _RL_ADD4(_RL_ADD4(_RL_ADD4(_RL_MUL4(_RL_LANE4(v,0), c0), _RL_MUL4(_RL_LANE4(v,1), c1)),
+		_RL_MUL4(_RL_LANE4(v,2), c2)), _RL_MUL4(_RL_LANE4(v,3), c3));
+}
+
+/* p = a * b, of row-major matrices. p may be a or b */
+void _rl_mat4_mul(const float* a, const float* b, float* p)
+{
+#ifdef __AVX__
+	// two rows at once
+	__m256 b0 = _mm256_broadcast_ps((const __m128*)(b));
+	__m256 b1 = _mm256_broadcast_ps((const __m128*)(b+4));
+	__m256 b2 = _mm256_broadcast_ps((const __m128*)(b+8));
+	__m256 b3 = _mm256_broadcast_ps((const __m128*)(b+12));
+	for(uint32_t i = 0; i < 16; i += 8)
+	{
+		__m256 r = _mm256_loadu_ps(a + i);
+		r = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(r, 0x00), b0),
+			_mm256_mul_ps(_mm256_permute_ps(r, 0x55), b1)), _mm256_mul_ps(_mm256_permute_ps(r, 0xAA), b2)),
+			_mm256_mul_ps(_mm256_permute_ps(r, 0xFF), b3));
+		_mm256_storeu_ps(p + i, r);
+	}
+#else
+	_rl_f4 b0 = _RL_LOAD4(b), b1 = _RL_LOAD4(b+4), b2 = _RL_LOAD4(b+8), b3 = _RL_LOAD4(b+12);
+	for(uint32_t i = 0; i < 16; i += 4)
+		_RL_STORE4(p + i, _rl_combine4(_RL_LOAD4(a + i), b0, b1, b2, b3));
+#endif
+}
+
+/* get the columns of a row-major matrix */
+void _rl_mat4_columns(const float* m, _rl_f4* c)
+{
+#if defined(__SSE2__)
+	__m128 r0 = _mm_loadu_ps(m), r1 = _mm_loadu_ps(m+4), r2 = _mm_loadu_ps(m+8), r3 = _mm_loadu_ps(m+12);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	c[0] = r0, c[1] = r1, c[2] = r2, c[3] = r3;
+#else
+	float32x4x4_t t = vld4q_f32(m);
+	c[0] = t.val[0], c[1] = t.val[1], c[2] = t.val[2], c[3] = t.val[3];
+#endif
+}
+#endif
+
 /* compute a * b */
 rlMat4 rlMat4Mat4(rlMat4 a, rlMat4 b)
 {
 	rlMat4 p;
+#ifdef _RL_SIMD_MATH
+	_rl_mat4_mul(&a.m00, &b.m00, &p.m00);
+#else
 	// first row
 	p.m00 = a.m00*b.m00 + a.m01*b.m10 + a.m02*b.m20 + a.m03*b.m30;
 	p.m01 = a.m00*b.m01 + a.m01*b.m11 + a.m02*b.m21 + a.m03*b.m31;
@@ -5041,6 +3976,7 @@ rlMat4 rlMat4Mat4(rlMat4 a, rlMat4 b)
 	p.m31 = a.m30*b.m01 + a.m31*b.m11 + a.m32*b.m21 + a.m33*b.m31;
 	p.m32 = a.m30*b.m02 + a.m31*b.m12 + a.m32*b.m22 + a.m33*b.m32;
 	p.m33 = a.m30*b.m03 + a.m31*b.m13 + a.m32*b.m23 + a.m33*b.m33;	
+#endif
 	return p;
 }
 
@@ -5048,13 +3984,65 @@ rlMat4 rlMat4Mat4(rlMat4 a, rlMat4 b)
 rlVec4 rlMat4Vec4(rlMat4 m, rlVec4 v)
 {
 	rlVec4 prod;
+#ifdef _RL_SIMD_MATH
+	_rl_f4 c[4];
+	_rl_mat4_columns(&m.m00, c);
+	_RL_STORE4(&prod.x, _rl_combine4(_RL_LOAD4(&v.x), c[0], c[1], c[2], c[3]));
+#else
 	prod.x = m.m00 * v.x + m.m01 * v.y + m.m02 * v.z + m.m03 * v.w;
 	prod.y = m.m10 * v.x + m.m11 * v.y + m.m12 * v.z + m.m13 * v.w;
 	prod.z = m.m20 * v.x + m.m21 * v.y + m.m22 * v.z + m.m23 * v.w;
 	prod.w = m.m30 * v.x + m.m31 * v.y + m.m32 * v.z + m.m33 * v.w;
+#endif
 	return prod;
 }
 
+/* compute out[i] = m * in[i] for 'count' vectors. 'out' may be 'in' */
+void rlMat4Vec4Array(rlMat4* m, rlVec4* in, rlVec4* out, uint32_t count)
+{
+	if(!m || !in || !out)
+		return;
+	uint32_t i = 0;
+#ifdef _RL_SIMD_MATH
+	_rl_f4 c[4];
+	_rl_mat4_columns(&m->m00, c);
+#ifdef __AVX__
+	// two vectors at once
+	__m256 c0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[0]), c[0], 1);
+	__m256 c1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[1]), c[1], 1);
+	__m256 c2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[2]), c[2], 1);
+	__m256 c3 = _mm256_insertf128_ps(_mm256_castps128_ps256(c[3]), c[3], 1);
+	for(; i + 2 <= count; i += 2)
+	{
+		__m256 v = _mm256_loadu_ps(&in[i].x);
+		v = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(v, 0x00), c0),
+			_mm256_mul_ps(_mm256_permute_ps(v, 0x55), c1)), _mm256_mul_ps(_mm256_permute_ps(v, 0xAA), c2)),
+			_mm256_mul_ps(_mm256_permute_ps(v, 0xFF), c3));
+		_mm256_storeu_ps(&out[i].x, v);
+	}
+#endif
+	for(; i < count; i += 1)
+		_RL_STORE4(&out[i].x, _rl_combine4(_RL_LOAD4(&in[i].x), c[0], c[1], c[2], c[3]));
+#endif
+	for(; i < count; i += 1)
+		out[i] = rlMat4Vec4(*m, in[i]);
+}
+
+/* compute out[i] = a[i] * b[i] for 'count' pairs of matrices. 'out' may be 'a' or 'b' */
+void rlMat4Mat4Array(rlMat4* a, rlMat4* b, rlMat4* out, uint32_t count)
+{
+	if(!a || !b || !out)
+		return;
+	for(uint32_t i = 0; i < count; i += 1)
+	{
+#ifdef _RL_SIMD_MATH
+		_rl_mat4_mul(&a[i].m00, &b[i].m00, &out[i].m00);
+#else
+		out[i] = rlMat4Mat4(a[i], b[i]);
+#endif
+	}
+}
+
 /* calculate a symmetrical-frustum projection matrix */
 rlMat4 rlPerspective(float fovy, float aspect, float near, float far)
 {
@@ -5233,6 +4221,84 @@ rlMat4 rlTranslate(rlVec3 translation)
 	return mtranslation;
 }
 
+/* set the allocator used for all memory allocated by RL, including contexts and display buffers. NULL restores the default (aligned_alloc and free) */
+void rlSetAllocator(rlAllocator* allocator)
+{
+	if(allocator && allocator->alloc && allocator->free)
+		_rlallocator = *allocator;
+	else
+	{
+		_rlallocator.alloc = _rl_default_alloc;
+		_rlallocator.free = _rl_default_free;
+		_rlallocator.user = NULL;
+	}
+}
+
+// huge page allocation callbacks (see rlHugePageAllocator). not to be used directly
+void* _rl_huge_page_alloc(size_t size, size_t alignment, void* user)
+{
+#ifdef __linux__
+	// every block this large is mapped, so _rl_huge_page_free can tell mapped blocks by size alone
+	if(size >= RL_HUGE_PAGE_SIZE)
+	{
+		size = (size + RL_HUGE_PAGE_SIZE-1) & ~(size_t)(RL_HUGE_PAGE_SIZE-1);
+		if(alignment <= RL_HUGE_PAGE_SIZE)
+		{
+			void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if(ptr != MAP_FAILED)
+				return ptr;
+		}
+		// no reserved huge pages (or a larger alignment); map an aligned range and ask for transparent huge pages
+		size_t align = alignment > RL_HUGE_PAGE_SIZE ? alignment : RL_HUGE_PAGE_SIZE;
+		uint8_t* base = (uint8_t*) mmap(NULL, size + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(base == MAP_FAILED)
+			return NULL;
+		uint8_t* aligned = (uint8_t*)(((uintptr_t)base + align-1) & ~(uintptr_t)(align-1));
+		if(aligned != base)
+			munmap(base, aligned - base);
+		munmap(aligned + size, base + align - aligned);
+		madvise(aligned, size, MADV_HUGEPAGE);
+		return aligned;
+	}
+#endif
+	return _rl_default_alloc(size, alignment, user);
+}
+
+void _rl_huge_page_free(void* ptr, size_t size, void* user)
+{
+#ifdef __linux__
+	if(size >= RL_HUGE_PAGE_SIZE)
+	{
+		munmap(ptr, (size + RL_HUGE_PAGE_SIZE-1) & ~(size_t)(RL_HUGE_PAGE_SIZE-1));
+		return;
+	}
+#endif
+	_rl_default_free(ptr, size, user);
+}
+
+/* get an allocator backing allocations of RL_HUGE_PAGE_SIZE bytes or more with huge pages (linux only) */
+rlAllocator* rlHugePageAllocator()
+{
+	static rlAllocator allocator = { _rl_huge_page_alloc, _rl_huge_page_free, NULL };
+	return &allocator;
+}
+
+/* get the bytes currently allocated by the current context, including its buffers */
+uint64_t rlAllocatedBytes()
+{
+	if(!_rlcore)
+		return 0;
+	return __atomic_load_n(&_rlcore->_allocated_bytes, __ATOMIC_RELAXED);
+}
+
+/* get the most bytes allocated by the current context at once */
+uint64_t rlPeakAllocatedBytes()
+{
+	if(!_rlcore)
+		return 0;
+	return __atomic_load_n(&_rlcore->_peak_allocated_bytes, __ATOMIC_RELAXED);
+}
+
 /* get an identity matrix */
 rlMat4 rlIdentity()
 {